@@ -30,6 +30,15 @@
 #include "colorEncoding.h"
 #include <math.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 using namespace QCV;
 
@@ -37,7 +46,10 @@ CColorEncoding::CColorEncoding( const EColorEncodingType_t f_type_e,
                                 S2D<float>                 f_range )
         : m_encodingType_e( f_type_e ),
           m_range (          f_range ),
-          m_logarithmic (      false )
+          m_logarithmic (      false ),
+          m_lut (                   ),
+          m_lutOffset_f (        0.f ),
+          m_lutScale_f (         0.f )
 {
     recomputeLut();
 }
@@ -421,6 +433,10 @@ CColorEncoding::encodeHue ( const float   f_value_f,
     if (f_inverse_b)
         val_f = 360-val_f;
 
+    /// Wrap around, so that the maximum gets the color of the minimum.
+    val_f = fmodf ( val_f, 360.f );
+    if ( val_f < 0 ) val_f += 360.f;
+
     SHsv color ( val_f, .75f, .8f);
     
     fr_color = CColor::getRgbFromHsv ( color );
@@ -451,9 +467,11 @@ bool
 CColorEncoding::setMinMaxRange ( S2D<float> f_range )
 {
     if ( m_range != f_range )
+    {
+        m_range = f_range;
         recomputeLut();
+    }
 
-    m_range = f_range;
     return true;    
 }
 
@@ -471,9 +489,11 @@ bool
 CColorEncoding::setMinimum ( float f_min_f )
 {
     if (m_range.min != f_min_f )
+    {
+        m_range.min = f_min_f;
         recomputeLut();
+    }
 
-    m_range.min = f_min_f;
     return true;    
 }
 
@@ -489,9 +509,11 @@ bool
 CColorEncoding::setMaximum ( float f_max_f )
 {
     if (m_range.max != f_max_f )
+    {
+        m_range.max = f_max_f;
         recomputeLut();
+    }
 
-    m_range.max = f_max_f;
     return true;    
 }
 
@@ -506,7 +528,12 @@ CColorEncoding::getMaximum ( ) const
 bool
 CColorEncoding::setLogarithmic ( bool f_log_b )
 {
-    m_logarithmic = f_log_b;
+    if ( m_logarithmic != f_log_b )
+    {
+        m_logarithmic = f_log_b;
+        recomputeLut();
+    }
+
     return true;
 }
 
@@ -521,32 +548,341 @@ bool
 CColorEncoding::setColorEncodingType( EColorEncodingType_t f_newType_e )
 {
     if ( m_encodingType_e !=  f_newType_e )
+    {
+        m_encodingType_e =  f_newType_e;
         recomputeLut();
+    }
 
-    m_encodingType_e =  f_newType_e;
     return true;
 }
 
 void
 CColorEncoding::recomputeLut()
 {
-    m_lut.clear();
-    
-    float val_f = m_range.min;
-    m_dx_f = (m_range.max-m_range.min)/512.f;
-    
+    computeLut ( m_range, m_lut, m_lutOffset_f, m_lutScale_f );
+}
+
+/// Pack a color as blue, green, red and a zero byte, so that it can be
+/// written as a 4 byte word into a BGR image.
+static inline uint32_t packColor ( const SRgb & f_color )
+{
+    const uint8_t bgr_p[4] = { f_color.b, f_color.g, f_color.r, 0 };
+    uint32_t packed_ui;
+    memcpy ( &packed_ui, bgr_p, 4 );
+    return packed_ui;
+}
+
+void
+CColorEncoding::computeLut ( const S2D<float>        f_range,
+                             std::vector<uint32_t> & fr_lut_v,
+                             float &                 fr_offset_f,
+                             float &                 fr_scale_f ) const
+{
+    float min_f = m_logarithmic ? log10f ( f_range.min ) : f_range.min;
+    float max_f = m_logarithmic ? log10f ( f_range.max ) : f_range.max;
+
+    /// The dark green encodings keep changing up to 2.5 times the
+    /// range beyond one of its ends (see encodeRed2DarkGreen).
+    if ( m_encodingType_e == CET_RED2DARKGREEN )
+        max_f = min_f + 2.5f * ( max_f - min_f );
+    else if ( m_encodingType_e == CET_GREEN2DARKRED )
+        min_f = max_f - 2.5f * ( max_f - min_f );
+
+    const float dx_f  = ( max_f - min_f ) / ( CCE_LUT_SIZE - 1 );
+
+    fr_offset_f = min_f;
+    fr_scale_f  = ( dx_f != 0.f && dx_f == dx_f ) ? 1.f / dx_f : 0.f;
+    fr_lut_v.resize ( CCE_LUT_SIZE );
+
     SRgb color;
 
-    for (int i = 0; i < 512; ++i, val_f += m_dx_f)
+    for (int i = 0; i < CCE_LUT_SIZE; ++i)
     {
-        colorFromValue ( val_f,
-                         m_range.min,
-                         m_range.max,
-                         color );
-        m_lut.push_back ( color );
-    }    
+        /// Evaluate at the last entry exactly at the maximum.
+        const float x_f   = i == CCE_LUT_SIZE - 1 ? max_f : min_f + i * dx_f;
+        const float val_f = m_logarithmic ? powf ( 10.f, x_f ) : x_f;
 
-    m_lut.push_back ( color );
+        if ( !colorFromValue ( val_f,
+                               f_range.min,
+                               f_range.max,
+                               color ) )
+            color = SRgb ( 0, 0, 0 );
+
+        fr_lut_v[i] = packColor ( color );
+    }
 }
 
+/// Write the color of entry f_idx_i of the lookup table into a BGR
+/// pixel. Four bytes are written, so the caller must only use it if
+/// another pixel follows in the row.
+static inline void storeColor4 ( uint8_t *        fr_dst_p,
+                                 const uint32_t * f_lut_p,
+                                 int              f_idx_i )
+{
+    memcpy ( fr_dst_p, f_lut_p + f_idx_i, 4 );
+}
+
+static inline void storeColor3 ( uint8_t *        fr_dst_p,
+                                 const uint32_t * f_lut_p,
+                                 int              f_idx_i )
+{
+    memcpy ( fr_dst_p, f_lut_p + f_idx_i, 3 );
+}
+
+/// Lookup table index of a value already transformed to the lookup
+/// table scale. NaN values go to the first entry.
+static inline int lutIndex ( float f_x_f )
+{
+    if ( !( f_x_f >= 0.f ) )
+        return 0;
+    if ( f_x_f > CCE_LUT_SIZE - 1 )
+        return CCE_LUT_SIZE - 1;
+    return (int) ( f_x_f + .5f );
+}
+
+/// Encode a row of f_size_i values. The values are transformed to
+/// (value - f_offset_f) * f_scale_f, or to (log10(value) - f_offset_f) *
+/// f_scale_f if logarithmic, and rounded to a lookup table index.
+template <class Type_>
+static void encodeRow ( const Type_ *    f_src_p,
+                        uint8_t *        fr_dst_p,
+                        int              f_size_i,
+                        int              f_first_i,
+                        const uint32_t * f_lut_p,
+                        float            f_offset_f,
+                        float            f_scale_f,
+                        bool             f_log_b )
+{
+    int i = f_first_i;
+
+    if ( f_log_b )
+    {
+        for (; i < f_size_i - 1; ++i)
+            storeColor4 ( fr_dst_p + 3 * i, f_lut_p,
+                          lutIndex ( ( log10f ( (float) f_src_p[i] ) - f_offset_f ) * f_scale_f ) );
+    }
+    else
+    {
+        for (; i < f_size_i - 1; ++i)
+            storeColor4 ( fr_dst_p + 3 * i, f_lut_p,
+                          lutIndex ( ( (float) f_src_p[i] - f_offset_f ) * f_scale_f ) );
+    }
+
+    if ( i < f_size_i )
+    {
+        const float val_f = f_log_b ? log10f ( (float) f_src_p[i] ) : (float) f_src_p[i];
+        storeColor3 ( fr_dst_p + 3 * i, f_lut_p,
+                      lutIndex ( ( val_f - f_offset_f ) * f_scale_f ) );
+    }
+}
+
+#if defined ( __SSE2__ )
+/// Lookup table indices of 4 values with the same rounding and NaN
+/// handling as lutIndex.
+static inline void lutIndices4 ( __m128   f_val,
+                                 __m128   f_offset,
+                                 __m128   f_scale,
+                                 int *    fr_idx_p )
+{
+    const __m128 x = _mm_mul_ps ( _mm_sub_ps ( f_val, f_offset ), f_scale );
+
+    /// max returns the second operand if the first is NaN.
+    const __m128 c = _mm_min_ps ( _mm_max_ps ( x, _mm_setzero_ps() ),
+                                  _mm_set1_ps ( (float) ( CCE_LUT_SIZE - 1 ) ) );
+
+    _mm_storeu_si128 ( (__m128i *) fr_idx_p,
+                       _mm_cvttps_epi32 ( _mm_add_ps ( c, _mm_set1_ps ( .5f ) ) ) );
+}
+
+/// Vectorized index computation for short and float rows. Returns the
+/// first value not encoded. The last value of the row is always left
+/// for the scalar code.
+static int encodeRowSIMD ( const float *    f_src_p,
+                           uint8_t *        fr_dst_p,
+                           int              f_size_i,
+                           const uint32_t * f_lut_p,
+                           float            f_offset_f,
+                           float            f_scale_f )
+{
+    const __m128 offset = _mm_set1_ps ( f_offset_f );
+    const __m128 scale  = _mm_set1_ps ( f_scale_f );
+    int idx_p[4];
+    int i = 0;
+
+    for (; i + 4 < f_size_i; i += 4)
+    {
+        lutIndices4 ( _mm_loadu_ps ( f_src_p + i ), offset, scale, idx_p );
+
+        for (int k = 0; k < 4; ++k)
+            storeColor4 ( fr_dst_p + 3 * ( i + k ), f_lut_p, idx_p[k] );
+    }
+
+    return i;
+}
 
+static int encodeRowSIMD ( const short *    f_src_p,
+                           uint8_t *        fr_dst_p,
+                           int              f_size_i,
+                           const uint32_t * f_lut_p,
+                           float            f_offset_f,
+                           float            f_scale_f )
+{
+    const __m128 offset = _mm_set1_ps ( f_offset_f );
+    const __m128 scale  = _mm_set1_ps ( f_scale_f );
+    int idx_p[8];
+    int i = 0;
+
+    for (; i + 8 < f_size_i; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128 ( (const __m128i *) ( f_src_p + i ) );
+
+        /// Sign extension of the 8 values to two vectors of 4 ints.
+        lutIndices4 ( _mm_cvtepi32_ps ( _mm_srai_epi32 ( _mm_unpacklo_epi16 ( v, v ), 16 ) ),
+                      offset, scale, idx_p );
+        lutIndices4 ( _mm_cvtepi32_ps ( _mm_srai_epi32 ( _mm_unpackhi_epi16 ( v, v ), 16 ) ),
+                      offset, scale, idx_p + 4 );
+
+        for (int k = 0; k < 8; ++k)
+            storeColor4 ( fr_dst_p + 3 * ( i + k ), f_lut_p, idx_p[k] );
+    }
+
+    return i;
+}
+#endif
+
+template <class Type_>
+static int encodeRowSIMD ( const Type_ *    /* f_src_p */,
+                           uint8_t *        /* fr_dst_p */,
+                           int              /* f_size_i */,
+                           const uint32_t * /* f_lut_p */,
+                           float            /* f_offset_f */,
+                           float            /* f_scale_f */ )
+{
+    return 0;
+}
+
+/// Encode all rows of an image in parallel.
+template <class Type_>
+static void encodeRows ( const cv::Mat &  f_src,
+                         cv::Mat &        fr_dst,
+                         const uint32_t * f_lut_p,
+                         float            f_offset_f,
+                         float            f_scale_f,
+                         bool             f_log_b )
+{
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(static)
+#endif
+    for (int i = 0; i < f_src.rows; ++i)
+    {
+        const Type_ * src_p = f_src.ptr<Type_>(i);
+        uint8_t *     dst_p = fr_dst.ptr<uint8_t>(i);
+
+        const int first_i = f_log_b ? 0 : encodeRowSIMD ( src_p, dst_p, f_src.cols,
+                                                          f_lut_p, f_offset_f, f_scale_f );
+
+        encodeRow<Type_> ( src_p, dst_p, f_src.cols, first_i,
+                           f_lut_p, f_offset_f, f_scale_f, f_log_b );
+    }
+}
+
+bool
+CColorEncoding::encodeImage ( const cv::Mat &  f_src,
+                              cv::Mat &        fr_dst ) const
+{
+    return encodeImage ( f_src, fr_dst, m_range );
+}
+
+bool
+CColorEncoding::encodeImage ( const cv::Mat &  f_src,
+                              cv::Mat &        fr_dst,
+                              const S2D<float> f_range ) const
+{
+    if ( f_src.channels() != 1 )
+    {
+        printf("%s:%i Only single channel images can be color encoded.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    if ( m_encodingType_e == CET_INVALID )
+        return false;
+
+    if ( f_src.data == fr_dst.data )
+    {
+        printf("%s:%i In-place color encoding is not allowed.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    fr_dst.create ( f_src.size(), CV_8UC3 );
+
+    const int depth_i = f_src.depth();
+
+    if ( depth_i == CV_8U || depth_i == CV_8S )
+    {
+        /// One entry per value, so that 8 bit images are encoded exactly.
+        uint32_t lut_p[256];
+        SRgb     color;
+
+        for (int i = 0; i < 256; ++i)
+        {
+            const float val_f = depth_i == CV_8U ? i : i - 128;
+
+            if ( !colorFromValue ( val_f, f_range.min, f_range.max, color ) )
+                color = SRgb ( 0, 0, 0 );
+
+            lut_p[i] = packColor ( color );
+        }
+
+        /// Signed values are shifted to [0, 255].
+        if ( depth_i == CV_8U )
+            encodeRows<uint8_t> ( f_src, fr_dst, lut_p, 0.f, 1.f, false );
+        else
+            encodeRows<int8_t>  ( f_src, fr_dst, lut_p, -128.f, 1.f, false );
+
+        return true;
+    }
+
+    std::vector<uint32_t>   lut_v;
+    const uint32_t *        lut_p    = &m_lut[0];
+    float                   offset_f = m_lutOffset_f;
+    float                   scale_f  = m_lutScale_f;
+
+    if ( f_range != m_range )
+    {
+        computeLut ( f_range, lut_v, offset_f, scale_f );
+        lut_p = &lut_v[0];
+    }
+
+    switch ( depth_i )
+    {
+        case CV_16U:
+            encodeRows<uint16_t> ( f_src, fr_dst, lut_p, offset_f, scale_f, m_logarithmic );
+            break;
+
+        case CV_16S:
+            encodeRows<short>    ( f_src, fr_dst, lut_p, offset_f, scale_f, m_logarithmic );
+            break;
+
+        case CV_32S:
+            encodeRows<int>      ( f_src, fr_dst, lut_p, offset_f, scale_f, m_logarithmic );
+            break;
+
+        case CV_32F:
+            encodeRows<float>    ( f_src, fr_dst, lut_p, offset_f, scale_f, m_logarithmic );
+            break;
+
+        case CV_64F:
+            encodeRows<double>   ( f_src, fr_dst, lut_p, offset_f, scale_f, m_logarithmic );
+            break;
+
+        default:
+            printf("%s:%i Unsupported image type for color encoding.\n",
+                   __FILE__, __LINE__ );
+            return false;
+    }
+
+    return true;
+}
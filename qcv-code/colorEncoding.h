@@ -36,6 +36,13 @@
 
 #include <string>
 #include <vector>
+#include <string.h>
+#include <math.h>
+
+/* CONSTANTS */
+/// Entries of the lookup table used to encode values and non 8 bit
+/// images.
+#define CCE_LUT_SIZE 4096
 
 namespace QCV
 {
@@ -100,6 +107,19 @@ namespace QCV
         bool       colorFromValue(    const float      f_value_f,
                                       SRgb            &fr_color ) const;
 
+    //// Image transformations.
+    public:
+        // Encode a single channel image (CV_8U, CV_8S, CV_16U, CV_16S,
+        // CV_32S, CV_32F or CV_64F) into a CV_8UC3 image with OpenCV's
+        // BGR channel order using preset range.
+        bool       encodeImage (      const cv::Mat &  f_src,
+                                      cv::Mat &        fr_dst ) const;
+
+        // Encode a single channel image using given range.
+        bool       encodeImage (      const cv::Mat &  f_src,
+                                      cv::Mat &        fr_dst,
+                                      const S2D<float> f_range ) const;
+
 
     /// Parameters.
     public:
@@ -137,6 +157,17 @@ namespace QCV
         // Set the min and max range.
         bool                 getLogarithmic ( ) const;
 
+        // Lookup table for the preset range. Colors are packed as
+        // blue, green, red and a zero byte.
+        const std::vector<uint32_t> &
+                             getLut ( ) const { return m_lut; }
+
+        // Value (or logarithm) of the first lookup table entry.
+        float                getLutOffset ( ) const { return m_lutOffset_f; }
+
+        // Lookup table entries per unit of value (or logarithm).
+        float                getLutScale ( ) const { return m_lutScale_f; }
+
     /// Help static methods
     protected:
         
@@ -202,7 +233,15 @@ namespace QCV
     protected:
 
         void recomputeLut();
-        
+
+        /// Compute the lookup table for the given range. Entry i is the
+        /// color of the value offset + i / scale (or of the value whose
+        /// logarithm it is if the encoding is logarithmic).
+        void computeLut ( const S2D<float>        f_range,
+                          std::vector<uint32_t> & fr_lut_v,
+                          float &                 fr_offset_f,
+                          float &                 fr_scale_f ) const;
+
         bool colorFromValueLUT ( const float   f_value_f,
                                  SRgb         &fr_color ) const;
     private:
@@ -216,11 +255,15 @@ namespace QCV
         /// Logarithmic?
         bool                  m_logarithmic;
 
-        /// Lookup table
-        std::vector<SRgb>     m_lut;
+        /// Lookup table for the preset range. Colors are packed as
+        /// blue, green, red and a zero byte.
+        std::vector<uint32_t> m_lut;
+
+        /// Value of the first lookup table entry
+        float                 m_lutOffset_f;
 
-        /// Normalized range
-        float                 m_dx_f;
+        /// Lookup table entries per unit of value
+        float                 m_lutScale_f;
         
         
     };
@@ -229,15 +272,18 @@ namespace QCV
     CColorEncoding::colorFromValueLUT ( const float   f_value_f,
                                         SRgb         &fr_color ) const
     {
-        if (f_value_f <= m_range.min )
-            fr_color = m_lut.front();
-        else if (f_value_f >= m_range.max )
-            fr_color = m_lut.back();
-        else
-        {
-            int idx_i = (f_value_f - m_range.min) / m_dx_f;
-            fr_color = m_lut[idx_i];
-        }
+        float x_f = ( ( m_logarithmic ? log10f ( f_value_f ) : f_value_f ) -
+                      m_lutOffset_f ) * m_lutScale_f;
+
+        /// Written to also send NaN to the first entry.
+        if ( !( x_f >= 0.f ) )
+            x_f = 0.f;
+        else if ( x_f > CCE_LUT_SIZE - 1 )
+            x_f = CCE_LUT_SIZE - 1;
+
+        uint8_t bgr_p[4];
+        memcpy ( bgr_p, &m_lut[(int)(x_f + .5f)], 4 );
+        fr_color = SRgb ( bgr_p[2], bgr_p[1], bgr_p[0] );
         
         return true;
     }
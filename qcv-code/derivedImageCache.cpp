@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose. 
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file derivedImageCache.cpp
+ *
+ * \class CDerivedImageCache
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Frame scoped cache of images derived from the input images.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <stdio.h>
+
+#include "derivedImageCache.h"
+
+using namespace QCV;
+
+CDerivedImageCache::SImageDesc &
+CDerivedImageCache::SImageDesc::gray ( )
+{
+    SOperation op = { OT_GRAY, 0, 1.f };
+    ops_v.push_back ( op );
+    return *this;
+}
+
+CDerivedImageCache::SImageDesc &
+CDerivedImageCache::SImageDesc::level ( unsigned int f_level_ui )
+{
+    if ( f_level_ui > 0 )
+    {
+        SOperation op = { OT_LEVEL, (int) f_level_ui, 1.f };
+        ops_v.push_back ( op );
+    }
+    return *this;
+}
+
+CDerivedImageCache::SImageDesc &
+CDerivedImageCache::SImageDesc::boxFilter ( int   f_size_i,
+                                            float f_scale_f )
+{
+    SOperation op = { OT_BOXFILTER, f_size_i, f_scale_f };
+    ops_v.push_back ( op );
+    return *this;
+}
+
+std::string
+CDerivedImageCache::SImageDesc::getKey ( ) const
+{
+    std::string key_str = imageId_str;
+    char str[64];
+
+    for (unsigned int i = 0; i < ops_v.size(); ++i)
+    {
+        switch ( ops_v[i].type )
+        {
+            case OT_GRAY:
+                sprintf ( str, " / gray" );
+                break;
+            case OT_LEVEL:
+                sprintf ( str, " / pyramid level %i", ops_v[i].param_i );
+                break;
+            case OT_BOXFILTER:
+                sprintf ( str, " / box-filter %i x%g", ops_v[i].param_i, ops_v[i].scale_f );
+                break;
+        }
+
+        key_str += str;
+    }
+
+    return key_str;
+}
+
+bool
+CDerivedImageCache::SImageDesc::getParent ( SImageDesc & fr_parent ) const
+{
+    if ( ops_v.empty() )
+        return false;
+
+    fr_parent = *this;
+
+    /// Level n is computed from level n-1.
+    if ( ops_v.back().type == OT_LEVEL && ops_v.back().param_i > 1 )
+        --fr_parent.ops_v.back().param_i;
+    else
+        fr_parent.ops_v.pop_back();
+
+    return true;
+}
+
+CDerivedImageCache::CDerivedImageCache ( )
+{
+#if defined ( _OPENMP )
+    omp_init_lock ( &m_mapLock );
+#endif
+}
+
+CDerivedImageCache::~CDerivedImageCache ( )
+{
+    clear();
+
+#if defined ( _OPENMP )
+    omp_destroy_lock ( &m_mapLock );
+#endif
+}
+
+cv::Mat
+CDerivedImageCache::get ( const SImageDesc & f_desc,
+                          const cv::Mat &    f_source )
+{
+    if ( f_source.empty() )
+        return cv::Mat();
+
+    /// Images are also keyed by the source data, because an id might be
+    /// registered again with a different image during the frame.
+    char src_str[32];
+    sprintf ( src_str, " @%p", (const void *) f_source.data );
+
+    const std::string key_str = f_desc.getKey() + src_str;
+
+#if defined ( _OPENMP )
+    omp_set_lock ( &m_mapLock );
+#endif
+
+    SEntry * entry_p;
+    std::map<std::string, SEntry *>::iterator it = m_entries.find ( key_str );
+
+    if ( it == m_entries.end() )
+    {
+        entry_p = new SEntry;
+        entry_p -> valid_b = false;
+#if defined ( _OPENMP )
+        omp_init_lock ( &entry_p -> lock );
+#endif
+        m_entries[key_str] = entry_p;
+    }
+    else
+        entry_p = it->second;
+
+#if defined ( _OPENMP )
+    omp_unset_lock ( &m_mapLock );
+
+    /// Only the first requester computes the image. The parents are 
+    /// requested from here, so the locks are always taken from derived
+    /// to source images.
+    omp_set_lock ( &entry_p -> lock );
+#endif
+
+    if ( !entry_p -> valid_b )
+    {
+        SImageDesc parent;
+
+        if ( f_desc.getParent ( parent ) )
+            derive ( f_desc, get ( parent, f_source ), entry_p -> image );
+        else
+            entry_p -> image = f_source;
+
+        entry_p -> valid_b = true;
+    }
+
+    cv::Mat image = entry_p -> image;
+
+#if defined ( _OPENMP )
+    omp_unset_lock ( &entry_p -> lock );
+#endif
+
+    return image;
+}
+
+void
+CDerivedImageCache::clear ( )
+{
+    for ( std::map<std::string, SEntry *>::iterator it = m_entries.begin(); 
+          it != m_entries.end(); ++it )
+    {
+#if defined ( _OPENMP )
+        omp_destroy_lock ( &it->second->lock );
+#endif
+        delete it->second;
+    }
+
+    m_entries.clear();
+}
+
+bool
+CDerivedImageCache::derive ( const SImageDesc & f_desc,
+                             const cv::Mat &    f_parent,
+                             cv::Mat &          fr_image )
+{
+    if ( f_parent.empty() || f_desc.ops_v.empty() )
+    {
+        fr_image = f_parent;
+        return !f_parent.empty();
+    }
+
+    const SOperation & op = f_desc.ops_v.back();
+
+    switch ( op.type )
+    {
+        case OT_GRAY:
+        {
+            if ( f_parent.channels() == 3 )
+                cv::cvtColor ( f_parent, fr_image, CV_BGR2GRAY );
+            else if ( f_parent.channels() == 4 )
+                cv::cvtColor ( f_parent, fr_image, CV_BGRA2GRAY );
+            else
+                fr_image = f_parent;
+        }
+        break;
+
+        case OT_LEVEL:
+        {
+            cv::pyrDown ( f_parent, fr_image, 
+                          cv::Size ( f_parent.cols/2, f_parent.rows/2 ) );
+        }
+        break;
+
+        case OT_BOXFILTER:
+        {
+            cv::Mat imgf, imgf2;
+            cv::boxFilter ( f_parent, imgf, CV_32F, 
+                            cv::Size ( op.param_i, op.param_i ),
+                            cv::Point(-1,-1), true, cv::BORDER_DEFAULT );
+            f_parent.convertTo ( imgf2, CV_32F, 1., 0 );
+            imgf -= imgf2;
+            imgf.convertTo ( fr_image, CV_8U, op.scale_f, 127 );
+        }
+        break;
+    }
+
+    return true;
+}
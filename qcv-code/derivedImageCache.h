@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose. 
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __DERIVEDIMAGECACHE_H
+#define __DERIVEDIMAGECACHE_H
+
+/**
+ *******************************************************************************
+ *
+ * @file derivedImageCache.h
+ *
+ * \class CDerivedImageCache
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Frame scoped cache of images derived from the input images.
+ *
+ * A derived image is described by the id of the source image and a
+ * chain of operations: gray scale conversion, pyramid level (successive
+ * pyrDown as in CImagePyramid) and box-filter pre-filtering. The key of
+ * a derived image reads for example 
+ * "Image 0 / gray / pyramid level 2 / box-filter 19 x5". A derived image
+ * is computed from its parent image (the chain without the last
+ * operation, or one pyramid level less) on the first request and shared
+ * by all later requests until the cache is cleared. Images are also
+ * keyed by the data pointer of the source image, so an id registered
+ * again with a different image does not return stale results. Requests
+ * from different threads are safe: different images are computed in 
+ * parallel, and requests for an image under computation wait for the
+ * result.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <string>
+#include <vector>
+#include <map>
+#include <opencv/cv.h>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CDerivedImageCache
+    {
+    /// Public data types.
+    public:
+        typedef enum 
+        {
+            OT_GRAY = 0,
+            OT_LEVEL,
+            OT_BOXFILTER
+        } EOperationType;
+
+        struct SOperation
+        {
+            /// Operation.
+            EOperationType type;
+
+            /// Pyramid level or box-filter mask size.
+            int            param_i;
+
+            /// Scale of the box-filter pre-filtering.
+            float          scale_f;
+        };
+
+        struct SImageDesc
+        {
+            SImageDesc ( const std::string & f_imageId_str = "Image 0" )
+                : imageId_str (     f_imageId_str ),
+                  ops_v (                         ) {}
+
+            /// Append a gray scale conversion.
+            SImageDesc & gray ( );
+
+            /// Append the computation of a pyramid level (0 is the 
+            /// image itself).
+            SImageDesc & level ( unsigned int f_level_ui );
+
+            /// Append a box-filter pre-filtering. The result is
+            /// (box - image) * scale + 127.
+            SImageDesc & boxFilter ( int   f_size_i,
+                                     float f_scale_f );
+
+            /// Key of the derived image.
+            std::string  getKey ( ) const;
+
+            /// Description of the image from which this one is derived.
+            /// Returns false if this is the source image.
+            bool         getParent ( SImageDesc & fr_parent ) const;
+
+            /// Id of the source image.
+            std::string              imageId_str;
+
+            /// Operations in order of application.
+            std::vector<SOperation>  ops_v;
+        };
+
+    /// Constructors/Destructor
+    public:
+        CDerivedImageCache ( );
+        virtual ~CDerivedImageCache ( );
+
+    /// Operations
+    public:
+        /// Get the derived image f_desc of the source image f_source.
+        /// The source is only used if the image is not yet cached. The 
+        /// returned image is shared and must not be modified.
+        cv::Mat     get ( const SImageDesc & f_desc,
+                          const cv::Mat &    f_source );
+
+        /// Release all images. Must not be called concurrently with get.
+        void        clear ( );
+
+    /// Protected help methods.
+    protected:
+        /// Compute f_desc from its parent image.
+        static bool derive ( const SImageDesc & f_desc,
+                             const cv::Mat &    f_parent,
+                             cv::Mat &          fr_image );
+
+    /// Private data types.
+    private:
+        struct SEntry
+        {
+            /// Derived image.
+            cv::Mat      image;
+
+            /// Has the image been computed?
+            bool         valid_b;
+
+#if defined ( _OPENMP )
+            /// Lock held while the image is computed.
+            omp_lock_t   lock;
+#endif
+        };
+
+    /// Private members.
+    private:
+        /// Cached images.
+        std::map<std::string, SEntry *>   m_entries;
+
+#if defined ( _OPENMP )
+        /// Lock of the entry map.
+        omp_lock_t                        m_mapLock;
+#endif
+    };
+}
+
+#endif // __DERIVEDIMAGECACHE_H
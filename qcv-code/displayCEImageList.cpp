@@ -28,15 +28,110 @@
 ******************************************************************************/
 
 /* INCLUDES */
+/// Must be first, before <QGLContext> includes GL/gl.h.
+#include "glheader.h"
+
+#include <QGLContext>
+
 #include "displayCEImageList.h"
+#include "glTexturePool.h"
 
 #include <opencv/highgui.h>
 
-#include "glheader.h"
+#include <stdio.h>
+
+/// Shaders need the OpenGL 2.0 entry points. opengl32 on Windows only
+/// exports OpenGL 1.1, so there they would have to be loaded at runtime.
+#if !defined ( WIN32 ) && defined ( GL_VERSION_2_0 )
+#define DCEIL_GPU_ENCODING
+#endif
 
+extern QGLContext * g_QGLContext_p;
 
 using namespace QCV;
 
+bool CDisplayColorEncImageList::m_encodeOnGPU_b = false;
+
+#if defined ( DCEIL_GPU_ENCODING )
+/// Fragment shader for the encoding on the GPU. The value texture
+/// holds the values already mapped to [0,1] over the lookup table,
+/// which is a texture of one row. The color is modulated by the
+/// vertex color, as with GL_MODULATE.
+static const char g_encodingShader_str[] =
+    "#extension GL_ARB_texture_rectangle : enable\n"
+    "uniform sampler2DRect values;\n"
+    "uniform sampler2DRect lut;\n"
+    "uniform float         lutSize;\n"
+    "void main()\n"
+    "{\n"
+    "    float t = texture2DRect ( values, gl_TexCoord[0].st ).r;\n"
+    "    gl_FragColor = gl_Color * vec4 ( texture2DRect ( lut, vec2 ( t * ( lutSize - 1.0 ) + 0.5, 0.5 ) ).rgb, 1.0 );\n"
+    "}\n";
+
+/// Encoding program and its state: 0 not yet built, 1 ready, -1 not
+/// supported.
+static GLuint g_encodingProgram_ui = 0;
+static int    g_encodingProgramState_i = 0;
+
+static bool buildEncodingProgram ()
+{
+    if ( g_encodingProgramState_i )
+        return g_encodingProgramState_i > 0;
+
+    g_encodingProgramState_i = -1;
+
+    GLint maxSize_i = 0;
+    glGetIntegerv ( GL_MAX_TEXTURE_SIZE, &maxSize_i );
+
+    const char * version_p = (const char *) glGetString ( GL_VERSION );
+
+    if ( !version_p || version_p[0] < '2' || maxSize_i < CCE_LUT_SIZE )
+    {
+        printf("%s:%i OpenGL 2.0 is not available. Images will be color encoded on the CPU.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    const char * source_p = g_encodingShader_str;
+    GLint status_i = 0;
+
+    GLuint shader_ui = glCreateShader ( GL_FRAGMENT_SHADER );
+    glShaderSource ( shader_ui, 1, &source_p, NULL );
+    glCompileShader ( shader_ui );
+    glGetShaderiv ( shader_ui, GL_COMPILE_STATUS, &status_i );
+
+    if ( status_i )
+    {
+        g_encodingProgram_ui = glCreateProgram();
+        glAttachShader ( g_encodingProgram_ui, shader_ui );
+        glLinkProgram ( g_encodingProgram_ui );
+        glGetProgramiv ( g_encodingProgram_ui, GL_LINK_STATUS, &status_i );
+    }
+
+    /// The program keeps the shader until it is deleted.
+    glDeleteShader ( shader_ui );
+
+    if ( !status_i )
+    {
+        printf("%s:%i The color encoding shader could not be built. Images will be color encoded on the CPU.\n",
+               __FILE__, __LINE__ );
+
+        if ( g_encodingProgram_ui )
+            glDeleteProgram ( g_encodingProgram_ui );
+        g_encodingProgram_ui = 0;
+        return false;
+    }
+
+    glUseProgram ( g_encodingProgram_ui );
+    glUniform1i ( glGetUniformLocation ( g_encodingProgram_ui, "values" ),  0 );
+    glUniform1i ( glGetUniformLocation ( g_encodingProgram_ui, "lut" ),     1 );
+    glUniform1f ( glGetUniformLocation ( g_encodingProgram_ui, "lutSize" ), (float) CCE_LUT_SIZE );
+    glUseProgram ( 0 );
+
+    g_encodingProgramState_i = 1;
+    return true;
+}
+#endif
 
 CDisplayColorEncImageList::CDisplayColorEncImageList() 
 {
@@ -52,9 +147,24 @@ CDisplayColorEncImageList::~CDisplayColorEncImageList()
 bool 
 CDisplayColorEncImageList::add ( const CDisplayColorEncImageList & f_otherList )
 {
+    if ( g_QGLContext_p )
+        g_QGLContext_p->makeCurrent();
+
+    const size_t first_ui = m_image_v.size();
+
     m_image_v.insert( m_image_v.end(), 
                       f_otherList.m_image_v.begin(),
                       f_otherList.m_image_v.end() );
+
+    /// The textures are shared with the other list.
+    for (size_t i = first_ui; i < m_image_v.size(); ++i)
+    {
+        CGLTexturePool::retain ( m_image_v[i].textureId_ui );
+
+        if ( m_image_v[i].lutTextureId_ui )
+            CGLTexturePool::retain ( m_image_v[i].lutTextureId_ui );
+    }
+
     return true;
     
 }
@@ -68,34 +178,136 @@ CDisplayColorEncImageList::add (  cv::Mat *           f_image_p,
                                   float               f_dispWidth_f,
                                   float               f_dispHeight_f,
                                   float               f_alpha_f,
-                                  bool                f_makeCopy_b )
+                                  bool                /* f_makeCopy_b */ )
 {
-    bool res_b = true;
+    /// The image is encoded and uploaded here, so it is never needed
+    /// later and does not have to be copied.
+    if ( !f_image_p || f_image_p->empty() )
+        return false;
+
+    if ( g_QGLContext_p )
+        g_QGLContext_p->makeCurrent();
+
     SDisplayColorEncImage newImage;
 
-    newImage.copied_b = f_makeCopy_b;
-    
-    if ( !f_makeCopy_b )
-        newImage.image_p = f_image_p;
-    else
+    newImage.u_f             = f_u_f;
+    newImage.v_f             = f_v_f;
+    newImage.width_f         = f_dispWidth_f;
+    newImage.height_f        = f_dispHeight_f;
+    newImage.alpha_f         = f_alpha_f;
+    newImage.cols_i          = f_image_p->cols;
+    newImage.rows_i          = f_image_p->rows;
+    newImage.textureId_ui    = 0;
+    newImage.lutTextureId_ui = 0;
+
+    if ( !uploadValues  ( *f_image_p, f_encoder_f, newImage ) &&
+         !uploadEncoded ( *f_image_p, f_encoder_f, newImage ) )
+        return false;
+
+    m_image_v.push_back( newImage );
+
+    return true;
+}
+
+bool
+CDisplayColorEncImageList::uploadEncoded ( const cv::Mat &         f_image,
+                                           const CColorEncoding &  f_encoder,
+                                           SDisplayColorEncImage & fr_elem )
+{
+    if ( !f_encoder.encodeImage ( f_image, m_encoded ) )
+        return false;
+
+    /// The buffer is reused for every image, so its texture is never
+    /// shared.
+    fr_elem.textureId_ui = CGLTexturePool::acquire ( m_encoded,
+                                                     GL_RGB,
+                                                     GL_BGR,
+                                                     GL_UNSIGNED_BYTE,
+                                                     1.f, 0.f,
+                                                     false );
+
+    return true;
+}
+
+bool
+CDisplayColorEncImageList::uploadValues ( const cv::Mat &         f_image,
+                                          const CColorEncoding &  f_encoder,
+                                          SDisplayColorEncImage & fr_elem )
+{
+#if defined ( DCEIL_GPU_ENCODING )
+    /// 8 bit images are encoded exactly on the CPU, and logarithmic
+    /// encodings and doubles are not supported by the shader.
+    if ( !m_encodeOnGPU_b ||
+         f_image.channels() != 1 ||
+         f_encoder.getColorEncodingType() == CColorEncoding::CET_INVALID ||
+         f_encoder.getLogarithmic() )
+        return false;
+
+    /// OpenGL maps unsigned integers c to c / (2^b-1) on upload. Undo
+    /// it together with the lookup table transformation with the pixel
+    /// transfer scale and bias, so that the texture holds (value -
+    /// offset) * scale / (size-1). The mapping of signed integers
+    /// changed with OpenGL 4.2, so they are uploaded as floats.
+    double max_d;
+    bool   signed_b;
+    GLenum type_e;
+
+    switch ( f_image.depth() )
     {
-        newImage.image_p = new cv::Mat;
-        f_image_p->copyTo(*newImage.image_p);
+        case CV_16U: max_d = 65535.; signed_b = false; type_e = GL_UNSIGNED_SHORT; break;
+        case CV_16S: max_d = 1.;     signed_b = true;  type_e = GL_FLOAT;          break;
+        case CV_32S: max_d = 1.;     signed_b = true;  type_e = GL_FLOAT;          break;
+        case CV_32F: max_d = 1.;     signed_b = false; type_e = GL_FLOAT;          break;
+        default:
+            return false;
     }
 
-    //if (res_b)
+    if ( !buildEncodingProgram() )
+        return false;
+
+    const double lutScale_d = f_encoder.getLutScale() / ( CCE_LUT_SIZE - 1. );
+    const double offset_d   = f_encoder.getLutOffset();
+
+    const float scale_f = max_d * lutScale_d;
+    const float bias_f  = -offset_d * lutScale_d;
+
+    if ( signed_b )
     {
-        newImage.u_f         = f_u_f;
-        newImage.v_f         = f_v_f;
-        newImage.width_f     = f_dispWidth_f;
-        newImage.height_f    = f_dispHeight_f;
-        newImage.alpha_f     = f_alpha_f;
-        newImage.encoder     = f_encoder_f;
-
-        m_image_v.push_back( newImage );
+        f_image.convertTo ( m_values, CV_32F );
+
+        /// The buffer is reused for every image, so its texture is
+        /// never shared.
+        fr_elem.textureId_ui = CGLTexturePool::acquire ( m_values,
+                                                         GL_LUMINANCE16,
+                                                         GL_LUMINANCE,
+                                                         type_e,
+                                                         scale_f,
+                                                         bias_f,
+                                                         false );
     }
+    else
+        fr_elem.textureId_ui = CGLTexturePool::acquire ( f_image,
+                                                         GL_LUMINANCE16,
+                                                         GL_LUMINANCE,
+                                                         type_e,
+                                                         scale_f,
+                                                         bias_f );
+
+    /// The packed colors of the encoder are BGRA with zero alpha.
+    const cv::Mat lut ( 1, CCE_LUT_SIZE, CV_8UC4,
+                        (void *) &f_encoder.getLut()[0] );
+
+    fr_elem.lutTextureId_ui = CGLTexturePool::acquire ( lut,
+                                                        GL_RGBA8,
+                                                        GL_BGRA,
+                                                        GL_UNSIGNED_BYTE,
+                                                        1.f, 0.f,
+                                                        false );
 
-    return res_b;
+    return true;
+#else
+    return false;
+#endif
 }
 
 // Clear all lines.
@@ -106,7 +318,10 @@ CDisplayColorEncImageList::clear ()
     
     for (; it != m_image_v.end(); ++it)
     {
-        it -> freeImage();
+        CGLTexturePool::release ( it -> textureId_ui );
+
+        if ( it -> lutTextureId_ui )
+            CGLTexturePool::release ( it -> lutTextureId_ui );
     }
     
     m_image_v.clear();
@@ -117,98 +332,59 @@ CDisplayColorEncImageList::clear ()
 bool 
 CDisplayColorEncImageList::show () const
 {
-
     DisplayColorEncImageList_t::const_iterator last = m_image_v.end();
     
-    glLineWidth( 0 );
-    for (DisplayColorEncImageList_t::const_iterator i = m_image_v.begin(); 
-         i != last; ++i )
-    {
-        switch( (*i).image_p->type() )
-        {
-            case CV_8S:
-                return showWithType<char>((*i));
-
-            case CV_8U:
-                return showWithType<unsigned char>((*i));
-
-            case CV_16S:
-                return showWithType<short int>((*i));
-
-            case CV_16U:
-                return showWithType<unsigned short int>((*i));
-            
-            case CV_32S:
-                return showWithType<int>((*i));
-            
-            //case CV_32U:
-            //    return showWithType<unsigned int>((*i));
-            
-            case CV_32F:
-                return showWithType<float>((*i));
-
-            case CV_64F:
-                return showWithType<double>((*i));
-
-            default:
-                return false;
-        }
-    }
-    return false;
-}
+    glEnable( GL_TEXTURE_RECTANGLE_NV );
 
-// Draw all lines.
-template <class Type_>
-bool 
-CDisplayColorEncImageList::showWithType ( const SDisplayColorEncImage & f_elem ) const
-{
-
-    const unsigned int w_ui = f_elem.image_p->size().width;
-    const int          h_i  = f_elem.image_p->size().height;
-    
-    const float dx_f = f_elem.width_f  / w_ui;
-    const float dy_f = f_elem.height_f / h_i;
-
-    glLineWidth( 0 );    
+    /// The texture color modulated by white with the alpha value of
+    /// each image.
+    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 
-    // OPENMP HERE?
-    for (int v = 0; v < h_i; ++v)
+    for (DisplayColorEncImageList_t::const_iterator i = m_image_v.begin(); 
+         i != last; ++i )
     {
-        Type_ *ptr_p = ((Type_ *)(f_elem.image_p->data)) + v * w_ui;
-        SRgba colorAlpha;
-        SRgb  color;
+        glColor4f ( 1.f, 1.f, 1.f, i->alpha_f );
 
-        float offsetX_f    = f_elem.u_f;
-        float offsetY_f    = f_elem.v_f + v * dy_f;
-        float offsetYpdy_f = offsetY_f + dy_f;
-
-        for ( unsigned u = 0; u < w_ui; ++u, ++ptr_p )
+#if defined ( DCEIL_GPU_ENCODING )
+        if ( i->lutTextureId_ui )
         {
-            float offsetXpdx_f = offsetX_f + dx_f;
-            
-            f_elem.encoder.colorFromValue( (float) (*ptr_p), 
-                                           color );
-
-            colorAlpha = color;
-            colorAlpha.a = f_elem.alpha_f;
-            
-
-            glColor4ub( colorAlpha.r, 
-                        colorAlpha.g,
-                        colorAlpha.b,
-                        colorAlpha.a );
-            
-            glBegin(GL_POLYGON);
-            glVertex2f ( offsetX_f,    offsetY_f );
-            glVertex2f ( offsetXpdx_f, offsetY_f );
-            glVertex2f ( offsetXpdx_f, offsetYpdy_f );
-            glVertex2f ( offsetX_f,    offsetYpdy_f );
-            glEnd();
-
-            offsetX_f = offsetXpdx_f;
+            glUseProgram ( g_encodingProgram_ui );
+            glActiveTexture ( GL_TEXTURE1 );
+            glBindTexture ( GL_TEXTURE_RECTANGLE_NV, i->lutTextureId_ui );
+            glActiveTexture ( GL_TEXTURE0 );
         }
+#endif
+
+        glBindTexture( GL_TEXTURE_RECTANGLE_NV,
+                       i->textureId_ui );
+        
+        float endX_f = i->u_f + i->width_f;
+        float endY_f = i->v_f + i->height_f;
+        
+        glBegin(GL_QUADS);
+        
+        glTexCoord2f(0, 0);
+        glVertex2f(i->u_f, i->v_f);
+        
+        glTexCoord2f(i->cols_i, 0);
+        glVertex2f(endX_f, i->v_f);
+
+        glTexCoord2f(i->cols_i, i->rows_i);
+        glVertex2f(endX_f, endY_f);
+
+        glTexCoord2f(0, i->rows_i);
+        glVertex2f(i->u_f, endY_f);
+
+        glEnd();        
+
+#if defined ( DCEIL_GPU_ENCODING )
+        if ( i->lutTextureId_ui )
+            glUseProgram ( 0 );
+#endif
     }
 
+    glDisable( GL_TEXTURE_RECTANGLE_NV );
+
     return true;
 }
 
@@ -38,6 +38,14 @@
  *  - display width and height,
  *  - the color encoding object (of type CColorEncoding).
  *
+ * Images are color encoded once when they are added and uploaded as a
+ * single texture, so that showing them draws one textured quad. The
+ * encoding is done on the CPU by default (see
+ * CColorEncoding::encodeImage). If GPU encoding is enabled and
+ * supported, the values are uploaded instead and encoded by a fragment
+ * shader with the lookup table of the encoder as texture. Textures
+ * are taken from CGLTexturePool.
+ *
  */
 
 /* INCLUDES */
@@ -93,15 +101,15 @@ namespace QCV
         // Return number of elements.
         virtual int  getSize () const;
 
+        // Encode images on the GPU if supported.
+        static void setEncodeOnGPU ( bool f_gpu_b ) { m_encodeOnGPU_b = f_gpu_b; }
+
+        // Encode images on the GPU if supported?
+        static bool getEncodeOnGPU ( ) { return m_encodeOnGPU_b; }
+
     protected:
         struct SDisplayColorEncImage
         {
-            /// Color information
-            cv::Mat *           image_p;
-
-            /// Copied
-            bool                copied_b;
-            
             /// Start position.
             float               u_f, v_f;
 
@@ -111,21 +119,26 @@ namespace QCV
             /// Alpha value.
             float               alpha_f;
 
-            /// Color encoding
-            CColorEncoding      encoder;
+            /// Image size.
+            int                 cols_i, rows_i;
+
+            /// Texture with the encoded image, or with the values if
+            /// encoded on the GPU.
+            unsigned int        textureId_ui;
 
-            void freeImage()
-            {
-                if ( copied_b )
-                    delete image_p;
-            }
-            
+            /// Lookup table texture if encoded on the GPU, 0 otherwise.
+            unsigned int        lutTextureId_ui;
         };
 
     /// Private Methods
     private:
-        template <class Type_>
-        bool showWithType ( const SDisplayColorEncImage & f_elem ) const;
+        bool uploadEncoded ( const cv::Mat &         f_image,
+                             const CColorEncoding &  f_encoder,
+                             SDisplayColorEncImage & fr_elem );
+
+        bool uploadValues ( const cv::Mat &         f_image,
+                            const CColorEncoding &  f_encoder,
+                            SDisplayColorEncImage & fr_elem );
         
     /// Private Members
     private:
@@ -134,6 +147,16 @@ namespace QCV
         
         /// Vector of images.
         DisplayColorEncImageList_t     m_image_v;        
+
+        /// Color encoded image buffer, reused between images.
+        cv::Mat                        m_encoded;
+
+        /// Signed values converted to float for the upload, reused
+        /// between images.
+        cv::Mat                        m_values;
+
+        /// Encode on the GPU?
+        static bool                    m_encodeOnGPU_b;
     };
 } // Namespace QCV
 
@@ -31,6 +31,7 @@
 #include <QGLContext>
 
 #include "displayImageList.h"
+#include "glTexturePool.h"
 
 #include <opencv/highgui.h>
 
@@ -196,12 +197,15 @@ CDisplayImageList::add ( const CDisplayImageList & f_otherList )
     if ( g_QGLContext_p )
         g_QGLContext_p->makeCurrent();
 
-    m_image_v.insert( m_image_v.begin(), 
+    const size_t first_ui = m_image_v.size();
+
+    m_image_v.insert( m_image_v.end(), 
                       f_otherList.m_image_v.begin(),
                       f_otherList.m_image_v.end() );
 
-    for (size_t i = 0; i < f_otherList.m_image_v.size(); ++i)
-      m_image_v[i].ownResources_b = false;
+    /// The textures are shared with the other list.
+    for (size_t i = first_ui; i < m_image_v.size(); ++i)
+        CGLTexturePool::retain ( m_image_v[i].textureId_ui );
 
     return true;    
 }
@@ -217,81 +221,37 @@ bool CDisplayImageList::add ( cv::Mat             f_image,
                               const float         f_alpha_f,
                               const bool          f_makeCopy_b )
 {
+    if ( f_image.empty() )
+        return false;
+
     if ( g_QGLContext_p )
         g_QGLContext_p->makeCurrent();
 
-    //bool res_b;
     SDisplayImage newImage;
 
-    if ( f_makeCopy_b )
-       f_image.copyTo(newImage.image);
-    else
-        newImage.image = f_image;
-
-    //if (res_b)
-    {
-        newImage.u_f         = f_u_f;
-        newImage.v_f         = f_v_f;
-        newImage.width_f     = f_dispWidth_f;
-        newImage.height_f    = f_dispHeight_f;
-        newImage.alpha_f     = f_alpha_f;
-        newImage.scale_f     = f_scale_f;
-        newImage.bias_f      = f_bias_f;
-
-        // Generate texture.
-        glGenTextures(1, &newImage.textureId_ui);
-        
-	newImage.ownResources_b = true;	
-
-        m_image_v.push_back(newImage);        
-
-        //first call transferes the texture to hw
-        glBindTexture( GL_TEXTURE_RECTANGLE_NV, newImage.textureId_ui );
-        
-        glPixelStorei( GL_UNPACK_ALIGNMENT, 1);    
-
-        // Interpolation settings ().
-        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        
-        // Interpolation settings (make as parameter).
-        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_MAG_FILTER, GL_NEAREST); //GL_LINEAR
-        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-
-        glPixelTransferf ( GL_RED_SCALE,   newImage.scale_f );
-        glPixelTransferf ( GL_RED_BIAS,    newImage.bias_f  );        
-        glPixelTransferf ( GL_GREEN_SCALE, newImage.scale_f );
-        glPixelTransferf ( GL_GREEN_BIAS,  newImage.bias_f  );        
-        glPixelTransferf ( GL_BLUE_SCALE,  newImage.scale_f );
-        glPixelTransferf ( GL_BLUE_BIAS,   newImage.bias_f  );
-
-        int realWidth_i  = newImage.image.step/newImage.image.elemSize();
-        int realHeight_i = newImage.image.step/newImage.image.elemSize();
-        int offX_i       = realWidth_i - newImage.image.cols;
-        int offY_i       = realHeight_i - newImage.image.rows;
-
-        glTexImage2D( GL_TEXTURE_RECTANGLE_NV,
-                      0,                                        // base level (only 0 allowed for GL_TEXTURE_RECTANGLE_NV).
-                      cv2GLFormat(newImage.image),           // internal format.
-                      realWidth_i,
-                      newImage.image.size().height,
-                      0,                                        // border.
-                      cv2GLFormat2(newImage.image),          // 
-                      cv2GLDType(newImage.image.type()),     // 
-                      newImage.image.ptr<unsigned char>(0) );  // data. 
-
-        glBindTexture(GL_TEXTURE_2D, newImage.textureId_ui);
-        glTexSubImage2D( GL_TEXTURE_RECTANGLE_NV,
-                         0,
-                         offX_i,
-                         offY_i,
-                         realWidth_i,
-                         newImage.image.rows,
-                         cv2GLFormat2(newImage.image),
-                         cv2GLDType(newImage.image.type()),
-                         newImage.image.ptr<unsigned char>(0) );
-   }
+    newImage.u_f         = f_u_f;
+    newImage.v_f         = f_v_f;
+    newImage.width_f     = f_dispWidth_f;
+    newImage.height_f    = f_dispHeight_f;
+    newImage.alpha_f     = f_alpha_f;
+    newImage.scale_f     = f_scale_f;
+    newImage.bias_f      = f_bias_f;
+    newImage.cols_i      = f_image.cols;
+    newImage.rows_i      = f_image.rows;
+
+    /// The image is uploaded here, so it never has to be copied. A
+    /// copy is requested for images that are going to be modified, so
+    /// these are always uploaded.
+    newImage.textureId_ui = 
+        CGLTexturePool::acquire ( f_image,
+                                  cv2GLFormat(f_image),
+                                  cv2GLFormat2(f_image),
+                                  cv2GLDType(f_image.type()),
+                                  f_scale_f,
+                                  f_bias_f,
+                                  !f_makeCopy_b );
+
+    m_image_v.push_back(newImage);        
 
     return true; //res_b;
 }
@@ -299,13 +259,9 @@ bool CDisplayImageList::add ( cv::Mat             f_image,
 // Clear all lines.
 bool CDisplayImageList::clear ()
 {
+    /// Released textures stay in the pool for the next images.
     for (unsigned int i = 0; i < m_image_v.size(); ++i)
-    {
-      if (m_image_v[i].ownResources_b)
-      {
-         glDeleteTextures( 1, &m_image_v[i].textureId_ui );
-      }
-    }
+        CGLTexturePool::release ( m_image_v[i].textureId_ui );
     
     m_image_v.clear();
     return true;
@@ -317,6 +273,7 @@ bool CDisplayImageList::show () const
     DisplayImageList_t::const_iterator last = m_image_v.end();
 
     glEnable( GL_TEXTURE_RECTANGLE_NV);
+    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
 
     for (DisplayImageList_t::const_iterator i = m_image_v.begin(); 
          i != last; ++i )
@@ -332,13 +289,13 @@ bool CDisplayImageList::show () const
         glTexCoord2f(0, 0);
         glVertex2f(i->u_f, i->v_f);
         
-        glTexCoord2f(i->image.size().width, 0);
+        glTexCoord2f(i->cols_i, 0);
         glVertex2f(endX_f, i->v_f);
 
-        glTexCoord2f(i->image.size().width, i->image.size().height);
+        glTexCoord2f(i->cols_i, i->rows_i);
         glVertex2f(endX_f, endY_f);
 
-        glTexCoord2f(0, i->image.size().height);
+        glTexCoord2f(0, i->rows_i);
         glVertex2f(i->u_f, endY_f);
 
         glEnd();        
@@ -38,6 +38,9 @@
  *  - an alpha component for transparency, and 
  *  - scale factor and bias to apply on the data for displaying, 
  *
+ * Images are uploaded to textures of CGLTexturePool when they are
+ * added, so they do not need to be kept or copied.
+ *
  */
 
 /* INCLUDES */
@@ -101,8 +104,8 @@ namespace QCV
     protected:
         typedef struct
         {
-            /// Color information
-            cv::Mat        image;
+            /// Image size.
+            int            cols_i, rows_i;
 
             /// Start position.
             float          u_f, v_f;
@@ -119,11 +122,8 @@ namespace QCV
             /// Bias
             float          bias_f;
 
-            /// Texture id
+            /// Texture id (from CGLTexturePool)
             unsigned int   textureId_ui;
-
-            /// Own resources?
-	    bool           ownResources_b;
         } SDisplayImage;
 
     /// Private Members
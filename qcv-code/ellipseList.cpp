@@ -32,13 +32,35 @@
 
 #include "glheader.h"
 #include <math.h>
+#include <algorithm>
 #include <stdio.h>
 
 
 using namespace QCV;
 
+/// Number of segments of large ellipses.
+#define ELL_MAX_SEGMENTS 36
+
+/// Unit circle sampled with ELL_MAX_SEGMENTS points.
+static struct SUnitCircle
+{
+    SUnitCircle()
+    {
+        for (int s = 0; s < ELL_MAX_SEGMENTS; ++s)
+        {
+            cos_p[s] = cos ( s * M_PI * 2. / ELL_MAX_SEGMENTS );
+            sin_p[s] = sin ( s * M_PI * 2. / ELL_MAX_SEGMENTS );
+        }
+    }
+
+    float cos_p[ELL_MAX_SEGMENTS];
+    float sin_p[ELL_MAX_SEGMENTS];
+} g_unitCircle;
 
 CEllipseList::CEllipseList( int /* f_bufferSize_i */ )
+        : m_shapeRadiusU_f (  -1.f ),
+          m_shapeRadiusV_f (  -1.f ),
+          m_shapeRotation_f (  0.f )
 {}
 
 /// Destructor.
@@ -52,6 +74,9 @@ CEllipseList::add (  const CEllipseList & f_otherList )
     m_ellipse_v.insert( m_ellipse_v.begin(), 
                         f_otherList.m_ellipse_v.begin(),
                         f_otherList.m_ellipse_v.end() );
+
+    m_batch.addFront ( f_otherList.m_batch );
+
     return true;
 }
 
@@ -81,6 +106,8 @@ CEllipseList::add ( float   f_u_f,
 
     m_ellipse_v.push_back(newEllipse);
 
+    addVertices ( newEllipse );
+
     return true;
 }
 
@@ -111,6 +138,8 @@ CEllipseList::add (  float   f_u_f,
 
     m_ellipse_v.push_back(newEllipse);
 
+    addVertices ( newEllipse );
+
     return true;
 }
 
@@ -118,76 +147,66 @@ CEllipseList::add (  float   f_u_f,
 bool CEllipseList::clear ()
 {
     m_ellipse_v.clear();
+    m_batch.clear();
     return m_ellipse_v.size();
 }
 
-// Draw all ellipses.
-bool CEllipseList::show () const
+// Add vertices of an ellipse for drawing.
+void
+CEllipseList::addVertices ( const SEllipse & f_ellipse )
 {
-    std::vector< SEllipse >::const_iterator last = m_ellipse_v.end();
-
-    for (std::vector< SEllipse >::const_iterator i = m_ellipse_v.begin(); 
-         i != last; ++i )
+    if ( f_ellipse.radiusU_f  != m_shapeRadiusU_f ||
+         f_ellipse.radiusV_f  != m_shapeRadiusV_f ||
+         f_ellipse.rotation_f != m_shapeRotation_f )
     {
-        const int   segments_i  = 36;
-        const float increment_f = M_PI * 2. / segments_i;
+        const float radius_f = std::max ( fabsf ( f_ellipse.radiusU_f ),
+                                          fabsf ( f_ellipse.radiusV_f ) );
 
-        float u_p[segments_i];
-        float v_p[segments_i];
+        /// Fewer segments for small ellipses.
+        const int step_i = radius_f < 3.f ? 3 : radius_f < 8.f ? 2 : 1;
 
-        float t = 0;
+        const float angle_f = f_ellipse.rotation_f * M_PI / 180.f;
+        const float c_f     = cos ( angle_f );
+        const float s_f     = sin ( angle_f );
 
-        for( int s = 0; s < segments_i; ++s )
+        m_shape_v.resize ( ELL_MAX_SEGMENTS / step_i );
+
+        for (unsigned int i = 0; i < m_shape_v.size(); ++i)
         {
-            u_p[s] = i->radiusU_f * cos(t);
-            v_p[s] = i->radiusV_f * sin(t);
-            t += increment_f;
-        }
+            const float u_f = f_ellipse.radiusU_f * g_unitCircle.cos_p[i * step_i];
+            const float v_f = f_ellipse.radiusV_f * g_unitCircle.sin_p[i * step_i];
 
-        glPushMatrix();
-        glTranslatef ( i->u_f, i->v_f, 0.f );
-        glRotatef    ( i->rotation_f, 0.f, 0.f, 1.f );
-        //glTranslatef ( -i->u_f, -i->v_f, 0.f );
+            m_shape_v[i].x = c_f * u_f - s_f * v_f;
+            m_shape_v[i].y = s_f * u_f + c_f * v_f;
+        }
 
-        glLineWidth( i->lineWidth_f );
+        m_shapeRadiusU_f  = f_ellipse.radiusU_f;
+        m_shapeRadiusV_f  = f_ellipse.radiusV_f;
+        m_shapeRotation_f = f_ellipse.rotation_f;
+    }
 
-        /// If not complete transparent.
-        if ( i->fillColor.a != 0 )
-        {
-            glColor4ub( i->fillColor.r, 
-                        i->fillColor.g, 
-                        i->fillColor.b, 
-                        i->fillColor.a );
-            
-            glBegin(GL_POLYGON);
-
-            for( int s = 0; s < segments_i; ++s )
-            {
-                glVertex2f( u_p[s], v_p[s] );
-            }
-
-            glEnd();
-        }       
-
-        glColor4ub( i->outlineColor.r, 
-                    i->outlineColor.g, 
-                    i->outlineColor.b, 
-                    i->outlineColor.a );
-        
-        glBegin ( GL_LINE_LOOP ) ;
-
-        for( int s = 0; s < segments_i; ++s )
-        {
-            glVertex2f( u_p[s], v_p[s] );
-        }
-        
-        glEnd();
+    m_outline_v.resize ( m_shape_v.size() );
 
-        glPopMatrix();
+    for (unsigned int i = 0; i < m_shape_v.size(); ++i)
+    {
+        m_outline_v[i].x = f_ellipse.u_f + m_shape_v[i].x;
+        m_outline_v[i].y = f_ellipse.v_f + m_shape_v[i].y;
     }
 
-    /// Todo: Check GL status and return value.
-    return true;
+    /// If not complete transparent.
+    if ( f_ellipse.fillColor.a != 0 )
+        m_batch.addFill ( &m_outline_v[0], m_outline_v.size(), f_ellipse.fillColor );
+
+    m_batch.addLineLoop ( &m_outline_v[0],
+                          m_outline_v.size(),
+                          f_ellipse.outlineColor,
+                          f_ellipse.lineWidth_f );
+}
+
+// Draw all ellipses.
+bool CEllipseList::show () const
+{
+    return m_batch.show();
 }
 
 bool CEllipseList::write ( FILE*                f_file_p,
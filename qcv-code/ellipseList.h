@@ -45,7 +45,9 @@
 
 /* INCLUDES */
 #include "drawingElementList.h"
+#include "standardTypes.h"
 #include "colors.h"
+#include "glVertexBatch.h"
 
 #include <vector>
 
@@ -132,9 +134,27 @@ namespace QCV
             float          lineWidth_f;
         } SEllipse;
 
+        /// Help methods
+    private:
+        void addVertices ( const SEllipse & f_ellipse );
+
         /// Private Members
     private:
         std::vector<SEllipse>    m_ellipse_v;
+
+        /// Vertices of the ellipses for drawing.
+        CGLVertexBatch           m_batch;
+
+        /// Outline of the last added ellipse shape relative to its
+        /// center, reused by following ellipses of the same shape.
+        std::vector< S2D<float> > m_shape_v;
+
+        /// Radii and rotation of the cached shape.
+        float                    m_shapeRadiusU_f, m_shapeRadiusV_f;
+        float                    m_shapeRotation_f;
+
+        /// Outline of the ellipse being added.
+        std::vector< S2D<float> > m_outline_v;
     };
 } // Namespace QCV
 
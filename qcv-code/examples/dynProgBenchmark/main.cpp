@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * Benchmark of CDynamicProgrammingOp. Random cost images of several widths
+ * are solved with the exhaustive O(W^2) relaxation and with the linear
+ * time relaxation. The program prints the time per image of both solvers
+ * and checks that both find the same path. Returns 1 if a path differs.
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "paramMacros.h"
+#include "dynProgOp.h"
+#include "clock.h"
+
+using namespace QCV;
+
+/// Random cost image. Integer costs produce many ties.
+static cv::Mat createCostImage ( int  f_width_i,
+                                 int  f_height_i,
+                                 int  f_type_i,
+                                 bool f_integer_b )
+{
+    cv::Mat costImg ( f_height_i, f_width_i, f_type_i );
+
+    for (int i = 0; i < f_height_i; ++i)
+    {
+        for (int j = 0; j < f_width_i; ++j)
+        {
+            if ( f_type_i == CV_16UC1 )
+                costImg.at<unsigned short>(i,j) = 1 + rand() % 100;
+            else if ( f_integer_b )
+                costImg.at<float>(i,j) = 1 + rand() % 100;
+            else
+                costImg.at<float>(i,j) = 1 + 99.f * rand() / (float) RAND_MAX;
+        }
+    }
+
+    return costImg;
+}
+
+/// Solves f_reps_i times and returns the time per image [ms].
+static double solve ( CDynamicProgrammingOp & fr_dp,
+                      const cv::Mat &         f_costImg,
+                      bool                    f_linear_b,
+                      int                     f_reps_i,
+                      std::vector<int> &      fr_path_v )
+{
+    CClock clock;
+
+    fr_dp.setUseDistTransform ( f_linear_b );
+
+    for (int r = 0; r < f_reps_i; ++r)
+    {
+        /// No prediction.
+        fr_path_v.assign ( f_costImg.rows, -1 );
+
+        clock.start();
+        fr_dp.compute ( f_costImg, fr_path_v );
+        clock.stop();
+    }
+
+    return clock.getLoopTime();
+}
+
+int main(int f_argc_i, char *f_argv_p[])
+{
+    const int height_i = f_argc_i > 1 ? atoi ( f_argv_p[1] ) : 200;
+    const int reps_i   = f_argc_i > 2 ? atoi ( f_argv_p[2] ) : 3;
+
+    if ( height_i < 2 || reps_i < 1 )
+    {
+        printf("\n\nUsage: %s [height [repetitions]]\n", f_argv_p[0]);
+        return 1;
+    }
+
+    const int widths_p[] = { 64, 128, 256, 512, 1024, 2048 };
+    const int numWidths_i = sizeof(widths_p) / sizeof(widths_p[0]);
+
+    const char * const names_p[] = { "32F integer", "32F", "16U" };
+    const int          types_p[] = { CV_32FC1, CV_32FC1, CV_16UC1 };
+
+    CDynamicProgrammingOp dp;
+
+    dp.setDistanceCost      ( 5.f );
+    dp.setDistanceTh        ( 10.f );
+    dp.setApplyMedianFilter ( false );
+
+    srand ( 1 );
+
+    bool same_b = true;
+
+    printf("height %i, %i repetitions\n", height_i, reps_i );
+    printf("%12s %6s %16s %12s %8s %5s\n",
+           "cost", "width", "exhaustive [ms]", "linear [ms]", "speedup", "same" );
+
+    for (int t = 0; t < 3; ++t)
+    {
+        for (int w = 0; w < numWidths_i; ++w)
+        {
+            const cv::Mat costImg = createCostImage ( widths_p[w],
+                                                      height_i,
+                                                      types_p[t],
+                                                      t == 0 );
+
+            dp.setCostImageSize ( costImg.cols, costImg.rows );
+
+            std::vector<int> exhPath_v, linPath_v;
+
+            const double exhTime_d = solve ( dp, costImg, false, reps_i, exhPath_v );
+            const double linTime_d = solve ( dp, costImg, true,  reps_i, linPath_v );
+
+            const bool equal_b = exhPath_v == linPath_v;
+            same_b &= equal_b;
+
+            printf("%12s %6i %16.3f %12.3f %7.1fx %5s\n",
+                   names_p[t], widths_p[w], exhTime_d, linTime_d,
+                   exhTime_d / linTime_d, equal_b?"yes":"NO" );
+        }
+    }
+
+    return same_b ? 0 : 1;
+}
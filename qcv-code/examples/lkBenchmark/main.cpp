@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * Benchmark of CLucasKanadeTracker against cv::calcOpticalFlowPyrLK. A
+ * textured image and a copy shifted by a sub-pixel offset are tracked
+ * with 500, 2000 and 8000 features. Both trackers run on the same
+ * pyramids with the same window, levels and termination criteria. The
+ * program prints the time per call of both trackers, the number of
+ * features with a different status, and the mean and max distance
+ * between the tracked positions. Returns 1 if the tracks differ.
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <opencv/cv.h>
+
+#include "lucasKanadeTracker.h"
+#include "clock.h"
+
+using namespace QCV;
+
+/// Max mean distance between the tracks of both trackers [px].
+#define LKB_MAX_MEAN_DIST 0.05
+
+/// Max fraction of features with a different status.
+#define LKB_MAX_STATUS_DIFF 0.01
+
+int main(int f_argc_i, char *f_argv_p[])
+{
+    const int reps_i    = f_argc_i > 1 ? atoi ( f_argv_p[1] ) : 10;
+    const int winSize_i = f_argc_i > 2 ? atoi ( f_argv_p[2] ) : 21;
+    const int levels_i  = 3;
+
+    if ( reps_i < 1 || winSize_i < 3 )
+    {
+        printf("\n\nUsage: %s [repetitions [window size]]\n", f_argv_p[0]);
+        return 1;
+    }
+
+    const cv::Point2f shift ( 2.37f, -1.61f );
+
+    /// Smoothed noise as texture.
+    cv::Mat noise ( 720, 1280, CV_8UC1 );
+    cv::randu ( noise, cv::Scalar(0), cv::Scalar(256) );
+
+    cv::Mat prevImg, currImg;
+    cv::GaussianBlur ( noise, prevImg, cv::Size(0,0), 1.5 );
+
+    cv::Mat warp = ( cv::Mat_<double>(2,3) << 1, 0, shift.x, 0, 1, shift.y );
+    cv::warpAffine ( prevImg, currImg, warp, prevImg.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT );
+
+    const cv::Size winSize ( winSize_i, winSize_i );
+
+    std::vector<cv::Mat> prevPyr_v, currPyr_v;
+    cv::buildOpticalFlowPyramid ( prevImg, prevPyr_v, winSize, levels_i, true );
+    cv::buildOpticalFlowPyramid ( currImg, currPyr_v, winSize, levels_i, true );
+
+    const cv::TermCriteria criteria ( cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01 );
+    const float            minEig_f = 1e-4f;
+
+    CLucasKanadeTracker tracker;
+    tracker.setWindowSize    ( winSize_i );
+    tracker.setMaxLevel      ( levels_i );
+    tracker.setMaxIterations ( criteria.maxCount );
+    tracker.setEpsilon       ( criteria.epsilon );
+    tracker.setMinEigenvalue ( minEig_f );
+
+    const int numFeatures_p[] = { 500, 2000, 8000 };
+
+    srand ( 1 );
+
+    bool same_b = true;
+
+    printf("1280x720, window %i, %i levels, %i repetitions\n", winSize_i, levels_i, reps_i );
+    printf("%8s %12s %12s %8s %11s %10s %10s\n",
+           "features", "opencv [ms]", "native [ms]", "speedup",
+           "status diff", "mean dist", "max dist" );
+
+    for (int n = 0; n < 3; ++n)
+    {
+        const int numFeatures_i = numFeatures_p[n];
+
+        /// Random positions away from the border.
+        std::vector<cv::Point2f> prevPts_v ( numFeatures_i );
+
+        for (int i = 0; i < numFeatures_i; ++i)
+            prevPts_v[i] = cv::Point2f ( 32 + rand() % ( prevImg.cols - 64 ) + rand() / (float) RAND_MAX,
+                                         32 + rand() % ( prevImg.rows - 64 ) + rand() / (float) RAND_MAX );
+
+        std::vector<cv::Point2f>   ocvPts_v, natPts_v;
+        std::vector<unsigned char> ocvStatus_v, natStatus_v;
+        std::vector<float>         ocvError_v, natError_v;
+
+        CClock ocvClock, natClock;
+
+        for (int r = 0; r < reps_i; ++r)
+        {
+            ocvClock.start();
+            cv::calcOpticalFlowPyrLK ( prevPyr_v, currPyr_v, prevPts_v, ocvPts_v,
+                                       ocvStatus_v, ocvError_v, winSize, levels_i,
+                                       criteria, 0, minEig_f );
+            ocvClock.stop();
+
+            natClock.start();
+            tracker.track ( prevPyr_v, currPyr_v, prevPts_v, natPts_v,
+                            natStatus_v, natError_v );
+            natClock.stop();
+        }
+
+        int    statusDiff_i = 0, count_i = 0;
+        double sumDist_d = 0, maxDist_d = 0;
+
+        for (int i = 0; i < numFeatures_i; ++i)
+        {
+            if ( !ocvStatus_v[i] != !natStatus_v[i] )
+                ++statusDiff_i;
+            else if ( ocvStatus_v[i] )
+            {
+                const cv::Point2f d = ocvPts_v[i] - natPts_v[i];
+                const double dist_d = sqrt ( d.x * d.x + d.y * d.y );
+                sumDist_d += dist_d;
+                maxDist_d  = std::max ( maxDist_d, dist_d );
+                ++count_i;
+            }
+        }
+
+        const double meanDist_d = count_i ? sumDist_d / count_i : 0.;
+        const bool   equal_b = statusDiff_i <= LKB_MAX_STATUS_DIFF * numFeatures_i &&
+                               meanDist_d   <= LKB_MAX_MEAN_DIST;
+        same_b &= equal_b;
+
+        printf("%8i %12.3f %12.3f %7.2fx %11i %10.4f %10.4f %s\n",
+               numFeatures_i, ocvClock.getLoopTime(), natClock.getLoopTime(),
+               ocvClock.getLoopTime() / natClock.getLoopTime(),
+               statusDiff_i, meanDist_d, maxDist_d, equal_b?"":"DIFFERENT" );
+    }
+
+    return same_b ? 0 : 1;
+}
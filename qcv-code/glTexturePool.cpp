@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file glTexturePool.cpp
+ *
+ * \class CGLTexturePool
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Pool of rectangle textures for displaying images.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "glheader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "glTexturePool.h"
+
+/// Pixel buffer objects need OpenGL 2.1, which is not exported by the
+/// Windows OpenGL library.
+#if !defined ( WIN32 ) && defined ( GL_VERSION_2_1 )
+#define GTP_USE_PBO
+#endif
+
+/// Generations after which an unused texture is deleted.
+#define GTP_MAX_IDLE_GENERATIONS 4
+
+using namespace QCV;
+
+std::vector<CGLTexturePool::STexture> CGLTexturePool::m_textures_v;
+unsigned int                          CGLTexturePool::m_generation_ui = 1;
+unsigned int                          CGLTexturePool::m_pbo_p[2]      = { 0, 0 };
+int                                   CGLTexturePool::m_nextPbo_i     = 0;
+int                                   CGLTexturePool::m_pboState_i    = 0;
+
+unsigned int
+CGLTexturePool::acquire ( const cv::Mat & f_image,
+                          int             f_internalFormat_i,
+                          int             f_format_i,
+                          int             f_type_i,
+                          float           f_scale_f,
+                          float           f_bias_f,
+                          bool            f_reuse_b )
+{
+    if ( f_image.empty() )
+        return 0;
+
+    deleteIdle();
+
+    int free_i = -1;
+
+    for (int i = 0; i < (int) m_textures_v.size(); ++i)
+    {
+        STexture & tex = m_textures_v[i];
+
+        if ( tex.width_i          != f_image.cols ||
+             tex.height_i         != f_image.rows ||
+             tex.internalFormat_i != f_internalFormat_i )
+            continue;
+
+        /// Same image data of this generation with the same transfer.
+        if ( f_reuse_b &&
+             tex.source.data     == f_image.data &&
+             tex.source.step     == f_image.step &&
+             tex.source.type()   == f_image.type() &&
+             tex.generation_ui   == m_generation_ui &&
+             tex.format_i        == f_format_i &&
+             tex.type_i          == f_type_i &&
+             tex.scale_f         == f_scale_f &&
+             tex.bias_f          == f_bias_f )
+        {
+            ++tex.refCount_i;
+            tex.lastUse_ui = m_generation_ui;
+            return tex.id_ui;
+        }
+
+        if ( free_i < 0 && tex.refCount_i == 0 )
+            free_i = i;
+    }
+
+    if ( free_i < 0 )
+    {
+        STexture tex;
+
+        glGenTextures ( 1, &tex.id_ui );
+        glBindTexture( GL_TEXTURE_RECTANGLE_NV, tex.id_ui );
+
+        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri( GL_TEXTURE_RECTANGLE_NV, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        /// Allocate only, the data is uploaded with a sub-image update.
+        glTexImage2D( GL_TEXTURE_RECTANGLE_NV,
+                      0,
+                      f_internalFormat_i,
+                      f_image.cols,
+                      f_image.rows,
+                      0,
+                      f_format_i,
+                      f_type_i,
+                      NULL );
+
+        tex.width_i          = f_image.cols;
+        tex.height_i         = f_image.rows;
+        tex.internalFormat_i = f_internalFormat_i;
+        tex.refCount_i       = 0;
+
+        free_i = m_textures_v.size();
+        m_textures_v.push_back ( tex );
+    }
+
+    STexture & tex = m_textures_v[free_i];
+
+    tex.format_i      = f_format_i;
+    tex.type_i        = f_type_i;
+    tex.scale_f       = f_scale_f;
+    tex.bias_f        = f_bias_f;
+    tex.source        = f_reuse_b ? f_image : cv::Mat();
+    tex.generation_ui = m_generation_ui;
+    tex.lastUse_ui    = m_generation_ui;
+    tex.refCount_i    = 1;
+
+    upload ( tex, f_image );
+
+    return tex.id_ui;
+}
+
+void
+CGLTexturePool::retain ( unsigned int f_textureId_ui )
+{
+    for (unsigned int i = 0; i < m_textures_v.size(); ++i)
+    {
+        if ( m_textures_v[i].id_ui == f_textureId_ui )
+        {
+            ++m_textures_v[i].refCount_i;
+            return;
+        }
+    }
+}
+
+void
+CGLTexturePool::release ( unsigned int f_textureId_ui )
+{
+    for (unsigned int i = 0; i < m_textures_v.size(); ++i)
+    {
+        if ( m_textures_v[i].id_ui == f_textureId_ui )
+        {
+            if ( m_textures_v[i].refCount_i > 0 )
+                --m_textures_v[i].refCount_i;
+            return;
+        }
+    }
+}
+
+void
+CGLTexturePool::newGeneration ( )
+{
+    ++m_generation_ui;
+}
+
+void
+CGLTexturePool::deleteIdle ( )
+{
+    for (int i = m_textures_v.size() - 1; i >= 0; --i)
+    {
+        if ( m_textures_v[i].refCount_i == 0 &&
+             m_generation_ui - m_textures_v[i].lastUse_ui > GTP_MAX_IDLE_GENERATIONS )
+        {
+            glDeleteTextures ( 1, &m_textures_v[i].id_ui );
+            m_textures_v.erase ( m_textures_v.begin() + i );
+        }
+    }
+}
+
+void
+CGLTexturePool::upload ( const STexture & f_texture,
+                         const cv::Mat &  f_image )
+{
+    glBindTexture( GL_TEXTURE_RECTANGLE_NV, f_texture.id_ui );
+
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, f_image.step / f_image.elemSize() );
+
+    glPixelTransferf ( GL_RED_SCALE,   f_texture.scale_f );
+    glPixelTransferf ( GL_RED_BIAS,    f_texture.bias_f  );
+    glPixelTransferf ( GL_GREEN_SCALE, f_texture.scale_f );
+    glPixelTransferf ( GL_GREEN_BIAS,  f_texture.bias_f  );
+    glPixelTransferf ( GL_BLUE_SCALE,  f_texture.scale_f );
+    glPixelTransferf ( GL_BLUE_BIAS,   f_texture.bias_f  );
+
+    const unsigned char * data_p = f_image.ptr<unsigned char>(0);
+    bool uploaded_b = false;
+
+#if defined ( GTP_USE_PBO )
+    if ( m_pboState_i == 0 )
+    {
+        int major_i = 0, minor_i = 0;
+        const char * version_p = (const char *) glGetString ( GL_VERSION );
+
+        if ( version_p &&
+             sscanf ( version_p, "%d.%d", &major_i, &minor_i ) == 2 &&
+             ( major_i > 2 || ( major_i == 2 && minor_i >= 1 ) ) )
+        {
+            glGenBuffers ( 2, m_pbo_p );
+            m_pboState_i = 1;
+        }
+        else
+            m_pboState_i = -1;
+    }
+
+    if ( m_pboState_i > 0 )
+    {
+        const size_t bytes_ui = ( f_image.rows - 1 ) * f_image.step +
+                                f_image.cols * f_image.elemSize();
+
+        glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, m_pbo_p[m_nextPbo_i] );
+        m_nextPbo_i = 1 - m_nextPbo_i;
+
+        /// Orphan the previous storage, so that mapping does not wait
+        /// for a transfer from it still in progress.
+        glBufferData ( GL_PIXEL_UNPACK_BUFFER, bytes_ui, NULL, GL_STREAM_DRAW );
+
+        void * dst_p = glMapBuffer ( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+
+        if ( dst_p )
+        {
+            memcpy ( dst_p, data_p, bytes_ui );
+
+            if ( glUnmapBuffer ( GL_PIXEL_UNPACK_BUFFER ) )
+            {
+                /// The data pointer is an offset into the buffer, and
+                /// the transfer runs asynchronously.
+                glTexSubImage2D( GL_TEXTURE_RECTANGLE_NV,
+                                 0, 0, 0,
+                                 f_image.cols,
+                                 f_image.rows,
+                                 f_texture.format_i,
+                                 f_texture.type_i,
+                                 NULL );
+                uploaded_b = true;
+            }
+        }
+
+        glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+#endif
+
+    if ( !uploaded_b )
+        glTexSubImage2D( GL_TEXTURE_RECTANGLE_NV,
+                         0, 0, 0,
+                         f_image.cols,
+                         f_image.rows,
+                         f_texture.format_i,
+                         f_texture.type_i,
+                         data_p );
+
+    glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+
+    glPixelTransferf ( GL_RED_SCALE,   1.f );
+    glPixelTransferf ( GL_RED_BIAS,    0.f );
+    glPixelTransferf ( GL_GREEN_SCALE, 1.f );
+    glPixelTransferf ( GL_GREEN_BIAS,  0.f );
+    glPixelTransferf ( GL_BLUE_SCALE,  1.f );
+    glPixelTransferf ( GL_BLUE_BIAS,   0.f );
+}
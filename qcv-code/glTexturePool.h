@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __GLTEXTUREPOOL_H
+#define __GLTEXTUREPOOL_H
+
+/**
+ *******************************************************************************
+ *
+ * @file glTexturePool.h
+ *
+ * \class CGLTexturePool
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Pool of rectangle textures for displaying images.
+ *
+ * Textures are kept between frames and reused for images of the same
+ * size and format, so that an image is uploaded with a sub-image update
+ * into an already allocated texture. Uploads are streamed through two
+ * pixel buffer objects used alternately: the image is copied into one
+ * buffer while the transfer from the other one may still be running.
+ *
+ * The pool counts frames with a generation number, incremented by
+ * newGeneration() when the images of a new frame are computed. A
+ * texture that already holds the same image data (same data pointer
+ * and layout) uploaded in the current generation with the same
+ * transfer is shared instead of uploaded again. This is the case, for
+ * example, when an operator shows again the same images after a mouse
+ * event. Images modified in place within a generation must therefore
+ * be added without reuse.
+ *
+ * Textures are reference counted. Textures not used for a few
+ * generations are deleted. All methods must be called with the OpenGL
+ * context current, except newGeneration().
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <vector>
+#include <opencv/cv.h>
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CGLTexturePool
+    {
+    /// Operations
+    public:
+        /// Get a texture with the image uploaded with the given OpenGL
+        /// internal format, format and type, and pixel transfer scale
+        /// and bias. If f_reuse_b is true, a texture holding the same
+        /// image of the current generation is returned without upload.
+        /// Returns 0 if the image is empty.
+        static unsigned int acquire ( const cv::Mat & f_image,
+                                      int             f_internalFormat_i,
+                                      int             f_format_i,
+                                      int             f_type_i,
+                                      float           f_scale_f  = 1.f,
+                                      float           f_bias_f   = 0.f,
+                                      bool            f_reuse_b  = true );
+
+        /// Add a user to a texture obtained with acquire.
+        static void         retain ( unsigned int f_textureId_ui );
+
+        /// Release a texture obtained with acquire or retained.
+        static void         release ( unsigned int f_textureId_ui );
+
+        /// Start a new generation. Images added from now on are
+        /// considered modified.
+        static void         newGeneration ( );
+
+    /// Private data types
+    private:
+        struct STexture
+        {
+            /// OpenGL texture id.
+            unsigned int   id_ui;
+
+            /// Size.
+            int            width_i, height_i;
+
+            /// OpenGL formats.
+            int            internalFormat_i, format_i, type_i;
+
+            /// Pixel transfer.
+            float          scale_f, bias_f;
+
+            /// Uploaded image. The reference keeps the data from being
+            /// freed and reallocated for another image while the
+            /// texture can be reused.
+            cv::Mat        source;
+
+            /// Generation of the upload.
+            unsigned int   generation_ui;
+
+            /// Last generation in which the texture was acquired.
+            unsigned int   lastUse_ui;
+
+            /// Number of users.
+            int            refCount_i;
+        };
+
+    /// Help methods
+    private:
+        static void         upload ( const STexture & f_texture,
+                                     const cv::Mat &  f_image );
+
+        static void         deleteIdle ( );
+
+    /// Private static members
+    private:
+        /// Textures of the pool.
+        static std::vector<STexture>   m_textures_v;
+
+        /// Current generation.
+        static unsigned int            m_generation_ui;
+
+        /// Pixel buffer objects for streaming.
+        static unsigned int            m_pbo_p[2];
+
+        /// Pixel buffer object for the next upload.
+        static int                     m_nextPbo_i;
+
+        /// Pixel buffer objects state: 0 not yet created, 1 ready,
+        /// -1 not supported.
+        static int                     m_pboState_i;
+    };
+}
+
+
+#endif // __GLTEXTUREPOOL_H
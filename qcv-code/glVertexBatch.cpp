@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file glVertexBatch.cpp
+ *
+ * \class CGLVertexBatch
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Interleaved vertex arrays of 2D primitives for drawing in batch.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "glheader.h"
+
+#include <stdio.h>
+
+#include "glVertexBatch.h"
+
+/// Vertex buffer objects need OpenGL 1.5. The Windows OpenGL library
+/// only exports OpenGL 1.1.
+#if !defined ( WIN32 ) && defined ( GL_VERSION_1_5 )
+#define GVB_USE_VBO
+#endif
+
+using namespace QCV;
+
+int CGLVertexBatch::m_vboState_i = 0;
+
+CGLVertexBatch::CGLVertexBatch()
+        : m_batch_v (                  ),
+          m_lastBatch_i (           -1 ),
+          m_vbo_ui (                 0 ),
+          m_modified_b (          true )
+{
+}
+
+CGLVertexBatch::CGLVertexBatch( const CGLVertexBatch & f_other )
+        : m_batch_v (         f_other.m_batch_v ),
+          m_lastBatch_i ( f_other.m_lastBatch_i ),
+          m_vbo_ui (                          0 ),
+          m_modified_b (                   true )
+{
+}
+
+CGLVertexBatch::~CGLVertexBatch()
+{
+#if defined ( GVB_USE_VBO )
+    if ( m_vbo_ui )
+        glDeleteBuffers ( 1, &m_vbo_ui );
+#endif
+}
+
+CGLVertexBatch &
+CGLVertexBatch::operator = ( const CGLVertexBatch & f_other )
+{
+    if ( this != &f_other )
+    {
+        m_batch_v     = f_other.m_batch_v;
+        m_lastBatch_i = f_other.m_lastBatch_i;
+        m_modified_b  = true;
+    }
+
+    return *this;
+}
+
+void
+CGLVertexBatch::addFront ( const CGLVertexBatch & f_other )
+{
+    for (unsigned int i = 0; i < f_other.m_batch_v.size(); ++i)
+    {
+        const SBatch & other = f_other.m_batch_v[i];
+
+        if ( other.vertex_v.empty() )
+            continue;
+
+        /// Make sure the batch exists and insert at its beginning.
+        append ( other.mode_i, other.lineWidth_f, 0 );
+
+        std::vector<SVertex> & vertex_v = m_batch_v[m_lastBatch_i].vertex_v;
+
+        vertex_v.insert ( vertex_v.begin(),
+                          other.vertex_v.begin(),
+                          other.vertex_v.end() );
+    }
+
+    m_modified_b = true;
+}
+
+void
+CGLVertexBatch::addLine ( float         f_u1_f,
+                          float         f_v1_f,
+                          float         f_u2_f,
+                          float         f_v2_f,
+                          const SRgba & f_color,
+                          float         f_lineWidth_f )
+{
+    SVertex * v_p = append ( GL_LINES, f_lineWidth_f, 2 );
+
+    v_p[0].u_f   = f_u1_f;
+    v_p[0].v_f   = f_v1_f;
+    v_p[0].color = f_color;
+
+    v_p[1].u_f   = f_u2_f;
+    v_p[1].v_f   = f_v2_f;
+    v_p[1].color = f_color;
+}
+
+void
+CGLVertexBatch::addLineLoop ( const S2D<float> * f_vertices_p,
+                              int                f_count_i,
+                              const SRgba &      f_color,
+                              float              f_lineWidth_f )
+{
+    if ( f_count_i < 2 )
+        return;
+
+    /// A loop of two vertices is a single line.
+    const int lines_i = f_count_i == 2 ? 1 : f_count_i;
+
+    SVertex * v_p = append ( GL_LINES, f_lineWidth_f, 2 * lines_i );
+
+    for (int i = 0; i < lines_i; ++i, v_p += 2)
+    {
+        const S2D<float> & p1 = f_vertices_p[i];
+        const S2D<float> & p2 = f_vertices_p[i + 1 < f_count_i ? i + 1 : 0];
+
+        v_p[0].u_f   = p1.x;
+        v_p[0].v_f   = p1.y;
+        v_p[0].color = f_color;
+
+        v_p[1].u_f   = p2.x;
+        v_p[1].v_f   = p2.y;
+        v_p[1].color = f_color;
+    }
+}
+
+void
+CGLVertexBatch::addFill ( const S2D<float> * f_vertices_p,
+                          int                f_count_i,
+                          const SRgba &      f_color )
+{
+    if ( f_count_i < 3 )
+        return;
+
+    /// Triangle fan around the first vertex.
+    SVertex * v_p = append ( GL_TRIANGLES, 0.f, 3 * ( f_count_i - 2 ) );
+
+    for (int i = 1; i < f_count_i - 1; ++i, v_p += 3)
+    {
+        v_p[0].u_f   = f_vertices_p[0].x;
+        v_p[0].v_f   = f_vertices_p[0].y;
+        v_p[0].color = f_color;
+
+        v_p[1].u_f   = f_vertices_p[i].x;
+        v_p[1].v_f   = f_vertices_p[i].y;
+        v_p[1].color = f_color;
+
+        v_p[2].u_f   = f_vertices_p[i+1].x;
+        v_p[2].v_f   = f_vertices_p[i+1].y;
+        v_p[2].color = f_color;
+    }
+}
+
+void
+CGLVertexBatch::clear ()
+{
+    /// Batches used since the last clear keep their memory for the
+    /// next frame; the others are removed.
+    for (int i = m_batch_v.size() - 1; i >= 0; --i)
+    {
+        if ( m_batch_v[i].vertex_v.empty() )
+            m_batch_v.erase ( m_batch_v.begin() + i );
+        else
+            m_batch_v[i].vertex_v.clear();
+    }
+
+    m_lastBatch_i = -1;
+    m_modified_b  = true;
+}
+
+CGLVertexBatch::SVertex *
+CGLVertexBatch::append ( int   f_mode_i,
+                         float f_lineWidth_f,
+                         int   f_count_i )
+{
+    if ( m_lastBatch_i < 0 ||
+         m_batch_v[m_lastBatch_i].mode_i      != f_mode_i ||
+         m_batch_v[m_lastBatch_i].lineWidth_f != f_lineWidth_f )
+    {
+        m_lastBatch_i = -1;
+
+        for (unsigned int i = 0; i < m_batch_v.size(); ++i)
+        {
+            if ( m_batch_v[i].mode_i      == f_mode_i &&
+                 m_batch_v[i].lineWidth_f == f_lineWidth_f )
+            {
+                m_lastBatch_i = i;
+                break;
+            }
+        }
+
+        if ( m_lastBatch_i < 0 )
+        {
+            m_batch_v.push_back ( SBatch() );
+            m_batch_v.back().mode_i      = f_mode_i;
+            m_batch_v.back().lineWidth_f = f_lineWidth_f;
+            m_lastBatch_i = m_batch_v.size() - 1;
+        }
+    }
+
+    std::vector<SVertex> & vertex_v = m_batch_v[m_lastBatch_i].vertex_v;
+
+    const unsigned int size_ui = vertex_v.size();
+    vertex_v.resize ( size_ui + f_count_i );
+
+    m_modified_b = true;
+
+    return f_count_i ? &vertex_v[size_ui] : NULL;
+}
+
+void
+CGLVertexBatch::upload () const
+{
+#if defined ( GVB_USE_VBO )
+    size_t size_ui = 0;
+
+    for (unsigned int i = 0; i < m_batch_v.size(); ++i)
+        size_ui += m_batch_v[i].vertex_v.size();
+
+    /// New storage every time, so that the upload does not wait for a
+    /// draw from the previous one still in progress.
+    glBufferData ( GL_ARRAY_BUFFER, size_ui * sizeof(SVertex), NULL, GL_STREAM_DRAW );
+
+    size_t offset_ui = 0;
+
+    for (unsigned int i = 0; i < m_batch_v.size(); ++i)
+    {
+        const std::vector<SVertex> & vertex_v = m_batch_v[i].vertex_v;
+
+        if ( vertex_v.empty() )
+            continue;
+
+        glBufferSubData ( GL_ARRAY_BUFFER,
+                          offset_ui * sizeof(SVertex),
+                          vertex_v.size() * sizeof(SVertex),
+                          &vertex_v[0] );
+
+        offset_ui += vertex_v.size();
+    }
+#endif
+}
+
+bool
+CGLVertexBatch::show () const
+{
+    bool empty_b = true;
+
+    for (unsigned int i = 0; i < m_batch_v.size() && empty_b; ++i)
+        empty_b = m_batch_v[i].vertex_v.empty();
+
+    if ( empty_b )
+        return true;
+
+    bool useVbo_b = false;
+
+#if defined ( GVB_USE_VBO )
+    if ( m_vboState_i == 0 )
+    {
+        int major_i = 0, minor_i = 0;
+        const char * version_p = (const char *) glGetString ( GL_VERSION );
+
+        if ( version_p &&
+             sscanf ( version_p, "%d.%d", &major_i, &minor_i ) == 2 &&
+             ( major_i > 1 || ( major_i == 1 && minor_i >= 5 ) ) )
+            m_vboState_i = 1;
+        else
+            m_vboState_i = -1;
+    }
+
+    if ( m_vboState_i > 0 )
+    {
+        if ( !m_vbo_ui )
+        {
+            glGenBuffers ( 1, &m_vbo_ui );
+            m_modified_b = true;
+        }
+
+        glBindBuffer ( GL_ARRAY_BUFFER, m_vbo_ui );
+
+        if ( m_modified_b )
+        {
+            upload();
+            m_modified_b = false;
+        }
+
+        useVbo_b = true;
+    }
+#endif
+
+    glEnableClientState ( GL_VERTEX_ARRAY );
+    glEnableClientState ( GL_COLOR_ARRAY );
+
+    /// Fillings first, then lines.
+    for (int pass_i = 0; pass_i < 2; ++pass_i)
+    {
+        size_t offset_ui = 0;
+
+        for (unsigned int i = 0; i < m_batch_v.size(); ++i)
+        {
+            const SBatch & batch   = m_batch_v[i];
+            const int      count_i = batch.vertex_v.size();
+
+            if ( count_i && ( batch.mode_i == GL_TRIANGLES ) == ( pass_i == 0 ) )
+            {
+                /// Offset into the buffer object or pointer into the
+                /// client memory.
+                const char * base_p = useVbo_b ?
+                    (const char *) NULL + offset_ui * sizeof(SVertex) :
+                    (const char *) &batch.vertex_v[0];
+
+                glVertexPointer ( 2, GL_FLOAT, sizeof(SVertex), base_p );
+                glColorPointer  ( 4, GL_UNSIGNED_BYTE, sizeof(SVertex),
+                                  base_p + 2 * sizeof(float) );
+
+                if ( batch.mode_i != GL_TRIANGLES )
+                    glLineWidth ( batch.lineWidth_f );
+
+                glDrawArrays ( batch.mode_i, 0, count_i );
+            }
+
+            offset_ui += count_i;
+        }
+    }
+
+    glDisableClientState ( GL_VERTEX_ARRAY );
+    glDisableClientState ( GL_COLOR_ARRAY );
+
+#if defined ( GVB_USE_VBO )
+    if ( useVbo_b )
+        glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+#endif
+
+    /// Todo: Check GL status and return value.
+    return true;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __GLVERTEXBATCH_H
+#define __GLVERTEXBATCH_H
+
+/**
+ *******************************************************************************
+ *
+ * @file glVertexBatch.h
+ *
+ * \class CGLVertexBatch
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Interleaved vertex arrays of 2D primitives for drawing in batch.
+ *
+ * Lines, outlines and fillings are converted into vertices with
+ * position and color when they are added, and kept in one array per
+ * primitive type and line width. When shown, the arrays are uploaded
+ * into a vertex buffer object if they were modified since the last
+ * call, and each array is drawn with a single call. Without vertex
+ * buffer objects the arrays are drawn from client memory.
+ *
+ * Fillings are drawn before lines. The order of elements within an
+ * array is kept.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "standardTypes.h"
+#include "colors.h"
+
+#include <vector>
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CGLVertexBatch
+    {
+    /// Constructor, Destructor
+    public:
+        /// Constructor
+        CGLVertexBatch();
+
+        /// Copy constructor. The vertex buffer object is not shared.
+        CGLVertexBatch( const CGLVertexBatch & f_other );
+
+        /// Destructor. Must be called with the OpenGL context current
+        /// if the batch was shown.
+        ~CGLVertexBatch();
+
+        /// Assignment. The vertex buffer object is not shared.
+        CGLVertexBatch & operator = ( const CGLVertexBatch & f_other );
+
+    /// Operations.
+    public:
+        /// Add the vertices of other batch before the ones of this batch.
+        void addFront ( const CGLVertexBatch & f_other );
+
+        /// Add a line.
+        void addLine ( float         f_u1_f,
+                       float         f_v1_f,
+                       float         f_u2_f,
+                       float         f_v2_f,
+                       const SRgba & f_color,
+                       float         f_lineWidth_f );
+
+        /// Add the closed outline of a polygon.
+        void addLineLoop ( const S2D<float> * f_vertices_p,
+                           int                f_count_i,
+                           const SRgba &      f_color,
+                           float              f_lineWidth_f );
+
+        /// Add the filling of a convex polygon.
+        void addFill ( const S2D<float> * f_vertices_p,
+                       int                f_count_i,
+                       const SRgba &      f_color );
+
+        /// Remove all vertices.
+        void clear ();
+
+        /// Draw all vertices. Must be called with the OpenGL context
+        /// current.
+        bool show () const;
+
+    /// Private data types
+    private:
+        struct SVertex
+        {
+            /// Position.
+            float          u_f, v_f;
+
+            /// Color.
+            SRgba          color;
+        };
+
+        struct SBatch
+        {
+            /// OpenGL primitive.
+            int                    mode_i;
+
+            /// Line width.
+            float                  lineWidth_f;
+
+            /// Interleaved vertices.
+            std::vector<SVertex>   vertex_v;
+        };
+
+    /// Help methods
+    private:
+        SVertex *   append ( int   f_mode_i,
+                             float f_lineWidth_f,
+                             int   f_count_i );
+
+        void        upload () const;
+
+    /// Private members
+    private:
+        /// Vertices per primitive type and line width.
+        std::vector<SBatch>    m_batch_v;
+
+        /// Batch of the last append.
+        int                    m_lastBatch_i;
+
+        /// Vertex buffer object.
+        mutable unsigned int   m_vbo_ui;
+
+        /// Vertices modified since the last upload.
+        mutable bool           m_modified_b;
+
+        /// Vertex buffer objects state: 0 not yet checked, 1 supported,
+        /// -1 not supported.
+        static int             m_vboState_i;
+    };
+} // Namespace QCV
+
+
+#endif // __GLVERTEXBATCH_H
@@ -27,6 +27,10 @@
  *
  * \brief Some definitions for using the opengl library.
  *
+ * Include it before any other header including GL/gl.h (e.g.
+ * <QGLContext>). Otherwise GL_GLEXT_PROTOTYPES has no effect and the
+ * extension entry points are not declared.
+ *
  ******************************************************************************/
 
 #ifndef GLHEADER
@@ -115,3 +115,13 @@ CImagePyramid::compute ( const cv::Mat &f_image )
     return true;
 }
 
+bool 
+CImagePyramid::setLevelImages ( const std::vector<cv::Mat> & f_levels_v )
+{
+    if ( f_levels_v.empty() )
+        return false;
+
+    m_images_v = f_levels_v;
+
+    return true;
+}
@@ -83,6 +83,9 @@ namespace QCV
     /// Computation
     public:
         bool        compute ( const cv::Mat &f_img );
+
+        /// Share the given level images instead of computing them.
+        bool        setLevelImages ( const std::vector<cv::Mat> & f_levels_v );
         
     /// Protected help methods.
     protected:
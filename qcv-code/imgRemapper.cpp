@@ -33,16 +33,59 @@
 #include "imgRemapper.h"
 #include <errno.h>
 #include <string.h>
+#include <algorithm>
+
+#if defined ( __unix__ ) || defined ( __APPLE__ )
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define IRM_USE_MMAP
+#endif
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+/// Magic string and header size of the compact LUT files.
+#define IRM_COMPACT_MAGIC       "QCVLUT16"
+#define IRM_COMPACT_HEADER_SIZE 64
+
+/// Rows per remap tile.
+#define IRM_ROWS_PER_TILE       16
 
 using namespace QCV;
 
+CImgRemapper::SMappedFile::SMappedFile()
+        : data_p (                  NULL ),
+          size_ui (                    0 )
+{
+}
+
+CImgRemapper::SMappedFile::~SMappedFile()
+{
+#if defined ( IRM_USE_MMAP )
+    if ( data_p )
+        munmap ( data_p, size_ui );
+#else
+    delete [] (unsigned char *) data_p;
+#endif
+}
+
 
 CImgRemapper::CImgRemapper()
         :  m_outWidth_i (              0 ),
            m_outHeight_i (             0 ),
            m_offsetU_i (               0 ),
            m_offsetV_i (               0 ),
-           m_nnInterpolation_b (   false )
+           m_nnInterpolation_b (   false ),
+           m_map1 (                       ),
+           m_map2 (                       ),
+           m_mapNN (                      ),
+           m_fixedValid_b (        false ),
+           m_mappedFile_p (               ),
+           m_prefilterLevels_i (       0 ),
+           m_prefiltered_v (              )
 {
 }
 
@@ -52,7 +95,7 @@ CImgRemapper::~CImgRemapper()
 bool
 CImgRemapper::load ( std::string f_path_str )
 {
-    FILE *file_p = fopen(f_path_str.c_str(), "r");
+    FILE *file_p = fopen(f_path_str.c_str(), "rb");
 
     if (!file_p)
     {
@@ -64,6 +107,101 @@ CImgRemapper::load ( std::string f_path_str )
         return false;
     }
 
+    char header_p[IRM_COMPACT_HEADER_SIZE+1] = {0};
+    const bool compact_b = ( fread ( header_p, IRM_COMPACT_HEADER_SIZE, 1, file_p ) == 1 &&
+                             strncmp ( header_p, IRM_COMPACT_MAGIC, strlen(IRM_COMPACT_MAGIC) ) == 0 );
+
+    if ( compact_b )
+    {
+        fclose(file_p);
+        
+        int levels_i = 0;
+        int n_i = sscanf( header_p + strlen(IRM_COMPACT_MAGIC), "%i %i\n%i %i\n%i\n", 
+                          &m_outWidth_i, 
+                          &m_outHeight_i,
+                          &m_offsetU_i,
+                          &m_offsetV_i,
+                          &levels_i );
+
+        const size_t pixels_ui = (n_i >= 4 && m_outWidth_i > 0 && m_outHeight_i > 0)?
+            (size_t) m_outWidth_i * m_outHeight_i : 0;
+        const size_t size_ui   = IRM_COMPACT_HEADER_SIZE + pixels_ui * ( 2*sizeof(short) + sizeof(unsigned short) );
+
+        cv::Ptr<SMappedFile> mapped_p ( new SMappedFile() );
+
+        if ( pixels_ui )
+        {
+#if defined ( IRM_USE_MMAP )
+            int fd_i = open ( f_path_str.c_str(), O_RDONLY );
+            struct stat stat_s;
+            
+            if ( fd_i >= 0 && fstat ( fd_i, &stat_s ) == 0 && (size_t) stat_s.st_size >= size_ui )
+            {
+                /// Private mapping: writes never reach the file.
+                void * data_p = mmap ( NULL, size_ui, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd_i, 0 );
+                
+                if ( data_p != MAP_FAILED )
+                {
+                    mapped_p -> data_p  = data_p;
+                    mapped_p -> size_ui = size_ui;
+                }
+            }
+
+            if ( fd_i >= 0 )
+                close ( fd_i );
+#else
+            file_p = fopen(f_path_str.c_str(), "rb");
+            
+            if ( file_p )
+            {
+                unsigned char * data_p = new unsigned char[size_ui];
+
+                if ( fread ( data_p, size_ui, 1, file_p ) == 1 )
+                {
+                    mapped_p -> data_p  = data_p;
+                    mapped_p -> size_ui = size_ui;
+                }
+                else
+                    delete [] data_p;
+
+                fclose(file_p);
+            }
+#endif
+        }
+
+        if ( !mapped_p -> data_p )
+        {
+            printf("Could not read compact LUT from file %s\n",
+                   f_path_str.c_str());
+            m_outWidth_i = 0;
+            m_outHeight_i = 0;
+            m_offsetU_i = 0;
+            m_offsetV_i = 0;
+            clearLuts();
+            return false;
+        }
+
+        unsigned char * data_p = (unsigned char *) mapped_p -> data_p;
+
+        m_lutU.release();
+        m_lutV.release();
+        m_mapNN.release();
+        
+        m_map1 = cv::Mat(m_outHeight_i, m_outWidth_i, CV_16SC2, 
+                         data_p + IRM_COMPACT_HEADER_SIZE );
+        m_map2 = cv::Mat(m_outHeight_i, m_outWidth_i, CV_16UC1, 
+                         data_p + IRM_COMPACT_HEADER_SIZE + pixels_ui * 2*sizeof(short) );
+
+        m_mappedFile_p = mapped_p;
+        m_fixedValid_b = true;
+
+        m_prefilterLevels_i = std::max ( levels_i, 0 );
+
+        return true;
+    }
+
+    rewind(file_p);
+
     int n_i = fscanf( file_p, "%i %i\n%i %i\n", 
                       &m_outWidth_i, 
                       &m_outHeight_i,
@@ -79,11 +217,11 @@ CImgRemapper::load ( std::string f_path_str )
         m_outHeight_i = 0;
         m_offsetU_i = 0;
         m_offsetV_i = 0;
+        clearLuts();
         return false;        
     }    
 
-    m_lutU = cv::Mat(m_outHeight_i, m_outWidth_i, CV_32FC1, cv::Scalar(-1) );
-    m_lutV = cv::Mat(m_outHeight_i, m_outWidth_i, CV_32FC1, cv::Scalar(-1) );
+    clearLuts();
 
     n_i = fread ( m_lutU.data, m_outWidth_i*m_outHeight_i*sizeof(float), 1, file_p);
 
@@ -94,25 +232,196 @@ CImgRemapper::load ( std::string f_path_str )
         fclose(file_p);
         m_outWidth_i = 0;
         m_outHeight_i = 0;         
-        
+        clearLuts();
         return false;
     }
 
     n_i = fread ( m_lutV.data, m_outWidth_i*m_outHeight_i*sizeof(float), 1, file_p);
     
+    fclose(file_p);
+
     if (n_i!=1)
     {
         printf("Could not read LUT from file %s\n",
                f_path_str.c_str());
-        fclose(file_p);
         m_outWidth_i = 0;
         m_outHeight_i = 0;         
+        clearLuts();
+        return false;
+    }
+
+    return updateFixedLuts();
+}
+
+bool
+CImgRemapper::saveCompact ( std::string f_path_str )
+{
+    if ( !m_fixedValid_b && !updateFixedLuts() )
+        return false;
+
+    FILE *file_p = fopen(f_path_str.c_str(), "wb");
+
+    if (!file_p)
+    {
+        printf("File %s could not be opened\n",
+               f_path_str.c_str());
+        printf("%s\n",
+               strerror(errno));
+        
+        return false;
+    }
+
+    /// Fixed size header so that the LUTs are aligned in the mapped
+    /// file.
+    char header_p[IRM_COMPACT_HEADER_SIZE];
+    memset ( header_p, ' ', IRM_COMPACT_HEADER_SIZE );
+    
+    int len_i = snprintf( header_p, IRM_COMPACT_HEADER_SIZE, "%s\n%i %i\n%i %i\n%i\n",
+                          IRM_COMPACT_MAGIC,
+                          m_outWidth_i, 
+                          m_outHeight_i,
+                          m_offsetU_i,
+                          m_offsetV_i,
+                          m_prefilterLevels_i );
+
+    if ( len_i > 0 && len_i < IRM_COMPACT_HEADER_SIZE )
+        header_p[len_i] = ' ';
+    header_p[IRM_COMPACT_HEADER_SIZE-1] = '\n';
+
+    bool ok_b = fwrite ( header_p, IRM_COMPACT_HEADER_SIZE, 1, file_p ) == 1;
+
+    for (int i = 0; ok_b && i < m_outHeight_i; ++i)
+        ok_b = fwrite ( m_map1.ptr(i), m_outWidth_i * 2*sizeof(short), 1, file_p ) == 1;
+
+    for (int i = 0; ok_b && i < m_outHeight_i; ++i)
+        ok_b = fwrite ( m_map2.ptr(i), m_outWidth_i * sizeof(unsigned short), 1, file_p ) == 1;
+
+    fclose(file_p);
+
+    if (!ok_b)
+    {
+        printf("Could not write LUT to file %s\n",
+               f_path_str.c_str());
         return false;
     }
 
     return true;
 }
 
+/// Bilinear interpolation of the float LUTs. Fails outside the LUT or
+/// next to invalid entries.
+static inline bool interpolateLut ( const cv::Mat & f_lutU,
+                                    const cv::Mat & f_lutV,
+                                    double          f_x_d,
+                                    double          f_y_d,
+                                    float &         fr_u_f,
+                                    float &         fr_v_f )
+{
+    if ( f_x_d < 0 || f_y_d < 0 || 
+         f_x_d > f_lutU.cols - 1 || f_y_d > f_lutU.rows - 1 )
+        return false;
+    
+    const int    x0_i = (int) f_x_d;
+    const int    y0_i = (int) f_y_d;
+    const int    x1_i = std::min ( x0_i + 1, f_lutU.cols - 1 );
+    const int    y1_i = std::min ( y0_i + 1, f_lutU.rows - 1 );
+    const double ax_d = f_x_d - x0_i;
+    const double ay_d = f_y_d - y0_i;
+
+    const float u_p[4] = { f_lutU.at<float>(y0_i, x0_i), f_lutU.at<float>(y0_i, x1_i),
+                           f_lutU.at<float>(y1_i, x0_i), f_lutU.at<float>(y1_i, x1_i) };
+    const float v_p[4] = { f_lutV.at<float>(y0_i, x0_i), f_lutV.at<float>(y0_i, x1_i),
+                           f_lutV.at<float>(y1_i, x0_i), f_lutV.at<float>(y1_i, x1_i) };
+
+    for (int k = 0; k < 4; ++k)
+        if ( u_p[k] < 0 || v_p[k] < 0 )
+            return false;
+
+    fr_u_f = (float) ( ( u_p[0] * (1-ax_d) + u_p[1] * ax_d ) * (1-ay_d) + 
+                       ( u_p[2] * (1-ax_d) + u_p[3] * ax_d ) * ay_d );
+    fr_v_f = (float) ( ( v_p[0] * (1-ax_d) + v_p[1] * ax_d ) * (1-ay_d) + 
+                       ( v_p[2] * (1-ax_d) + v_p[3] * ax_d ) * ay_d );
+
+    return true;
+}
+
+bool
+CImgRemapper::compose ( const CImgRemapper & f_source,
+                        S2D<double>          f_offset,
+                        S2D<double>          f_scale,
+                        S2D<unsigned int>    f_outputSize )
+{
+    if ( this == &f_source || f_scale.x <= 0 || f_scale.y <= 0 )
+    {
+        printf("%s:%i Invalid LUT composition.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    cv::Mat lutU = f_source.m_lutU;
+    cv::Mat lutV = f_source.m_lutV;
+
+    if ( lutU.empty() || lutV.empty() )
+    {
+        if ( !f_source.m_fixedValid_b || f_source.m_map1.empty() )
+        {
+            printf("%s:%i Source LUT is empty.\n",
+                   __FILE__, __LINE__ );
+            return false;
+        }
+        
+        cv::convertMaps( f_source.m_map1, f_source.m_map2, lutU, lutV, CV_32FC1 );
+    }
+
+    /// Each pyramid level halves the input before the remap, so
+    /// that the remap never downscales by two or more. The source
+    /// LUT might be prefiltered itself.
+    const float sourceScale_f = (float) ( 1 << f_source.m_prefilterLevels_i );
+    
+    int    levels_i   = 0;
+    double minScale_d = std::min ( f_scale.x, f_scale.y ) / sourceScale_f;
+
+    while ( minScale_d * 2 <= 1 + 1.e-6 )
+    {
+        ++levels_i;
+        minScale_d *= 2;
+    }
+
+    const float levelScale_f = sourceScale_f / ( 1 << levels_i );
+
+    m_outWidth_i  = f_outputSize.width;
+    m_outHeight_i = f_outputSize.height;
+    m_offsetU_i   = f_source.m_offsetU_i;
+    m_offsetV_i   = f_source.m_offsetV_i;
+    
+    clearLuts();
+
+    m_prefilterLevels_i = levels_i;
+
+    for (int i = 0; i < m_outHeight_i; ++i)
+    {
+        const double y_d = f_offset.y + ( i + .5 ) / f_scale.y - .5;
+        float * u_p = m_lutU.ptr<float>(i);
+        float * v_p = m_lutV.ptr<float>(i);
+        
+        for (int j = 0; j < m_outWidth_i; ++j)
+        {
+            const double x_d = f_offset.x + ( j + .5 ) / f_scale.x - .5;
+            float u_f, v_f;
+
+            if ( interpolateLut ( lutU, lutV, x_d, y_d, u_f, v_f ) )
+            {
+                /// Pixel i of a pyramid level is pixel 2i of the
+                /// level below.
+                u_p[j] = u_f * levelScale_f;
+                v_p[j] = v_f * levelScale_f;
+            }
+        }
+    }
+
+    return updateFixedLuts();
+}
+
 bool
 CImgRemapper::setOutputSize(S2D<unsigned int> f_size)
 {
@@ -133,30 +442,233 @@ CImgRemapper::clearLuts()
 {
    m_lutU = cv::Mat(m_outHeight_i, m_outWidth_i, CV_32FC1, cv::Scalar(-1) );
    m_lutV = cv::Mat(m_outHeight_i, m_outWidth_i, CV_32FC1, cv::Scalar(-1) );
+
+   m_map1.release();
+   m_map2.release();
+   m_mapNN.release();
+   m_mappedFile_p.release();
+   m_fixedValid_b = false;
+
+   m_prefilterLevels_i = 0;
+}
+
+cv::Mat &
+CImgRemapper::getLutUReference()
+{
+    ensureFloatLuts();
+    m_fixedValid_b = false;
+    return m_lutU;
+}
+
+cv::Mat &
+CImgRemapper::getLutVReference()
+{
+    ensureFloatLuts();
+    m_fixedValid_b = false;
+    return m_lutV;
+}
+
+void
+CImgRemapper::ensureFloatLuts()
+{
+    if ( m_lutU.empty() || m_lutV.empty() )
+    {
+        if ( m_fixedValid_b && !m_map1.empty() )
+            cv::convertMaps( m_map1, m_map2, m_lutU, m_lutV, CV_32FC1 );
+        else
+            clearLuts();
+    }
 }
 
 bool
-CImgRemapper::remap ( const cv::Mat &f_input,
-                      cv::Mat       &fr_output )
+CImgRemapper::updateFixedLuts()
 {
-    if ( fr_output.size() != m_lutU.size() )
+    if ( m_lutU.size() != cv::Size(m_outWidth_i, m_outHeight_i) ||
+         m_lutV.size() != m_lutU.size() )
+    {
+        printf("%s:%i LUT has wrong size.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    /// Never write into a mapped file.
+    m_map1.release();
+    m_map2.release();
+    m_mappedFile_p.release();
+
+    cv::convertMaps( m_lutU, m_lutV, m_map1, m_map2, CV_16SC2, false );
+
+    m_mapNN.release();
+    m_fixedValid_b = true;
+
+    return true;
+}
+
+bool
+CImgRemapper::prepare ( const cv::Mat &f_input,
+                        cv::Mat       &fr_output )
+{
+    if ( !m_fixedValid_b && !updateFixedLuts() )
+        return false;
+
+    if ( fr_output.size() != m_map1.size() )
     {
         printf("CImgRemapper::remap output image has wrong size.\n");
         printf("Expected image size is %i %i\n", 
-               m_lutU.size().width, m_lutU.size().height );
+               m_map1.size().width, m_map1.size().height );
         printf("Received image size is %i %i.\n", 
                fr_output.size().width, 
                fr_output.size().height );
         return false;
     }
 
-    const int interpolation_i = m_nnInterpolation_b?cv::INTER_NEAREST:cv::INTER_LINEAR;
+    /// The tiles are views of the output, so it must have the type of
+    /// the input before remapping. cv::remap would otherwise reallocate
+    /// each tile and leave the output unchanged. Does nothing if the
+    /// type already matches.
+    fr_output.create ( m_map1.size(), f_input.type() );
+
+    if ( m_nnInterpolation_b && m_mapNN.empty() && !m_lutU.empty() )
+    {
+        cv::Mat empty;
+        cv::convertMaps( m_lutU, m_lutV, m_mapNN, empty, CV_16SC2, true );
+    }
+    else if ( m_nnInterpolation_b && m_mapNN.empty() )
+    {
+        /// Compact LUT only: nearest neighbor from the fixed point
+        /// coordinates (rounded to 1/INTER_TAB_SIZE pixel).
+        m_mapNN.create ( m_map1.size(), CV_16SC2 );
         
-    cv::remap( f_input, fr_output, m_lutU, m_lutV, interpolation_i, cv::BORDER_TRANSPARENT, 0);
+        for (int i = 0; i < m_map1.rows; ++i)
+        {
+            const short *          xy_p  = m_map1.ptr<short>(i);
+            const unsigned short * idx_p = m_map2.ptr<unsigned short>(i);
+            short *                nn_p  = m_mapNN.ptr<short>(i);
+            
+            for (int j = 0; j < m_map1.cols; ++j)
+            {
+                const int frac_i = idx_p[j] & (cv::INTER_TAB_SIZE2 - 1);
+                nn_p[2*j]   = xy_p[2*j]   + ( (frac_i % cv::INTER_TAB_SIZE) >= cv::INTER_TAB_SIZE/2 );
+                nn_p[2*j+1] = xy_p[2*j+1] + ( (frac_i / cv::INTER_TAB_SIZE) >= cv::INTER_TAB_SIZE/2 );
+            }
+        }
+    }
 
     return true;
 }
 
+void
+CImgRemapper::remapRows ( const cv::Mat &f_input,
+                          cv::Mat       &fr_output,
+                          int            f_firstRow_i,
+                          int            f_lastRow_i ) const
+{
+    const cv::Range rows ( f_firstRow_i, f_lastRow_i );
+    cv::Mat dst = fr_output.rowRange ( rows );
+
+    if ( m_nnInterpolation_b )
+        cv::remap( f_input, dst, m_mapNN.rowRange ( rows ), cv::Mat(), 
+                   cv::INTER_NEAREST, cv::BORDER_TRANSPARENT, 0);
+    else
+        cv::remap( f_input, dst, m_map1.rowRange ( rows ), m_map2.rowRange ( rows ), 
+                   cv::INTER_LINEAR, cv::BORDER_TRANSPARENT, 0);
+}
+
+cv::Mat
+CImgRemapper::prefilter ( const cv::Mat &f_input,
+                          const cv::Mat &f_output )
+{
+    if ( m_prefilterLevels_i == 0 )
+    {
+        /// Tiles must not read rows already written by other tiles.
+        if ( f_input.datastart == f_output.datastart )
+            return f_input.clone();
+
+        return f_input;
+    }
+
+    m_prefiltered_v.resize ( m_prefilterLevels_i );
+
+    cv::Mat src = f_input;
+    
+    for (int l = 0; l < m_prefilterLevels_i; ++l)
+    {
+        cv::pyrDown ( src, m_prefiltered_v[l], 
+                      cv::Size ( ( src.cols + 1 ) / 2, ( src.rows + 1 ) / 2 ) );
+        src = m_prefiltered_v[l];
+    }
+
+    return src;
+}
+
+bool
+CImgRemapper::remapImages ( int                    f_count_i,
+                            CImgRemapper * const * fr_remappers_p,
+                            const cv::Mat * const *f_inputs_p,
+                            cv::Mat * const *      fr_outputs_p )
+{
+    cv::Mat inputs_p[2];
+    int     firstTile_p[3] = { 0, 0, 0 };
+
+    for (int k = 0; k < f_count_i; ++k)
+    {
+        if ( !fr_remappers_p[k] -> prepare ( *f_inputs_p[k], *fr_outputs_p[k] ) )
+            return false;
+
+        firstTile_p[k+1] = firstTile_p[k] + 
+            ( fr_outputs_p[k] -> rows + IRM_ROWS_PER_TILE - 1 ) / IRM_ROWS_PER_TILE;
+    }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(f_count_i)
+#endif
+    for (int k = 0; k < f_count_i; ++k)
+        inputs_p[k] = fr_remappers_p[k] -> prefilter ( *f_inputs_p[k], *fr_outputs_p[k] );
+
+    const int tiles_i = firstTile_p[f_count_i];
+    
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
+#endif
+    for (int t = 0; t < tiles_i; ++t)
+    {
+        const int k = ( t >= firstTile_p[1] )?1:0;
+        const int firstRow_i = ( t - firstTile_p[k] ) * IRM_ROWS_PER_TILE;
+        const int lastRow_i  = std::min ( firstRow_i + IRM_ROWS_PER_TILE, fr_outputs_p[k] -> rows );
+        
+        fr_remappers_p[k] -> remapRows ( inputs_p[k], *fr_outputs_p[k], firstRow_i, lastRow_i );
+    }
+
+    return true;
+}
+
+bool
+CImgRemapper::remap ( const cv::Mat &f_input,
+                      cv::Mat       &fr_output )
+{
+    CImgRemapper * const  remappers_p[1] = { this };
+    const cv::Mat * const inputs_p[1]    = { &f_input };
+    cv::Mat * const       outputs_p[1]   = { &fr_output };
+
+    return remapImages ( 1, remappers_p, inputs_p, outputs_p );
+}
+
+bool
+CImgRemapper::remapPair ( CImgRemapper  &fr_left,
+                          const cv::Mat &f_leftInput,
+                          cv::Mat       &fr_leftOutput,
+                          CImgRemapper  &fr_right,
+                          const cv::Mat &f_rightInput,
+                          cv::Mat       &fr_rightOutput )
+{
+    CImgRemapper * const  remappers_p[2] = { &fr_left, &fr_right };
+    const cv::Mat * const inputs_p[2]    = { &f_leftInput, &f_rightInput };
+    cv::Mat * const       outputs_p[2]   = { &fr_leftOutput, &fr_rightOutput };
+
+    return remapImages ( 2, remappers_p, inputs_p, outputs_p );
+}
+
 
 bool 
 CImgRemapper::setNNInterpolation( bool f_val_b )
@@ -32,11 +32,21 @@
 *
 * Remaps images by using the provided LUT.
 *
+* The float LUTs are converted once into the compact fixed point form
+* used internally by cv::remap (integer coordinates as CV_16SC2 plus an
+* index into the interpolation table as CV_16UC1). Images are remapped
+* in row tiles in parallel. The compact form can be saved to disk and
+* is memory-mapped when loaded back. A LUT can be composed with a crop
+* and scale, so that rectification, cropping and downscaling are done
+* in a single remap.
+*
 *******************************************************************************
 *****             (C) Hernan Badino 2011 - All Rights Reserved            *****
 ******************************************************************************/
 
 /* INCLUDES */
+#include <string>
+#include <vector>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "s2d.h"
 
@@ -52,11 +62,34 @@ namespace QCV
         ~CImgRemapper();
 
     public:
+        /// Load the LUT from a float or a compact file.
         bool load    ( std::string f_file_str  );
+
+        /// Save the LUT in compact fixed point format (native byte
+        /// order).
+        bool saveCompact ( std::string f_file_str );
         
         bool remap ( const cv::Mat  &f_input,
                      cv::Mat        &fr_output );
 
+        /// Remap the left and right images of a stereo pair in a
+        /// single parallel pass.
+        static bool remapPair ( CImgRemapper  &fr_left,
+                                const cv::Mat &f_leftInput,
+                                cv::Mat       &fr_leftOutput,
+                                CImgRemapper  &fr_right,
+                                const cv::Mat &f_rightInput,
+                                cv::Mat       &fr_rightOutput );
+
+        /// Compose the LUT of f_source with a crop and scale: output
+        /// pixel (u,v) takes the pixel of the f_source output at
+        /// f_offset + ((u,v) + 0.5) / f_scale - 0.5. Downscaling by
+        /// two or more is prefiltered with an image pyramid.
+        bool compose ( const CImgRemapper & f_source,
+                       S2D<double>          f_offset,
+                       S2D<double>          f_scale,
+                       S2D<unsigned int>    f_outputSize );
+
        void clearLuts ( );
 
     public:
@@ -79,19 +112,53 @@ namespace QCV
         int    getOffsetU() const { return m_offsetU_i; }
         int    getOffsetV() const { return m_offsetV_i; }
 
+        /// Float LUTs. Empty if the LUT was loaded from a compact
+        /// file and no reference has been requested.
         cv::Mat
                getLutU() const {return m_lutU;}
 
         cv::Mat
                getLutV() const {return m_lutV;}
 
+        /// References to the float LUTs for writing. The fixed point
+        /// LUTs are rebuilt on the next remap.
         cv::Mat &
-               getLutUReference() {return m_lutU;}
+               getLutUReference();
 
         cv::Mat &
-               getLutVReference() {return m_lutV;}
+               getLutVReference();
 
     private:
+        /// Memory-mapped file. Unmapped when the last reference is
+        /// released.
+        struct SMappedFile
+        {
+            SMappedFile();
+            ~SMappedFile();
+
+            void *   data_p;
+            size_t   size_ui;
+        };
+
+        bool   prepare ( const cv::Mat &f_input,
+                         cv::Mat       &fr_output );
+
+        bool   updateFixedLuts ( );
+
+        cv::Mat prefilter ( const cv::Mat &f_input,
+                            const cv::Mat &f_output );
+
+        void   ensureFloatLuts ( );
+
+        void   remapRows ( const cv::Mat &f_input,
+                           cv::Mat       &fr_output,
+                           int            f_firstRow_i,
+                           int            f_lastRow_i ) const;
+
+        static bool remapImages ( int                   f_count_i,
+                                  CImgRemapper * const *fr_remappers_p,
+                                  const cv::Mat * const *f_inputs_p,
+                                  cv::Mat * const       *fr_outputs_p );
         
     private:
 
@@ -115,6 +182,28 @@ namespace QCV
         
         /// NN interpolation?
         bool                  m_nnInterpolation_b;
+
+        /// Fixed point LUT: integer source coordinates.
+        cv::Mat               m_map1;
+
+        /// Fixed point LUT: interpolation table index.
+        cv::Mat               m_map2;
+
+        /// Fixed point LUT for NN interpolation.
+        cv::Mat               m_mapNN;
+
+        /// Are the fixed point LUTs up to date with the float LUTs?
+        bool                  m_fixedValid_b;
+
+        /// Memory-mapped compact file holding m_map1 and m_map2.
+        cv::Ptr<SMappedFile>  m_mappedFile_p;
+
+        /// Number of pyramid levels applied to the input before the
+        /// remap.
+        int                   m_prefilterLevels_i;
+
+        /// Prefiltered input images.
+        std::vector<cv::Mat>  m_prefiltered_v;
     };
 }
 
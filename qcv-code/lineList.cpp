@@ -52,6 +52,8 @@ CLineList::add ( const CLineList &f_otherList )
                      f_otherList.m_line_v.begin(),
                      f_otherList.m_line_v.end() );
 
+    m_batch.addFront ( f_otherList.m_batch );
+
     return true;
 }
 
@@ -75,6 +77,8 @@ CLineList::add ( float   f_u1_f,
 
     m_line_v.push_back(newLine);
 
+    m_batch.addLine ( f_u1_f, f_v1_f, f_u2_f, f_v2_f, f_color, f_lineWidth_i );
+
     return true;
 }
 
@@ -83,6 +87,7 @@ bool
 CLineList::clear ()
 {
     m_line_v.clear();
+    m_batch.clear();
     return m_line_v.size();
 }
 
@@ -91,22 +96,7 @@ bool
 CLineList::show () const
 {
     //printf("g_QGLContext_p  = %p\n",g_QGLContext_p);
-    std::vector< SLine >::const_iterator last = m_line_v.end();
-
-    for (std::vector< SLine >::const_iterator i = m_line_v.begin(); 
-         i != last; ++i )
-    {   
-        glLineWidth( i->lineWidth_f );
-        glColor4ub(i->color.r, i->color.g, i->color.b, i->color.a);
-
-        glBegin(GL_LINES);
-        glVertex2f(i->u1_f, i->v1_f);
-        glVertex2f(i->u2_f, i->v2_f);
-        glEnd();
-    }
-
-    /// Todo: Check GL status and return value.
-    return true;
+    return m_batch.show();
 }
 
 bool
@@ -43,6 +43,7 @@
 /* INCLUDES */
 #include "drawingElementList.h"
 #include "colors.h"
+#include "glVertexBatch.h"
 
 #include <vector>
 
@@ -116,6 +117,9 @@ namespace QCV
     /// Private Members
     private:
         std::vector<SLine>    m_line_v;
+
+        /// Vertices of the lines for drawing.
+        CGLVertexBatch        m_batch;
     };
 } // Namespace QCV
 
@@ -0,0 +1,713 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file medianFilter.cpp
+ *
+ * \class CMedianFilter
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief 1D and 2D median filters.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "medianFilter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE4_1__ )
+#include <smmintrin.h>
+#elif defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/// Largest window computed with a sorting network (11x11).
+#define CMF_MAX_NETWORK_SIZE    121
+
+/// Largest 1D kernel computed with a sorting network.
+#define CMF_MAX_NETWORK_SIZE_1D 9
+
+/// Largest 16 bit window computed with a sorting network (9x9). The
+/// histogram is faster for larger windows.
+#define CMF_MAX_NETWORK_SIZE_16S 81
+
+/// Fine and coarse bins of the 16 bit histograms.
+#define CMF_HIST_FINE_BINS      65536
+#define CMF_HIST_COARSE_BINS    256
+#define CMF_HIST_COARSE_SHIFT   8
+
+using namespace QCV;
+
+namespace
+{
+    /// Compare-swap of a sorting network: min to a, max to b.
+    struct SCompareSwap
+    {
+        short     a;
+        short     b;
+    };
+
+    template <typename T>
+    struct SScalarOps
+    {
+        typedef T V;
+        enum { LANES = 1 };
+
+        static inline V    load  ( const T * f_p )  { return *f_p; }
+        static inline void store ( T * f_p, V f_v ) { *f_p = f_v; }
+        static inline V    min   ( V f_a, V f_b )   { return f_b < f_a ? f_b : f_a; }
+        static inline V    max   ( V f_a, V f_b )   { return f_a < f_b ? f_b : f_a; }
+    };
+
+#if defined ( __SSE2__ )
+    struct SFloatOps
+    {
+        typedef __m128 V;
+        enum { LANES = 4 };
+
+        static inline V    load  ( const float * f_p )  { return _mm_loadu_ps ( f_p ); }
+        static inline void store ( float * f_p, V f_v ) { _mm_storeu_ps ( f_p, f_v ); }
+        static inline V    min   ( V f_a, V f_b )       { return _mm_min_ps ( f_a, f_b ); }
+        static inline V    max   ( V f_a, V f_b )       { return _mm_max_ps ( f_a, f_b ); }
+    };
+
+    struct SShortOps
+    {
+        typedef __m128i V;
+        enum { LANES = 8 };
+
+        static inline V    load  ( const short * f_p )  { return _mm_loadu_si128 ( (const __m128i *) f_p ); }
+        static inline void store ( short * f_p, V f_v ) { _mm_storeu_si128 ( (__m128i *) f_p, f_v ); }
+        static inline V    min   ( V f_a, V f_b )       { return _mm_min_epi16 ( f_a, f_b ); }
+        static inline V    max   ( V f_a, V f_b )       { return _mm_max_epi16 ( f_a, f_b ); }
+    };
+
+    struct SIntOps
+    {
+        typedef __m128i V;
+        enum { LANES = 4 };
+
+        static inline V    load  ( const int * f_p )  { return _mm_loadu_si128 ( (const __m128i *) f_p ); }
+        static inline void store ( int * f_p, V f_v ) { _mm_storeu_si128 ( (__m128i *) f_p, f_v ); }
+#if defined ( __SSE4_1__ )
+        static inline V    min   ( V f_a, V f_b )     { return _mm_min_epi32 ( f_a, f_b ); }
+        static inline V    max   ( V f_a, V f_b )     { return _mm_max_epi32 ( f_a, f_b ); }
+#else
+        static inline V    min   ( V f_a, V f_b )
+        {
+            const __m128i gt = _mm_cmpgt_epi32 ( f_a, f_b );
+            return _mm_or_si128 ( _mm_and_si128 ( gt, f_b ), _mm_andnot_si128 ( gt, f_a ) );
+        }
+        static inline V    max   ( V f_a, V f_b )
+        {
+            const __m128i gt = _mm_cmpgt_epi32 ( f_a, f_b );
+            return _mm_or_si128 ( _mm_and_si128 ( gt, f_a ), _mm_andnot_si128 ( gt, f_b ) );
+        }
+#endif
+    };
+#else
+    typedef SScalarOps<float> SFloatOps;
+    typedef SScalarOps<short> SShortOps;
+    typedef SScalarOps<int>   SIntOps;
+#endif
+}
+
+/// Network computing the median (element f_n_i/2) of f_n_i values.
+/// Built from the merge exchange sort (Knuth, Algorithm 5.2.2M),
+/// keeping only the comparisons the median depends on.
+static void buildMedianNetwork ( int                         f_n_i,
+                                 std::vector<SCompareSwap> & fr_network_v )
+{
+    std::vector<SCompareSwap> sort_v;
+
+    int t_i = 0;
+    while ( ( 1 << t_i ) < f_n_i )
+        ++t_i;
+
+    for (int p_i = t_i > 0 ? 1 << ( t_i - 1 ) : 0; p_i > 0; p_i >>= 1)
+    {
+        int q_i = 1 << ( t_i - 1 );
+        int r_i = 0;
+        int d_i = p_i;
+
+        for (;;)
+        {
+            for (int i = 0; i < f_n_i - d_i; ++i)
+            {
+                if ( ( i & p_i ) == r_i )
+                {
+                    SCompareSwap cs = { (short) i, (short) ( i + d_i ) };
+                    sort_v.push_back ( cs );
+                }
+            }
+
+            if ( q_i == p_i )
+                break;
+
+            d_i  = q_i - p_i;
+            q_i >>= 1;
+            r_i  = p_i;
+        }
+    }
+
+    std::vector<bool> needed_v ( f_n_i, false );
+    needed_v[f_n_i/2] = true;
+
+    fr_network_v.clear();
+
+    for (int k = (int) sort_v.size() - 1; k >= 0; --k)
+    {
+        const SCompareSwap & cs = sort_v[k];
+
+        if ( !needed_v[cs.a] && !needed_v[cs.b] )
+            continue;
+
+        needed_v[cs.a] = needed_v[cs.b] = true;
+        fr_network_v.push_back ( cs );
+    }
+
+    std::reverse ( fr_network_v.begin(), fr_network_v.end() );
+}
+
+/// Median networks for every odd number of values up to
+/// CMF_MAX_NETWORK_SIZE, built once at load time.
+static std::vector<SCompareSwap> g_networks_v[CMF_MAX_NETWORK_SIZE + 1];
+
+static struct SNetworkBuilder
+{
+    SNetworkBuilder()
+    {
+        for (int n = 1; n <= CMF_MAX_NETWORK_SIZE; n += 2)
+            buildMedianNetwork ( n, g_networks_v[n] );
+    }
+} g_networkBuilder;
+
+template <typename OPS>
+static inline void applyNetwork ( typename OPS::V *     fr_v_p,
+                                  const SCompareSwap *  f_network_p,
+                                  int                   f_count_i )
+{
+    for (int k = 0; k < f_count_i; ++k)
+    {
+        const SCompareSwap &  cs = f_network_p[k];
+        const typename OPS::V a  = fr_v_p[cs.a];
+        const typename OPS::V b  = fr_v_p[cs.b];
+
+        fr_v_p[cs.a] = OPS::min ( a, b );
+        fr_v_p[cs.b] = OPS::max ( a, b );
+    }
+}
+
+/// Medians of the windows of f_kw_i x f_kh_i values starting at
+/// columns f_first_i to f_last_i-1 of f_rows_p. Returns the first
+/// column not computed (less than OPS::LANES columns are left).
+template <typename T, typename OPS>
+static int networkMedians ( const T * const *                 f_rows_p,
+                            int                               f_kw_i,
+                            int                               f_kh_i,
+                            const std::vector<SCompareSwap> & f_network_v,
+                            T *                               fr_dst_p,
+                            int                               f_first_i,
+                            int                               f_last_i )
+{
+    typename OPS::V v_p[CMF_MAX_NETWORK_SIZE];
+
+    const int n_i     = f_kw_i * f_kh_i;
+    const int count_i = (int) f_network_v.size();
+    const SCompareSwap * network_p = count_i ? &f_network_v[0] : NULL;
+
+    int x = f_first_i;
+
+    for (; x + OPS::LANES <= f_last_i; x += OPS::LANES)
+    {
+        int m = 0;
+
+        for (int dy = 0; dy < f_kh_i; ++dy)
+            for (int dx = 0; dx < f_kw_i; ++dx)
+                v_p[m++] = OPS::load ( f_rows_p[dy] + x + dx );
+
+        applyNetwork<OPS> ( v_p, network_p, count_i );
+
+        OPS::store ( fr_dst_p + x, v_p[n_i/2] );
+    }
+
+    return x;
+}
+
+template <typename T>
+static inline bool isNumber ( const std::pair<T, int> & f_pair )
+{
+    return f_pair.first == f_pair.first;
+}
+
+/// Sorted distinct values of f_data_p and the rank of every value
+/// in that list. NaN values are not ordered, so they are moved out
+/// before sorting and ranked after all other values.
+template <typename T>
+static void rankValues ( const T *          f_data_p,
+                         int                f_size_i,
+                         std::vector<T> &   fr_values_v,
+                         std::vector<int> & fr_ranks_v )
+{
+    std::vector< std::pair<T, int> > sorted_v ( f_size_i );
+
+    for (int k = 0; k < f_size_i; ++k)
+        sorted_v[k] = std::make_pair ( f_data_p[k], k );
+
+    typename std::vector< std::pair<T, int> >::iterator numbersEnd =
+        std::partition ( sorted_v.begin(), sorted_v.end(), isNumber<T> );
+
+    std::sort ( sorted_v.begin(), numbersEnd );
+
+    const int numbers_i = (int) ( numbersEnd - sorted_v.begin() );
+
+    fr_values_v.clear();
+    fr_ranks_v.resize ( f_size_i );
+
+    for (int k = 0; k < numbers_i; ++k)
+    {
+        if ( fr_values_v.empty() || fr_values_v.back() < sorted_v[k].first )
+            fr_values_v.push_back ( sorted_v[k].first );
+
+        fr_ranks_v[sorted_v[k].second] = (int) fr_values_v.size() - 1;
+    }
+
+    if ( numbers_i < f_size_i )
+    {
+        fr_values_v.push_back ( sorted_v[numbers_i].first );
+
+        for (int k = numbers_i; k < f_size_i; ++k)
+            fr_ranks_v[sorted_v[k].second] = (int) fr_values_v.size() - 1;
+    }
+}
+
+static inline void updateRank ( int * fr_tree_p,
+                                int   f_size_i,
+                                int   f_rank_i,
+                                int   f_delta_i )
+{
+    for (int i = f_rank_i + 1; i <= f_size_i; i += i & -i)
+        fr_tree_p[i] += f_delta_i;
+}
+
+/// Rank of the f_order_i-th (1 based) element counted in the tree.
+/// f_top_i is the largest power of two not greater than f_size_i.
+static inline int findRank ( const int * f_tree_p,
+                             int         f_size_i,
+                             int         f_top_i,
+                             int         f_order_i )
+{
+    int pos_i = 0;
+
+    for (int step_i = f_top_i; step_i > 0; step_i >>= 1)
+    {
+        if ( pos_i + step_i <= f_size_i && f_tree_p[pos_i + step_i] < f_order_i )
+        {
+            pos_i     += step_i;
+            f_order_i -= f_tree_p[pos_i];
+        }
+    }
+
+    return pos_i;
+}
+
+/// Medians of the windows of f_kw_i x f_kh_i values starting at
+/// columns 0 to f_width_i-1 of f_rankRows_p, given as ranks into 
+/// f_values_p. The ranks inside the window are counted in the Fenwick
+/// tree fr_tree_v of f_numValues_i+1 zeros, so that moving the window
+/// and finding the median take O(log n) each. The tree is zero again 
+/// on return.
+template <typename T>
+static void slidingMedians ( const int * const * f_rankRows_p,
+                             int                 f_kw_i,
+                             int                 f_kh_i,
+                             const T *           f_values_p,
+                             int                 f_numValues_i,
+                             T *                 fr_dst_p,
+                             int                 f_width_i,
+                             std::vector<int> &  fr_tree_v )
+{
+    int * tree_p = &fr_tree_v[0];
+
+    int top_i = 1;
+    while ( 2 * top_i <= f_numValues_i )
+        top_i *= 2;
+
+    for (int dy = 0; dy < f_kh_i; ++dy)
+        for (int x = 0; x < f_kw_i; ++x)
+            updateRank ( tree_p, f_numValues_i, f_rankRows_p[dy][x], 1 );
+
+    const int order_i = f_kw_i * f_kh_i / 2 + 1;
+
+    for (int x = 0; ; ++x)
+    {
+        fr_dst_p[x] = f_values_p[findRank ( tree_p, f_numValues_i, top_i, order_i )];
+
+        if ( x + 1 == f_width_i )
+            break;
+
+        /// Replace the leftmost column by the next one.
+        for (int dy = 0; dy < f_kh_i; ++dy)
+        {
+            updateRank ( tree_p, f_numValues_i, f_rankRows_p[dy][x], -1 );
+            updateRank ( tree_p, f_numValues_i, f_rankRows_p[dy][x + f_kw_i], 1 );
+        }
+    }
+
+    /// Remove the last window.
+    for (int dy = 0; dy < f_kh_i; ++dy)
+        for (int x = f_width_i - 1; x < f_width_i - 1 + f_kw_i; ++x)
+            updateRank ( tree_p, f_numValues_i, f_rankRows_p[dy][x], -1 );
+}
+
+/// Adds (f_delta_i = 1) or removes (f_delta_i = -1) a value to the
+/// histograms. fr_lower_i counts the values in the bins below
+/// f_median_i.
+static inline void updateHistogram ( int * fr_fine_p,
+                                     int * fr_coarse_p,
+                                     int   f_bin_i,
+                                     int   f_median_i,
+                                     int & fr_lower_i,
+                                     int   f_delta_i )
+{
+    fr_fine_p[f_bin_i]                            += f_delta_i;
+    fr_coarse_p[f_bin_i >> CMF_HIST_COARSE_SHIFT] += f_delta_i;
+
+    if ( f_bin_i < f_median_i )
+        fr_lower_i += f_delta_i;
+}
+
+/// Medians of the windows of f_kw_i x f_kh_i values starting at
+/// columns 0 to f_width_i-1 of f_rows_p. The window is counted in a
+/// histogram of all 16 bit values and in a coarse histogram of the
+/// upper 8 bits (Huang's algorithm). Only the column leaving and the
+/// column entering the window are updated when it moves. The median
+/// bin of the last window is moved until it holds the median again,
+/// skipping whole coarse bins, so that it moves little for smooth
+/// images. The histograms of fr_fine_p and fr_coarse_p must be zero
+/// and are zero again on return.
+static void histogramMedians ( const short * const * f_rows_p,
+                               int                   f_kw_i,
+                               int                   f_kh_i,
+                               short *               fr_dst_p,
+                               int                   f_width_i,
+                               int *                 fr_fine_p,
+                               int *                 fr_coarse_p )
+{
+    const int offset_i = CMF_HIST_FINE_BINS / 2;
+    const int order_i  = f_kw_i * f_kh_i / 2;
+    const int size_i   = 1 << CMF_HIST_COARSE_SHIFT;
+
+    int median_i = 0;
+    int lower_i  = 0;
+
+    for (int dy = 0; dy < f_kh_i; ++dy)
+        for (int x = 0; x < f_kw_i; ++x)
+            updateHistogram ( fr_fine_p, fr_coarse_p, f_rows_p[dy][x] + offset_i,
+                              median_i, lower_i, 1 );
+
+    for (int x = 0; ; ++x)
+    {
+        /// The median bin holds the value with order_i values below.
+        while ( lower_i + fr_fine_p[median_i] <= order_i )
+        {
+            lower_i += fr_fine_p[median_i++];
+
+            while ( !( median_i & ( size_i - 1 ) ) &&
+                    lower_i + fr_coarse_p[median_i >> CMF_HIST_COARSE_SHIFT] <= order_i )
+            {
+                lower_i  += fr_coarse_p[median_i >> CMF_HIST_COARSE_SHIFT];
+                median_i += size_i;
+            }
+        }
+
+        while ( lower_i > order_i )
+        {
+            const int below_i = ( median_i >> CMF_HIST_COARSE_SHIFT ) - 1;
+
+            if ( !( median_i & ( size_i - 1 ) ) && lower_i - fr_coarse_p[below_i] > order_i )
+            {
+                lower_i  -= fr_coarse_p[below_i];
+                median_i -= size_i;
+            }
+            else
+                lower_i -= fr_fine_p[--median_i];
+        }
+
+        fr_dst_p[x] = (short) ( median_i - offset_i );
+
+        if ( x + 1 == f_width_i )
+            break;
+
+        /// Replace the leftmost column by the next one.
+        for (int dy = 0; dy < f_kh_i; ++dy)
+        {
+            updateHistogram ( fr_fine_p, fr_coarse_p, f_rows_p[dy][x] + offset_i,
+                              median_i, lower_i, -1 );
+            updateHistogram ( fr_fine_p, fr_coarse_p, f_rows_p[dy][x + f_kw_i] + offset_i,
+                              median_i, lower_i, 1 );
+        }
+    }
+
+    /// Remove the last window.
+    for (int dy = 0; dy < f_kh_i; ++dy)
+        for (int x = f_width_i - 1; x < f_width_i - 1 + f_kw_i; ++x)
+            updateHistogram ( fr_fine_p, fr_coarse_p, f_rows_p[dy][x] + offset_i,
+                              median_i, lower_i, -1 );
+}
+
+bool
+CMedianFilter::filter1D ( const int * f_src_p,
+                          int *       fr_dst_p,
+                          int         f_size_i,
+                          int         f_kernelSize_i )
+{
+    if ( f_kernelSize_i < 1 || !( f_kernelSize_i & 1 ) || f_src_p == fr_dst_p )
+    {
+        printf("%s:%i Invalid median filter parameters.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    const int h_i = f_kernelSize_i / 2;
+
+    if ( f_size_i <= 2 * h_i )
+    {
+        memcpy ( fr_dst_p, f_src_p, f_size_i * sizeof(int) );
+        return true;
+    }
+
+    memcpy ( fr_dst_p, f_src_p, h_i * sizeof(int) );
+    memcpy ( fr_dst_p + f_size_i - h_i, f_src_p + f_size_i - h_i, h_i * sizeof(int) );
+
+    /// Output i + h_i is the median of the values i to i + 2 h_i.
+    const int   width_i = f_size_i - 2 * h_i;
+    int *       dst_p   = fr_dst_p + h_i;
+
+    if ( f_kernelSize_i <= CMF_MAX_NETWORK_SIZE_1D )
+    {
+        const std::vector<SCompareSwap> & network_v = g_networks_v[f_kernelSize_i];
+
+        int x = networkMedians<int, SIntOps> ( &f_src_p, f_kernelSize_i, 1, network_v,
+                                               dst_p, 0, width_i );
+        networkMedians<int, SScalarOps<int> > ( &f_src_p, f_kernelSize_i, 1, network_v,
+                                                dst_p, x, width_i );
+    }
+    else
+    {
+        std::vector<int> values_v, ranks_v;
+        rankValues<int> ( f_src_p, f_size_i, values_v, ranks_v );
+
+        std::vector<int> tree_v ( values_v.size() + 1, 0 );
+        const int * ranks_p = &ranks_v[0];
+
+        slidingMedians<int> ( &ranks_p, f_kernelSize_i, 1, &values_v[0], (int) values_v.size(), 
+                              dst_p, width_i, tree_v );
+    }
+
+    return true;
+}
+
+namespace
+{
+    /// Row buffers of a thread.
+    template <typename T>
+    struct SRowBuffers
+    {
+        std::vector<const T *>    rows_v;
+        std::vector<const int *>  rankRows_v;
+        std::vector<int>          tree_v;
+    };
+
+    /// Row pointers and histograms of a thread.
+    struct SHistogramBuffers
+    {
+        std::vector<const short *> rows_v;
+        std::vector<int>           fine_v;
+        std::vector<int>           coarse_v;
+    };
+}
+
+template <typename T, typename OPS>
+static void filterImage ( const cv::Mat & f_padded,
+                          cv::Mat &       fr_dst,
+                          int             f_kernelSize_i )
+{
+    const bool network_b = f_kernelSize_i * f_kernelSize_i <= CMF_MAX_NETWORK_SIZE;
+
+    const std::vector<SCompareSwap> & network_v =
+        g_networks_v[network_b ? f_kernelSize_i * f_kernelSize_i : 0];
+
+    /// Ranks of the padded image for the sliding window.
+    std::vector<T>   values_v;
+    std::vector<int> ranks_v;
+
+    if ( !network_b )
+        rankValues<T> ( f_padded.ptr<T>(0), f_padded.rows * f_padded.cols, values_v, ranks_v );
+
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#else
+    const unsigned int numThreads_ui = 1;
+#endif
+
+    std::vector< SRowBuffers<T> > buffers_v ( numThreads_ui );
+
+    for (unsigned int t = 0; t < numThreads_ui; ++t)
+    {
+        buffers_v[t].rows_v.resize ( f_kernelSize_i );
+
+        if ( !network_b )
+        {
+            buffers_v[t].rankRows_v.resize ( f_kernelSize_i );
+            buffers_v[t].tree_v.assign ( values_v.size() + 1, 0 );
+        }
+    }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, 8)
+#endif
+    for (int i = 0; i < fr_dst.rows; ++i)
+    {
+#if defined ( _OPENMP )
+        SRowBuffers<T> & buffers = buffers_v[omp_get_thread_num()];
+#else
+        SRowBuffers<T> & buffers = buffers_v[0];
+#endif
+
+        T * dst_p = fr_dst.ptr<T>(i);
+
+        if ( network_b )
+        {
+            for (int dy = 0; dy < f_kernelSize_i; ++dy)
+                buffers.rows_v[dy] = f_padded.ptr<T>(i + dy);
+
+            const T * const * r_p = &buffers.rows_v[0];
+
+            int x = networkMedians<T, OPS> ( r_p, f_kernelSize_i, f_kernelSize_i, network_v,
+                                             dst_p, 0, fr_dst.cols );
+            networkMedians<T, SScalarOps<T> > ( r_p, f_kernelSize_i, f_kernelSize_i, network_v,
+                                                dst_p, x, fr_dst.cols );
+        }
+        else
+        {
+            /// The padded image is continuous.
+            for (int dy = 0; dy < f_kernelSize_i; ++dy)
+                buffers.rankRows_v[dy] = &ranks_v[( i + dy ) * f_padded.cols];
+
+            slidingMedians<T> ( &buffers.rankRows_v[0], f_kernelSize_i, f_kernelSize_i,
+                                &values_v[0], (int) values_v.size(),
+                                dst_p, fr_dst.cols, buffers.tree_v );
+        }
+    }
+}
+
+/// 16 bit images with kernels larger than CMF_MAX_NETWORK_SIZE_16S.
+static void filterImageHistogram ( const cv::Mat & f_padded,
+                                   cv::Mat &       fr_dst,
+                                   int             f_kernelSize_i )
+{
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#else
+    const unsigned int numThreads_ui = 1;
+#endif
+
+    std::vector<SHistogramBuffers> buffers_v ( numThreads_ui );
+
+    for (unsigned int t = 0; t < numThreads_ui; ++t)
+    {
+        buffers_v[t].rows_v.resize ( f_kernelSize_i );
+        buffers_v[t].fine_v.assign ( CMF_HIST_FINE_BINS, 0 );
+        buffers_v[t].coarse_v.assign ( CMF_HIST_COARSE_BINS, 0 );
+    }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, 8)
+#endif
+    for (int i = 0; i < fr_dst.rows; ++i)
+    {
+#if defined ( _OPENMP )
+        SHistogramBuffers & buffers = buffers_v[omp_get_thread_num()];
+#else
+        SHistogramBuffers & buffers = buffers_v[0];
+#endif
+
+        for (int dy = 0; dy < f_kernelSize_i; ++dy)
+            buffers.rows_v[dy] = f_padded.ptr<short>(i + dy);
+
+        histogramMedians ( &buffers.rows_v[0], f_kernelSize_i, f_kernelSize_i,
+                           fr_dst.ptr<short>(i), fr_dst.cols,
+                           &buffers.fine_v[0], &buffers.coarse_v[0] );
+    }
+}
+
+bool
+CMedianFilter::filter2D ( const cv::Mat & f_src,
+                          cv::Mat &       fr_dst,
+                          int             f_kernelSize_i )
+{
+    if ( f_kernelSize_i < 1 || !( f_kernelSize_i & 1 ) || f_src.channels() != 1 ||
+         ( f_src.depth() != CV_8U && f_src.depth() != CV_16S && f_src.depth() != CV_32F ) )
+    {
+        printf("%s:%i Invalid median filter parameters.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    if ( f_kernelSize_i == 1 || f_src.empty() )
+    {
+        f_src.copyTo ( fr_dst );
+        return true;
+    }
+
+    if ( f_src.depth() == CV_8U )
+    {
+        cv::medianBlur ( f_src, fr_dst, f_kernelSize_i );
+        return true;
+    }
+
+    const int h_i = f_kernelSize_i / 2;
+
+    cv::Mat padded;
+    cv::copyMakeBorder ( f_src, padded, h_i, h_i, h_i, h_i, cv::BORDER_REPLICATE );
+
+    fr_dst.create ( f_src.size(), f_src.type() );
+
+    if ( f_src.depth() == CV_16S && f_kernelSize_i * f_kernelSize_i > CMF_MAX_NETWORK_SIZE_16S )
+        filterImageHistogram ( padded, fr_dst, f_kernelSize_i );
+    else if ( f_src.depth() == CV_16S )
+        filterImage<short, SShortOps> ( padded, fr_dst, f_kernelSize_i );
+    else
+        filterImage<float, SFloatOps> ( padded, fr_dst, f_kernelSize_i );
+
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __MEDIANFILTER_H
+#define __MEDIANFILTER_H
+
+/**
+ *******************************************************************************
+ *
+ * @file medianFilter.h
+ *
+ * \class CMedianFilter
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief 1D and 2D median filters.
+ *
+ * Small kernels are computed with a sorting network reduced to the
+ * comparisons the median depends on. The network is applied with SSE2
+ * to several neighboring windows at once. Larger 16 bit kernels slide
+ * a two level histogram of the window along each row (Huang), so that
+ * moving the window only updates two columns. Other large kernels use
+ * a sliding window over the ranks of the values, kept in a Fenwick
+ * tree, so that moving the window and finding the median take
+ * O(log n). There, NaN values are ordered after all other values. 8 bit
+ * images are filtered with cv::medianBlur, which is already vectorized
+ * for small kernels and uses constant time histograms for large
+ * kernels.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <opencv/cv.h>
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CMedianFilter
+    {
+    /// Operations
+    public:
+        /// Median filter of a signal with an odd kernel size. The
+        /// first and last f_kernelSize_i/2 values are copied. The
+        /// whole signal is copied if it is shorter than the kernel.
+        /// In-place filtering is not allowed.
+        static bool filter1D ( const int * f_src_p,
+                               int *       fr_dst_p,
+                               int         f_size_i,
+                               int         f_kernelSize_i );
+
+        /// Median filter of an image (CV_8UC1, CV_16SC1 or CV_32FC1)
+        /// with a square odd kernel and replicated borders. In-place
+        /// filtering is allowed.
+        static bool filter2D ( const cv::Mat & f_src,
+                               cv::Mat &       fr_dst,
+                               int             f_kernelSize_i );
+    };
+}
+
+
+#endif // __MEDIANFILTER_H
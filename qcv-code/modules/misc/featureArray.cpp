@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/*@@@**************************************************************************
+ * \file  featureArray
+ * \author Hernan Badino
+ * \notes
+ *******************************************************************************
+ *****             (C) Hernan Badino 2010 - All Rights Reserved            *****
+ ******************************************************************************/
+
+/* INCLUDES */
+#include "featureArray.h"
+
+using namespace QCV;
+
+CFeatureArray::CFeatureArray ( )
+{
+}
+
+CFeatureArray::~CFeatureArray ( )
+{
+}
+
+void
+CFeatureArray::resize ( size_t f_size_ui )
+{
+    m_pos_v.resize   ( f_size_ui, cv::Point2f ( -1.f, -1.f ) );
+    m_disp_v.resize  ( f_size_ui, -1.f );
+    m_state_v.resize ( f_size_ui, (unsigned char) SFeature::FS_UNINITIALIZED );
+    m_age_v.resize   ( f_size_ui, 0 );
+    m_error_v.resize ( f_size_ui, 0.f );
+    m_frame_v.resize ( f_size_ui, 0 );
+    m_idx_v.resize   ( f_size_ui, -1 );
+}
+
+void
+CFeatureArray::clear ( )
+{
+    m_pos_v.clear();
+    m_disp_v.clear();
+    m_state_v.clear();
+    m_age_v.clear();
+    m_error_v.clear();
+    m_frame_v.clear();
+    m_idx_v.clear();
+}
+
+void
+CFeatureArray::clearFeature ( size_t f_idx_ui )
+{
+    m_pos_v[f_idx_ui]   = cv::Point2f ( -1.f, -1.f );
+    m_disp_v[f_idx_ui]  = -1.f;
+    m_state_v[f_idx_ui] = SFeature::FS_UNINITIALIZED;
+    m_age_v[f_idx_ui]   = 0;
+    m_error_v[f_idx_ui] = 0.f;
+    m_idx_v[f_idx_ui]   = -1;
+}
+
+cv::Mat
+CFeatureArray::getPositionMat ( )
+{
+    if ( m_pos_v.empty() )
+        return cv::Mat ( 1, 0, CV_32FC2 );
+
+    return cv::Mat ( 1, (int) m_pos_v.size(), CV_32FC2, &m_pos_v[0] );
+}
+
+void
+CFeatureArray::importVector ( const CFeatureVector & f_vec )
+{
+    const size_t n_ui = f_vec.size();
+
+    m_pos_v.resize   ( n_ui );
+    m_disp_v.resize  ( n_ui );
+    m_state_v.resize ( n_ui );
+    m_age_v.resize   ( n_ui );
+    m_error_v.resize ( n_ui );
+    m_frame_v.resize ( n_ui );
+    m_idx_v.resize   ( n_ui );
+
+    for (size_t i = 0; i < n_ui; ++i)
+    {
+        const SFeature & f = f_vec[i];
+        m_pos_v[i]   = cv::Point2f ( (float) f.u, (float) f.v );
+        m_disp_v[i]  = (float) f.d;
+        m_state_v[i] = (unsigned char) f.state;
+        m_age_v[i]   = f.t;
+        m_error_v[i] = (float) f.e;
+        m_frame_v[i] = (unsigned int) f.f;
+        m_idx_v[i]   = f.idx;
+    }
+}
+
+bool
+CFeatureArray::importDisparities ( const CFeatureVector & f_vec )
+{
+    if ( f_vec.size() != m_disp_v.size() )
+        return false;
+
+    for (size_t i = 0; i < f_vec.size(); ++i)
+        m_disp_v[i] = (float) f_vec[i].d;
+
+    return true;
+}
+
+void
+CFeatureArray::exportVector ( CFeatureVector & fr_vec ) const
+{
+    const size_t n_ui = m_state_v.size();
+
+    fr_vec.resize ( n_ui );
+
+    for (size_t i = 0; i < n_ui; ++i)
+    {
+        SFeature & f = fr_vec[i];
+        f.u     = m_pos_v[i].x;
+        f.v     = m_pos_v[i].y;
+        f.d     = m_disp_v[i];
+        f.t     = m_age_v[i];
+        f.e     = m_error_v[i];
+        f.f     = m_frame_v[i];
+        f.idx   = m_idx_v[i];
+        f.state = (SFeature::EFeatureState) m_state_v[i];
+    }
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __FEATUREARRAY_H
+#define __FEATUREARRAY_H
+
+/**
+ *******************************************************************************
+ *
+ * @file featureArray.h
+ *
+ * \class CFeatureArray
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Structure of arrays storage of features.
+ *
+ * Stores the attributes of SFeature in separate contiguous arrays. The
+ * image positions are stored as interleaved float pairs so that they
+ * can be passed to the OpenCV functions as a vector of cv::Point2f or
+ * viewed as a 1xN CV_32FC2 matrix without copying. States are stored as
+ * one byte per feature. Conversion functions to and from CFeatureVector
+ * are provided for the operators using the array of structures layout.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <vector>
+#include <opencv/cv.h>
+
+#include "feature.h"
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CFeatureArray
+    {
+    /// Constructors/Destructor
+    public:
+        CFeatureArray ( );
+
+        virtual ~CFeatureArray ( );
+
+    /// Operations
+    public:
+        /// Set the number of features. New features are uninitialized.
+        void    resize ( size_t f_size_ui );
+
+        /// Remove all features.
+        void    clear ( );
+
+        /// Set a feature to the uninitialized state (as SFeature::clear).
+        void    clearFeature ( size_t f_idx_ui );
+
+        /// Is the feature new or tracked?
+        bool    isActive ( size_t f_idx_ui ) const
+        {
+            return ( m_state_v[f_idx_ui] == SFeature::FS_NEW ||
+                     m_state_v[f_idx_ui] == SFeature::FS_TRACKED );
+        }
+
+        /// Copy all features from an array of structures.
+        void    importVector ( const CFeatureVector & f_vec );
+
+        /// Copy only the disparities from an array of structures of the
+        /// same size.
+        bool    importDisparities ( const CFeatureVector & f_vec );
+
+        /// Copy all features to an array of structures.
+        void    exportVector ( CFeatureVector & fr_vec ) const;
+
+    /// Sets and Gets
+    public:
+        size_t  size ( ) const { return m_state_v.size(); }
+
+        /// 1xN CV_32FC2 matrix header pointing to the positions. Only
+        /// valid until the next resize.
+        cv::Mat getPositionMat ( );
+
+        cv::Point2f &      getPosition  ( size_t f_idx_ui ) { return m_pos_v[f_idx_ui]; }
+        float &            getDisparity ( size_t f_idx_ui ) { return m_disp_v[f_idx_ui]; }
+        unsigned char &    getState     ( size_t f_idx_ui ) { return m_state_v[f_idx_ui]; }
+        int &              getAge       ( size_t f_idx_ui ) { return m_age_v[f_idx_ui]; }
+        float &            getError     ( size_t f_idx_ui ) { return m_error_v[f_idx_ui]; }
+        unsigned int &     getFrame     ( size_t f_idx_ui ) { return m_frame_v[f_idx_ui]; }
+        int &              getIndex     ( size_t f_idx_ui ) { return m_idx_v[f_idx_ui]; }
+
+        const cv::Point2f & getPosition  ( size_t f_idx_ui ) const { return m_pos_v[f_idx_ui]; }
+        float               getDisparity ( size_t f_idx_ui ) const { return m_disp_v[f_idx_ui]; }
+        unsigned char       getState     ( size_t f_idx_ui ) const { return m_state_v[f_idx_ui]; }
+        int                 getAge       ( size_t f_idx_ui ) const { return m_age_v[f_idx_ui]; }
+        float               getError     ( size_t f_idx_ui ) const { return m_error_v[f_idx_ui]; }
+        unsigned int        getFrame     ( size_t f_idx_ui ) const { return m_frame_v[f_idx_ui]; }
+        int                 getIndex     ( size_t f_idx_ui ) const { return m_idx_v[f_idx_ui]; }
+
+        /// Whole arrays.
+        std::vector<cv::Point2f> &          getPositions   ( ) { return m_pos_v; }
+        std::vector<float> &                getDisparities ( ) { return m_disp_v; }
+        std::vector<unsigned char> &        getStates      ( ) { return m_state_v; }
+        std::vector<int> &                  getAges        ( ) { return m_age_v; }
+        std::vector<float> &                getErrors      ( ) { return m_error_v; }
+
+        const std::vector<cv::Point2f> &    getPositions   ( ) const { return m_pos_v; }
+        const std::vector<float> &          getDisparities ( ) const { return m_disp_v; }
+        const std::vector<unsigned char> &  getStates      ( ) const { return m_state_v; }
+        const std::vector<int> &            getAges        ( ) const { return m_age_v; }
+        const std::vector<float> &          getErrors      ( ) const { return m_error_v; }
+
+    private:
+        /// Image positions (u,v).
+        std::vector<cv::Point2f>     m_pos_v;
+
+        /// Disparities.
+        std::vector<float>           m_disp_v;
+
+        /// States (SFeature::EFeatureState).
+        std::vector<unsigned char>   m_state_v;
+
+        /// Number of times tracked.
+        std::vector<int>             m_age_v;
+
+        /// User defined information (i.e. tracking error).
+        std::vector<float>           m_error_v;
+
+        /// Frame up to which each feature has been updated.
+        std::vector<unsigned int>    m_frame_v;
+
+        /// General flags for user's purposes.
+        std::vector<int>             m_idx_v;
+    };
+}
+
+
+#endif // __FEATUREARRAY_H
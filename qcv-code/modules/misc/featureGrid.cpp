@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/*@@@**************************************************************************
+ * \file  featureGrid
+ * \author Hernan Badino
+ * \notes
+ *******************************************************************************
+ *****             (C) Hernan Badino 2010 - All Rights Reserved            *****
+ ******************************************************************************/
+
+/* INCLUDES */
+#include <stdio.h>
+#include <math.h>
+
+#include "featureGrid.h"
+
+using namespace QCV;
+
+CFeatureGrid::CFeatureGrid ( )
+        : m_cellSize_d (         1. ),
+          m_invCellSize_d (      1. ),
+          m_cols_i (              0 ),
+          m_rows_i (              0 )
+{
+}
+
+CFeatureGrid::~CFeatureGrid ( )
+{
+}
+
+bool
+CFeatureGrid::initialize ( double f_width_d,
+                           double f_height_d,
+                           double f_cellSize_d )
+{
+    if ( f_width_d <= 0 || f_height_d <= 0 || f_cellSize_d <= 0 )
+    {
+        printf("%s:%i Invalid grid size %fx%f with cell size %f\n",
+               __FILE__, __LINE__, f_width_d, f_height_d, f_cellSize_d );
+        return false;
+    }
+
+    m_cellSize_d    = f_cellSize_d;
+    m_invCellSize_d = 1. / f_cellSize_d;
+    m_cols_i        = (int) ceil ( f_width_d  * m_invCellSize_d );
+    m_rows_i        = (int) ceil ( f_height_d * m_invCellSize_d );
+
+    m_head_v.resize ( m_cols_i * m_rows_i );
+
+    clear();
+
+    return true;
+}
+
+void
+CFeatureGrid::clear ( )
+{
+    m_head_v.assign ( m_head_v.size(), -1 );
+    m_points_v.clear();
+}
+
+void
+CFeatureGrid::getCell ( double f_u_d,
+                        double f_v_d,
+                        int &  fr_cx_i,
+                        int &  fr_cy_i ) const
+{
+    /// Clamping keeps neighbor cells adjacent for points outside the grid.
+    /// The cell coordinates are clamped before the conversion to int, 
+    /// NaN goes to cell 0.
+    const double cx_d = f_u_d * m_invCellSize_d;
+    const double cy_d = f_v_d * m_invCellSize_d;
+
+    fr_cx_i = !(cx_d > 0) ? 0 : cx_d >= m_cols_i ? m_cols_i - 1 : (int) cx_d;
+    fr_cy_i = !(cy_d > 0) ? 0 : cy_d >= m_rows_i ? m_rows_i - 1 : (int) cy_d;
+}
+
+void
+CFeatureGrid::insert ( int    f_idx_i,
+                       double f_u_d,
+                       double f_v_d )
+{
+    if ( m_head_v.empty() ) return;
+
+    int cx_i, cy_i;
+    getCell ( f_u_d, f_v_d, cx_i, cy_i );
+
+    int & head_i = m_head_v[cy_i * m_cols_i + cx_i];
+
+    SGridPoint p;
+    p.u    = f_u_d;
+    p.v    = f_v_d;
+    p.idx  = f_idx_i;
+    p.next = head_i;
+
+    head_i = (int) m_points_v.size();
+    m_points_v.push_back ( p );
+}
+
+void
+CFeatureGrid::getNeighbors ( double             f_u_d,
+                             double             f_v_d,
+                             double             f_sqDist_d,
+                             std::vector<int> & fr_idx_v ) const
+{
+    fr_idx_v.clear();
+
+    if ( m_head_v.empty() ) return;
+
+    int cx_i, cy_i;
+    getCell ( f_u_d, f_v_d, cx_i, cy_i );
+
+    const int minY_i = cy_i > 0 ? cy_i - 1 : 0;
+    const int maxY_i = cy_i < m_rows_i - 1 ? cy_i + 1 : cy_i;
+    const int minX_i = cx_i > 0 ? cx_i - 1 : 0;
+    const int maxX_i = cx_i < m_cols_i - 1 ? cx_i + 1 : cx_i;
+
+    for (int y = minY_i; y <= maxY_i; ++y)
+    {
+        for (int x = minX_i; x <= maxX_i; ++x)
+        {
+            for (int k = m_head_v[y * m_cols_i + x]; k >= 0; k = m_points_v[k].next)
+            {
+                const SGridPoint & p = m_points_v[k];
+                const double du_d = p.u - f_u_d;
+                const double dv_d = p.v - f_v_d;
+
+                if ( du_d * du_d + dv_d * dv_d <= f_sqDist_d )
+                    fr_idx_v.push_back ( p.idx );
+            }
+        }
+    }
+}
+
+bool
+CFeatureGrid::hasNeighbor ( double f_u_d,
+                            double f_v_d,
+                            double f_sqDist_d ) const
+{
+    if ( m_head_v.empty() ) return false;
+
+    int cx_i, cy_i;
+    getCell ( f_u_d, f_v_d, cx_i, cy_i );
+
+    const int minY_i = cy_i > 0 ? cy_i - 1 : 0;
+    const int maxY_i = cy_i < m_rows_i - 1 ? cy_i + 1 : cy_i;
+    const int minX_i = cx_i > 0 ? cx_i - 1 : 0;
+    const int maxX_i = cx_i < m_cols_i - 1 ? cx_i + 1 : cx_i;
+
+    for (int y = minY_i; y <= maxY_i; ++y)
+    {
+        for (int x = minX_i; x <= maxX_i; ++x)
+        {
+            for (int k = m_head_v[y * m_cols_i + x]; k >= 0; k = m_points_v[k].next)
+            {
+                const double du_d = m_points_v[k].u - f_u_d;
+                const double dv_d = m_points_v[k].v - f_v_d;
+
+                if ( du_d * du_d + dv_d * dv_d <= f_sqDist_d )
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
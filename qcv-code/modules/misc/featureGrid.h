@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __FEATUREGRID_H
+#define __FEATUREGRID_H
+
+/**
+ *******************************************************************************
+ *
+ * @file featureGrid.h
+ *
+ * \class CFeatureGrid
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Uniform grid for neighborhood queries of image points.
+ *
+ * Points are hashed into square cells of the given size. Queries with
+ * a radius not larger than the cell size only visit the 3x3 cells around
+ * the query point. Points outside the grid area are stored in the
+ * border cells.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <vector>
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CFeatureGrid
+    {
+    /// Constructors/Destructor
+    public:
+        CFeatureGrid ( );
+
+        virtual ~CFeatureGrid ( );
+
+    /// Operations
+    public:
+        /// Set the area covered by the grid and the cell size. Removes
+        /// all points.
+        bool    initialize ( double f_width_d,
+                             double f_height_d,
+                             double f_cellSize_d );
+
+        /// Remove all points.
+        void    clear ( );
+
+        /// Add a point with a user index.
+        void    insert ( int    f_idx_i,
+                         double f_u_d,
+                         double f_v_d );
+
+        /// Indices of the points with squared distance to (u,v) smaller
+        /// or equal than the given one. The distance must not be larger
+        /// than the cell size.
+        void    getNeighbors ( double             f_u_d,
+                               double             f_v_d,
+                               double             f_sqDist_d,
+                               std::vector<int> & fr_idx_v ) const;
+
+        /// Is there any point with squared distance to (u,v) smaller or
+        /// equal than the given one?
+        bool    hasNeighbor ( double f_u_d,
+                              double f_v_d,
+                              double f_sqDist_d ) const;
+
+    /// Sets and Gets
+    public:
+        double  getCellSize ( ) const { return m_cellSize_d; }
+
+        int     getNumPoints ( ) const { return (int) m_points_v.size(); }
+
+    /// Help functions
+    protected:
+        /// Cell column and row of a point.
+        void    getCell ( double f_u_d,
+                          double f_v_d,
+                          int &  fr_cx_i,
+                          int &  fr_cy_i ) const;
+
+    /// Protected data types
+    protected:
+        struct SGridPoint
+        {
+            double u;
+            double v;
+            int    idx;
+
+            /// Next point in the same cell (-1 for none).
+            int    next;
+        };
+
+    private:
+        /// Cell size [px].
+        double                    m_cellSize_d;
+
+        /// Inverse cell size.
+        double                    m_invCellSize_d;
+
+        /// Number of cell columns.
+        int                       m_cols_i;
+
+        /// Number of cell rows.
+        int                       m_rows_i;
+
+        /// First point of each cell (-1 for empty cells).
+        std::vector<int>          m_head_v;
+
+        /// Points.
+        std::vector<SGridPoint>   m_points_v;
+    };
+}
+
+
+#endif // __FEATUREGRID_H
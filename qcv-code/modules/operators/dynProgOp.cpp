@@ -33,12 +33,82 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
 #include "paramMacros.h" 
 #include "dynProgOp.h"
-#include "medf_inline.h"
+#include "medianFilter.h"
 
 using namespace QCV;
 
+#if defined ( __SSE2__ )
+/// Transition costs acc_k + nod + c * min(|j - k - grad|, T) of four 
+/// parent nodes, evaluated in the same order as the scalar expression.
+static inline __m128 transitionCost4 ( const __m128        f_accCost,
+                                       const __m128i       f_cols,
+                                       const __m128i       f_col,
+                                       const __m128        f_nodCost,
+                                       const __m128        f_currGrad,
+                                       const __m128        f_jumpCost,
+                                       const __m128        f_distTh )
+{
+    const __m128 absMask = _mm_castsi128_ps ( _mm_set1_epi32 ( 0x7fffffff ) );
+
+    __m128 dist = _mm_sub_ps ( _mm_cvtepi32_ps ( _mm_sub_epi32 ( f_col, f_cols ) ), f_currGrad );
+    dist = _mm_min_ps ( _mm_and_ps ( dist, absMask ), f_distTh );
+
+    return _mm_add_ps ( _mm_add_ps ( f_accCost, f_nodCost ),
+                        _mm_mul_ps ( f_jumpCost, dist ) );
+}
+
+/// Transition costs of four consecutive parent nodes.
+static inline __m128 transitionCost4 ( const float * const f_accCost_p,
+                                       const __m128i       f_cols,
+                                       const __m128i       f_col,
+                                       const __m128        f_nodCost,
+                                       const __m128        f_currGrad,
+                                       const __m128        f_jumpCost,
+                                       const __m128        f_distTh )
+{
+    return transitionCost4 ( _mm_loadu_ps ( f_accCost_p ), f_cols, f_col,
+                             f_nodCost, f_currGrad, f_jumpCost, f_distTh );
+}
+
+/// Keeps the lowest cost of each lane, and the lowest column on ties.
+static inline void selectBest4 ( const __m128  f_cost,
+                                 const __m128i f_cols,
+                                 __m128 &      fr_bestCost,
+                                 __m128i &     fr_bestCols )
+{
+    const __m128i take = _mm_or_si128 ( _mm_castps_si128 ( _mm_cmplt_ps ( f_cost, fr_bestCost ) ),
+                                        _mm_and_si128 ( _mm_castps_si128 ( _mm_cmpeq_ps ( f_cost, fr_bestCost ) ),
+                                                        _mm_cmplt_epi32 ( f_cols, fr_bestCols ) ) );
+
+    fr_bestCost = _mm_or_ps ( _mm_and_ps    ( _mm_castsi128_ps ( take ), f_cost ),
+                              _mm_andnot_ps ( _mm_castsi128_ps ( take ), fr_bestCost ) );
+    fr_bestCols = _mm_or_si128 ( _mm_and_si128    ( take, f_cols ),
+                                 _mm_andnot_si128 ( take, fr_bestCols ) );
+}
+
+/// Four consecutive costs of the cost image as float.
+static inline __m128 loadCost4 ( const float * const f_cost_p )
+{
+    return _mm_loadu_ps ( f_cost_p );
+}
+
+static inline __m128 loadCost4 ( const unsigned short * const f_cost_p )
+{
+    return _mm_cvtepi32_ps ( _mm_unpacklo_epi16 ( _mm_loadl_epi64 ( (const __m128i *) f_cost_p ),
+                                                  _mm_setzero_si128() ) );
+}
+#endif
+
 /* *************************** METHOD ************************************** */
 /**
  * Standardconstructor.
@@ -61,7 +131,9 @@ using namespace QCV;
  *************************************************************************** */
 CDynamicProgrammingOp::CDynamicProgrammingOp( const int f_width_i,
                                               const int f_height_i )
-        : m_nodesImg (                                              ),
+        : m_nodCostImg (                                            ),
+          m_accCostImg (                                            ),
+          m_parNodeImg (                                            ),
           m_width_i (                                     f_width_i ),
           m_height_i (                                   f_height_i ),
           m_distCost_f (                                        5.f ),
@@ -76,6 +148,11 @@ CDynamicProgrammingOp::CDynamicProgrammingOp( const int f_width_i,
           m_applyMedianFilter_b  (                             true ),
           m_medFiltHKSize_i (                                     9 ),
           m_pathTol_i (                                           5 ),
+          m_useDistTransform_b (                               true ),
+          m_fwdEnvArg_v (                                           ),
+          m_bwdEnvArg_v (                                           ),
+          m_minAccCostCol_i (                                    -1 ),
+          m_workers_v (                                             ),
           m_paramSet_p (                                       NULL )
 {
     createParamSet();
@@ -83,7 +160,9 @@ CDynamicProgrammingOp::CDynamicProgrammingOp( const int f_width_i,
 }
 
 CDynamicProgrammingOp::CDynamicProgrammingOp( )
-        : m_nodesImg (                                              ),
+        : m_nodCostImg (                                            ),
+          m_accCostImg (                                            ),
+          m_parNodeImg (                                            ),
           m_width_i (                                             8 ),
           m_height_i (                                            8 ),
           m_distCost_f (                                        5.f ),
@@ -98,6 +177,11 @@ CDynamicProgrammingOp::CDynamicProgrammingOp( )
           m_applyMedianFilter_b  (                             true ),
           m_medFiltHKSize_i (                                     9 ),
           m_pathTol_i (                                           5 ),
+          m_useDistTransform_b (                               true ),
+          m_fwdEnvArg_v (                                           ),
+          m_bwdEnvArg_v (                                           ),
+          m_minAccCostCol_i (                                    -1 ),
+          m_workers_v (                                             ),
           m_paramSet_p (                                       NULL )
 {
     createParamSet();
@@ -182,7 +266,14 @@ CDynamicProgrammingOp::createParamSet()
                        this,
                        FollowPathTolerance,
                        CDynamicProgrammingOp );
-    
+
+    ADD_BOOL_PARAMETER( "Linear Time DP", 
+                        "Relax each row with a distance transform (O(W)) instead\n"
+                        "of testing all node pairs of consecutive rows (O(W^2)).",
+                        getUseDistTransform(),
+                        this,
+                        UseDistTransform,
+                        CDynamicProgrammingOp );
 }
 
 /* *************************** METHOD ************************************** */
@@ -206,7 +297,16 @@ CDynamicProgrammingOp::createParamSet()
  *************************************************************************** */
 void CDynamicProgrammingOp::reinitialize()
 {
-    m_nodesImg = cv::Mat::zeros( m_height_i, m_width_i * sizeof ( Node ), CV_8UC1 );
+    // Rows are padded to a multiple of 8 elements so that every row of 
+    // the planes starts at an aligned address.
+    const int stride_i = (m_width_i + 7) & ~7;
+
+    m_nodCostImg = cv::Mat::zeros( m_height_i, stride_i, CV_32FC1 ).colRange(0, m_width_i);
+    m_accCostImg = cv::Mat::zeros( m_height_i, stride_i, CV_32FC1 ).colRange(0, m_width_i);
+    m_parNodeImg = cv::Mat::zeros( m_height_i, stride_i, CV_16SC1 ).colRange(0, m_width_i);
+
+    m_fwdEnvArg_v.resize  ( m_width_i );
+    m_bwdEnvArg_v.resize  ( m_width_i );
 }
 
 
@@ -226,6 +326,9 @@ void CDynamicProgrammingOp::reinitialize()
  *************************************************************************** */
 CDynamicProgrammingOp::~CDynamicProgrammingOp( )
 {
+    for (unsigned int t = 0; t < m_workers_v.size(); ++t)
+        delete m_workers_v[t];
+
     if ( !m_paramSet_p -> getParent() )
         delete m_paramSet_p;
 }
@@ -328,6 +431,100 @@ bool CDynamicProgrammingOp::setDistCostVector ( const std::vector <float> * cons
     return true;
 }
 
+/* *************************** METHOD ************************************** */
+/**
+ * Constructor of the parameter structure.
+ *
+ * \brief          Sets the default parameters of the operator.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ *************************************************************************** */
+CDynamicProgrammingOp::SParameters::SParameters()
+        : m_distCost_f (                                        5.f ),
+          m_distTh_f (                                         10.f ),
+          m_predCost_f (                                       0.5f ),
+          m_predTh_f (                                         10.f ),
+          m_initialCost_f (                                     0.f ),
+          m_minCostValue_f (                                   0.0f ),
+          m_maxCostValue_f (                                  1.e9f ),
+          m_applyMedianFilter_b  (                             true ),
+          m_medFiltKernelSize_i (                                19 ),
+          m_useDistTransform_b (                               true ),
+          m_expectedGradient_p (                               NULL ), 
+          m_distCostVector_p (                                 NULL )
+{
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Sets all parameters of the optimization at once.
+ *
+ * \brief          Sets all parameters of the optimization at once.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The distance cost vector is not checked against the 
+ *                 width of the cost image.
+ * \sa             getParameters
+ *
+ * \param[in]      f_params - New parameters.
+ * \return         true
+ *
+ *************************************************************************** */
+bool CDynamicProgrammingOp::setParameters ( const SParameters & f_params )
+{
+    setDistanceCost        ( f_params.m_distCost_f );
+    setDistanceTh          ( f_params.m_distTh_f );
+    setPredictionCost      ( f_params.m_predCost_f );
+    setPredictionTh        ( f_params.m_predTh_f );
+    setInitialCost         ( f_params.m_initialCost_f );
+    setMinCostValue        ( f_params.m_minCostValue_f );
+    setMaxCostValue        ( f_params.m_maxCostValue_f );
+    setApplyMedianFilter   ( f_params.m_applyMedianFilter_b );
+    setMedFiltKernelSize   ( f_params.m_medFiltKernelSize_i );
+    setUseDistTransform    ( f_params.m_useDistTransform_b );
+    setExpectedGradient    ( f_params.m_expectedGradient_p );
+
+    m_distCostVector_p = f_params.m_distCostVector_p;
+
+    return true;
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Returns all parameters of the optimization.
+ *
+ * \brief          Returns all parameters of the optimization.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \sa             setParameters
+ *
+ * \return         Current parameters.
+ *
+ *************************************************************************** */
+CDynamicProgrammingOp::SParameters 
+CDynamicProgrammingOp::getParameters ( ) const
+{
+    SParameters params;
+
+    params.m_distCost_f          = getDistanceCost();
+    params.m_distTh_f            = getDistanceTh();
+    params.m_predCost_f          = getPredictionCost();
+    params.m_predTh_f            = getPredictionTh();
+    params.m_initialCost_f       = getInitialCost();
+    params.m_minCostValue_f      = getMinCostValue();
+    params.m_maxCostValue_f      = getMaxCostValue();
+    params.m_applyMedianFilter_b = getApplyMedianFilter();
+    params.m_medFiltKernelSize_i = getMedFiltKernelSize();
+    params.m_useDistTransform_b  = getUseDistTransform();
+    params.m_expectedGradient_p  = getExpectedGradient();
+    params.m_distCostVector_p    = getDistCostVector();
+
+    return params;
+}
+
 /******************************/
 /*    COMPUTE METHODS         */
 /******************************/
@@ -343,7 +540,7 @@ bool CDynamicProgrammingOp::setDistCostVector ( const std::vector <float> * cons
  * \author         Hernan Badino
  * \date           08.03.2009
  *
- * \note           -
+ * \note           The cost image can be of type CV_32FC1 or CV_16UC1.
  * \remarks        -
  * \sa             -
  *
@@ -358,6 +555,29 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
                                   std::vector<int>       & fr_vecRes,
                                   const std::vector<int> & f_followPath,
                                   const std::vector<int> & f_pathTolVector )
+{
+    if ( f_costImg.type() == CV_32FC1 )
+        return computeT<float> ( f_costImg, 
+                                 fr_vecRes, 
+                                 f_followPath, 
+                                 f_pathTolVector );
+
+    if ( f_costImg.type() == CV_16UC1 )
+        return computeT<unsigned short> ( f_costImg, 
+                                          fr_vecRes, 
+                                          f_followPath, 
+                                          f_pathTolVector );
+
+    printf("Cost image must be of type CV_32FC1 or CV_16UC1.\n");
+    return false;
+}
+
+template <typename CostType_>
+bool 
+CDynamicProgrammingOp::computeT ( const cv::Mat          & f_costImg,
+                                  std::vector<int>       & fr_vecRes,
+                                  const std::vector<int> & f_followPath,
+                                  const std::vector<int> & f_pathTolVector )
 {
     if ( (int) fr_vecRes.size()      < m_height_i ||
          (int) f_costImg.size().width  < m_width_i || 
@@ -383,25 +603,32 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
         return false;
     }
 
-    if ( m_auxVector.size() < fr_vecRes.size() )
-    {
-        m_auxVector.resize( fr_vecRes.size() );
-    }
+    /// Exactly one entry per row. Rows without a valid node keep the
+    /// value the result vector had on entry, i.e. the previous result
+    /// when it is passed back as prediction.
+    m_auxVector.assign ( fr_vecRes.begin(), fr_vecRes.begin() + m_height_i );
 
     int      i, j, k;
-    float    newCost_f;
+    float    cost_f;
     float    node2nodeDist_f;
     int      startCol_i = 0, endCol_i = m_width_i - 1;
     int      startColPrevRow_i = 0, endColPrevRow_i = m_width_i - 1;
     int      startColThisRow_i, endColThisRow_i;
     int      tolerance_i = m_pathTol_i;
 
+    const CostType_ * cost_p;
+    float           * nodCost_p;
+    float           * accCost_p;
+    short int       * parNode_p;
+    const float     * prevAccCost_p;
+
     /// Set the current expected gradient of the solution to 0.
     float    currGrad_f = 0.;
 
     /// Set the jump cost equal to the default distance cost.
     float    jumpCost_f = m_distCost_f;
-    const std::vector<float> jumpCostVec = m_distCostVector_p?*m_distCostVector_p:std::vector<float>(0);
+    const float * const jumpCostVec_p = 
+        ( m_distCostVector_p && m_distCostVector_p->size() )?&(*m_distCostVector_p)[0]:NULL;
 
     // Lets start with the first row.
 
@@ -409,8 +636,6 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
     startColThisRow_i= -1;
     endColThisRow_i  = -1;
 
-    //m_nodesImg.clear();
-
     for (i = 0;  i < m_height_i && startColThisRow_i == -1; ++i)
     {
         // Set first limits to startCol and endCol if required.
@@ -426,16 +651,23 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
             if (endCol_i < 0 || endCol_i >= m_width_i) endCol_i = m_width_i - 1;
             
         }
+
+        cost_p    = f_costImg.ptr<CostType_>(i);
+        nodCost_p = m_nodCostImg.ptr<float>(i);
+        accCost_p = m_accCostImg.ptr<float>(i);
+        parNode_p = m_parNodeImg.ptr<short int>(i);
         
         //printf("Starting in col %i ending in col %i (init)\n", 
         //           startCol_i, endCol_i );
         for (j = startCol_i; j <= endCol_i; ++j)
         {
+            cost_f = cost_p[j];
+
             // Check first if this cost can be considered as valid.
-            if ( f_costImg.at<float>(i,j) > m_minCostValue_f && 
-                 f_costImg.at<float>(i,j) <= m_maxCostValue_f )
+            if ( cost_f > m_minCostValue_f && 
+                 cost_f <= m_maxCostValue_f )
             {            
-                m_nodesImg.at<Node>(i,j).m_nodCost_f = f_costImg.at<float>(i,j);
+                nodCost_p[j] = cost_f;
                 
                 // Up to now the last row is this row.
                 endColThisRow_i = j;
@@ -444,7 +676,7 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
                 {
                     // For the first column we reduce some cost in order to be robust against noise
                     // in the same row.
-                    m_nodesImg.at<Node>(i,j).m_nodCost_f += m_initialCost_f;
+                    nodCost_p[j] += m_initialCost_f;
                     
                     startColThisRow_i = j;
                 }        
@@ -454,19 +686,19 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
                 {
                     node2nodeDist_f = fabs(fr_vecRes[i] - j);
                     
-                    m_nodesImg.at<Node>(i,j).m_nodCost_f += m_predCost_f * std::min(node2nodeDist_f, m_predTh_f);
+                    nodCost_p[j] += m_predCost_f * std::min(node2nodeDist_f, m_predTh_f);
                 }
                 
                 // Update accumulated cost = current cost.
-                m_nodesImg.at<Node>(i,j).m_accCost_f = m_nodesImg.at<Node>(i,j).m_nodCost_f;
+                accCost_p[j] = nodCost_p[j];
                 
                 // Parent node is the base node.
-                m_nodesImg.at<Node>(i,j).m_parNode_i = -1;   
+                parNode_p[j] = -1;   
             }
             else
             {                
-                m_nodesImg.at<Node>(i,j).m_nodCost_f = m_maxCostValue_f;
-                m_nodesImg.at<Node>(i,j).m_parNode_i = -1;
+                nodCost_p[j] = m_maxCostValue_f;
+                parNode_p[j] = -1;
             }
         }
     }
@@ -480,9 +712,9 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
     {
         if (startColThisRow_i == -1)
         {
-            m_nodesImg.at<Node>(i,startCol_i).m_parNode_i = -1;
-            m_nodesImg.at<Node>(i,startCol_i).m_nodCost_f = 0;
-            m_nodesImg.at<Node>(i,startCol_i).m_accCost_f = 0;
+            m_parNodeImg.at<short int>(i,startCol_i) = -1;
+            m_nodCostImg.at<float>(i,startCol_i)     = 0;
+            m_accCostImg.at<float>(i,startCol_i)     = 0;
             
             //startColThisRow_i = endColThisRow_i = startCol_i;
             printf("Aborting DP optimization because there is no valid node on row %i\n", i-1);            
@@ -518,18 +750,152 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
         startColThisRow_i = -1;
         endColThisRow_i   = -1;
 
-        for (j = startCol_i; j <= endCol_i; ++j)
+        cost_p        = f_costImg.ptr<CostType_>(i);
+        nodCost_p     = m_nodCostImg.ptr<float>(i);
+        accCost_p     = m_accCostImg.ptr<float>(i);
+        parNode_p     = m_parNodeImg.ptr<short int>(i);
+        prevAccCost_p = m_accCostImg.ptr<float>(i-1);
+
+        // The lower envelopes of the previous row are shared by all 
+        // nodes of this row. They are only valid for non-negative 
+        // jump costs.
+        if (jumpCostVec_p)
+            jumpCost_f = jumpCostVec_p[i-1];
+
+        const bool useDT_b = m_useDistTransform_b && jumpCost_f >= 0.f;
+
+        if ( useDT_b )
+            computeEnvelopes ( prevAccCost_p, 
+                               startColPrevRow_i, 
+                               endColPrevRow_i, 
+                               jumpCost_f );
+
+        j = startCol_i;
+
+#if defined ( __SSE2__ )
+        /// Four nodes at a time. Node costs, parent candidates and 
+        /// accumulated costs are evaluated with the same expressions as
+        /// the scalar loop below, so that the result is the same.
+        if ( useDT_b )
         {
-            // Check first if this cost can be considered as valid.
-            //if ( f_costImg.at<float>(i,j) < m_minCostValue_f ||
-            //     f_costImg.at<float>(i,j) > m_maxCostValue_f )
-            //    continue;
+            const __m128   minCost   = _mm_set1_ps ( m_minCostValue_f );
+            const __m128   maxCost   = _mm_set1_ps ( m_maxCostValue_f );
+            const __m128   initCost  = _mm_set1_ps ( m_initialCost_f );
+            const __m128   currGrad  = _mm_set1_ps ( currGrad_f );
+            const __m128   jumpCost  = _mm_set1_ps ( jumpCost_f );
+            const __m128   distTh    = _mm_set1_ps ( m_distTh_f );
+            const bool     usePred_b = fr_vecRes[i] >= 0 && m_predCost_f;
+            const __m128i  pred      = _mm_set1_epi32 ( fr_vecRes[i] );
+            const __m128   predCost  = _mm_set1_ps ( m_predCost_f );
+            const __m128   predTh    = _mm_set1_ps ( m_predTh_f );
+            const __m128   absMask   = _mm_castsi128_ps ( _mm_set1_epi32 ( 0x7fffffff ) );
+            const __m128i  minAccCol = _mm_set1_epi32 ( m_minAccCostCol_i );
+            const __m128   minAcc    = _mm_set1_ps ( prevAccCost_p[m_minAccCostCol_i] );
+            const int    * fwdArg_p  = &m_fwdEnvArg_v[0];
+            const int    * bwdArg_p  = &m_bwdEnvArg_v[0];
+
+            int split_p[4], candA_p[4], candB_p[4];
+
+            for (; j + 3 <= endCol_i; j += 4)
+            {
+                const __m128i cols   = _mm_setr_epi32 ( j, j+1, j+2, j+3 );
+                const __m128  cost   = loadCost4 ( cost_p + j );
+                const __m128  valid  = _mm_and_ps ( _mm_cmpgt_ps ( cost, minCost ),
+                                                    _mm_cmple_ps ( cost, maxCost ) );
+                const int     mask_i = _mm_movemask_ps ( valid );
+
+                __m128 nod = cost;
+
+                if ( mask_i )
+                {
+                    int l = 3;
+                    while ( !( mask_i & ( 1 << l ) ) ) --l;
+
+                    // Up to now the last row is this row.
+                    endColThisRow_i = j + l;
+
+                    if ( startColThisRow_i < 0 )
+                    {
+                        for (l = 0; !( mask_i & ( 1 << l ) ); ++l);
+
+                        startColThisRow_i = j + l;
+
+                        // Initial cost for the first column only.
+                        const __m128 first = _mm_castsi128_ps ( _mm_cmpeq_epi32 ( cols, _mm_set1_epi32 ( j + l ) ) );
+                        nod = _mm_or_ps ( _mm_and_ps    ( first, _mm_add_ps ( nod, initCost ) ),
+                                          _mm_andnot_ps ( first, nod ) );
+                    }
+
+                    // Add prediction cost with saturation.
+                    if ( usePred_b )
+                    {
+                        const __m128 dist = _mm_and_ps ( _mm_cvtepi32_ps ( _mm_sub_epi32 ( pred, cols ) ), absMask );
+                        nod = _mm_add_ps ( nod, _mm_mul_ps ( predCost, _mm_min_ps ( dist, predTh ) ) );
+                    }
+
+                    // Candidates of findBestParent. Missing candidates
+                    // are replaced by the minimum accumulated cost node.
+                    const __m128 x     = _mm_sub_ps ( _mm_cvtepi32_ps ( cols ), currGrad );
+                    __m128i      split = _mm_cvttps_epi32 ( x );
+                    split = _mm_add_epi32 ( split, _mm_castps_si128 ( _mm_cmpgt_ps ( _mm_cvtepi32_ps ( split ), x ) ) );
+                    _mm_storeu_si128 ( (__m128i *) split_p, split );
+
+                    for (l = 0; l < 4; ++l)
+                    {
+                        const int split_i = split_p[l];
+
+                        candA_p[l] = ( split_i >= startColPrevRow_i ) ?
+                            fwdArg_p[std::min(split_i, endColPrevRow_i)] : m_minAccCostCol_i;
+                        candB_p[l] = ( split_i < endColPrevRow_i ) ?
+                            bwdArg_p[std::max(split_i+1, startColPrevRow_i)] : m_minAccCostCol_i;
+                    }
+
+                    const __m128i candA = _mm_loadu_si128 ( (const __m128i *) candA_p );
+                    const __m128i candB = _mm_loadu_si128 ( (const __m128i *) candB_p );
+
+                    const __m128 accA = _mm_setr_ps ( prevAccCost_p[candA_p[0]], prevAccCost_p[candA_p[1]],
+                                                      prevAccCost_p[candA_p[2]], prevAccCost_p[candA_p[3]] );
+                    const __m128 accB = _mm_setr_ps ( prevAccCost_p[candB_p[0]], prevAccCost_p[candB_p[1]],
+                                                      prevAccCost_p[candB_p[2]], prevAccCost_p[candB_p[3]] );
+
+                    __m128  bestCost = transitionCost4 ( accA, candA, cols, nod, currGrad, jumpCost, distTh );
+                    __m128i bestCols = candA;
+
+                    selectBest4 ( transitionCost4 ( accB, candB, cols, nod, currGrad, jumpCost, distTh ),
+                                  candB, bestCost, bestCols );
+                    selectBest4 ( transitionCost4 ( minAcc, minAccCol, cols, nod, currGrad, jumpCost, distTh ),
+                                  minAccCol, bestCost, bestCols );
+
+                    // Parent and accumulated cost of the valid nodes.
+                    const __m128i valid16 = _mm_packs_epi32 ( _mm_castps_si128 ( valid ), _mm_castps_si128 ( valid ) );
+                    const __m128i par16   = _mm_packs_epi32 ( bestCols, bestCols );
+                    const __m128i oldPar  = _mm_loadl_epi64 ( (const __m128i *) ( parNode_p + j ) );
+                    const __m128  oldAcc  = _mm_loadu_ps ( accCost_p + j );
+
+                    _mm_storel_epi64 ( (__m128i *) ( parNode_p + j ),
+                                       _mm_or_si128 ( _mm_and_si128    ( valid16, par16 ),
+                                                      _mm_andnot_si128 ( valid16, oldPar ) ) );
+                    _mm_storeu_ps ( accCost_p + j,
+                                    _mm_or_ps ( _mm_and_ps    ( valid, bestCost ),
+                                                _mm_andnot_ps ( valid, oldAcc ) ) );
+                }
+
+                _mm_storeu_ps ( nodCost_p + j,
+                                _mm_or_ps ( _mm_and_ps    ( valid, nod ),
+                                            _mm_andnot_ps ( valid, maxCost ) ) );
+            }
+        }
+#endif
+
+        for (; j <= endCol_i; ++j)
+        {
+            cost_f = cost_p[j];
 
             // Check first if this cost can be considered as valid.
-            if ( f_costImg.at<float>(i,j) > m_minCostValue_f &&
-                 f_costImg.at<float>(i,j) <= m_maxCostValue_f )
+            if ( cost_f > m_minCostValue_f &&
+                 cost_f <= m_maxCostValue_f )
             {
-                m_nodesImg.at<Node>(i,j).m_nodCost_f = f_costImg.at<float>(i,j);
+                nodCost_p[j] = cost_f;
 
                 // Up to now the last row is this row.
                 endColThisRow_i = j;
@@ -538,7 +904,7 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
                 {
                     // For the first column we reduce some cost in order to be robust against noise
                     // in the same row.
-                    m_nodesImg.at<Node>(i,j).m_nodCost_f += m_initialCost_f;
+                    nodCost_p[j] += m_initialCost_f;
                         
                     startColThisRow_i = j;
                 }
@@ -547,56 +913,40 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
                 if ( fr_vecRes[i] >= 0 && m_predCost_f )
                 {
                     node2nodeDist_f = fabs(fr_vecRes[i] - j);
-                    m_nodesImg.at<Node>(i,j).m_nodCost_f += m_predCost_f * std::min(node2nodeDist_f, m_predTh_f);
+                    nodCost_p[j] += m_predCost_f * std::min(node2nodeDist_f, m_predTh_f);
                 }                    
 
-                // Per default the parent node is the first one, i.e.
-                // the node corresponding to first valid cell in the 
-                // previous row.
-                m_nodesImg.at<Node>(i,j).m_parNode_i  = startColPrevRow_i;
-                    
-                // Initial cost (of the current parent node).
-
-                if (jumpCostVec.size())
-                    jumpCost_f = jumpCostVec[i-1];
-                    
-                node2nodeDist_f = fabs(j - startColPrevRow_i - currGrad_f);
-
-                newCost_f = ( // Accumulated Cost.
-                    m_nodesImg.at<Node>(i-1,startColPrevRow_i).m_accCost_f + 
+                // Best parent node in the previous row. Ties are 
+                // resolved in favour of the leftmost node.
+                if ( useDT_b )
+                    k = findBestParent ( prevAccCost_p,
+                                         nodCost_p[j],
+                                         j,
+                                         startColPrevRow_i, 
+                                         endColPrevRow_i,
+                                         currGrad_f,
+                                         jumpCost_f );
+                else
+                    k = findBestParentExhaustive ( prevAccCost_p,
+                                                   nodCost_p[j],
+                                                   j,
+                                                   startColPrevRow_i, 
+                                                   endColPrevRow_i,
+                                                   currGrad_f,
+                                                   jumpCost_f );
+
+                node2nodeDist_f = fabs(j - k - currGrad_f);
+
+                parNode_p[j] = k;
+                accCost_p[j] = ( // Accumulated Cost.
+                        prevAccCost_p[k] +
                         // Local Cost.
-                    m_nodesImg.at<Node>(i  ,j).m_nodCost_f +
+                        nodCost_p[j] +
                         // Smoothness cost with saturation.
-                        jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) ); 
-                    
-                m_nodesImg.at<Node>(i,j).m_accCost_f = newCost_f;
-                    
-                for (k = startColPrevRow_i+1; k <= endColPrevRow_i; ++k)
-                {
-                    if (jumpCostVec.size())
-                        jumpCost_f = jumpCostVec[i-1];
-                    //printf("%i, %i %i jumpCost_f = %f (size vec: %i)\n", i,j,k, jumpCost_f, jumpCostVec.size());
-                        
-                    // then compute new cost...
-                    node2nodeDist_f = fabs(j - k - currGrad_f);
-                    newCost_f = ( 
-                            // Accumulated Cost. 
-                        m_nodesImg.at<Node>(i-1,k).m_accCost_f +
-                            // Local Cost.
-                        m_nodesImg.at<Node>(i  ,j).m_nodCost_f +
-                            // Smoothness cost with saturation.
-                            jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) );
-                        
-                    // and check if it is better than the current one.
-                    if ( newCost_f < m_nodesImg.at<Node>(i,j).m_accCost_f )
-                    {
-                        m_nodesImg.at<Node>(i,j).m_accCost_f = newCost_f;
-                        m_nodesImg.at<Node>(i,j).m_parNode_i = k;                            
-                    }                
-                }
+                        jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) );
             }
             else
-                m_nodesImg.at<Node>(i,j).m_nodCost_f = m_maxCostValue_f;
+                nodCost_p[j] = m_maxCostValue_f;
         }
     }
 
@@ -612,12 +962,6 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
         --i;
         startColThisRow_i = startColPrevRow_i;
         endColThisRow_i   = endColPrevRow_i;
-//         m_nodesImg.at<Node>(i,startCol_i).m_parNode_i = startColPrevRow_i;
-//         m_nodesImg.at<Node>(i,startCol_i).m_nodCost_f = m_nodesImg.at<Node>(i-1,startColPrevRow_i).m_nodCost_f;
-//         m_nodesImg.at<Node>(i,startCol_i).m_accCost_f = m_nodesImg.at<Node>(i-1,startColPrevRow_i).m_nodCost_f;
-        
-//         startColThisRow_i = endColThisRow_i = startCol_i;
-        //return false;
     }   
 
     // Lets search now the best path (lowest cost).
@@ -628,14 +972,16 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
     int      f_bestNode_i = -1;
     bool     f_uninit_b = true;
     float    minAccCost_f = 0;
+
+    accCost_p = m_accCostImg.ptr<float>(i);
     
     for (j = startColThisRow_i; j <= endColThisRow_i; ++j)
     {
-        if ( m_nodesImg.at<Node>(i,j).m_accCost_f < minAccCost_f || 
+        if ( accCost_p[j] < minAccCost_f || 
              f_uninit_b )
         {
             f_uninit_b = false;
-            minAccCost_f  = m_nodesImg.at<Node>(i,j).m_accCost_f;
+            minAccCost_f  = accCost_p[j];
             f_bestNode_i = j;
         }        
     }
@@ -652,7 +998,7 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
     for (; i >= firstValidRow_i; --i)
     {        
         m_auxVector[i] = f_bestNode_i;
-        f_bestNode_i = m_nodesImg.at<Node>(i,f_bestNode_i).m_parNode_i;
+        f_bestNode_i = m_parNodeImg.at<short int>(i,f_bestNode_i);
 
         if (i > firstValidRow_i && (f_bestNode_i < 0 || f_bestNode_i >= m_width_i))
         {
@@ -665,41 +1011,451 @@ CDynamicProgrammingOp::compute (  const cv::Mat          & f_costImg,
 
     if (m_applyMedianFilter_b)
     {
-        int f_array_a[DP4F_MAX_MEDFILT_KERNEL_SIZE];
-        int f_filtSize_i = m_medFiltHKSize_i * 2 + 1;
-        int f_lastElem_i = m_height_i-m_medFiltHKSize_i;
-        int f_min_i, f_max_i;
-        f_min_i = 0;
-        f_max_i = f_filtSize_i-1;
-
-        // Copy left part of vector.
-        for (i = 0; i < m_medFiltHKSize_i; ++i)
+        CMedianFilter::filter1D ( &m_auxVector[0], &fr_vecRes[0], 
+                                  m_height_i, m_medFiltHKSize_i * 2 + 1 );
+    }
+    else
+    {
+        for (int i = 0; i < m_height_i; ++i)
+        {
             fr_vecRes[i] = m_auxVector[i];
-       
-        while (i < f_lastElem_i)
-        {   
-            for (j = f_min_i; j <= f_max_i; ++j)
-                f_array_a[j-f_min_i] = m_auxVector[j];
+        }
+    }
 
-            fr_vecRes[i] = median_filter(f_array_a, f_filtSize_i);
-            
-            ++i;
-            ++f_min_i;
-            ++f_max_i;
+    return true;
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Computes dynamic programming on a set of independent cost images.
+ *
+ * \brief          Computes dynamic programming on a set of cost images.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The optimizations are distributed over the available 
+ *                 cores. Every thread owns a private instance of this 
+ *                 class as scratch graph, which is kept between calls. 
+ *                 The cost images may have different sizes. If 
+ *                 f_params_v is empty the parameters of this object are 
+ *                 used for all images, otherwise it must contain one 
+ *                 element per image. Each path vector is the prediction
+ *                 and the output of its image as in compute(). The path
+ *                 of a failed optimization is set to -1.
+ * \sa             compute
+ *
+ * \param[in]      f_costImgs_v - Cost images (CV_32FC1 or CV_16UC1).
+ * \param[in,out]  fr_paths_v   - Predictions and output paths.
+ * \param[in]      f_params_v   - Parameters of each optimization.
+ * \return         true if all optimizations succeeded.
+ *
+ *************************************************************************** */
+bool
+CDynamicProgrammingOp::computeBatch ( const std::vector<cv::Mat>         & f_costImgs_v,
+                                      std::vector< std::vector<int> >    & fr_paths_v,
+                                      const std::vector<SParameters>     & f_params_v )
+{
+    const int numImgs_i = (int) f_costImgs_v.size();
+
+    if ( f_params_v.size() != 0 && 
+         (int) f_params_v.size() != numImgs_i )
+    {
+        printf("Number of parameters (%i) does not match number of cost images (%i).\n",
+               (int) f_params_v.size(), numImgs_i );
+        return false;
+    }
+
+    fr_paths_v.resize ( numImgs_i );
+
+    for (int n = 0; n < numImgs_i; ++n)
+    {
+        if ( (int) fr_paths_v[n].size() < f_costImgs_v[n].rows )
+            fr_paths_v[n].resize ( f_costImgs_v[n].rows, -1 );
+    }
+
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = std::min(omp_get_max_threads(), DP4F_MAX_CORES);
+#else
+    const unsigned int numThreads_ui = 1;
+#endif
+
+    /// Scratch graphs are created once and reused in later calls.
+    while ( m_workers_v.size() < numThreads_ui )
+        m_workers_v.push_back ( new CDynamicProgrammingOp ( m_width_i, m_height_i ) );
+
+    const SParameters defParams = getParameters();
+    int failed_i = 0;
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic) reduction(+:failed_i)
+#endif
+    for (int n = 0; n < numImgs_i; ++n)
+    {
+#if defined ( _OPENMP )
+        const unsigned int threadNum_ui = omp_get_thread_num();
+#else
+        const unsigned int threadNum_ui = 0;
+#endif
+        CDynamicProgrammingOp & worker = *m_workers_v[threadNum_ui];
+
+        worker.setCostImageSize ( f_costImgs_v[n].cols, 
+                                  f_costImgs_v[n].rows );
+        worker.setParameters ( f_params_v.size()?f_params_v[n]:defParams );
+
+        if ( !worker.compute ( f_costImgs_v[n], fr_paths_v[n] ) )
+        {
+            std::fill ( fr_paths_v[n].begin(), fr_paths_v[n].end(), -1 );
+            ++failed_i;
         }
+    }
 
-        // Copy right part of vector.
-        for (; i < m_height_i; ++i)
-            fr_vecRes[i] = m_auxVector[i];
+    return failed_i == 0;
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Computes dynamic programming on every slice of a cost volume.
+ *
+ * \brief          Computes dynamic programming on a cost volume.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The volume must be a 3D matrix of size 
+ *                 instances x height x width. The slices are processed 
+ *                 without copying them.
+ * \sa             computeBatch
+ *
+ * \param[in]      f_costVolume - Cost volume (CV_32FC1 or CV_16UC1).
+ * \param[in,out]  fr_paths_v   - Predictions and output paths.
+ * \param[in]      f_params_v   - Parameters of each optimization.
+ * \return         true if all optimizations succeeded.
+ *
+ *************************************************************************** */
+bool
+CDynamicProgrammingOp::computeBatch ( const cv::Mat                      & f_costVolume,
+                                      std::vector< std::vector<int> >    & fr_paths_v,
+                                      const std::vector<SParameters>     & f_params_v )
+{
+    if ( f_costVolume.dims != 3 )
+    {
+        printf("Cost volume must have 3 dimensions.\n");
+        return false;
     }
-    else
+
+    std::vector<cv::Mat> slices_v ( f_costVolume.size[0] );
+
+    for (int n = 0; n < f_costVolume.size[0]; ++n)
+        slices_v[n] = cv::Mat ( f_costVolume.size[1],
+                                f_costVolume.size[2],
+                                f_costVolume.type(),
+                                (void *) f_costVolume.ptr(n),
+                                f_costVolume.step[1] );
+
+    return computeBatch ( slices_v, fr_paths_v, f_params_v );
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Computes the lower envelopes of the accumulated costs of a row.
+ *
+ * \brief          Computes the lower envelopes of a row for the linear 
+ *                 time relaxation.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The smoothness term c * min(|x-k|, T) of a transition
+ *                 from column k to position x splits into the two linear
+ *                 terms (acc_k - c*k) + c*x for k <= x and 
+ *                 (acc_k + c*k) - c*x for k > x, plus the saturated term
+ *                 acc_k + c*T. The arguments of the running minima of 
+ *                 both linear terms and of the global minimum of acc_k 
+ *                 are stored here, so that the best parent of any node 
+ *                 is found in O(1).
+ *                 Ties keep the leftmost column, as the exhaustive search
+ *                 does.
+ * \sa             findBestParent
+ *
+ * \param[in]      f_accCost_p  - Accumulated costs of the parent row.
+ * \param[in]      f_startCol_i - First valid column of the row.
+ * \param[in]      f_endCol_i   - Last valid column of the row.
+ * \param[in]      f_jumpCost_f - Jump cost c (must be non-negative).
+ * \return         -
+ *
+ *************************************************************************** */
+void
+CDynamicProgrammingOp::computeEnvelopes ( const float * const f_accCost_p,
+                                          const int           f_startCol_i,
+                                          const int           f_endCol_i,
+                                          const float         f_jumpCost_f )
+{
+    int * const fwdEnvArg_p = &m_fwdEnvArg_v[0];
+    int * const bwdEnvArg_p = &m_bwdEnvArg_v[0];
+
+    float minCost_f = f_accCost_p[f_startCol_i] - f_jumpCost_f * f_startCol_i;
+    int   minArg_i  = f_startCol_i;
+
+    m_minAccCostCol_i = f_startCol_i;
+
+    for (int k = f_startCol_i; k <= f_endCol_i; ++k)
     {
-        for (unsigned int i = 0; i < m_auxVector.size(); ++i)
+        const float acc_f  = f_accCost_p[k];
+        const float cost_f = acc_f - f_jumpCost_f * k;
+
+        if ( cost_f < minCost_f )
         {
-            fr_vecRes[i] = m_auxVector[i];
+            minCost_f = cost_f;
+            minArg_i  = k;
         }
+
+        fwdEnvArg_p[k] = minArg_i;
+
+        if ( acc_f < f_accCost_p[m_minAccCostCol_i] )
+            m_minAccCostCol_i = k;
     }
 
-    return true;
+    minCost_f = f_accCost_p[f_endCol_i] + f_jumpCost_f * f_endCol_i;
+    minArg_i  = f_endCol_i;
+
+    for (int k = f_endCol_i; k >= f_startCol_i; --k)
+    {
+        const float cost_f = f_accCost_p[k] + f_jumpCost_f * k;
+
+        if ( cost_f <= minCost_f )
+        {
+            minCost_f = cost_f;
+            minArg_i  = k;
+        }
+
+        bwdEnvArg_p[k] = minArg_i;
+    }
 }
 
+/* *************************** METHOD ************************************** */
+/**
+ * Finds the best parent of a node using the envelopes of the previous row.
+ *
+ * \brief          Finds the best parent of a node in O(1).
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           At most three candidates are possible: the best parent 
+ *                 on the left of the expected position, the best one on 
+ *                 its right and the one with minimum accumulated cost 
+ *                 (saturated jump). The candidates are evaluated with the
+ *                 same expression as the exhaustive search, so that the 
+ *                 resulting accumulated cost and parent are the same.
+ * \sa             computeEnvelopes, findBestParentExhaustive
+ *
+ * \param[in]      f_prevAccCost_p     - Accumulated costs of previous row.
+ * \param[in]      f_nodCost_f         - Cost of the node.
+ * \param[in]      f_col_i             - Column of the node.
+ * \param[in]      f_startColPrevRow_i - First valid column of previous row.
+ * \param[in]      f_endColPrevRow_i   - Last valid column of previous row.
+ * \param[in]      f_currGrad_f        - Expected gradient for this row.
+ * \param[in]      f_jumpCost_f        - Jump cost.
+ * \return         Column of the best parent node.
+ *
+ *************************************************************************** */
+int
+CDynamicProgrammingOp::findBestParent ( const float * const f_prevAccCost_p,
+                                        const float         f_nodCost_f,
+                                        const int           f_col_i,
+                                        const int           f_startColPrevRow_i,
+                                        const int           f_endColPrevRow_i,
+                                        const float         f_currGrad_f,
+                                        const float         f_jumpCost_f ) const
+{
+    /// Split column: parents k <= split are on the left of the 
+    /// expected position j - grad.
+    const int split_i = (int) floorf(f_col_i - f_currGrad_f);
+
+    int candidates_p[3];
+    int numCands_i = 0;
+
+    if ( split_i >= f_startColPrevRow_i )
+        candidates_p[numCands_i++] = m_fwdEnvArg_v[std::min(split_i, f_endColPrevRow_i)];
+
+    if ( split_i < f_endColPrevRow_i )
+        candidates_p[numCands_i++] = m_bwdEnvArg_v[std::max(split_i+1, f_startColPrevRow_i)];
+
+    candidates_p[numCands_i++] = m_minAccCostCol_i;
+
+    int   bestNode_i   = -1;
+    float bestCost_f   = 0.f;
+
+    for (int c = 0; c < numCands_i; ++c)
+    {
+        const int   k = candidates_p[c];
+        const float node2nodeDist_f = fabs(f_col_i - k - f_currGrad_f);
+        const float newCost_f = ( f_prevAccCost_p[k] +
+                                  f_nodCost_f +
+                                  f_jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) );
+
+        if ( bestNode_i < 0 || 
+             newCost_f < bestCost_f || 
+             ( newCost_f == bestCost_f && k < bestNode_i ) )
+        {
+            bestCost_f = newCost_f;
+            bestNode_i = k;
+        }
+    }
+
+    return bestNode_i;
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Finds the best parent of a node testing all nodes of the previous row.
+ *
+ * \brief          Finds the best parent of a node in O(W).
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The minimum is reduced four columns at a time with SSE2
+ *                 when available. Every lane keeps its leftmost minimum 
+ *                 and the lanes are merged by cost and column, so that 
+ *                 the result is the same as the sequential search.
+ * \sa             findBestParent
+ *
+ * \param[in]      f_prevAccCost_p     - Accumulated costs of previous row.
+ * \param[in]      f_nodCost_f         - Cost of the node.
+ * \param[in]      f_col_i             - Column of the node.
+ * \param[in]      f_startColPrevRow_i - First valid column of previous row.
+ * \param[in]      f_endColPrevRow_i   - Last valid column of previous row.
+ * \param[in]      f_currGrad_f        - Expected gradient for this row.
+ * \param[in]      f_jumpCost_f        - Jump cost.
+ * \return         Column of the best parent node.
+ *
+ *************************************************************************** */
+int
+CDynamicProgrammingOp::findBestParentExhaustive ( const float * const f_prevAccCost_p,
+                                                  const float         f_nodCost_f,
+                                                  const int           f_col_i,
+                                                  const int           f_startColPrevRow_i,
+                                                  const int           f_endColPrevRow_i,
+                                                  const float         f_currGrad_f,
+                                                  const float         f_jumpCost_f ) const
+{
+    float node2nodeDist_f;
+    float newCost_f;
+
+    // Per default the parent node is the first one, i.e.
+    // the node corresponding to first valid cell in the 
+    // previous row.
+    int   bestNode_i = f_startColPrevRow_i;
+
+    node2nodeDist_f = fabs(f_col_i - bestNode_i - f_currGrad_f);
+
+    float bestCost_f = ( f_prevAccCost_p[bestNode_i] + 
+                         f_nodCost_f +
+                         f_jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) );
+
+    int k = f_startColPrevRow_i + 1;
+
+#if defined ( __SSE2__ )
+    if ( f_endColPrevRow_i - k + 1 >= 8 )
+    {
+        const __m128  nodCost   = _mm_set1_ps ( f_nodCost_f );
+        const __m128  currGrad  = _mm_set1_ps ( f_currGrad_f );
+        const __m128  jumpCost  = _mm_set1_ps ( f_jumpCost_f );
+        const __m128  distTh    = _mm_set1_ps ( m_distTh_f );
+        const __m128i col       = _mm_set1_epi32 ( f_col_i );
+        const __m128i four      = _mm_set1_epi32 ( 4 );
+
+        __m128i minCols = _mm_setr_epi32 ( k, k+1, k+2, k+3 );
+        __m128  minCost = transitionCost4 ( f_prevAccCost_p + k, minCols, col, 
+                                            nodCost, currGrad, jumpCost, distTh );
+        __m128i cols    = _mm_add_epi32 ( minCols, four );
+
+        for (k += 4; k + 3 <= f_endColPrevRow_i; k += 4)
+        {
+            const __m128  cost = transitionCost4 ( f_prevAccCost_p + k, cols, col, 
+                                                   nodCost, currGrad, jumpCost, distTh );
+            const __m128i less = _mm_castps_si128 ( _mm_cmplt_ps ( cost, minCost ) );
+
+            minCost = _mm_min_ps ( cost, minCost );
+            minCols = _mm_or_si128 ( _mm_and_si128    ( less, cols ),
+                                     _mm_andnot_si128 ( less, minCols ) );
+            cols    = _mm_add_epi32 ( cols, four );
+        }
+
+        float laneCost_p[4];
+        int   laneCols_p[4];
+        _mm_storeu_ps    ( laneCost_p, minCost );
+        _mm_storeu_si128 ( (__m128i *) laneCols_p, minCols );
+
+        for (int l = 0; l < 4; ++l)
+        {
+            if ( laneCost_p[l] < bestCost_f || 
+                 ( laneCost_p[l] == bestCost_f && laneCols_p[l] < bestNode_i ) )
+            {
+                bestCost_f = laneCost_p[l];
+                bestNode_i = laneCols_p[l];
+            }
+        }
+    }
+#endif
+
+    for (; k <= f_endColPrevRow_i; ++k)
+    {
+        // then compute new cost...
+        node2nodeDist_f = fabs(f_col_i - k - f_currGrad_f);
+        newCost_f = ( 
+                // Accumulated Cost. 
+                f_prevAccCost_p[k] +
+                // Local Cost.
+                f_nodCost_f +
+                // Smoothness cost with saturation.
+                f_jumpCost_f * std::min(node2nodeDist_f, m_distTh_f) );
+                        
+        // and check if it is better than the current one.
+        if ( newCost_f < bestCost_f )
+        {
+            bestCost_f = newCost_f;
+            bestNode_i = k;
+        }                
+    }
+
+    return bestNode_i;
+}
+
+/* *************************** METHOD ************************************** */
+/**
+ * Returns the graph in the original node image layout.
+ *
+ * \brief          Returns the graph as a matrix of Node elements.
+ * \author         Hernan Badino
+ * \date           08.03.2009
+ *
+ * \note           The nodes are stored internally as separate cost, 
+ *                 accumulated cost and parent planes. This builds a new 
+ *                 CV_8UC1 matrix of width*sizeof(Node) bytes per row that
+ *                 can be accessed through at<Node>(i,j) as before. Use 
+ *                 the plane accessors to avoid the copy.
+ * \sa             getNodeCostImage, getAccCostImage, getParentNodeImage
+ *
+ * \return         Matrix of nodes.
+ *
+ *************************************************************************** */
+cv::Mat
+CDynamicProgrammingOp::getGraphImage() const
+{
+    cv::Mat graph ( m_height_i, m_width_i * sizeof ( Node ), CV_8UC1 );
+
+    for (int i = 0; i < m_height_i; ++i)
+    {
+        const float     * const nodCost_p = m_nodCostImg.ptr<float>(i);
+        const float     * const accCost_p = m_accCostImg.ptr<float>(i);
+        const short int * const parNode_p = m_parNodeImg.ptr<short int>(i);
+        Node            * const node_p    = graph.ptr<Node>(i);
+
+        for (int j = 0; j < m_width_i; ++j)
+        {
+            node_p[j].m_nodCost_f = nodCost_p[j];
+            node_p[j].m_accCost_f = accCost_p[j];
+            node_p[j].m_parNode_i = parNode_p[j];
+        }
+    }
+
+    return graph;
+}
@@ -44,6 +44,7 @@
 
 /* CONSTANTS */
 #define DP4F_MAX_MEDFILT_KERNEL_SIZE 51
+#define DP4F_MAX_CORES 16
 
 /* PROTOTYPES */
 
@@ -68,6 +69,29 @@ namespace QCV
             short int m_parNode_i;
         };
 
+        /// Parameters of a single optimization (see computeBatch).
+        struct SParameters
+        {
+            SParameters();
+
+            float                      m_distCost_f;
+            float                      m_distTh_f;
+            float                      m_predCost_f;
+            float                      m_predTh_f;
+            float                      m_initialCost_f;
+            float                      m_minCostValue_f;
+            float                      m_maxCostValue_f;
+            bool                       m_applyMedianFilter_b;
+            int                        m_medFiltKernelSize_i;
+            bool                       m_useDistTransform_b;
+
+            /// Optional expected gradient (one element per row).
+            const float *              m_expectedGradient_p;
+
+            /// Optional distance cost vector (one element per row).
+            const std::vector<float> * m_distCostVector_p;
+        };
+
     public:
     
         /******************************/
@@ -91,6 +115,14 @@ namespace QCV
                                const std::vector<int> & f_followPath    = std::vector<int>(0),
                                const std::vector<int> & f_pathTolVector = std::vector<int>(0) );
 
+        virtual bool computeBatch ( const std::vector<cv::Mat>         & f_costImgs_v,
+                                    std::vector< std::vector<int> >    & fr_paths_v,
+                                    const std::vector<SParameters>     & f_params_v = std::vector<SParameters>(0) );
+
+        virtual bool computeBatch ( const cv::Mat                      & f_costVolume,
+                                    std::vector< std::vector<int> >    & fr_paths_v,
+                                    const std::vector<SParameters>     & f_params_v = std::vector<SParameters>(0) );
+
         /******************************/
         /*          DISPLAY           */
         /******************************/
@@ -133,6 +165,12 @@ namespace QCV
 
         bool  setFollowPathTolerance ( const int f_tol_i ) { m_pathTol_i = f_tol_i<1?1:f_tol_i; return true;}
         int   getFollowPathTolerance ( ) const { return m_pathTol_i; }
+
+        bool  setUseDistTransform ( const bool f_val_b ) { m_useDistTransform_b = f_val_b; return true;}
+        bool  getUseDistTransform ( ) const { return m_useDistTransform_b; }
+
+        bool        setParameters ( const SParameters & f_params );
+        SParameters getParameters ( ) const;
     
         bool  setCostImageSize( const int f_width_i, 
                                 const int f_height_i );
@@ -147,7 +185,17 @@ namespace QCV
         const std::vector <float> * getDistCostVector ( ) const { return m_distCostVector_p; }
 
 
-        cv::Mat  getGraphImage() const { return m_nodesImg; }
+        /// Graph in the Node layout (built on request, see getGraphImage).
+        cv::Mat  getGraphImage() const;
+
+        /// Node cost plane (CV_32FC1).
+        cv::Mat  getNodeCostImage()   const { return m_nodCostImg; }
+
+        /// Accumulated cost plane (CV_32FC1).
+        cv::Mat  getAccCostImage()    const { return m_accCostImg; }
+
+        /// Parent node plane (CV_16SC1).
+        cv::Mat  getParentNodeImage() const { return m_parNodeImg; }
 
         /******************************/
         /*    PROTECTED METHODS       */
@@ -157,14 +205,47 @@ namespace QCV
         void  reinitialize();
         void  createParamSet();
 
+        template <typename CostType_>
+        bool  computeT ( const cv::Mat          & f_costImg,
+                         std::vector<int>       & fr_vecRes_v,
+                         const std::vector<int> & f_followPath,
+                         const std::vector<int> & f_pathTolVector );
+
+        void  computeEnvelopes ( const float * const f_accCost_p,
+                                 const int           f_startCol_i,
+                                 const int           f_endCol_i,
+                                 const float         f_jumpCost_f );
+
+        int   findBestParent ( const float * const f_prevAccCost_p,
+                               const float         f_nodCost_f,
+                               const int           f_col_i,
+                               const int           f_startColPrevRow_i,
+                               const int           f_endColPrevRow_i,
+                               const float         f_currGrad_f,
+                               const float         f_jumpCost_f ) const;
+
+        int   findBestParentExhaustive ( const float * const f_prevAccCost_p,
+                                         const float         f_nodCost_f,
+                                         const int           f_col_i,
+                                         const int           f_startColPrevRow_i,
+                                         const int           f_endColPrevRow_i,
+                                         const float         f_currGrad_f,
+                                         const float         f_jumpCost_f ) const;
+
 
         /******************************/
         /*    PROTECTED MEMBERS       */
         /******************************/
     protected:
 
-        /// Matrix for the nodes.
-        cv::Mat                           m_nodesImg;
+        /// Cost of the nodes.
+        cv::Mat                           m_nodCostImg;
+
+        /// Accumulated cost of the best path to the nodes.
+        cv::Mat                           m_accCostImg;
+
+        /// Best parent node (column in the previous row).
+        cv::Mat                           m_parNodeImg;
 
         /// Width of the depth input cost image.
         int                               m_width_i;
@@ -212,6 +293,23 @@ namespace QCV
         /// around the path to follow. For pyramidal implementation.
         int                               m_pathTol_i;
 
+        /// Use the linear time (distance transform) relaxation?
+        bool                              m_useDistTransform_b;
+
+        /// Argument of the lower envelope of acc - jumpCost * col of 
+        /// the previous row from the left.
+        std::vector<int>                  m_fwdEnvArg_v;
+
+        /// Argument of the lower envelope of acc + jumpCost * col of 
+        /// the previous row from the right.
+        std::vector<int>                  m_bwdEnvArg_v;
+
+        /// Column of the minimum accumulated cost in the previous row.
+        int                               m_minAccCostCol_i;
+
+        /// Per-thread instances (scratch graphs) for batch computation.
+        std::vector<CDynamicProgrammingOp *> m_workers_v;
+
         /// Parameter set.
         CParameterSet *                   m_paramSet_p;
 
@@ -21,6 +21,7 @@
 
 /* INCLUDES */
 #include <limits>
+#include <string.h>
 
 #include "featureStereoOp.h"
 #include "drawingList.h"
@@ -38,6 +39,10 @@
 
 #include "ceParameter.h"
 
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
 using namespace QCV;
 
 static const float INVALID_DISP=-std::numeric_limits<float>::max();
@@ -51,6 +56,7 @@ CFeatureStereoOp::CFeatureStereoOp ( COperator * const f_parent_p,
      m_compute_b (                                 true ),
      m_idLeftImage_str (                      "Image 0" ),
      m_idRightImage_str (                     "Image 1" ),
+     m_idLeftPyramid_str ( "KltTrackerOp Current Pyramid" ),
      m_featPointVector_str (           "Feature Vector" ),
      m_dispRange (                                0, 80 ),
      m_maskSize (                                11, 11 ),
@@ -62,7 +68,12 @@ CFeatureStereoOp::CFeatureStereoOp ( COperator * const f_parent_p,
      m_pyrLeft (                                      2 ),
      m_pyrRight (                                     2 ),
      m_pyrDisp (                                      2 ),
+     m_intLeft_v (                                      ),
+     m_intSqLeft_v (                                    ),
+     m_intRight_v (                                     ),
+     m_intSqRight_v (                                   ),
      m_levels_ui (                                    2 ),
+     m_sharedLeftPyr_b (                          false ),
      m_deltaDisp_i (                                  1 ),
      m_ceDistance ( CColorEncoding::CET_GREEN2RED,
                                    S2D<float>(0.f,40.f) ),
@@ -121,6 +132,14 @@ CFeatureStereoOp::registerParameters()
                          this,
                          IdRightImageStr, 
                          CFeatureStereoOp );
+      
+      ADD_STR_PARAMETER( "Left Pyramid Id", 
+                         "Id of a pyramid of the left image (CImagePyramid) to reuse. "
+                         "It is only used if built from the same image.",
+                         m_idLeftPyramid_str,
+                         this,
+                         IdLeftPyramidStr, 
+                         CFeatureStereoOp );
     END_PARAMETER_GROUP;     
 
     BEGIN_PARAMETER_GROUP("Computation", false, SRgb(220,0,0));
@@ -264,19 +283,8 @@ CFeatureStereoOp::cycle()
          if (m_preFilter_b)
          {
             startClock ("Pre-filtering");            
-            getInput<cv::Mat>( m_idLeftImage_str,  cv::Mat() ).copyTo(m_lImg);
-            getInput<cv::Mat>( m_idRightImage_str, cv::Mat() ).copyTo(m_rImg);
-            int ddepth = CV_32F;
-            cv::Mat imgf,imgf2;
-            cv::Mat *imgs_p[2] = {&m_lImg, &m_rImg};
-
-            for (int i = 0; i < 2; ++i)
-            {
-               cv::boxFilter( *imgs_p[i], imgf, ddepth, cv::Size(19,19), cv::Point(-1,-1), true, cv::BORDER_DEFAULT );
-               imgs_p[i]->convertTo ( imgf2, CV_32F, 1., 0);
-               imgf -= imgf2;
-               imgf.convertTo ( *imgs_p[i], CV_8U, 5, 127);
-            }
+            m_lImg = getDerivedImage ( getLeftImageDesc() );
+            m_rImg = getDerivedImage ( getRightImageDesc() );
             stopClock ("Pre-filtering");            
          }
          else
@@ -296,10 +304,15 @@ CFeatureStereoOp::cycle()
             setPyramidParams ( m_levels_ui );
         
             /// 1.- Compute Gaussian Pyramids.
-           m_pyrLeft.compute  ( m_lImg );
-           m_pyrRight.compute ( m_rImg );
+           if ( !shareLeftPyramid() )
+              getPyramid ( getLeftImageDesc(), m_pyrLeft );
+           getPyramid ( getRightImageDesc(), m_pyrRight );
         
             stopClock("Pyramid construction");
+
+            startClock("Integral images");
+            computeIntegralImages();
+            stopClock("Integral images");
             
             startClock("First Correlation");
             
@@ -388,6 +401,192 @@ CFeatureStereoOp::generateDispImage( const CFeatureVector *f_vec_p )
   }
 */
 
+/// Sum of the window [f_top_i,f_bottom_i) x [f_left_i,f_right_i) of an
+/// image from its integral image.
+template <typename T>
+static inline T windowSum ( const cv::Mat & f_int,
+                            int             f_top_i,
+                            int             f_left_i,
+                            int             f_bottom_i,
+                            int             f_right_i )
+{
+   const T * const top_p    = f_int.ptr<T>(f_top_i);
+   const T * const bottom_p = f_int.ptr<T>(f_bottom_i);
+
+   return ( bottom_p[f_right_i] - top_p[f_right_i] - 
+            bottom_p[f_left_i]  + top_p[f_left_i] );
+}
+
+/// Cross term sum(L*R) of the left window at column f_uL_i with the
+/// f_count_i (at most 8) right windows starting at columns f_uR_i, 
+/// f_uR_i+1, ...
+static inline void crossCorrelation ( const cv::Mat & f_imgL,
+                                      const cv::Mat & f_imgR,
+                                      int             f_top_i,
+                                      int             f_rows_i,
+                                      int             f_uL_i,
+                                      int             f_uR_i,
+                                      int             f_width_i,
+                                      int             f_count_i,
+                                      int *           fr_cross_p )
+{
+#if defined ( __SSE2__ )
+   if ( f_count_i == 8 )
+   {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i acc0 = zero, acc1 = zero;
+
+      for (int i = f_top_i; i < f_top_i + f_rows_i; ++i)
+      {
+         const uint8_t * const l_p = f_imgL.ptr<uint8_t>(i) + f_uL_i;
+         const uint8_t * const r_p = f_imgR.ptr<uint8_t>(i) + f_uR_i;
+         
+         /// Two mask columns per step. The pairs (R[j+k], R[j+k+1]) of 
+         /// the 8 windows are multiplied with (L[j], L[j+1]) and added
+         /// to 32 bits.
+         int j = 0;
+         for (; j+1 < f_width_i; j+=2)
+         {
+            const __m128i r0 = _mm_unpacklo_epi8 ( _mm_loadl_epi64 ( (const __m128i *) (r_p+j)   ), zero );
+            const __m128i r1 = _mm_unpacklo_epi8 ( _mm_loadl_epi64 ( (const __m128i *) (r_p+j+1) ), zero );
+            const __m128i l  = _mm_set1_epi32 ( l_p[j] | ( l_p[j+1] << 16 ) );
+
+            acc0 = _mm_add_epi32 ( acc0, _mm_madd_epi16 ( _mm_unpacklo_epi16 ( r0, r1 ), l ) );
+            acc1 = _mm_add_epi32 ( acc1, _mm_madd_epi16 ( _mm_unpackhi_epi16 ( r0, r1 ), l ) );
+         }
+
+         if ( j < f_width_i )
+         {
+            const __m128i r0 = _mm_unpacklo_epi8 ( _mm_loadl_epi64 ( (const __m128i *) (r_p+j) ), zero );
+            const __m128i l  = _mm_set1_epi32 ( l_p[j] );
+
+            acc0 = _mm_add_epi32 ( acc0, _mm_madd_epi16 ( _mm_unpacklo_epi16 ( r0, zero ), l ) );
+            acc1 = _mm_add_epi32 ( acc1, _mm_madd_epi16 ( _mm_unpackhi_epi16 ( r0, zero ), l ) );
+         }
+      }
+
+      _mm_storeu_si128 ( (__m128i *) fr_cross_p,     acc0 );
+      _mm_storeu_si128 ( (__m128i *) (fr_cross_p+4), acc1 );
+      return;
+   }
+#endif
+
+   for (int k = 0; k < f_count_i; ++k)
+      fr_cross_p[k] = 0;
+
+   for (int i = f_top_i; i < f_top_i + f_rows_i; ++i)
+   {
+      const uint8_t * const l_p = f_imgL.ptr<uint8_t>(i) + f_uL_i;
+      const uint8_t * const r_p = f_imgR.ptr<uint8_t>(i) + f_uR_i;
+
+      for (int k = 0; k < f_count_i; ++k)
+      {
+         int sum_i = 0;
+         for (int j = 0; j < f_width_i; ++j)
+            sum_i += l_p[j] * r_p[j+k];
+         fr_cross_p[k] += sum_i;
+      }
+   }
+}
+
+void
+CFeatureStereoOp::computeIntegralImages ( )
+{
+   m_intLeft_v.resize    ( m_levels_ui );
+   m_intSqLeft_v.resize  ( m_levels_ui );
+   m_intRight_v.resize   ( m_levels_ui );
+   m_intSqRight_v.resize ( m_levels_ui );
+
+#if defined ( _OPENMP )
+   const unsigned int numThreads_ui = std::min(omp_get_max_threads(), FSO_MAX_CORES);
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
+#endif
+   for (int i = 0; i < 2 * (int) m_levels_ui; ++i)
+   {
+      const int level_i = i / 2;
+      
+      if ( i % 2 == 0 )
+         cv::integral ( m_pyrLeft.getLevelImage(level_i), 
+                        m_intLeft_v[level_i], m_intSqLeft_v[level_i], CV_32S );
+      else
+         cv::integral ( m_pyrRight.getLevelImage(level_i), 
+                        m_intRight_v[level_i], m_intSqRight_v[level_i], CV_32S );
+   }
+}
+
+void
+CFeatureStereoOp::computeScores ( int            f_level_i,
+                                  const S2D<int> f_pos,
+                                  const S2D<int> f_hMask,
+                                  int            f_firstCol_i,
+                                  int            f_lastCol_i,
+                                  float *        fr_zssd_p,
+                                  float *        fr_ssd_p ) const
+{
+   const cv::Mat imgL = m_pyrLeft.getLevelImage(f_level_i);
+   const cv::Mat imgR = m_pyrRight.getLevelImage(f_level_i);
+
+   const cv::Mat & intR   = m_intRight_v[f_level_i];
+   const cv::Mat & intSqR = m_intSqRight_v[f_level_i];
+   
+   const int   width_i    = 2 * f_hMask.width  + 1;
+   const int   rows_i     = 2 * f_hMask.height + 1;
+   const int   maskSize_i = width_i * rows_i;
+   const int   top_i      = f_pos.y - f_hMask.height;
+   const int   bottom_i   = top_i + rows_i;
+   const int   uL_i       = f_pos.x - f_hMask.width;
+
+   /// Left window terms are the same for all disparities.
+   const int    sumL_i    = windowSum<int>    ( m_intLeft_v[f_level_i],   
+                                                top_i, uL_i, bottom_i, uL_i + width_i );
+   const double sumSqL_d  = windowSum<double> ( m_intSqLeft_v[f_level_i], 
+                                                top_i, uL_i, bottom_i, uL_i + width_i );
+
+   int cross_p[8];
+
+   for (int colr_i = f_firstCol_i; colr_i <= f_lastCol_i; )
+   {
+      const int count_i = std::min ( 8, f_lastCol_i - colr_i + 1 );
+
+      crossCorrelation ( imgL, imgR, top_i, rows_i, uL_i, colr_i - f_hMask.width,
+                         width_i, count_i, cross_p );
+
+      for (int k = 0; k < count_i; ++k, ++colr_i)
+      {
+         const int    uR_i     = colr_i - f_hMask.width;
+         const int    sumR_i   = windowSum<int>    ( intR,   top_i, uR_i, bottom_i, uR_i + width_i );
+         const double sumSqR_d = windowSum<double> ( intSqR, top_i, uR_i, bottom_i, uR_i + width_i );
+
+         /// sum((L-R)^2) = sum(L^2) + sum(R^2) - 2 sum(L*R)
+         const float  sumSq_f   = (float) ( sumSqL_d + sumSqR_d - 2. * cross_p[k] );
+         const float  avgDiff_f = (float) ( sumL_i - sumR_i );
+         const int    d         = f_pos.x - colr_i;
+
+         fr_ssd_p[d]  = sumSq_f;
+         fr_zssd_p[d] = sumSq_f - avgDiff_f * avgDiff_f / maskSize_i;
+      }
+   }
+}
+
+float
+CFeatureStereoOp::rightVariance ( int            f_level_i,
+                                  const S2D<int> f_pos,
+                                  const S2D<int> f_hMask ) const
+{
+   const int width_i    = 2 * f_hMask.width  + 1;
+   const int rows_i     = 2 * f_hMask.height + 1;
+   const int maskSize_i = width_i * rows_i;
+   const int top_i      = f_pos.y - f_hMask.height;
+   const int uR_i       = f_pos.x - f_hMask.width;
+
+   const float sumR_f   = windowSum<int>    ( m_intRight_v[f_level_i],
+                                              top_i, uR_i, top_i + rows_i, uR_i + width_i );
+   const float sumSqR_f = windowSum<double> ( m_intSqRight_v[f_level_i],
+                                              top_i, uR_i, top_i + rows_i, uR_i + width_i );
+
+   return ( sumSqR_f - sumR_f * sumR_f / maskSize_i ) / maskSize_i;
+}
+
 /// Cycle event.
 bool
 CFeatureStereoOp::computeFirstCorrelation( int f_fromLevel_i )
@@ -406,7 +605,6 @@ CFeatureStereoOp::computeFirstCorrelation( int f_fromLevel_i )
    m_pyrDisp.clear();
     
    cv::Mat & imgL = m_pyrLeft.getLevelImage(f_fromLevel_i);
-   cv::Mat & imgR = m_pyrRight.getLevelImage(f_fromLevel_i);
    cv::Mat & disp = m_pyrDisp.getLevelImage(f_fromLevel_i);
 
    disp = cv::Mat::zeros(imgL.size(), CV_32FC1);
@@ -429,6 +627,7 @@ CFeatureStereoOp::computeFirstCorrelation( int f_fromLevel_i )
     
 #if not defined ( _OPENMP )
    float * const scores_p = m_scoresACTUAL_p[0] + FSO_MAX_WIDTH;
+   float * const ssd_p    = m_ssdACTUAL_p[0]    + FSO_MAX_WIDTH;
 #else
    const unsigned int numThreads_ui = std::min(omp_get_max_threads(), FSO_MAX_CORES);
 #pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
@@ -438,6 +637,7 @@ CFeatureStereoOp::computeFirstCorrelation( int f_fromLevel_i )
 #if defined ( _OPENMP )
       const unsigned int threadNum_ui = omp_get_thread_num();
       float * const scores_p = m_scoresACTUAL_p[threadNum_ui] + FSO_MAX_WIDTH;
+      float * const ssd_p    = m_ssdACTUAL_p[threadNum_ui]    + FSO_MAX_WIDTH;
 #endif
       S2D<int> featPos ( vec[f].u / scale_i + .5, 
                          vec[f].v / scale_i + .5 );
@@ -477,68 +677,27 @@ CFeatureStereoOp::computeFirstCorrelation( int f_fromLevel_i )
                      int   bestDisp_i     = INVALID_DISP;
                      float maskVar_f      = std::numeric_limits<float>::max();
                                 
+                     computeScores ( f_fromLevel_i, featPos, hMask, 
+                                     rlimit.min, rlimit.max,
+                                     scores_p, ssd_p );
+
                      for (int colrPos = rlimit.min; colrPos <= rlimit.max; ++colrPos)
                      {
                         int d = featPos.x - colrPos;
-                        /// Column limits for current disparity.
-                        S2D<int> uRlimit ( colrPos - hMask.width, 
-                                           colrPos + hMask.width );
 
-                        /// The following should never happen.
-                        if ( uRlimit.min < 0 ||
-                             uRlimit.max >= imgSize.width )
+                        if (scores_p[d] < minZssdScore_f)
                         {
-                           printf("%s:%i Invalid right limits\n", __FILE__, __LINE__);
-                           continue;
-                        }                            
-                            
-                        float sumL_f    = 0.f;
-                        float sumR_f    = 0.f;
-                        float sumSqR_f  = 0.f;
-                        float sumSq_f   = 0.f;
-                        float varR_f    = 0.f;
-                                  
-                       /// Correlate windows now.
-                        for (int i = vlimit.min; i <= vlimit.max; ++i)
-                        {
-                           uint8_t *ptrL_p = &imgL.at<uint8_t>(i,uLlimit.x);
-                           uint8_t *ptrR_p = &imgR.at<uint8_t>(i,uRlimit.x);;
-                                
-                           for (int j = 0; j < mask.width; ++j, ++ptrL_p, ++ptrR_p)
-                           {
-                              float diff_f = (float)*ptrL_p - (float)*ptrR_p;
-                              sumL_f  += *ptrL_p;
-                              sumR_f  += *ptrR_p;
-                              sumSq_f += diff_f * diff_f;
-                                    
-                               if ( m_checkVars_b )
-                                 sumSqR_f += (float)( *ptrR_p * *ptrR_p);
-                           }
-                        }
-
-                        if ( m_checkVars_b )
-                        {
-                           float sqR_f  = sumR_f * sumR_f / maskSize_i;
-                           varR_f = (sumSqR_f - sqR_f) / maskSize_i;
-                        }
-
-                        float avgDiff_f   = (sumL_f - sumR_f);
-                        float sqDiff_f    = avgDiff_f * avgDiff_f / maskSize_i;
-                        float scoreZssd_f = sumSq_f - sqDiff_f;
-
-                        /// Store scoreZssd in vector
-                        scores_p[d] = scoreZssd_f;
-
-                        if (scoreZssd_f < minZssdScore_f)
-                        {
-                           minZssdScore_f = scoreZssd_f;
-                           ssdScore_f     = sumSq_f;
+                           minZssdScore_f = scores_p[d];
+                           ssdScore_f     = ssd_p[d];
                            bestDisp_i     = d;
-
-                           maskVar_f      = varR_f;
                         } 
                      }
 
+                     if ( m_checkVars_b )
+                        maskVar_f = rightVariance ( f_fromLevel_i, 
+                                                    S2D<int> ( featPos.x - bestDisp_i, featPos.y ),
+                                                    hMask );
+
                      minZssdScore_f /= maskSize_i;
                      ssdScore_f     /= maskSize_i; 
 
@@ -625,7 +784,6 @@ CFeatureStereoOp::transferLevel( int f_level_i )
    if ( ! featureVector_p ) return false;
    
    cv::Mat &imgL = m_pyrLeft.getLevelImage(f_level_i);
-   cv::Mat &imgR = m_pyrRight.getLevelImage(f_level_i);
    cv::Mat &disp = m_pyrDisp.getLevelImage(f_level_i);
 
    disp = cv::Mat::zeros(imgL.size(), CV_32FC1);
@@ -649,6 +807,7 @@ CFeatureStereoOp::transferLevel( int f_level_i )
 
 #if not defined ( _OPENMP )
    float * const scores_p = m_scoresACTUAL_p[0] + FSO_MAX_WIDTH;
+   float * const ssd_p    = m_ssdACTUAL_p[0]    + FSO_MAX_WIDTH;
 #else
    const unsigned int numThreads_ui = std::min(omp_get_max_threads(), FSO_MAX_CORES);
 #pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
@@ -658,6 +817,7 @@ CFeatureStereoOp::transferLevel( int f_level_i )
 #if defined ( _OPENMP )
       const unsigned int threadNum_ui = omp_get_thread_num();
       float * const scores_p = m_scoresACTUAL_p[threadNum_ui] + FSO_MAX_WIDTH;
+      float * const ssd_p    = m_ssdACTUAL_p[threadNum_ui]    + FSO_MAX_WIDTH;
 #endif        
       S2D<int> featPos ( vec[f].u / scale_i + .5, 
                          vec[f].v / scale_i + .5 );
@@ -698,62 +858,19 @@ CFeatureStereoOp::transferLevel( int f_level_i )
                         int   bestDisp_i     = INVALID_DISP;
                         float maskVar_f      = std::numeric_limits<float>::max();
                         
+                        computeScores ( f_level_i, featPos, hMask, 
+                                        rlimit.min, rlimit.max,
+                                        scores_p, ssd_p );
+
                         for (int colrPos_i = rlimit.min; colrPos_i <= rlimit.max; ++colrPos_i)
                         {
                            int d = featPos.x - colrPos_i;
-                           /// Column limits for current disparity.
-                           S2D<int> uRlimit ( colrPos_i - hMask.width, 
-                                              colrPos_i + hMask.width );
-                            
-                           if ( uRlimit.min < 0 ||
-                                uRlimit.max >= imgSize.width )
-                           {
-                              //getchar();
-                           }                            
-                            
-                           float sumL_f    = 0.f;
-                           float sumR_f    = 0.f;
-                           float sumSqR_f  = 0.f;
-                           float sumSq_f   = 0.f;
-                           float varR_f    = 0.f;
-                            
-                           /// Correlate windows now.
-                           for (int i = vlimit.min; i <= vlimit.max; ++i)
-                           {
-                              uint8_t *ptrL_p = &imgL.at<uint8_t>(i,uLlimit.x);
-                              uint8_t *ptrR_p = &imgR.at<uint8_t>(i,uRlimit.x);
-                                
-                              for (int j = 0; j < mask.width; ++j, ++ptrL_p, ++ptrR_p)
-                              {
-                                 float diff_f = (float)*ptrL_p - (float)*ptrR_p;
-                                 sumL_f  += *ptrL_p;
-                                 sumR_f  += *ptrR_p;
-                                 sumSq_f += diff_f * diff_f;
-                                    
-                                 if ( m_checkVars_b )
-                                    sumSqR_f += (float)( *ptrR_p * *ptrR_p);
-                              }
-                           }
-                            
-                           if ( m_checkVars_b )
-                           {
-                              float sqR_f  = sumR_f * sumR_f / maskSize_i;
-                              varR_f = (sumSqR_f - sqR_f) / maskSize_i;
-                           }
 
-                           float avgDiff_f   = (sumL_f - sumR_f);
-                           float sqDiff_f    = avgDiff_f * avgDiff_f / maskSize_i;
-                           float scoreZssd_f = sumSq_f - sqDiff_f;
-                            
-                           /// Store scoreZssd in vector
-                           scores_p[d] = scoreZssd_f;
-                            
-                           if (scoreZssd_f < minZssdScore_f)
+                           if (scores_p[d] < minZssdScore_f)
                            {
-                              minZssdScore_f = scoreZssd_f;
-                              ssdScore_f     = sumSq_f;
+                              minZssdScore_f = scores_p[d];
+                              ssdScore_f     = ssd_p[d];
                               bestDisp_i     = d;
-                              maskVar_f      = varR_f;
                            }
 
                            // If already evaluated at least 3 positions and 
@@ -762,6 +879,11 @@ CFeatureStereoOp::transferLevel( int f_level_i )
                               break;
                         }
 
+                        if ( m_checkVars_b )
+                           maskVar_f = rightVariance ( f_level_i, 
+                                                       S2D<int> ( featPos.x - bestDisp_i, featPos.y ),
+                                                       hMask );
+
                         minZssdScore_f /= maskSize_i;
                         ssdScore_f     /= maskSize_i;                               
 
@@ -1056,6 +1178,90 @@ CFeatureStereoOp::setPyramidParams ( unsigned int f_levels_ui )
    return true;
 }
 
+bool
+CFeatureStereoOp::shareLeftPyramid ( )
+{
+   const bool wasShared_b = m_sharedLeftPyr_b;
+   m_sharedLeftPyr_b = false;
+
+   CImagePyramid * pyr_p = NULL;
+
+   if ( !m_preFilter_b && !m_idLeftPyramid_str.empty() )
+      pyr_p = getInput<CImagePyramid> ( m_idLeftPyramid_str );
+
+   if ( pyr_p && pyr_p->getLevels() >= m_levels_ui )
+   {
+      std::vector<cv::Mat> levels_v ( m_levels_ui );
+      bool valid_b = true;
+
+      /// Level sizes must be the ones computed by CImagePyramid.
+      for (unsigned int i = 0; i < m_levels_ui && valid_b; ++i)
+      {
+         levels_v[i] = pyr_p->getLevelImage(i);
+
+         cv::Size size = m_lImg.size();
+         if ( i > 0 )
+            size = cv::Size ( levels_v[i-1].cols/2, levels_v[i-1].rows/2 );
+
+         valid_b = ( levels_v[i].size() == size && 
+                     levels_v[i].type() == m_lImg.type() );
+      }
+
+      /// Built from the same image?
+      for (int i = 0; i < m_lImg.rows && valid_b; ++i)
+         valid_b = !memcmp ( m_lImg.ptr(i), 
+                             levels_v[0].ptr(i),
+                             m_lImg.cols * m_lImg.elemSize() );
+
+      if ( valid_b )
+      {
+         m_pyrLeft.setLevelImages ( levels_v );
+         m_sharedLeftPyr_b = true;
+         return true;
+      }
+   }
+
+   /// Do not overwrite the images of the previously shared pyramid.
+   if ( wasShared_b )
+      m_pyrLeft.setLevelImages ( std::vector<cv::Mat> ( m_levels_ui ) );
+
+   return false;
+}
+
+CDerivedImageCache::SImageDesc
+CFeatureStereoOp::getLeftImageDesc ( ) const
+{
+   CDerivedImageCache::SImageDesc desc ( m_idLeftImage_str );
+   
+   if ( m_preFilter_b )
+      desc.boxFilter ( 19, 5.f );
+
+   return desc;
+}
+
+CDerivedImageCache::SImageDesc
+CFeatureStereoOp::getRightImageDesc ( ) const
+{
+   CDerivedImageCache::SImageDesc desc ( m_idRightImage_str );
+   
+   if ( m_preFilter_b )
+      desc.boxFilter ( 19, 5.f );
+
+   return desc;
+}
+
+void
+CFeatureStereoOp::getPyramid ( const CDerivedImageCache::SImageDesc & f_desc,
+                               CImagePyramid &                        fr_pyramid ) const
+{
+   std::vector<cv::Mat> levels_v ( m_levels_ui );
+
+   for (unsigned int i = 0; i < m_levels_ui; ++i)
+      levels_v[i] = getDerivedImage ( CDerivedImageCache::SImageDesc ( f_desc ).level ( i ) );
+
+   fr_pyramid.setLevelImages ( levels_v );
+}
+
 bool
 CFeatureStereoOp::setLevels ( unsigned int f_levels_ui )
 {
@@ -97,6 +97,7 @@ namespace QCV
 
         ADD_PARAM_ACCESS (std::string, m_idLeftImage_str,     IdLeftImageStr);
         ADD_PARAM_ACCESS (std::string, m_idRightImage_str,    IdRightImageStr);
+        ADD_PARAM_ACCESS (std::string, m_idLeftPyramid_str,   IdLeftPyramidStr);
         ADD_PARAM_ACCESS (std::string, m_featPointVector_str, FeaturePointVectorId );
 
         ADD_PARAM_ACCESS (bool,        m_compute_b,           Compute );
@@ -129,9 +130,39 @@ namespace QCV
 
         bool setPyramidParams ( unsigned int f_levels_ui );
 
+        /// Use the input left pyramid if it was built from the left image.
+        bool shareLeftPyramid ( );
+
+        /// Derived images used as base level of the pyramids.
+        CDerivedImageCache::SImageDesc getLeftImageDesc ( ) const;
+        CDerivedImageCache::SImageDesc getRightImageDesc ( ) const;
+
+        /// Take the pyramid levels of f_desc from the derived image cache.
+        void getPyramid ( const CDerivedImageCache::SImageDesc & f_desc,
+                          CImagePyramid &                        fr_pyramid ) const;
+
         bool transferLevel( int f_level_i );
         bool computeFirstCorrelation( int m_fromLevel_i = -1 );
 
+        /// Integral images of all pyramid levels.
+        void computeIntegralImages ( );
+
+        /// ZSSD and SSD scores of the left window centered at f_pos
+        /// against the right windows centered at the columns
+        /// f_firstCol_i to f_lastCol_i, indexed by disparity.
+        void computeScores ( int            f_level_i,
+                             const S2D<int> f_pos,
+                             const S2D<int> f_hMask,
+                             int            f_firstCol_i,
+                             int            f_lastCol_i,
+                             float *        fr_zssd_p,
+                             float *        fr_ssd_p ) const;
+
+        /// Variance of the right window centered at f_pos.
+        float rightVariance ( int            f_level_i,
+                              const S2D<int> f_pos,
+                              const S2D<int> f_hMask ) const;
+
         void generateDispImage( const CFeatureVector *f_vec );
 
        //void generate3DPointList( const CStereoFeaturePointVector *f_vec );
@@ -166,6 +197,9 @@ namespace QCV
         
         /// Right image Id
         std::string                  m_idRightImage_str;
+
+        /// Id of an input pyramid of the left image
+        std::string                  m_idLeftPyramid_str;
         
         /// Feature Vector Input String
         std::string                  m_featPointVector_str;
@@ -200,9 +234,24 @@ namespace QCV
         /// Disparity image pyramid.
         CImagePyramid                m_pyrDisp;
 
+        /// Integral images of the left pyramid levels.
+        std::vector<cv::Mat>         m_intLeft_v;
+
+        /// Integral images of the squared left pyramid levels.
+        std::vector<cv::Mat>         m_intSqLeft_v;
+
+        /// Integral images of the right pyramid levels.
+        std::vector<cv::Mat>         m_intRight_v;
+
+        /// Integral images of the squared right pyramid levels.
+        std::vector<cv::Mat>         m_intSqRight_v;
+
         /// Levels
         unsigned int                 m_levels_ui;
 
+        /// Is the left pyramid shared with the input one?
+        bool                         m_sharedLeftPyr_b;
+
         /// Correction
         int                          m_deltaDisp_i;
 
@@ -232,6 +281,9 @@ namespace QCV
     private:
         /// Data structure to store scores.
         float m_scoresACTUAL_p[FSO_MAX_CORES][2*FSO_MAX_WIDTH];
+
+        /// Data structure to store the SSD of the scores.
+        float m_ssdACTUAL_p[FSO_MAX_CORES][2*FSO_MAX_WIDTH];
     };
 }
 #endif // __FEATURESTEREOOP_H
@@ -32,6 +32,7 @@
 
 /* INCLUDES */
 #include <limits>
+#include <algorithm>
 
 #include "gfttFreakOp.h"
 #include "paramMacros.h"
@@ -59,7 +60,6 @@ CGfttFreakOp::CGfttFreakOp ( COperator * const f_parent_p,
                                S2D<float> ( 0, 200 ) ),
       m_gftt_p (                                NULL ),
       m_freak_p (                               NULL ),
-      m_matcher_p (                             NULL ),
       m_cnt_i (                                    0 ),
 
       m_subPixBlockSize_i (                        3 ), 
@@ -328,6 +328,10 @@ CGfttFreakOp::cycle()
                    &modDescriptors.at<uint8_t>(i, 0),
                    modDescriptors.cols );
          }         
+
+         // Packed descriptors are outdated.
+         if ( !modIdxs_v.empty() )
+            prevFeatures.packedDescriptors.release();
          
          stopClock ("Extractor - FREAK");  
 
@@ -336,47 +340,7 @@ CGfttFreakOp::cycle()
       startClock ("Detector");
       {         
          startClock ("Detector - GFTT");
-         currFeatures.keypoints_v.clear();
-
-         const int maxFeatPerTile_i = std::min(std::max(1, m_maxFeatPerTile_i), m_numFeatures_i);
-      
-         const int tiles_i = sqrt(m_numFeatures_i/maxFeatPerTile_i);
-         
-         int verTiles_i = int(m_img.rows/(float)tiles_i)*tiles_i+1;
-         int horTiles_i = int(m_img.cols/(float)tiles_i)*tiles_i+1;
-         
-         cv::GoodFeaturesToTrackDetector gftt (maxFeatPerTile_i,
-                                               m_qualityLevel_d,
-                                               m_minDistance_d, 
-                                               m_blockSize_i, 
-                                               m_useHarris_b);
-         
-         std::vector<cv::KeyPoint> points ( maxFeatPerTile_i*2 );
-         
-         for (int i = 0 ; i < verTiles_i; i += m_img.rows / tiles_i )
-         {
-            for (int j = 0 ; j < horTiles_i; j += m_img.cols / tiles_i )
-            {
-               cv::Rect roi ( std::max(0, j-m_blockSize_i), 
-                              std::max(0, i-m_blockSize_i), 
-                              m_img.cols / tiles_i + m_blockSize_i,
-                              m_img.rows / tiles_i + m_blockSize_i );
-               
-               if (roi.width  + roi.x >= m_img.cols || j == horTiles_i-1) roi.width  = m_img.cols - roi.x - 1;
-               if (roi.height + roi.y >= m_img.rows || i == verTiles_i-1) roi.height = m_img.rows - roi.y - 1;
-               
-               points.clear();
-               gftt.detect(m_img(roi), points );
-               
-               for (int k = 0; k < points.size(); ++k)
-               {
-                  points[k].pt.x+=j;
-                  points[k].pt.y+=i;
-               }
-               
-               currFeatures.keypoints_v.insert( currFeatures.keypoints_v.end(), points.begin(), points.end() );
-            }
-         }
+         detectTiles ( currFeatures.keypoints_v );
          stopClock ("Detector - GFTT");
       }
       
@@ -384,24 +348,7 @@ CGfttFreakOp::cycle()
       if(m_useSubPix_b && !currFeatures.keypoints_v.empty())
       {
          startClock ("Detector - Sub-pixel");
-         cv::vector<cv::Point2f> points;
-         points.clear();
-         for(size_t i = 0; i < currFeatures.keypoints_v.size(); i++) 
-            points.push_back(currFeatures.keypoints_v[i].pt);
-         
-         cv::cornerSubPix (m_img, 
-                           points,
-                           cv::Size (m_subPixBlockSize_i, 
-                                     m_subPixBlockSize_i), 
-                           cv::Size (-1, -1), 
-                           cv::TermCriteria ( CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 
-                                              m_subPixIterNum_i,
-                                              m_subPixEPS_f) );
-         
-         for(size_t i = 0; i < points.size(); i ++) 
-         {
-            currFeatures.keypoints_v[i].pt = points[i];
-         }
+         refineSubPixel ( currFeatures.keypoints_v );
          stopClock ("Detector - Sub-pixel");
       }
       stopClock ("Detector");
@@ -479,17 +426,9 @@ CGfttFreakOp::cycle()
       {
          startClock ("Matcher");
          
-         startClock ("Matcher - Create Mask");
+         startClock ("Matcher - Candidates");
 
-         // Create mask based on distances
-         cv::Mat match_mask ( prevFeatures.keypoints_v.size(),
-                              currFeatures.keypoints_v.size(),
-                              CV_8UC1,
-                              cv::Scalar(0) );
-      
-         // use integer value for reducing the processing time of generating masks
          size_t prevSize_ui = prevFeatures.keypoints_v.size();
-         size_t currSize_ui = currFeatures.keypoints_v.size();	      
 
          SRigidMotion *   motion_p = getInput<SRigidMotion>  ( "Predicted Motion" );
          CStereoCamera *  camera_p = getInput<CStereoCamera> ( "Rectified Camera" );
@@ -502,19 +441,29 @@ CGfttFreakOp::cycle()
          if (motion_p)
             motion = *motion_p;         
 
+         m_predictions_v.resize ( prevSize_ui );
+         m_predMaxDist_v.resize ( prevSize_ui );
+
 #if defined ( _OPENMP )
          const unsigned int numThreads_ui = omp_get_max_threads();
 #pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
 #endif
          for(unsigned i = 0; i < prevSize_ui; i ++)
          {
-            int idx_i = prevFeatures.idx_feature_v[i];
+            int idx_i = i < prevFeatures.idx_feature_v.size() ? prevFeatures.idx_feature_v[i] : -1;
 
             int    maxDist_i   = static_cast<int>(m_maxDistance_f);
 
-            C3DVector prediction ( m_prevFeatureVector[idx_i].u,
-                                   m_prevFeatureVector[idx_i].v,
-                                   m_prevFeatureVector[idx_i].d );
+            /// Keypoints without entry in the feature vector are searched
+            /// around their own position.
+            C3DVector prediction ( prevFeatures.keypoints_v[i].pt.x,
+                                   prevFeatures.keypoints_v[i].pt.y,
+                                   -1 );
+
+            if ( idx_i >= 0 )
+               prediction = C3DVector ( m_prevFeatureVector[idx_i].u,
+                                        m_prevFeatureVector[idx_i].v,
+                                        m_prevFeatureVector[idx_i].d );
 
             if (camera_p && prediction.z() > 0 && motion_p)
             {
@@ -527,38 +476,18 @@ CGfttFreakOp::cycle()
                maxDist_i  = m_maxDistanceForPred_f;
             }
 
-            cv::KeyPoint *k1 = &prevFeatures.keypoints_v[i];
-            uchar *p1 = &match_mask.data[i*match_mask.step];
-            cv::Point2f refPnt = k1->pt;
-            cv::KeyPoint *k2 = &currFeatures.keypoints_v[0];
-
-            for(unsigned j = 0; j < currSize_ui; j++, ++p1, ++k2) 
-            {
-               int dx=static_cast<int>(prediction.x() - k2->pt.x);
-               int dy=static_cast<int>((prediction.y() - k2->pt.y)*xyRatio_f);
-               *p1 = (dx*dx+dy*dy < maxDist_i);
-            }
+            m_predictions_v[i] = cv::Point2f ( prediction.x(), prediction.y() );
+            m_predMaxDist_v[i] = maxDist_i;
          }
-         stopClock ("Matcher - Create Mask");
 
-         // Matching from the previous frame to the current frame
-         startClock ("Forward Matching");
-         m_matcher_p->knnMatch( prevFeatures.descriptors, 
-                                currFeatures.descriptors, 
-                                prevFeatures.radius_matches_v,
-                                1,
-                                match_mask);//m_featureMatchTh_f);
-         stopClock ("Forward Matching");
+         buildCandidates ( currFeatures, xyRatio_f );
 
-      
-         // Matching from the current frame to the previous frame
-         startClock ("Backward Matching");
-         m_matcher_p->knnMatch( currFeatures.descriptors, 
-                                prevFeatures.descriptors, 
-                                currFeatures.radius_matches_v,
-                                1,
-                                match_mask.t());//m_featureMatchTh_f);
-         stopClock ("Backward Matching");
+         stopClock ("Matcher - Candidates");
+
+         // Matching from the previous frame to the current frame and back
+         startClock ("Forward-Backward Matching");
+         matchCandidates ( prevFeatures, currFeatures );
+         stopClock ("Forward-Backward Matching");
       
          startClock ("Check consistency");      
          // Check the consistency of the matches.
@@ -696,6 +625,391 @@ CGfttFreakOp::cycle()
    return COperator::cycle();
 }
 
+void
+CGfttFreakOp::detectTiles ( std::vector<cv::KeyPoint> & fr_keypoints_v )
+{
+   fr_keypoints_v.clear();
+
+   const int maxFeatPerTile_i = std::min(std::max(1, m_maxFeatPerTile_i), m_numFeatures_i);
+      
+   const int tiles_i = sqrt(m_numFeatures_i/maxFeatPerTile_i);
+         
+   int verTiles_i = int(m_img.rows/(float)tiles_i)*tiles_i+1;
+   int horTiles_i = int(m_img.cols/(float)tiles_i)*tiles_i+1;
+
+   /// Tile regions in raster order, which is the merge order.
+   m_tileRois_v.clear();
+
+   for (int i = 0 ; i < verTiles_i; i += m_img.rows / tiles_i )
+   {
+      for (int j = 0 ; j < horTiles_i; j += m_img.cols / tiles_i )
+      {
+         cv::Rect roi ( std::max(0, j-m_blockSize_i), 
+                        std::max(0, i-m_blockSize_i), 
+                        m_img.cols / tiles_i + m_blockSize_i,
+                        m_img.rows / tiles_i + m_blockSize_i );
+               
+         if (roi.width  + roi.x >= m_img.cols || j == horTiles_i-1) roi.width  = m_img.cols - roi.x - 1;
+         if (roi.height + roi.y >= m_img.rows || i == verTiles_i-1) roi.height = m_img.rows - roi.y - 1;
+
+         m_tileRois_v.push_back ( roi );
+      }
+   }
+
+   const int numTiles_i = m_tileRois_v.size();
+
+   if ( (int) m_tileKeypoints_v.size() < numTiles_i )
+      m_tileKeypoints_v.resize ( numTiles_i );
+
+   cv::GoodFeaturesToTrackDetector gftt (maxFeatPerTile_i,
+                                         m_qualityLevel_d,
+                                         m_minDistance_d, 
+                                         m_blockSize_i, 
+                                         m_useHarris_b);
+
+#if defined ( _OPENMP )
+   const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
+#endif
+   for (int t = 0; t < numTiles_i; ++t)
+   {
+      std::vector<cv::KeyPoint> & points = m_tileKeypoints_v[t];
+      const cv::Rect &            roi    = m_tileRois_v[t];
+
+      points.clear();
+      gftt.detect(m_img(roi), points );
+               
+      /// Positions are relative to the region, which starts before the
+      /// tile.
+      for (int k = 0; k < (int) points.size(); ++k)
+      {
+         points[k].pt.x+=roi.x;
+         points[k].pt.y+=roi.y;
+      }
+   }
+
+   for (int t = 0; t < numTiles_i; ++t)
+      fr_keypoints_v.insert( fr_keypoints_v.end(), 
+                             m_tileKeypoints_v[t].begin(), 
+                             m_tileKeypoints_v[t].end() );
+}
+
+void
+CGfttFreakOp::refineSubPixel ( std::vector<cv::KeyPoint> & fr_keypoints_v )
+{
+   const int numPoints_i = fr_keypoints_v.size();
+
+   m_subPixPoints_v.resize ( numPoints_i );
+
+   for (int i = 0; i < numPoints_i; ++i) 
+      m_subPixPoints_v[i] = fr_keypoints_v[i].pt;
+
+   /// Each point is refined independently, so contiguous chunks can be
+   /// processed by different threads.
+#if defined ( _OPENMP )
+   const int numChunks_i = std::max(1, std::min( (int) omp_get_max_threads(), numPoints_i / 16 ) );
+#pragma omp parallel for num_threads(numChunks_i) schedule(static, 1)
+#else
+   const int numChunks_i = 1;
+#endif
+   for (int c = 0; c < numChunks_i; ++c)
+   {
+      const int from_i = (int) ( (long long) numPoints_i * c       / numChunks_i );
+      const int to_i   = (int) ( (long long) numPoints_i * (c + 1) / numChunks_i );
+
+      if ( to_i <= from_i )
+         continue;
+
+      cv::Mat points ( to_i - from_i, 1, CV_32FC2, &m_subPixPoints_v[from_i] );
+
+      cv::cornerSubPix (m_img, 
+                        points,
+                        cv::Size (m_subPixBlockSize_i, 
+                                  m_subPixBlockSize_i), 
+                        cv::Size (-1, -1), 
+                        cv::TermCriteria ( CV_TERMCRIT_ITER | CV_TERMCRIT_EPS, 
+                                           m_subPixIterNum_i,
+                                           m_subPixEPS_f) );
+   }
+         
+   for (int i = 0; i < numPoints_i; ++i) 
+      fr_keypoints_v[i].pt = m_subPixPoints_v[i];
+}
+
+void
+CGfttFreakOp::buildCandidates ( const SFeatureData & f_currFeatures,
+                                float                f_xyRatio_f )
+{
+   const int prevSize_i = m_predictions_v.size();
+   const int currSize_i = f_currFeatures.keypoints_v.size();
+
+   const float xyRatio_f = std::max(f_xyRatio_f, 1.e-3f);
+
+   /// Search radius: dx and dy below are truncated to integers, so
+   /// distances up to one pixel beyond sqrt(maxDist) can still pass.
+   int maxDist_i = 0;
+   for (int i = 0; i < prevSize_i; ++i)
+      maxDist_i = std::max(maxDist_i, m_predMaxDist_v[i]);
+
+   const float radius_f = sqrtf((float)maxDist_i) + 1.f;
+
+   /// Cells as large as the search region so that few cells are visited.
+   const float cellWidth_f  = std::max(radius_f, 8.f);
+   const float cellHeight_f = std::max(radius_f / xyRatio_f, 8.f);
+   const int   cols_i       = m_img.cols / cellWidth_f  + 1;
+   const int   rows_i       = m_img.rows / cellHeight_f + 1;
+
+   /// Bucket the current keypoints (counting sort by cell).
+   m_cellStart_v.assign ( cols_i * rows_i + 1, 0 );
+   m_cellPoints_v.resize ( currSize_i );
+
+   std::vector<int> cellOf_v ( currSize_i );
+
+   for (int j = 0; j < currSize_i; ++j)
+   {
+      const cv::Point2f & pt = f_currFeatures.keypoints_v[j].pt;
+      const int cx_i = std::min(std::max(0, (int)(pt.x / cellWidth_f)),  cols_i-1);
+      const int cy_i = std::min(std::max(0, (int)(pt.y / cellHeight_f)), rows_i-1);
+      cellOf_v[j] = cy_i * cols_i + cx_i;
+      ++m_cellStart_v[cellOf_v[j]+1];
+   }
+
+   for (int c = 0; c < cols_i * rows_i; ++c)
+      m_cellStart_v[c+1] += m_cellStart_v[c];
+
+   std::vector<int> fill_v ( m_cellStart_v.begin(), m_cellStart_v.end() - 1 );
+      
+   for (int j = 0; j < currSize_i; ++j)
+      m_cellPoints_v[fill_v[cellOf_v[j]]++] = j;
+
+   /// Candidates of each previous keypoint. First pass counts, second
+   /// pass fills, so that the list does not depend on the threads.
+   m_candStart_v.assign ( prevSize_i + 1, 0 );
+
+#if defined ( _OPENMP )
+   const unsigned int numThreads_ui = omp_get_max_threads();
+#endif
+
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      if ( pass == 1 )
+      {
+         for (int i = 0; i < prevSize_i; ++i)
+            m_candStart_v[i+1] += m_candStart_v[i];
+
+         m_candidates_v.resize ( m_candStart_v[prevSize_i] );
+      }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, 64)
+#endif
+      for (int i = 0; i < prevSize_i; ++i)
+      {
+         const int maxDist_i = m_predMaxDist_v[i];
+
+         if ( maxDist_i <= 0 ) continue;
+
+         const cv::Point2f & pred = m_predictions_v[i];
+         const float rx_f = sqrtf((float)maxDist_i) + 1.f;
+         const float ry_f = rx_f / xyRatio_f;
+
+         const float minX_f = floorf((pred.x - rx_f) / cellWidth_f);
+         const float maxX_f = floorf((pred.x + rx_f) / cellWidth_f);
+         const float minY_f = floorf((pred.y - ry_f) / cellHeight_f);
+         const float maxY_f = floorf((pred.y + ry_f) / cellHeight_f);
+
+         /// Also skips invalid predictions.
+         if ( !( maxX_f >= 0 && minX_f <= cols_i-1 && 
+                 maxY_f >= 0 && minY_f <= rows_i-1 ) )
+            continue;
+
+         const int minX_i = (int)std::max(minX_f, 0.f);
+         const int maxX_i = std::min((int)std::min(maxX_f, (float)cols_i), cols_i-1);
+         const int minY_i = (int)std::max(minY_f, 0.f);
+         const int maxY_i = std::min((int)std::min(maxY_f, (float)rows_i), rows_i-1);
+
+         int count_i = 0;
+         int * out_p = pass==1?&m_candidates_v[m_candStart_v[i]]:NULL;
+
+         for (int cy = minY_i; cy <= maxY_i; ++cy)
+         {
+            for (int cx = minX_i; cx <= maxX_i; ++cx)
+            {
+               const int c = cy * cols_i + cx;
+               for (int k = m_cellStart_v[c]; k < m_cellStart_v[c+1]; ++k)
+               {
+                  const int j = m_cellPoints_v[k];
+                  const cv::Point2f & pt = f_currFeatures.keypoints_v[j].pt;
+
+                  /// Same test as the former dense match mask.
+                  int dx=static_cast<int>(pred.x - pt.x);
+                  int dy=static_cast<int>((pred.y - pt.y)*f_xyRatio_f);
+
+                  if ( dx*dx+dy*dy < maxDist_i )
+                  {
+                     if ( out_p ) out_p[count_i] = j;
+                     ++count_i;
+                  }
+               }
+            }
+         }
+
+         if ( pass == 0 )
+            m_candStart_v[i+1] = count_i;
+         else
+            std::sort ( out_p, out_p + count_i );
+      }
+   }
+
+   /// Transposed list: previous keypoints having each current keypoint as
+   /// candidate, in increasing order.
+   m_revCandStart_v.assign ( currSize_i + 1, 0 );
+
+   for (size_t k = 0; k < m_candidates_v.size(); ++k)
+      ++m_revCandStart_v[m_candidates_v[k]+1];
+
+   for (int j = 0; j < currSize_i; ++j)
+      m_revCandStart_v[j+1] += m_revCandStart_v[j];
+
+   m_revCandidates_v.resize ( m_candidates_v.size() );
+
+   fill_v.assign ( m_revCandStart_v.begin(), m_revCandStart_v.end() - 1 );
+
+   for (int i = 0; i < prevSize_i; ++i)
+      for (int k = m_candStart_v[i]; k < m_candStart_v[i+1]; ++k)
+         m_revCandidates_v[fill_v[m_candidates_v[k]]++] = i;
+}
+
+/// L2 distance of two correlation patches.
+static inline float
+l2Distance ( const uchar * f_a_p,
+             const uchar * f_b_p,
+             int           f_size_i )
+{
+   int sum_i = 0;
+   for (int k = 0; k < f_size_i; ++k)
+   {
+      const int d_i = (int)f_a_p[k] - (int)f_b_p[k];
+      sum_i += d_i * d_i;
+   }
+   return sqrtf((float)sum_i);
+}
+
+void
+CGfttFreakOp::matchCandidates ( SFeatureData & fr_prevFeatures,
+                                SFeatureData & fr_currFeatures )
+{
+   const int prevSize_i = fr_prevFeatures.keypoints_v.size();
+   const int currSize_i = fr_currFeatures.keypoints_v.size();
+
+   const cv::Mat & prevDesc = fr_prevFeatures.descriptors;
+   const cv::Mat & currDesc = fr_currFeatures.descriptors;
+
+   fr_prevFeatures.radius_matches_v.clear();
+   fr_prevFeatures.radius_matches_v.resize ( prevSize_i );
+   fr_currFeatures.radius_matches_v.clear();
+   fr_currFeatures.radius_matches_v.resize ( currSize_i );
+
+   /// Only packed for the Hamming matcher below.
+   fr_currFeatures.packedDescriptors.release();
+
+   if ( prevDesc.rows != prevSize_i || currDesc.rows != currSize_i ||
+        prevDesc.cols != currDesc.cols || prevDesc.type() != CV_8U || currDesc.type() != CV_8U )
+      return;
+
+   if ( !m_correlation_b )
+   {
+      /// FREAK descriptors: Hamming distance. The previous descriptors
+      /// were packed in the last frame, unless that frame did not use 
+      /// the Hamming matcher.
+      cv::Mat & prevPacked = fr_prevFeatures.packedDescriptors;
+      cv::Mat & currPacked = fr_currFeatures.packedDescriptors;
+
+      if ( prevPacked.rows != prevDesc.rows || 
+           prevPacked.cols != ( ( prevDesc.cols + 15 ) / 16 ) * 16 )
+      {
+         if ( !CHammingMatcher::pack ( prevDesc, prevPacked ) )
+            return;
+      }
+
+      if ( !CHammingMatcher::pack ( currDesc, currPacked ) ||
+           !m_hammingMatcher.match ( prevPacked, currPacked,
+                                     m_candStart_v, m_candidates_v,
+                                     m_fwdMatches_v ) ||
+           !m_hammingMatcher.match ( currPacked, prevPacked,
+                                     m_revCandStart_v, m_revCandidates_v,
+                                     m_bwdMatches_v ) )
+         return;
+
+      for (int i = 0; i < prevSize_i; ++i)
+         if ( m_fwdMatches_v[i].trainIdx >= 0 )
+            fr_prevFeatures.radius_matches_v[i].push_back ( cv::DMatch ( i, 
+                                                                         m_fwdMatches_v[i].trainIdx, 
+                                                                         (float) m_fwdMatches_v[i].distance ) );
+
+      for (int j = 0; j < currSize_i; ++j)
+         if ( m_bwdMatches_v[j].trainIdx >= 0 )
+            fr_currFeatures.radius_matches_v[j].push_back ( cv::DMatch ( j, 
+                                                                         m_bwdMatches_v[j].trainIdx, 
+                                                                         (float) m_bwdMatches_v[j].distance ) );
+      return;
+   }
+
+   /// Correlation patches: L2 distance.
+   const int descSize_i = prevDesc.cols;
+
+#if defined ( _OPENMP )
+   const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, 64)
+#endif
+   for (int i = 0; i < prevSize_i; ++i)
+   {
+      int   best_i  = -1;
+      float bestDist_f = std::numeric_limits<float>::max();
+
+      for (int k = m_candStart_v[i]; k < m_candStart_v[i+1]; ++k)
+      {
+         const int j = m_candidates_v[k];
+         const float dist_f = l2Distance ( prevDesc.ptr<uchar>(i),
+                                           currDesc.ptr<uchar>(j),
+                                           descSize_i );
+         if ( dist_f < bestDist_f )
+         {
+            bestDist_f = dist_f;
+            best_i     = j;
+         }
+      }
+
+      if ( best_i >= 0 )
+         fr_prevFeatures.radius_matches_v[i].push_back ( cv::DMatch ( i, best_i, bestDist_f ) );
+   }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, 64)
+#endif
+   for (int j = 0; j < currSize_i; ++j)
+   {
+      int   best_i  = -1;
+      float bestDist_f = std::numeric_limits<float>::max();
+
+      for (int k = m_revCandStart_v[j]; k < m_revCandStart_v[j+1]; ++k)
+      {
+         const int i = m_revCandidates_v[k];
+         const float dist_f = l2Distance ( currDesc.ptr<uchar>(j),
+                                           prevDesc.ptr<uchar>(i),
+                                           descSize_i );
+         if ( dist_f < bestDist_f )
+         {
+            bestDist_f = dist_f;
+            best_i     = i;
+         }
+      }
+
+      if ( best_i >= 0 )
+         fr_currFeatures.radius_matches_v[j].push_back ( cv::DMatch ( j, best_i, bestDist_f ) );
+   }
+}
+
 /// Show event.
 bool CGfttFreakOp::show()
 {
@@ -829,8 +1143,6 @@ bool CGfttFreakOp::initialize()
     if (m_freak_p) delete m_freak_p;
     m_freak_p = new cv::FREAK (false, false, 18.0, 0);
    
-    if (m_matcher_p) delete m_matcher_p;
-    m_matcher_p = new cv::BFMatcher(m_correlation_b?cv::NORM_L2:cv::NORM_HAMMING, false); //
 
     m_featureVector.clear();
     m_featureVector.resize( m_numFeatures_i );
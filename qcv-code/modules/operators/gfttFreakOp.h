@@ -49,6 +49,7 @@
 #include "colorEncoding.h"
 
 #include "feature.h"
+#include "hammingMatcher.h"
 
 /* PROTOTYPES */
 
@@ -129,12 +130,22 @@ namespace QCV
 
         void registerParameters(  );
 
+        /// Detect features in each tile of the image in parallel and
+        /// append them in tile order.
+        void detectTiles ( std::vector<cv::KeyPoint> & fr_keypoints_v );
+
+        /// Sub-pixel refinement of the keypoints split across threads.
+        void refineSubPixel ( std::vector<cv::KeyPoint> & fr_keypoints_v );
+
     /// Protected data types
     protected:
         struct SFeatureData
         {
             std::vector<cv::KeyPoint>                keypoints_v;
             cv::Mat                                  descriptors;
+            /// Descriptors packed for the Hamming matcher. Kept for the
+            /// next frame, when these become the previous features.
+            cv::Mat                                  packedDescriptors;
             /// Map from keypoints_v to feature vector
             std::vector<int>                         idx_feature_v;
             /// Map from feature vector to keypoints_v
@@ -145,12 +156,27 @@ namespace QCV
            {
               keypoints_v.clear();
               descriptors=cv::Mat();
+              packedDescriptors=cv::Mat();
               idx_feature_rev_v.clear();
               radius_matches_v.clear();
            }
            
         };
 
+    /// Help methods
+    protected:
+
+        /// Gather the current keypoints around the predicted position of
+        /// each previous keypoint in a compressed row list.
+        void buildCandidates ( const SFeatureData & f_currFeatures,
+                               float                f_xyRatio_f );
+
+        /// Best match of each previous keypoint among its candidates and
+        /// of each current keypoint among the previous keypoints having
+        /// it as candidate.
+        void matchCandidates ( SFeatureData & fr_prevFeatures,
+                               SFeatureData & fr_currFeatures );
+
     private:
         
         /// Input image Id.
@@ -180,8 +206,8 @@ namespace QCV
         /// Freak extractor
         cv::FREAK *                         m_freak_p;
 
-        /// Matcher
- 	cv::BFMatcher *                     m_matcher_p;
+        /// Matcher for FREAK descriptors
+        CHammingMatcher                     m_hammingMatcher;
 
         /// Feature data
         SFeatureData                        m_featData[2];
@@ -214,6 +240,38 @@ namespace QCV
        bool m_normalizedCorr_b;
 
        int m_maxFeatPerTile_i;
+
+       /// Image region of each detection tile (tile plus border).
+       std::vector<cv::Rect>                  m_tileRois_v;
+
+       /// Keypoints detected in each tile.
+       std::vector< std::vector<cv::KeyPoint> > m_tileKeypoints_v;
+
+       /// Keypoint positions for the sub-pixel refinement.
+       std::vector<cv::Point2f>               m_subPixPoints_v;
+
+       /// Predicted position of each previous keypoint.
+       std::vector<cv::Point2f>               m_predictions_v;
+
+       /// Max squared search distance of each previous keypoint.
+       std::vector<int>                       m_predMaxDist_v;
+
+       /// Current keypoints sorted by grid cell and first entry of each
+       /// cell.
+       std::vector<int>                       m_cellPoints_v;
+       std::vector<int>                       m_cellStart_v;
+
+       /// Candidate current keypoints of each previous keypoint.
+       std::vector<int>                       m_candidates_v;
+       std::vector<int>                       m_candStart_v;
+
+       /// Candidate previous keypoints of each current keypoint.
+       std::vector<int>                       m_revCandidates_v;
+       std::vector<int>                       m_revCandStart_v;
+
+       /// Forward and backward binary descriptor matches.
+       std::vector<CHammingMatcher::SMatch>   m_fwdMatches_v;
+       std::vector<CHammingMatcher::SMatch>   m_bwdMatches_v;
        
     };
 }
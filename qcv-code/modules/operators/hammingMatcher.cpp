@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file hammingMatcher.cpp
+ *
+ * \class CHammingMatcher
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Nearest neighbor matcher for binary descriptors.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "hammingMatcher.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/// The POPCNT, AVX2 and AVX-512 kernels are compiled with target 
+/// attributes and selected at run time (GCC and Clang on x86).
+#if defined ( __GNUC__ ) && ( defined ( __x86_64__ ) || defined ( __i386__ ) ) && \
+    ( defined ( __clang__ ) || __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define HMM_RUNTIME_DISPATCH
+#include <immintrin.h>
+
+/// Kernels are inlined into the search loop of their instruction set.
+#define HMM_TARGET(f_isa)         __attribute__ (( target ( f_isa ) ))
+#define HMM_TARGET_FLATTEN(f_isa) __attribute__ (( target ( f_isa ), flatten ))
+
+#if defined ( __clang__ ) || __GNUC__ >= 8
+#define HMM_AVX512_POPCNT
+#endif
+#endif
+
+/// Queries per chunk for the dynamic thread scheduling.
+#define HMM_QUERIES_PER_CHUNK 64
+
+using namespace QCV;
+
+#if !defined ( __SSE2__ )
+static const unsigned char g_bitCount_p[256] = {
+    0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+    1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+    1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+    2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+    1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+    2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+    2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+    3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,4,5,5,6,5,6,6,7,5,6,6,7,6,7,7,8 };
+#endif
+
+CHammingMatcher::CHammingMatcher()
+{
+}
+
+CHammingMatcher::~CHammingMatcher()
+{
+}
+
+bool
+CHammingMatcher::pack ( const cv::Mat & f_desc,
+                        cv::Mat &       fr_packed )
+{
+    if ( f_desc.type() != CV_8UC1 )
+    {
+        printf("%s:%i Binary descriptors must be of type CV_8UC1.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    const int bytes_i = ( ( f_desc.cols + 15 ) / 16 ) * 16;
+
+    /// Mat data is 16 byte aligned, and so is every row.
+    fr_packed.create ( f_desc.rows, bytes_i, CV_8UC1 );
+
+    for (int i = 0; i < f_desc.rows; ++i)
+    {
+        unsigned char * dst_p = fr_packed.ptr<unsigned char>(i);
+        memcpy ( dst_p, f_desc.ptr<unsigned char>(i), f_desc.cols );
+        memset ( dst_p + f_desc.cols, 0, bytes_i - f_desc.cols );
+    }
+
+    return true;
+}
+
+/// Hamming distance of two 16 byte aligned rows with the instructions
+/// of the build target (SSE2 bit counting or table lookup).
+static inline int hammingDistance ( const unsigned char * f_a_p,
+                                    const unsigned char * f_b_p,
+                                    int                   f_bytes_i )
+{
+#if defined ( __SSE2__ )
+    const __m128i low4 = _mm_set1_epi8 ( 0x0f );
+    __m128i sum = _mm_setzero_si128();
+
+    for (int k = 0; k < f_bytes_i; k += 16)
+    {
+        __m128i x = _mm_xor_si128 ( _mm_load_si128 ( (const __m128i *) (f_a_p + k) ),
+                                    _mm_load_si128 ( (const __m128i *) (f_b_p + k) ) );
+
+        /// Bit count of each byte in parallel.
+        x = _mm_sub_epi8 ( x, _mm_and_si128 ( _mm_srli_epi16 ( x, 1 ), _mm_set1_epi8 ( 0x55 ) ) );
+        x = _mm_add_epi8 ( _mm_and_si128 ( x, _mm_set1_epi8 ( 0x33 ) ),
+                           _mm_and_si128 ( _mm_srli_epi16 ( x, 2 ), _mm_set1_epi8 ( 0x33 ) ) );
+        __m128i cnt = _mm_and_si128 ( _mm_add_epi8 ( x, _mm_srli_epi16 ( x, 4 ) ), low4 );
+
+        sum = _mm_add_epi64 ( sum, _mm_sad_epu8 ( cnt, _mm_setzero_si128() ) );
+    }
+
+    return _mm_cvtsi128_si32 ( sum ) + _mm_cvtsi128_si32 ( _mm_unpackhi_epi64 ( sum, sum ) );
+#else
+    int dist_i = 0;
+    for (int k = 0; k < f_bytes_i; ++k)
+        dist_i += g_bitCount_p[f_a_p[k] ^ f_b_p[k]];
+    return dist_i;
+#endif
+}
+
+#if defined ( HMM_RUNTIME_DISPATCH )
+/// POPCNT on 8 bytes at a time.
+HMM_TARGET("popcnt")
+static inline int hammingDistancePopcnt ( const unsigned char * f_a_p,
+                                          const unsigned char * f_b_p,
+                                          int                   f_bytes_i )
+{
+    int dist_i = 0;
+    for (int k = 0; k < f_bytes_i; k += 8)
+    {
+        unsigned long long a, b;
+        memcpy ( &a, f_a_p + k, 8 );
+        memcpy ( &b, f_b_p + k, 8 );
+        dist_i += __builtin_popcountll ( a ^ b );
+    }
+    return dist_i;
+}
+
+/// AVX2 nibble table lookup on 32 bytes at a time, and SSSE3 on the
+/// last 16 bytes.
+HMM_TARGET("avx2")
+static inline int hammingDistanceAvx2 ( const unsigned char * f_a_p,
+                                        const unsigned char * f_b_p,
+                                        int                   f_bytes_i )
+{
+    const __m256i lut  = _mm256_setr_epi8 ( 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4 );
+    const __m256i low4 = _mm256_set1_epi8 ( 0x0f );
+    __m256i sum = _mm256_setzero_si256();
+
+    int k = 0;
+    for (; k + 32 <= f_bytes_i; k += 32)
+    {
+        const __m256i x = _mm256_xor_si256 ( _mm256_loadu_si256 ( (const __m256i *) (f_a_p + k) ),
+                                             _mm256_loadu_si256 ( (const __m256i *) (f_b_p + k) ) );
+        const __m256i cnt = _mm256_add_epi8 ( _mm256_shuffle_epi8 ( lut, _mm256_and_si256 ( x, low4 ) ),
+                                              _mm256_shuffle_epi8 ( lut, _mm256_and_si256 ( _mm256_srli_epi16 ( x, 4 ), low4 ) ) );
+        sum = _mm256_add_epi64 ( sum, _mm256_sad_epu8 ( cnt, _mm256_setzero_si256() ) );
+    }
+
+    __m128i sum128 = _mm_add_epi64 ( _mm256_castsi256_si128 ( sum ),
+                                     _mm256_extracti128_si256 ( sum, 1 ) );
+
+    if ( k < f_bytes_i )
+    {
+        const __m128i x = _mm_xor_si128 ( _mm_load_si128 ( (const __m128i *) (f_a_p + k) ),
+                                          _mm_load_si128 ( (const __m128i *) (f_b_p + k) ) );
+        const __m128i cnt = _mm_add_epi8 ( _mm_shuffle_epi8 ( _mm256_castsi256_si128 ( lut ), 
+                                                              _mm_and_si128 ( x, _mm256_castsi256_si128 ( low4 ) ) ),
+                                           _mm_shuffle_epi8 ( _mm256_castsi256_si128 ( lut ), 
+                                                              _mm_and_si128 ( _mm_srli_epi16 ( x, 4 ), 
+                                                                              _mm256_castsi256_si128 ( low4 ) ) ) );
+        sum128 = _mm_add_epi64 ( sum128, _mm_sad_epu8 ( cnt, _mm_setzero_si128() ) );
+    }
+
+    return _mm_cvtsi128_si32 ( sum128 ) + _mm_cvtsi128_si32 ( _mm_unpackhi_epi64 ( sum128, sum128 ) );
+}
+
+#if defined ( HMM_AVX512_POPCNT )
+/// AVX-512 VPOPCNTDQ on 64 bytes at a time. The last bytes are loaded
+/// with a mask.
+HMM_TARGET("avx512f,avx512vpopcntdq")
+static inline int hammingDistanceAvx512 ( const unsigned char * f_a_p,
+                                          const unsigned char * f_b_p,
+                                          int                   f_bytes_i )
+{
+    __m512i sum = _mm512_setzero_si512();
+
+    int k = 0;
+    for (; k + 64 <= f_bytes_i; k += 64)
+        sum = _mm512_add_epi64 ( sum, _mm512_popcnt_epi64 ( _mm512_xor_si512 ( _mm512_loadu_si512 ( f_a_p + k ),
+                                                                               _mm512_loadu_si512 ( f_b_p + k ) ) ) );
+
+    if ( k < f_bytes_i )
+    {
+        const __mmask8 mask = (__mmask8) ( ( 1u << ( ( f_bytes_i - k ) / 8 ) ) - 1 );
+        sum = _mm512_add_epi64 ( sum, _mm512_popcnt_epi64 ( _mm512_xor_si512 ( _mm512_maskz_loadu_epi64 ( mask, f_a_p + k ),
+                                                                               _mm512_maskz_loadu_epi64 ( mask, f_b_p + k ) ) ) );
+    }
+
+    long long sum_p[8];
+    _mm512_storeu_si512 ( sum_p, sum );
+
+    return (int) ( sum_p[0] + sum_p[1] + sum_p[2] + sum_p[3] + 
+                   sum_p[4] + sum_p[5] + sum_p[6] + sum_p[7] );
+}
+#endif
+#endif
+
+/// Distance function.
+typedef int (*THammingDistanceFunc) ( const unsigned char *,
+                                      const unsigned char *,
+                                      int );
+
+/// Best and second best train rows for a query among the rows
+/// f_idx_p[0..f_count_i-1], or among the first f_count_i rows if f_idx_p
+/// is NULL. DIST is the distance kernel. BYTES_I is the row size if
+/// known at compile time, 0 otherwise.
+template <THammingDistanceFunc DIST, int BYTES_I>
+static inline void searchBest ( const unsigned char *     f_query_p,
+                                const cv::Mat &           f_train,
+                                const int *               f_idx_p,
+                                int                       f_count_i,
+                                CHammingMatcher::SMatch & fr_match )
+{
+    const int bytes_i = BYTES_I > 0 ? BYTES_I : f_train.cols;
+    int best_i = -1, bestDist_i = INT_MAX, secondDist_i = INT_MAX;
+
+    for (int k = 0; k < f_count_i; ++k)
+    {
+        const int j = f_idx_p ? f_idx_p[k] : k;
+        const int dist_i = DIST ( f_query_p, f_train.ptr<unsigned char>(j), bytes_i );
+
+        if ( dist_i < bestDist_i )
+        {
+            secondDist_i = bestDist_i;
+            bestDist_i   = dist_i;
+            best_i       = j;
+        }
+        else if ( dist_i < secondDist_i )
+            secondDist_i = dist_i;
+    }
+
+    fr_match.trainIdx       = best_i;
+    fr_match.distance       = bestDist_i;
+    fr_match.secondDistance = secondDist_i;
+}
+
+/// Search of one query, inlined for 512 bit descriptors.
+typedef void (*TSearchFunc) ( const unsigned char *,
+                              const cv::Mat &,
+                              const int *,
+                              int,
+                              CHammingMatcher::SMatch & );
+
+#define HMM_SEARCH_ARGS const unsigned char * f_query_p, const cv::Mat & f_train, \
+                        const int * f_idx_p, int f_count_i, CHammingMatcher::SMatch & fr_match
+#define HMM_SEARCH(f_dist) \
+    if ( f_train.cols == 64 ) \
+        searchBest<f_dist, 64> ( f_query_p, f_train, f_idx_p, f_count_i, fr_match ); \
+    else \
+        searchBest<f_dist, 0>  ( f_query_p, f_train, f_idx_p, f_count_i, fr_match );
+
+static void searchDefault ( HMM_SEARCH_ARGS ) { HMM_SEARCH ( hammingDistance ) }
+
+#if defined ( HMM_RUNTIME_DISPATCH )
+HMM_TARGET_FLATTEN("popcnt")
+static void searchPopcnt ( HMM_SEARCH_ARGS ) { HMM_SEARCH ( hammingDistancePopcnt ) }
+
+HMM_TARGET_FLATTEN("avx2")
+static void searchAvx2 ( HMM_SEARCH_ARGS ) { HMM_SEARCH ( hammingDistanceAvx2 ) }
+
+#if defined ( HMM_AVX512_POPCNT )
+HMM_TARGET_FLATTEN("avx512f,avx512vpopcntdq")
+static void searchAvx512 ( HMM_SEARCH_ARGS ) { HMM_SEARCH ( hammingDistanceAvx512 ) }
+#endif
+#endif
+
+/// Fastest distance and search functions supported by the CPU.
+static void selectKernels ( THammingDistanceFunc & fr_dist_p,
+                            TSearchFunc &          fr_search_p )
+{
+    fr_dist_p   = hammingDistance;
+    fr_search_p = searchDefault;
+
+#if defined ( HMM_RUNTIME_DISPATCH )
+    __builtin_cpu_init();
+
+#if defined ( HMM_AVX512_POPCNT )
+    if ( __builtin_cpu_supports ( "avx512vpopcntdq" ) )
+    {
+        fr_dist_p   = hammingDistanceAvx512;
+        fr_search_p = searchAvx512;
+        return;
+    }
+#endif
+
+    if ( __builtin_cpu_supports ( "avx2" ) )
+    {
+        fr_dist_p   = hammingDistanceAvx2;
+        fr_search_p = searchAvx2;
+    }
+    else if ( __builtin_cpu_supports ( "popcnt" ) )
+    {
+        fr_dist_p   = hammingDistancePopcnt;
+        fr_search_p = searchPopcnt;
+    }
+#endif
+}
+
+static THammingDistanceFunc g_distance_p = NULL;
+static TSearchFunc          g_search_p   = NULL;
+
+/// Selects the kernels once at load time.
+static struct SKernelSelector
+{
+    SKernelSelector() { selectKernels ( g_distance_p, g_search_p ); }
+} g_kernelSelector;
+
+int
+CHammingMatcher::distance ( const unsigned char * f_a_p,
+                            const unsigned char * f_b_p,
+                            int                   f_bytes_i )
+{
+    return g_distance_p ( f_a_p, f_b_p, f_bytes_i );
+}
+
+bool
+CHammingMatcher::checkFormat ( const cv::Mat & f_query,
+                               const cv::Mat & f_train ) const
+{
+    if ( f_query.type() != CV_8UC1 || f_train.type() != CV_8UC1 ||
+         f_query.cols   != f_train.cols || f_query.cols % 16 ||
+         ( f_query.rows > 1 && (size_t) f_query.step % 16 ) ||
+         ( f_train.rows > 1 && (size_t) f_train.step % 16 ) ||
+         ( (size_t) f_query.data % 16 ) || ( (size_t) f_train.data % 16 ) )
+    {
+        printf("%s:%i Descriptors must be packed with CHammingMatcher::pack.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    return true;
+}
+
+bool
+CHammingMatcher::match ( const cv::Mat &       f_query,
+                         const cv::Mat &       f_train,
+                         std::vector<SMatch> & fr_matches_v ) const
+{
+    fr_matches_v.resize ( f_query.rows );
+
+    if ( !checkFormat ( f_query, f_train ) )
+        return false;
+
+    const TSearchFunc search_p = g_search_p;
+
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, HMM_QUERIES_PER_CHUNK)
+#endif
+    for (int i = 0; i < f_query.rows; ++i)
+    {
+        search_p ( f_query.ptr<unsigned char>(i), f_train, NULL, f_train.rows, fr_matches_v[i] );
+    }
+
+    return true;
+}
+
+bool
+CHammingMatcher::match ( const cv::Mat &          f_query,
+                         const cv::Mat &          f_train,
+                         const std::vector<int> & f_candStart_v,
+                         const std::vector<int> & f_candidates_v,
+                         std::vector<SMatch> &    fr_matches_v ) const
+{
+    fr_matches_v.resize ( f_query.rows );
+
+    if ( !checkFormat ( f_query, f_train ) )
+        return false;
+
+    if ( (int) f_candStart_v.size() != f_query.rows + 1 ||
+         f_candStart_v.back() > (int) f_candidates_v.size() )
+    {
+        printf("%s:%i Invalid candidate list.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    const TSearchFunc search_p = g_search_p;
+
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic, HMM_QUERIES_PER_CHUNK)
+#endif
+    for (int i = 0; i < f_query.rows; ++i)
+    {
+        const int * idx_p   = f_candidates_v.empty() ? NULL : &f_candidates_v[f_candStart_v[i]];
+        const int   count_i = f_candStart_v[i+1] - f_candStart_v[i];
+
+        search_p ( f_query.ptr<unsigned char>(i), f_train, idx_p, count_i, fr_matches_v[i] );
+    }
+
+    return true;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __HAMMINGMATCHER_H
+#define __HAMMINGMATCHER_H
+
+/**
+ *******************************************************************************
+ *
+ * @file hammingMatcher.h
+ *
+ * \class CHammingMatcher
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Nearest neighbor matcher for binary descriptors.
+ *
+ * Matches binary descriptors (e.g. 512 bit FREAK descriptors) with the
+ * Hamming distance. Descriptors are first packed into contiguous rows
+ * padded to a multiple of 16 bytes. The distance is computed with
+ * AVX-512 VPOPCNTDQ, AVX2, POPCNT or SSE2 bit counting, the fastest
+ * one supported by the CPU, selected once at load time. For each query
+ * the best and second best distances are returned, so that a ratio test
+ * can be applied. Queries are matched in parallel, either against all
+ * train descriptors or against a sparse list of candidates.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <vector>
+#include <opencv/cv.h>
+
+/* CONSTANTS */
+
+namespace QCV
+{
+    class CHammingMatcher
+    {
+    /// Public data types
+    public:
+        struct SMatch
+        {
+            /// Best train descriptor (-1 if none).
+            int    trainIdx;
+
+            /// Distance to the best train descriptor.
+            int    distance;
+
+            /// Distance to the second best train descriptor (INT_MAX
+            /// if none).
+            int    secondDistance;
+        };
+
+    /// Constructors/Destructor
+    public:
+        CHammingMatcher();
+
+        virtual ~CHammingMatcher();
+
+    /// Operations
+    public:
+        /// Copy the descriptors (CV_8U, one per row) into rows padded
+        /// with zeros to a multiple of 16 bytes.
+        static bool pack ( const cv::Mat & f_desc,
+                           cv::Mat &       fr_packed );
+
+        /// Hamming distance of two packed rows.
+        static int  distance ( const unsigned char * f_a_p,
+                               const unsigned char * f_b_p,
+                               int                   f_bytes_i );
+
+        /// Match every query against all train descriptors.
+        bool        match ( const cv::Mat &       f_query,
+                            const cv::Mat &       f_train,
+                            std::vector<SMatch> & fr_matches_v ) const;
+
+        /// Match every query i against the train descriptors
+        /// f_candidates_v[f_candStart_v[i]] to
+        /// f_candidates_v[f_candStart_v[i+1]-1].
+        bool        match ( const cv::Mat &          f_query,
+                            const cv::Mat &          f_train,
+                            const std::vector<int> & f_candStart_v,
+                            const std::vector<int> & f_candidates_v,
+                            std::vector<SMatch> &    fr_matches_v ) const;
+
+    /// Help functions
+    protected:
+        bool        checkFormat ( const cv::Mat & f_query,
+                                  const cv::Mat & f_train ) const;
+    };
+}
+
+
+#endif // __HAMMINGMATCHER_H
@@ -36,8 +36,286 @@
 #include "drawingList.h"
 #include "ceParameter.h"
 
+#include <limits.h>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
 using namespace QCV;
 
+/// Min number of rows per thread for the edge extraction.
+#define HTO_MIN_ROWS_PER_THREAD 16
+
+/// Size of the arc tangent table of the orientation quantization.
+#define HTO_ATAN_LUT_SIZE 1024
+
+/// Sub-bin resolution (bits) of the arc tangent table.
+#define HTO_ATAN_SUBBIN_BITS 4
+
+/// atan(k/HTO_ATAN_LUT_SIZE) for k in [0,HTO_ATAN_LUT_SIZE] in units
+/// of 1/2^HTO_ATAN_SUBBIN_BITS orientation bins.
+static int g_atanBins_p[HTO_ATAN_LUT_SIZE + 1];
+
+static struct SAtanBinsBuilder
+{
+    SAtanBinsBuilder()
+    {
+        const double scale_d = HTO_THETA_BINS * (1 << HTO_ATAN_SUBBIN_BITS) / M_PI;
+
+        for (int k = 0; k <= HTO_ATAN_LUT_SIZE; ++k)
+            g_atanBins_p[k] = (int) ( atan ( k / (double) HTO_ATAN_LUT_SIZE ) * scale_d + .5 );
+    }
+} g_atanBinsBuilder;
+
+/// Orientation of the gradient in [0,pi) (equivalent to atan(gy/gx)
+/// moved to [0,pi)) quantized to HTO_THETA_BINS bins. The ratio of the
+/// smaller to the larger component is looked up in the arc tangent 
+/// table, which is accurate to 0.03 deg, below the bin width of 0.09
+/// deg.
+static inline unsigned short gradientOrientation ( const float f_gx_f,
+                                                   const float f_gy_f )
+{
+    const int half_i = HTO_THETA_BINS << ( HTO_ATAN_SUBBIN_BITS - 1 );
+
+    const float ax_f = fabsf(f_gx_f);
+    const float ay_f = fabsf(f_gy_f);
+    const float a_f  = std::min(ax_f, ay_f) / std::max(ax_f, ay_f);
+
+    int t_i = g_atanBins_p[(int)( a_f * HTO_ATAN_LUT_SIZE + .5f )];
+
+    if ( ay_f > ax_f )
+        t_i = half_i - t_i;
+
+    if ( (f_gx_f < 0) != (f_gy_f < 0) && t_i > 0 )
+        t_i = 2 * half_i - t_i;
+
+    return (unsigned short) std::min(t_i >> HTO_ATAN_SUBBIN_BITS, HTO_THETA_BINS - 1);
+}
+
+/// Appends an edge point to the list.
+static inline void addEdgePoint ( SEdgePointList & fr_list,
+                                  const float      f_x_f,
+                                  const float      f_y_f,
+                                  const float      f_gx_f,
+                                  const float      f_gy_f,
+                                  const float      f_sqMag_f,
+                                  const float      f_invNorm_f,
+                                  const bool       f_theta_b )
+{
+    fr_list.x_v.push_back ( f_x_f );
+    fr_list.y_v.push_back ( f_y_f );
+    fr_list.weight_v.push_back ( sqrtf(f_sqMag_f) * f_invNorm_f );
+
+    if ( f_theta_b )
+        fr_list.thetaBin_v.push_back ( gradientOrientation ( f_gx_f, f_gy_f ) );
+}
+
+/// Edge points of the rows [y0,y1] and columns [x0,x1] of an image. 
+/// The 3x3 Sobel gradient is scaled by f_scale_f and compared with the
+/// squared threshold.
+template <typename PixelType_>
+static void extractEdgeRows ( const cv::Mat &  f_img,
+                              const int        f_x0_i,
+                              const int        f_x1_i,
+                              const int        f_y0_i,
+                              const int        f_y1_i,
+                              const float      f_scale_f,
+                              const double     f_sqThreshold_d,
+                              const float      f_invNorm_f,
+                              const bool       f_theta_b,
+                              SEdgePointList & fr_list )
+{
+    const float cx_f = f_img.cols / 2.f;
+    const float cy_f = f_img.rows / 2.f;
+    const float th_f = f_sqThreshold_d;
+    
+    for (int i = f_y0_i; i <= f_y1_i; ++i)
+    {
+        const PixelType_ * const r0_p = f_img.ptr<PixelType_>(i-1);
+        const PixelType_ * const r1_p = f_img.ptr<PixelType_>(i);
+        const PixelType_ * const r2_p = f_img.ptr<PixelType_>(i+1);
+
+        for (int j = f_x0_i; j <= f_x1_i; ++j)
+        {
+            const float gx_f = ( ( (float)r0_p[j+1] - (float)r0_p[j-1] ) + 
+                                 ( (float)r1_p[j+1] - (float)r1_p[j-1] ) * 2.f + 
+                                 ( (float)r2_p[j+1] - (float)r2_p[j-1] ) ) * f_scale_f;
+            const float gy_f = ( ( (float)r2_p[j-1] - (float)r0_p[j-1] ) + 
+                                 ( (float)r2_p[j  ] - (float)r0_p[j  ] ) * 2.f + 
+                                 ( (float)r2_p[j+1] - (float)r0_p[j+1] ) ) * f_scale_f;
+            const float sqMag_f = gx_f * gx_f + gy_f * gy_f;
+
+            if ( sqMag_f > th_f )
+                addEdgePoint ( fr_list, j - cx_f, i - cy_f, gx_f, gy_f, sqMag_f, 
+                               f_invNorm_f, f_theta_b );
+        }
+    }
+}
+
+#if defined ( __SSE2__ )
+/// Eight consecutive pixels as 16 bit integers.
+static inline __m128i loadPixels8 ( const unsigned char * const f_row_p )
+{
+    return _mm_unpacklo_epi8 ( _mm_loadl_epi64 ( (const __m128i *) f_row_p ), 
+                               _mm_setzero_si128() );
+}
+
+static inline __m128i loadPixels8 ( const unsigned short * const f_row_p )
+{
+    return _mm_loadu_si128 ( (const __m128i *) f_row_p );
+}
+#endif
+
+/// Integer version of extractEdgeRows. The gradients and squared 
+/// magnitudes are computed in integer arithmetic (SSE2: 8 pixels per 
+/// iteration). The pixel values must be below 8192 so that the 
+/// gradients fit in 16 bits.
+template <typename PixelType_>
+static void extractEdgeRowsInt ( const cv::Mat &  f_img,
+                                 const int        f_x0_i,
+                                 const int        f_x1_i,
+                                 const int        f_y0_i,
+                                 const int        f_y1_i,
+                                 const float      f_scale_f,
+                                 const double     f_sqThreshold_d,
+                                 const float      f_invNorm_f,
+                                 const bool       f_theta_b,
+                                 SEdgePointList & fr_list )
+{
+    const float cx_f = f_img.cols / 2.f;
+    const float cy_f = f_img.rows / 2.f;
+
+    /// Threshold for the unscaled squared magnitude.
+    const double th_d = floor ( f_sqThreshold_d / ( (double)f_scale_f * f_scale_f ) );
+    const int    th_i = (int) std::min( th_d, (double)INT_MAX );
+
+    for (int i = f_y0_i; i <= f_y1_i; ++i)
+    {
+        const PixelType_ * const r0_p = f_img.ptr<PixelType_>(i-1);
+        const PixelType_ * const r1_p = f_img.ptr<PixelType_>(i);
+        const PixelType_ * const r2_p = f_img.ptr<PixelType_>(i+1);
+
+        int j = f_x0_i;
+
+#if defined ( __SSE2__ )
+        const __m128i th   = _mm_set1_epi32 ( th_i );
+
+        short gx_p[8];
+        short gy_p[8];
+        int   mag_p[8];
+
+        for (; j + 7 <= f_x1_i; j += 8)
+        {
+            const __m128i a0 = loadPixels8 ( r0_p + j - 1 );
+            const __m128i b0 = loadPixels8 ( r0_p + j );
+            const __m128i c0 = loadPixels8 ( r0_p + j + 1 );
+            const __m128i a1 = loadPixels8 ( r1_p + j - 1 );
+            const __m128i c1 = loadPixels8 ( r1_p + j + 1 );
+            const __m128i a2 = loadPixels8 ( r2_p + j - 1 );
+            const __m128i b2 = loadPixels8 ( r2_p + j );
+            const __m128i c2 = loadPixels8 ( r2_p + j + 1 );
+
+            /// gx = (c0 - a0) + 2 (c1 - a1) + (c2 - a2)
+            const __m128i d1 = _mm_sub_epi16 ( c1, a1 );
+            const __m128i gx = _mm_add_epi16 ( _mm_add_epi16 ( _mm_sub_epi16 ( c0, a0 ), 
+                                                               _mm_sub_epi16 ( c2, a2 ) ),
+                                               _mm_add_epi16 ( d1, d1 ) );
+
+            /// gy = (a2 - a0) + 2 (b2 - b0) + (c2 - c0)
+            const __m128i d2 = _mm_sub_epi16 ( b2, b0 );
+            const __m128i gy = _mm_add_epi16 ( _mm_add_epi16 ( _mm_sub_epi16 ( a2, a0 ), 
+                                                               _mm_sub_epi16 ( c2, c0 ) ),
+                                               _mm_add_epi16 ( d2, d2 ) );
+
+            /// gx^2 + gy^2 by multiplying and adding interleaved pairs.
+            const __m128i lo = _mm_unpacklo_epi16 ( gx, gy );
+            const __m128i hi = _mm_unpackhi_epi16 ( gx, gy );
+            const __m128i magLo = _mm_madd_epi16 ( lo, lo );
+            const __m128i magHi = _mm_madd_epi16 ( hi, hi );
+
+            const int mask_i = _mm_movemask_epi8 ( _mm_packs_epi32 ( _mm_cmpgt_epi32 ( magLo, th ),
+                                                                     _mm_cmpgt_epi32 ( magHi, th ) ) );
+            if ( !mask_i )
+                continue;
+
+            _mm_storeu_si128 ( (__m128i *) gx_p,      gx );
+            _mm_storeu_si128 ( (__m128i *) gy_p,      gy );
+            _mm_storeu_si128 ( (__m128i *) mag_p,     magLo );
+            _mm_storeu_si128 ( (__m128i *)(mag_p+4),  magHi );
+
+            for (int k = 0; k < 8; ++k)
+            {
+                if ( mask_i & (1 << (2*k)) )
+                    addEdgePoint ( fr_list, j + k - cx_f, i - cy_f, 
+                                   gx_p[k] * f_scale_f, gy_p[k] * f_scale_f, 
+                                   mag_p[k] * f_scale_f * f_scale_f, 
+                                   f_invNorm_f, f_theta_b );
+            }
+        }
+#endif
+
+        for (; j <= f_x1_i; ++j)
+        {
+            const int gx_i = ( ( r0_p[j+1] - r0_p[j-1] ) + 
+                               ( r1_p[j+1] - r1_p[j-1] ) * 2 + 
+                               ( r2_p[j+1] - r2_p[j-1] ) );
+            const int gy_i = ( ( r2_p[j-1] - r0_p[j-1] ) + 
+                               ( r2_p[j  ] - r0_p[j  ] ) * 2 + 
+                               ( r2_p[j+1] - r0_p[j+1] ) );
+            const int mag_i = gx_i * gx_i + gy_i * gy_i;
+
+            if ( mag_i > th_i )
+                addEdgePoint ( fr_list, j - cx_f, i - cy_f, 
+                               gx_i * f_scale_f, gy_i * f_scale_f, 
+                               mag_i * f_scale_f * f_scale_f, 
+                               f_invNorm_f, f_theta_b );
+        }
+    }
+}
+
+/// 8 bit specialization.
+template <>
+void extractEdgeRows<unsigned char> ( const cv::Mat &  f_img,
+                                      const int        f_x0_i,
+                                      const int        f_x1_i,
+                                      const int        f_y0_i,
+                                      const int        f_y1_i,
+                                      const float      f_scale_f,
+                                      const double     f_sqThreshold_d,
+                                      const float      f_invNorm_f,
+                                      const bool       f_theta_b,
+                                      SEdgePointList & fr_list )
+{
+    extractEdgeRowsInt<unsigned char> ( f_img, f_x0_i, f_x1_i, f_y0_i, f_y1_i, 
+                                        f_scale_f, f_sqThreshold_d, f_invNorm_f, 
+                                        f_theta_b, fr_list );
+}
+
+/// 16 bit specialization for the r+g+r intensity of color images 
+/// (values below 768).
+template <>
+void extractEdgeRows<unsigned short> ( const cv::Mat &  f_img,
+                                       const int        f_x0_i,
+                                       const int        f_x1_i,
+                                       const int        f_y0_i,
+                                       const int        f_y1_i,
+                                       const float      f_scale_f,
+                                       const double     f_sqThreshold_d,
+                                       const float      f_invNorm_f,
+                                       const bool       f_theta_b,
+                                       SEdgePointList & fr_list )
+{
+    extractEdgeRowsInt<unsigned short> ( f_img, f_x0_i, f_x1_i, f_y0_i, f_y1_i, 
+                                         f_scale_f, f_sqThreshold_d, f_invNorm_f, 
+                                         f_theta_b, fr_list );
+}
+
+
 /// Constructors.
 CHoughTransformOp::CHoughTransformOp ( COperator * const f_parent_p,
                                        std::string           f_name_str )
@@ -48,6 +326,9 @@ CHoughTransformOp::CHoughTransformOp ( COperator * const f_parent_p,
       m_gradX (                                    ),
       m_gradY (                                    ),
       m_binImg (                                   ),
+      m_intensityImg (                             ),
+      m_intensityScale_f (                     1.f ),
+      m_gradImagesValid_b (                  false ),
       m_gradThreshold_f (                     0.1f ),
       m_deltaTheta_d (                         10. ),
       m_magnitudeNorm_d (                      10. ),
@@ -57,11 +338,20 @@ CHoughTransformOp::CHoughTransformOp ( COperator * const f_parent_p,
       m_colorEncHoughImg ( CColorEncoding::CET_HUE, 
                                 S2D<float>(0.,20.) ),
       m_minHoughVal_f (                        2.f ),
+      m_maxPeaks_i (                             0 ),
       m_lines (                                    ),
+      m_peaks (                                    ),
       m_showMaxLines_i (                        50 ),
       m_roiTopLeft (                        -1, -1 ),
       m_roiBottomRight (                    -1, -1 ),
-      m_minHoughDistance (              25.f, 10.f )
+      m_minHoughDistance (              25.f, 10.f ),
+      m_tracking_b (                         false ),
+      m_trackWindow (                    3.f, 10.f ),
+      m_maxTracks_i (                           10 ),
+      m_fullVoteInterval_i (                    10 ),
+      m_framesSinceFullVote_i (                  0 ),
+      m_tracks (                                   ),
+      m_trackWindows (                             )
 {
     registerDrawingLists();
     registerParameters();
@@ -169,6 +459,13 @@ CHoughTransformOp::registerParameters()
                           MinHoughValue,
                           CHoughTransformOp );
 
+    ADD_INT_PARAMETER   ( "Max Peaks",
+                          "Max number of maxima to extract from the accumulator (0: all).",
+                          m_maxPeaks_i,
+                          this,
+                          MaxPeaks,
+                          CHoughTransformOp );
+
     ADD_FLT2D_PARAMETER ( "Min Hough Value",
                           "Min distance between the found maxima in the accumulator.",
                           m_minHoughDistance,
@@ -177,6 +474,39 @@ CHoughTransformOp::registerParameters()
                           MinHoughDistance,
                           CHoughTransformOp );
 
+    BEGIN_PARAMETER_GROUP("Tracking", false, CColor::red );
+
+      ADD_BOOL_PARAMETER ( "Tracking",
+                           "Vote only in windows around the lines found in the previous frame.",
+                           m_tracking_b,
+                           this,
+                           Tracking,
+                           CHoughTransformOp );
+
+      ADD_FLT2D_PARAMETER ( "Track Window",
+                            "Half size of the voting window around each tracked line.",
+                            m_trackWindow,
+                            "angle [deg]", "range [px]",
+                            this,
+                            TrackWindow,
+                            CHoughTransformOp );
+
+      ADD_INT_PARAMETER ( "Max Tracks",
+                          "Max number of lines to track.",
+                          m_maxTracks_i,
+                          this,
+                          MaxTracks,
+                          CHoughTransformOp );
+
+      ADD_INT_PARAMETER ( "Full Vote Interval",
+                          "Number of frames between votes in the whole Hough space.",
+                          m_fullVoteInterval_i,
+                          this,
+                          FullVoteInterval,
+                          CHoughTransformOp );
+
+    END_PARAMETER_GROUP;
+
     BEGIN_PARAMETER_GROUP("Display ", false, CColor::red );
 
       ADD_INT_PARAMETER( "Max Lines", 
@@ -227,7 +557,7 @@ bool CHoughTransformOp::cycle()
     if ( m_compute_b && getInput() )
     {
         startClock ("Cycle: Reallocation and initialization");
-        cv::Size size = m_houghTransOp.getAccumulatorImage().size();
+        cv::Size size = m_houghTransOp.getAccumulatorSize();
         if ( size != m_gradHX.size() )
         {
             m_gradHX = cv::Mat(size, CV_32FC1);
@@ -243,128 +573,101 @@ bool CHoughTransformOp::cycle()
             return  COperator::cycle();
         }
 
-        if ( m_srcImg.size() != m_gradX.size() )
-        {
-            m_gradX    = cv::Mat(m_srcImg.size(), CV_32FC1);
-            m_gradY    = cv::Mat(m_srcImg.size(), CV_32FC1);
-            m_binImg   = cv::Mat(m_srcImg.size(), CV_8UC1);
-            m_gradient = cv::Mat(m_srcImg.size(), CV_32FC1);
-        }
-
         stopClock ("Cycle: Reallocation and initialization");
 
         {
-            startClock ("Cycle: Sobel");
-
-            cv::Sobel(m_srcImg,  m_gradY, -1, 0, 1, 3, 1/6., 0, cv::BORDER_DEFAULT);
-            cv::Sobel(m_srcImg,  m_gradX, -1, 1, 0, 3, 1/6., 0, cv::BORDER_DEFAULT);    
-
-            stopClock ("Cycle: Sobel");
-
-            startClock ("Cycle: Binary Image Computation");
-            computeBinaryImage ( m_gradX, m_gradY, m_binImg);
-            stopClock ("Cycle: Binary Image Computation");
+            /// Gradient and binary images are computed on demand.
+            m_gradImagesValid_b = false;
 
             S2D<int> br = m_roiBottomRight;
             S2D<int> tl = m_roiTopLeft;
 
-            cv::Size size = m_gradX.size();
+            cv::Size size = m_srcImg.size();
 
             if (tl.x < 0)  tl.x = 0;
             if (tl.y < 0)  tl.y = 0;
             if (br.x < 0)  br.x = size.width-1;
             if (br.y < 0)  br.y = size.height-1;
 
-            startClock ("Cycle: Accumulation");
-
             br.x = std::min(std::max(br.x, 1), size.width-2  );
             br.y = std::min(std::max(br.y, 1), size.height-2 );
             tl.x = std::min(std::max(tl.x, 1), size.width-2  );
             tl.y = std::min(std::max(tl.y, 1), size.height-2 );            
-            
-            double th_d = m_gradThreshold_f * m_gradThreshold_f;
-            
-            for (int i = tl.y; i <= br.y; ++i)
-            {
-                unsigned char *  sl_p = &m_binImg.at<unsigned char>(i, tl.x);
 
-                float * gX_p = &m_gradX.at<float>(i,0);
-                float * gY_p = &m_gradY.at<float>(i,0);
+            startClock ("Cycle: Edge Extraction");
+            extractEdgePoints ( tl, br );
+            stopClock ("Cycle: Edge Extraction");
 
-                for (int j = tl.x; j <=  br.x; ++j, ++sl_p)
-                {
-                    double magnitude_d = ( gX_p[j] * gX_p[j] + 
-                                           gY_p[j] * gY_p[j] );
+            startClock ("Cycle: Accumulation");
 
-                    if ( magnitude_d > th_d )
-                    {
-                        double x = j-m_gradX.size().width/2.;
-                        double y = i-m_gradX.size().height/2.;
+            const bool useTheta_b = m_deltaTheta_d > 0;
 
-                        double weight_d = sqrt(magnitude_d)/m_magnitudeNorm_d;
-                        
-                        if ( m_deltaTheta_d <= 0 )
-                            m_houghTransOp.addPoint ( x, 
-                                                      y, 
-                                                      weight_d );
-                        else
-                        {
-                            double theta = atan( gY_p[j] / gX_p[j] );
-                            
-                            if (theta < 0 )
-                                theta+=M_PI;
+            /// When tracking, vote in the whole space periodically or if
+            /// there are no lines to track.
+            const bool fullVote_b = ( !m_tracking_b || 
+                                      m_tracks.empty() || 
+                                      m_framesSinceFullVote_i + 1 >= m_fullVoteInterval_i );
 
-                            if (theta > M_PI)
-                                theta-=M_PI;
-                        
-                            m_houghTransOp.addPoint ( x, 
-                                                      y, 
-                                                      weight_d,
-                                                      theta, 
-                                                      m_deltaTheta_d/180. * M_PI );
-                        }
-                    }
+            if ( fullVote_b )
+            {
+                m_houghTransOp.clearVotingWindows();
+                m_framesSinceFullVote_i = 0;
+            }
+            else
+            {
+                const double dTheta_d = m_trackWindow.x / 180. * M_PI;
+                const double dRange_d = m_trackWindow.y;
+
+                m_trackWindows.resize ( m_tracks.size() );
+                
+                for (unsigned int k = 0; k < m_tracks.size(); ++k)
+                {
+                    double theta_d = m_houghTransOp.column2Theta ( m_tracks[k].x_f );
+                    double range_d = m_houghTransOp.row2Range    ( m_tracks[k].y_f );
+
+                    m_trackWindows[k] = SHoughWindow ( S2D<double>( theta_d - dTheta_d, theta_d + dTheta_d ),
+                                                       S2D<double>( range_d - dRange_d, range_d + dRange_d ) );
                 }
+
+                m_houghTransOp.setVotingWindows ( m_trackWindows );
+                ++m_framesSinceFullVote_i;
+            }
+
+            if ( m_edges.size() > 0 )
+            {
+                if ( useTheta_b )
+                    m_houghTransOp.addPoints ( &m_edges.x_v[0], 
+                                               &m_edges.y_v[0], 
+                                               &m_edges.weight_v[0],
+                                               &m_edges.thetaBin_v[0],
+                                               HTO_THETA_BINS,
+                                               m_edges.size(),
+                                               m_deltaTheta_d/180. * M_PI );
+                else
+                    m_houghTransOp.addPoints ( &m_edges.x_v[0], 
+                                               &m_edges.y_v[0], 
+                                               &m_edges.weight_v[0],
+                                               m_edges.size() );
             }
 
             stopClock ("Cycle: Accumulation");
 
             startClock ("Cycle: Line Extraction");
 
+            /// The 3x3 gaussian filter of the accumulator is applied 
+            /// while searching the maxima.
+            m_houghTransOp.extractPeaks ( m_minHoughVal_f, 
+                                          3, 
+                                          std::max(m_maxPeaks_i, 0),
+                                          m_peaks );
+
+            /// The published and displayed accumulator is the filtered
+            /// one.
             m_houghTransOp.compute();
 
-            cv::Mat accumImg = m_houghTransOp.getAccumulatorImage();
+            startClock ("Cycle: Line Extraction: Min distance");
 
             m_lines.clear();
-            for (int i = 3; i < (signed)accumImg.size().height-3; ++i)
-            {
-                float *  sl0_p = &accumImg.at<float>(i-1, 3);
-                float *  sl1_p = &accumImg.at<float>(i,   3);
-                float *  sl2_p = &accumImg.at<float>(i+1, 3);
-
-                for (int j = 3; j < (signed)accumImg.size().width-3; ++j, sl0_p++, sl1_p++, sl2_p++ )
-                {
-                    if ( *sl1_p >= m_minHoughVal_f && 
-                         *sl1_p > *sl0_p && 
-                         *sl1_p > *sl2_p &&
-                         *sl1_p > sl0_p[-1] &&
-                         *sl1_p > sl0_p[+1] &&
-                         *sl1_p > sl2_p[-1] &&
-                         *sl1_p > sl2_p[+1] &&
-                         *sl1_p > sl1_p[-1] &&
-                         *sl1_p > sl1_p[+1] )
-                    {
-                        m_lines.push_back(SHoughLine(j, i, *sl1_p));
-                    }
-                }
-            }
-            
-            startClock ("Cycle: Line Extraction: Sort");
-            if (m_lines.size() > 0 )
-                sort (m_lines.begin(), m_lines.end());
-            stopClock ("Cycle: Line Extraction: Sort");
-
-            startClock ("Cycle: Line Extraction: Min distance");
 
             if ( m_minHoughDistance.x > 0 ||
                  m_minHoughDistance.y > 0 )
@@ -372,18 +675,21 @@ bool CHoughTransformOp::cycle()
                 S2D<float> houghDist( std::max(m_minHoughDistance.x/180.f*(float)M_PI / m_houghTransOp.getThetaScale(), 1.),
                                       std::max(m_minHoughDistance.y / m_houghTransOp.getRangeScale(), 1.));
                 
-                cv::Mat accumImg = m_houghTransOp.getAccumulatorImage();
-                size = accumImg.size();
-                m_binImg2 = cv::Mat::zeros(accumImg.size(), m_binImg.type());
+                size = m_houghTransOp.getAccumulatorSize();
+
+                if ( m_binImg2.size() != size )
+                    m_binImg2 = cv::Mat::zeros(size, CV_8UC1);
+                else
+                    m_binImg2 = cv::Scalar(0);
                 
-                for (unsigned int k = 0; k < m_lines.size(); ++k)
+                for (unsigned int k = 0; k < m_peaks.size(); ++k)
                 {
-                    if (  m_binImg2.at<uint8_t>(m_lines[k].y_f+0.5f,m_lines[k].x_f+0.5f) == 0 )
+                    if (  m_binImg2.at<uint8_t>(m_peaks[k].y_f+0.5f,m_peaks[k].x_f+0.5f) == 0 )
                     {
-                        int top_i = std::max(0.f,             m_lines[k].y_f - houghDist.y/2.f);
-                        int bot_i = std::min(size.height-1.f, m_lines[k].y_f + houghDist.y/2.f);
-                        int lef_i = std::max(0.f,             m_lines[k].x_f - houghDist.x/2.f);
-                        int rig_i = std::min(size.width-1.f,  m_lines[k].x_f + houghDist.x/2.f);
+                        int top_i = std::max(0.f,             m_peaks[k].y_f - houghDist.y/2.f);
+                        int bot_i = std::min(size.height-1.f, m_peaks[k].y_f + houghDist.y/2.f);
+                        int lef_i = std::max(0.f,             m_peaks[k].x_f - houghDist.x/2.f);
+                        int rig_i = std::min(size.width-1.f,  m_peaks[k].x_f + houghDist.x/2.f);
                         
                         for (int i = top_i; i <= bot_i; ++i)
                         {
@@ -393,16 +699,19 @@ bool CHoughTransformOp::cycle()
                                 *p = 255;
                             }
                         }
-                    }
-                    else
-                    {
-                        m_lines.erase(m_lines.begin()+k);
-                        --k;
+
+                        m_lines.push_back ( m_peaks[k] );
                     }
                 }   
             }
+            else
+                m_lines.swap ( m_peaks );
 
             stopClock ("Cycle: Line Extraction: Min distance");
+
+            if ( m_tracking_b )
+                updateTracks ( fullVote_b );
+            
             stopClock ("Cycle: Line Extraction");
         }    
  
@@ -414,6 +723,86 @@ bool CHoughTransformOp::cycle()
     return COperator::cycle();
 }
 
+/// Edge points of the ROI. The rows are split in contiguous stripes, 
+/// one per thread. Each thread fills its own list and the lists are 
+/// concatenated in raster order.
+void
+CHoughTransformOp::extractEdgePoints ( S2D<int> f_tl,
+                                       S2D<int> f_br )
+{
+    m_edges.clear();
+
+    const int rows_i = f_br.y - f_tl.y + 1;
+
+    if ( rows_i <= 0 || f_br.x < f_tl.x )
+        return;
+    
+#if defined ( _OPENMP )
+    const int numThreads_i = std::max(1, std::min( std::min(omp_get_max_threads(), HTO_MAX_CORES),
+                                                   rows_i / HTO_MIN_ROWS_PER_THREAD ) );
+#else
+    const int numThreads_i = 1;
+#endif
+
+    const float  scale_f   = m_intensityScale_f / 6.f;
+    const double th_d      = m_gradThreshold_f * m_gradThreshold_f;
+    const float  invNorm_f = 1.f / m_magnitudeNorm_d;
+    const bool   theta_b   = m_deltaTheta_d > 0;
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_i) schedule(static)
+#endif
+    for (int t = 0; t < numThreads_i; ++t)
+    {
+        const int y0_i = f_tl.y + (rows_i *  t   ) / numThreads_i;
+        const int y1_i = f_tl.y + (rows_i * (t+1)) / numThreads_i - 1;
+
+        SEdgePointList & list = numThreads_i == 1 ? m_edges : m_threadEdges_p[t];
+
+        list.clear();
+
+        if ( m_intensityImg.type() == CV_8UC1 )
+            extractEdgeRows<unsigned char>  ( m_intensityImg, f_tl.x, f_br.x, y0_i, y1_i, 
+                                              scale_f, th_d, invNorm_f, theta_b, list );
+        else if ( m_intensityImg.type() == CV_16UC1 )
+            extractEdgeRows<unsigned short> ( m_intensityImg, f_tl.x, f_br.x, y0_i, y1_i, 
+                                              scale_f, th_d, invNorm_f, theta_b, list );
+        else
+            extractEdgeRows<float>          ( m_intensityImg, f_tl.x, f_br.x, y0_i, y1_i, 
+                                              scale_f, th_d, invNorm_f, theta_b, list );
+    }
+
+    if ( numThreads_i == 1 )
+        return;
+
+    for (int t = 0; t < numThreads_i; ++t)
+    {
+        const SEdgePointList & list = m_threadEdges_p[t];
+
+        m_edges.x_v.insert        ( m_edges.x_v.end(),        list.x_v.begin(),        list.x_v.end() );
+        m_edges.y_v.insert        ( m_edges.y_v.end(),        list.y_v.begin(),        list.y_v.end() );
+        m_edges.weight_v.insert   ( m_edges.weight_v.end(),   list.weight_v.begin(),   list.weight_v.end() );
+        m_edges.thetaBin_v.insert ( m_edges.thetaBin_v.end(), list.thetaBin_v.begin(), list.thetaBin_v.end() );
+    }
+}
+
+void
+CHoughTransformOp::computeGradientImages ( )
+{
+    if ( m_gradImagesValid_b || m_intensityImg.size().width == 0 )
+        return;
+
+    cv::Sobel(m_intensityImg,  m_gradY, CV_32F, 0, 1, 3, m_intensityScale_f/6., 0, cv::BORDER_DEFAULT);
+    cv::Sobel(m_intensityImg,  m_gradX, CV_32F, 1, 0, 3, m_intensityScale_f/6., 0, cv::BORDER_DEFAULT);    
+
+    if ( m_binImg.size() != m_gradX.size() )
+        m_binImg = cv::Mat(m_gradX.size(), CV_8UC1);
+
+    computeBinaryImage ( m_gradX, m_gradY, m_binImg);
+
+    m_gradImagesValid_b = true;
+}
+
 bool
 CHoughTransformOp::computeBinaryImage( const cv::Mat & f_gradX,
                                        const cv::Mat & f_gradY,
@@ -543,7 +932,7 @@ bool CHoughTransformOp::show()
     {
         /// Check if we can show something.
         if ( m_srcImg.size().width == 0 || 
-             m_houghTransOp.getAccumulatorImage().size() != m_gradHX.size() )
+             m_houghTransOp.getAccumulatorSize() != m_gradHX.size() )
         {
             getDrawingList("Accumulator") -> clear();
             getDrawingList("Binary Image") -> clear();
@@ -558,7 +947,17 @@ bool CHoughTransformOp::show()
         list_p = getDrawingList("Input Image");
         if (list_p -> isVisible() )
         {
-            list_p -> addImage ( m_srcImg, 0, 0, w_f, h_f);
+            /// Grayscale intensity normalized to [0,1] as in the
+            /// former float input image. Integer textures are already
+            /// normalized by the maximum of their type.
+            float scale_f = m_intensityScale_f;
+
+            if ( m_intensityImg.type() == CV_8UC1 )
+                scale_f *= 255.f;
+            else if ( m_intensityImg.type() == CV_16UC1 )
+                scale_f *= 65535.f;
+
+            list_p -> addImage ( m_intensityImg, 0, 0, w_f, h_f, scale_f );
             list_p -> setLineColor ( 0, 255, 0 );
             list_p -> addText ( "Left click and move mouse", 5, 5, 24, false );
         }
@@ -590,6 +989,7 @@ bool CHoughTransformOp::show()
 
         if (list_p -> isVisible() )
         {
+            computeGradientImages();
             list_p -> clear();
             list_p -> addImage ( m_binImg, 
                                  0, 0, 
@@ -600,7 +1000,7 @@ bool CHoughTransformOp::show()
         S2D<int> br = m_roiBottomRight;
         S2D<int> tl = m_roiTopLeft;
 
-        cv::Size size = m_binImg.size();
+        cv::Size size = m_srcImg.size();
 
         if (tl.x < 0)  tl.x = 0;
         if (tl.y < 0)  tl.y = 0;
@@ -621,7 +1021,7 @@ bool CHoughTransformOp::show()
 
         if ( list_p -> isVisible() )
         {
-            cv::Size size = m_houghTransOp.getAccumulatorImage().size();
+            cv::Size size = m_houghTransOp.getAccumulatorSize();
             
             const float sx_f = w_f / size.width;
             const float sy_f = h_f / size.height;
@@ -629,8 +1029,8 @@ bool CHoughTransformOp::show()
             const double dispWidth_d  = getScreenSize().width;
             const double dispHeight_d = getScreenSize().height;
 
-            const int w_ui = m_gradX.size().width;
-            const int h_ui = m_gradX.size().height;
+            const int w_ui = m_srcImg.size().width;
+            const int h_ui = m_srcImg.size().height;
 
             const float aspOX_f = dispWidth_d  /(float) w_ui;
             const float aspOY_f = dispHeight_d /(float) h_ui;
@@ -677,6 +1077,7 @@ bool CHoughTransformOp::show()
         list_p -> clear();
         if (list_p -> isVisible() )
         {
+            computeGradientImages();
             list_p -> addImage ( m_gradX,
                                  0, 0, 
                                  w_f, h_f, scale_f );
@@ -687,6 +1088,7 @@ bool CHoughTransformOp::show()
         list_p -> clear();
         if (list_p -> isVisible() )
         {
+            computeGradientImages();
             list_p -> addImage ( m_gradY,
                                  0, 0, 
                                  w_f, h_f, scale_f );
@@ -705,23 +1107,68 @@ bool CHoughTransformOp::initialize()
         return  COperator::initialize();
     }
 
-    m_gradX    = cv::Mat(m_srcImg.size(), CV_32FC1 ); 
-    m_gradY    = cv::Mat(m_srcImg.size(), CV_32FC1 ); 
-    m_binImg   = cv::Mat(m_srcImg.size(), CV_8UC1 );
-    m_gradient = cv::Mat(m_srcImg.size(), CV_32FC1 ); 
+    /// Gradient and binary images are allocated on demand.
+    m_gradImagesValid_b = false;
     
-    if ( m_houghTransOp.getAccumulatorImage().size() != m_gradHX.size() )
+    if ( m_houghTransOp.getAccumulatorSize() != m_gradHX.size() )
     {
-        m_gradHX = cv::Mat(m_houghTransOp.getAccumulatorImage().size(), CV_32FC1 );
-        m_gradHY = cv::Mat(m_houghTransOp.getAccumulatorImage().size(), CV_32FC1 );
+        m_gradHX = cv::Mat(m_houghTransOp.getAccumulatorSize(), CV_32FC1 );
+        m_gradHY = cv::Mat(m_houghTransOp.getAccumulatorSize(), CV_32FC1 );
     }
     
     return COperator::initialize();
 }
 
+/// Updates the tracked lines with the lines of the current frame. If a
+/// track was not found again inside its window, the next frame votes in
+/// the whole Hough space.
+void
+CHoughTransformOp::updateTracks ( bool f_fullVote_b )
+{
+    bool lost_b = false;
+
+    if ( !f_fullVote_b )
+    {
+        const float dCol_f = m_trackWindow.x / 180.f * M_PI / m_houghTransOp.getThetaScale();
+        const float dRow_f = m_trackWindow.y / m_houghTransOp.getRangeScale();
+        const float width_f = m_houghTransOp.getAccumulatorSize().width;
+
+        /// Row of the range 0 (range is mirrored around it when wrapping 
+        /// theta).
+        const float row0_f  = m_houghTransOp.range2Row ( 0. );
+
+        for (unsigned int k = 0; k < m_tracks.size() && !lost_b; ++k)
+        {
+            bool found_b = false;
+            
+            for (unsigned int l = 0; l < m_lines.size() && !found_b; ++l)
+            {
+                const float dx_f = fabs(m_lines[l].x_f - m_tracks[k].x_f);
+                
+                found_b = ( ( dx_f <= dCol_f &&
+                              fabs(m_lines[l].y_f - m_tracks[k].y_f) <= dRow_f ) ||
+                            ( width_f - dx_f <= dCol_f &&
+                              fabs(2.f * row0_f - m_lines[l].y_f - m_tracks[k].y_f) <= dRow_f ) );
+            }
+
+            lost_b = !found_b;
+        }
+    }
+
+    m_tracks.assign ( m_lines.begin(), 
+                      m_lines.begin() + std::min( (int)m_lines.size(), std::max(m_maxTracks_i, 0) ) );
+
+    /// Force a full vote in the next frame.
+    if ( lost_b )
+        m_tracks.clear();
+}
+
 /// Reset event.
 bool CHoughTransformOp::reset()
 {
+    m_tracks.clear();
+    m_framesSinceFullVote_i = 0;
+
     return COperator::reset();
 }
 
@@ -752,18 +1199,18 @@ CHoughTransformOp::mouseMoved ( CMouseEvent * f_event_p )
     bool mouseOnSrcImg_b  = ( f_event_p -> displayScreen == srcImgList_p->getPosition() && 
                               srcImgList_p -> isVisible() );
 
-    const float aspOX_f = dispWidth_d  /(float) m_gradX.size().width; 
-    const float aspOY_f = dispHeight_d /(float) m_gradX.size().height;      
+    const float aspOX_f = dispWidth_d  /(float) m_srcImg.size().width; 
+    const float aspOY_f = dispHeight_d /(float) m_srcImg.size().height;      
     
-    cv::Mat accumImg = m_houghTransOp.getAccumulatorImage();
+    const cv::Size accumSize = m_houghTransOp.getAccumulatorSize();
 
-    const float aspAX_f = dispWidth_d  /(float) accumImg.size().width; 
-    const float aspAY_f = dispHeight_d /(float) accumImg.size().height;    
+    const float aspAX_f = dispWidth_d  /(float) accumSize.width; 
+    const float aspAY_f = dispHeight_d /(float) accumSize.height;    
     
     if ( mouseOnAccum_b )
     {
-        const int w_ui = m_gradX.size().width;
-        const int h_ui = m_gradX.size().height;
+        const int w_ui = m_srcImg.size().width;
+        const int h_ui = m_srcImg.size().height;
         
         double imgPosU_d = f_event_p -> posInScreen.x / aspAX_f;
         double imgPosV_d = f_event_p -> posInScreen.y / aspAY_f;
@@ -811,11 +1258,11 @@ CHoughTransformOp::mouseMoved ( CMouseEvent * f_event_p )
             list_p -> clear();
             list_p->setPosition ( accumList_p -> getPosition() );            
 
-            double imgPosU_d = f_event_p -> posInScreen.x / aspOX_f - m_gradX.size().width /2;
-            double imgPosV_d = f_event_p -> posInScreen.y / aspOY_f - m_gradX.size().height/2;
+            double imgPosU_d = f_event_p -> posInScreen.x / aspOX_f - m_srcImg.size().width /2;
+            double imgPosV_d = f_event_p -> posInScreen.y / aspOY_f - m_srcImg.size().height/2;
 
             S2D<float> p1, p2;
-            for (int i = 0; i < accumImg.size().width; ++i)
+            for (int i = 0; i < accumSize.width; ++i)
             {
                 double theta_d = m_houghTransOp.column2Theta( i );
                 double range_d = imgPosV_d * sin( theta_d ) + imgPosU_d * cos ( theta_d );
@@ -861,20 +1308,23 @@ CHoughTransformOp::getAccumulatorImage()
 }
 
 cv::Mat
-CHoughTransformOp::getBinaryImage () const
+CHoughTransformOp::getBinaryImage ()
 {
+    computeGradientImages();
     return m_binImg;
 }
 
 cv::Mat 
 CHoughTransformOp::getGradientXImage()
 {
+    computeGradientImages();
     return  m_gradX;
 }
 
 cv::Mat 
 CHoughTransformOp::getGradientYImage()
 {
+    computeGradientImages();
     return  m_gradY;
 }
 
@@ -886,30 +1336,43 @@ CHoughTransformOp::getInput  (  )
     
     if ( inpimg.size().width == 0 ) { m_srcImg = inpimg; return false; }
     
-    if (inpimg.type()!=CV_32F)
+    /// The input is not converted to float. The intensity image keeps
+    /// the input type and the scale normalizes it to [0,1].
+    if ( inpimg.type() == CV_8UC3 )
     {
-        if ( inpimg.type() == CV_8UC3 )
-        {
-            m_srcImg      = cv::Mat(inpimg.size(), CV_32F);
-            float *dst_p  = &m_srcImg.at<float>(0,0);
-            const SRgb *s = &inpimg.at<SRgb>(0,0);            
-            const SRgb *e = s + inpimg.size().width * inpimg.size().height;
+        m_srcImg = inpimg;
 
-            for (; s < e; ++s, ++dst_p) *dst_p = (s->r+s->g+s->r)/768.f;
-        }
-        else if ( inpimg.type() == CV_8U )
+        if ( m_intensityImg.size() != inpimg.size() || m_intensityImg.type() != CV_16UC1 )
+            m_intensityImg = cv::Mat(inpimg.size(), CV_16UC1);
+
+        for (int i = 0; i < inpimg.size().height; ++i)
         {
-            m_srcImg       = cv::Mat(inpimg.size(), CV_32F);
-            float *dst_p   = &m_srcImg.at<float>(0,0);
-            const uint8_t *s  = &inpimg.at<uint8_t>(0,0);            
-            const uint8_t *e  = s + inpimg.size().width * inpimg.size().height;
-            for (; s < e; ++s, ++dst_p) *dst_p = *s/256.f;
+            uint16_t *   dst_p = m_intensityImg.ptr<uint16_t>(i);
+            const SRgb * s     = inpimg.ptr<SRgb>(i);
+            const SRgb * e     = s + inpimg.size().width;
+
+            for (; s < e; ++s, ++dst_p) *dst_p = s->r+s->g+s->r;
         }
-        else
-            printf("%s:%i Please provide a CV_8UC3, CV_8U or CV_32F (prefered) image.\n", __FILE__, __LINE__);
+
+        m_intensityScale_f = 1/768.f;
+    }
+    else if ( inpimg.type() == CV_8U )
+    {
+        m_srcImg           = inpimg;
+        m_intensityImg     = inpimg;
+        m_intensityScale_f = 1/256.f;
+    }
+    else if ( inpimg.type() == CV_32F )
+    {
+        m_srcImg           = inpimg;
+        m_intensityImg     = inpimg;
+        m_intensityScale_f = 1.f;
     }
     else
-        m_srcImg = inpimg;
+    {
+        printf("%s:%i Please provide a CV_8UC3, CV_8U or CV_32F image.\n", __FILE__, __LINE__);
+        return false;
+    }
 
     return true;
 }
@@ -43,29 +43,37 @@
 /* PROTOTYPES */
 
 /* CONSTANTS */
+#define HTO_MAX_CORES 8
+
+/// Number of orientation bins over [0,pi) of the edge points.
+#define HTO_THETA_BINS 2048
 
 namespace QCV
 {
-    struct SHoughLine
+    /// Edge points ready for batch voting.
+    struct SEdgePointList
     {
-        float x_f;
-        float y_f;
-        float val_f;
-
-        SHoughLine () { x_f = y_f = val_f = 0.f; }
-            
-        SHoughLine (float f_x_f, float f_y_f, float f_val_f )
-            : x_f (     f_x_f ),
-              y_f (     f_y_f ),
-              val_f ( f_val_f ) {}
-
-        bool operator < ( const SHoughLine & f_other ) const
+        /// Coordinates relative to the image center.
+        std::vector<float> x_v;
+        std::vector<float> y_v;
+
+        /// Normalized gradient magnitude.
+        std::vector<float> weight_v;
+
+        /// Gradient orientation in [0,pi) quantized to HTO_THETA_BINS
+        /// bins.
+        std::vector<unsigned short> thetaBin_v;
+
+        void clear()
         {
-            return val_f > f_other.val_f;
+            x_v.clear();
+            y_v.clear();
+            weight_v.clear();
+            thetaBin_v.clear();
         }
-    };
 
-    typedef std::vector<SHoughLine> THoughLineVector;
+        unsigned int size() const { return x_v.size(); }
+    };
 
     class CHoughTransformOp: public QCV::COperator
     {
@@ -115,19 +123,25 @@ namespace QCV
         ADD_PARAM_ACCESS(double,      m_magnitudeNorm_d,   MagnitudeNorm  );
 
         ADD_PARAM_ACCESS(float,       m_minHoughVal_f,     MinHoughValue  );
+        ADD_PARAM_ACCESS(int,         m_maxPeaks_i,        MaxPeaks       );
 
         ADD_PARAM_ACCESS(S2D<int>,    m_roiTopLeft,        RoiTopLeft );
         ADD_PARAM_ACCESS(S2D<int>,    m_roiBottomRight,    RoiBottomRight );
         ADD_PARAM_ACCESS(int,         m_showMaxLines_i,    ShowMaxLines );
 
         ADD_PARAM_ACCESS(S2D<float>,  m_minHoughDistance,  MinHoughDistance );
+
+        ADD_PARAM_ACCESS(bool,        m_tracking_b,        Tracking );
+        ADD_PARAM_ACCESS(S2D<float>,  m_trackWindow,       TrackWindow );
+        ADD_PARAM_ACCESS(int,         m_maxTracks_i,       MaxTracks );
+        ADD_PARAM_ACCESS(int,         m_fullVoteInterval_i, FullVoteInterval );
     public:
 
         CLinearHoughTransform *  getLinearHoughTransformOp();
         cv::Mat                  getAccumulatorImage();
         cv::Mat                  getGradientXImage();
         cv::Mat                  getGradientYImage();
-        cv::Mat                  getBinaryImage() const;
+        cv::Mat                  getBinaryImage();
 
     /// Data types
     public:
@@ -141,6 +155,18 @@ namespace QCV
         bool computeBinaryImage( const cv::Mat & f_gradX,
                                  const cv::Mat & f_gradY,
                                  cv::Mat       & fr_binImg );
+
+        /// Fused gradient, magnitude and threshold computation over the 
+        /// ROI [tl, br] producing the edge point list.
+        void extractEdgePoints ( S2D<int> f_tl,
+                                 S2D<int> f_br );
+
+        /// Computes the gradient and binary images (only required for
+        /// display and the getters).
+        void computeGradientImages ( );
+
+        /// Update tracked lines from the current frame.
+        void updateTracks ( bool f_fullVote_b );
     private:
         
         /// Input id
@@ -176,6 +202,21 @@ namespace QCV
         /// Auxiliar Binary image.
         cv::Mat                    m_auxBinImg;
 
+        /// Intensity image for the gradient computation.
+        cv::Mat                    m_intensityImg;
+
+        /// Factor to convert the intensity image to [0,1].
+        float                      m_intensityScale_f;
+
+        /// Are the gradient and binary images up to date?
+        bool                       m_gradImagesValid_b;
+
+        /// Edge points for batch accumulation.
+        SEdgePointList             m_edges;
+
+        /// Per thread edge points.
+        SEdgePointList             m_threadEdges_p[HTO_MAX_CORES];
+
         /// Gradient threshold
         float                      m_gradThreshold_f;
 
@@ -200,8 +241,14 @@ namespace QCV
         /// Min value for extracting lines
         float                      m_minHoughVal_f;
 
+        /// Max number of peaks extracted from the accumulator (0: all).
+        int                        m_maxPeaks_i;
+
         /// Vector with extracted lines
         THoughLineVector           m_lines;
+
+        /// Peaks of the accumulator before min distance suppression.
+        THoughLineVector           m_peaks;
       
         /// Show only top X lines.
         int                        m_showMaxLines_i;
@@ -214,6 +261,27 @@ namespace QCV
 
         /// ROI
         S2D<float>                 m_minHoughDistance;
+
+        /// Vote only around the lines of the previous frame?
+        bool                       m_tracking_b;
+
+        /// Half size of the tracking windows (angle [deg], range [px]).
+        S2D<float>                 m_trackWindow;
+
+        /// Max number of tracked lines.
+        int                        m_maxTracks_i;
+
+        /// Frames between votes in the whole Hough space when tracking.
+        int                        m_fullVoteInterval_i;
+
+        /// Frames since the last vote in the whole Hough space.
+        int                        m_framesSinceFullVote_i;
+
+        /// Tracked lines (accumulator coordinates).
+        THoughLineVector           m_tracks;
+
+        /// Voting windows of the tracked lines.
+        THoughWindowVector         m_trackWindows;
      };
 }
 
@@ -32,6 +32,7 @@
 
 /* INCLUDES */
 #include <limits>
+#include <algorithm>
 
 #include "imgScalerOp.h"
 
@@ -39,6 +40,17 @@
 #include "drawingList.h"
 #include "ceParameter.h"
 
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/// Output rows per task of the fast downsampling path.
+#define ISO_ROWS_PER_TASK 32
+
 using namespace QCV;
 
 /// Constructors.
@@ -54,7 +66,12 @@ CImageScalerOp::CImageScalerOp ( COperator * const f_parent_p,
       m_scaleSize (                         320, 240 ),
       m_img_v (                                      ),
       m_scaledImgs_v (                               ),
-      m_interpolMode_i (            cv::INTER_LINEAR )
+      m_interpolMode_i (            cv::INTER_LINEAR ),
+      m_toGray_b (                             false ),
+      m_buffers_v (                                  ),
+      m_grayImgs_v (                                 ),
+      m_tasks_v (                                    ),
+      m_grayRows_v (                                 )
 {
     registerDrawingLists( f_preferedNumImgs_i );
     registerParameters ( f_preferedNumImgs_i );
@@ -135,6 +152,13 @@ CImageScalerOp::registerParameters( int f_numReg_i )
     scaleMode_p -> addDescription ( cv::INTER_CUBIC,    "Bicubic interpolation" );
     scaleMode_p -> addDescription ( cv::INTER_LANCZOS4, "Lanczos" );
     
+    ADD_BOOL_PARAMETER ( "Convert To Gray",
+                         "Convert color images to gray scale while scaling.",
+                         m_toGray_b,
+                         this,
+                         ToGray,
+                         CImageScalerOp );
+
 
     END_PARAMETER_GROUP;
 
@@ -192,44 +216,282 @@ CImageScalerOp::cycle()
     return COperator::cycle();
 }
 
+/// Gray values of a row of BGR(A) pixels as computed by cv::cvtColor.
+static inline void rowToGray ( const uint8_t * f_src_p,
+                               int             f_channels_i,
+                               int             f_width_i,
+                               uint8_t *       fr_dst_p )
+{
+    for (int j = 0; j < f_width_i; ++j, f_src_p += f_channels_i)
+        fr_dst_p[j] = (uint8_t) ( ( f_src_p[0] * 1868 + 
+                                    f_src_p[1] * 9617 + 
+                                    f_src_p[2] * 4899 + (1 << 13) ) >> 14 );
+}
+
+/// Average of the 2x2 blocks of two rows. Same result as cv::resize with
+/// INTER_AREA or INTER_LINEAR.
+static inline void downsampleRow2 ( const uint8_t * f_r0_p,
+                                    const uint8_t * f_r1_p,
+                                    int             f_dstWidth_i,
+                                    uint8_t *       fr_dst_p )
+{
+    int j = 0;
+
+#if defined ( __SSE2__ )
+    const __m128i mask = _mm_set1_epi16 ( 0x00ff );
+    const __m128i two  = _mm_set1_epi16 ( 2 );
+
+    for (; j + 16 <= f_dstWidth_i; j += 16)
+    {
+        const __m128i a0 = _mm_loadu_si128 ( (const __m128i *) ( f_r0_p + 2*j ) );
+        const __m128i b0 = _mm_loadu_si128 ( (const __m128i *) ( f_r1_p + 2*j ) );
+        const __m128i a1 = _mm_loadu_si128 ( (const __m128i *) ( f_r0_p + 2*j + 16 ) );
+        const __m128i b1 = _mm_loadu_si128 ( (const __m128i *) ( f_r1_p + 2*j + 16 ) );
+
+        /// Even plus odd bytes of each row.
+        __m128i s0 = _mm_add_epi16 ( _mm_add_epi16 ( _mm_and_si128 ( a0, mask ), _mm_srli_epi16 ( a0, 8 ) ),
+                                     _mm_add_epi16 ( _mm_and_si128 ( b0, mask ), _mm_srli_epi16 ( b0, 8 ) ) );
+        __m128i s1 = _mm_add_epi16 ( _mm_add_epi16 ( _mm_and_si128 ( a1, mask ), _mm_srli_epi16 ( a1, 8 ) ),
+                                     _mm_add_epi16 ( _mm_and_si128 ( b1, mask ), _mm_srli_epi16 ( b1, 8 ) ) );
+
+        s0 = _mm_srli_epi16 ( _mm_add_epi16 ( s0, two ), 2 );
+        s1 = _mm_srli_epi16 ( _mm_add_epi16 ( s1, two ), 2 );
+
+        _mm_storeu_si128 ( (__m128i *) ( fr_dst_p + j ), _mm_packus_epi16 ( s0, s1 ) );
+    }
+#endif
+
+    for (; j < f_dstWidth_i; ++j)
+        fr_dst_p[j] = (uint8_t) ( ( f_r0_p[2*j] + f_r0_p[2*j+1] + 
+                                    f_r1_p[2*j] + f_r1_p[2*j+1] + 2 ) >> 2 );
+}
+
+/// Average of the 4x4 blocks of four rows. Same result as cv::resize with
+/// INTER_AREA (sums are rounded half to even).
+static inline void downsampleRow4 ( const uint8_t * const * f_rows_p,
+                                    int                     f_dstWidth_i,
+                                    uint8_t *               fr_dst_p )
+{
+    int j = 0;
+
+#if defined ( __SSE2__ )
+    const __m128i mask  = _mm_set1_epi16 ( 0x00ff );
+    const __m128i ones  = _mm_set1_epi16 ( 1 );
+    const __m128i one   = _mm_set1_epi32 ( 1 );
+    const __m128i seven = _mm_set1_epi32 ( 7 );
+
+    for (; j + 8 <= f_dstWidth_i; j += 8)
+    {
+        __m128i s0 = _mm_setzero_si128();
+        __m128i s1 = _mm_setzero_si128();
+
+        /// Sums of the horizontal pairs of the four rows.
+        for (int r = 0; r < 4; ++r)
+        {
+            const __m128i a = _mm_loadu_si128 ( (const __m128i *) ( f_rows_p[r] + 4*j ) );
+            const __m128i b = _mm_loadu_si128 ( (const __m128i *) ( f_rows_p[r] + 4*j + 16 ) );
+            s0 = _mm_add_epi16 ( s0, _mm_add_epi16 ( _mm_and_si128 ( a, mask ), _mm_srli_epi16 ( a, 8 ) ) );
+            s1 = _mm_add_epi16 ( s1, _mm_add_epi16 ( _mm_and_si128 ( b, mask ), _mm_srli_epi16 ( b, 8 ) ) );
+        }
+
+        /// Sums of two pairs, rounded half to even.
+        __m128i q0 = _mm_madd_epi16 ( s0, ones );
+        __m128i q1 = _mm_madd_epi16 ( s1, ones );
+        q0 = _mm_srli_epi32 ( _mm_add_epi32 ( _mm_add_epi32 ( q0, seven ), 
+                                              _mm_and_si128 ( _mm_srli_epi32 ( q0, 4 ), one ) ), 4 );
+        q1 = _mm_srli_epi32 ( _mm_add_epi32 ( _mm_add_epi32 ( q1, seven ), 
+                                              _mm_and_si128 ( _mm_srli_epi32 ( q1, 4 ), one ) ), 4 );
+
+        const __m128i q = _mm_packs_epi32 ( q0, q1 );
+        _mm_storel_epi64 ( (__m128i *) ( fr_dst_p + j ), _mm_packus_epi16 ( q, q ) );
+    }
+#endif
+
+    for (; j < f_dstWidth_i; ++j)
+    {
+        int sum_i = 0;
+        for (int r = 0; r < 4; ++r)
+            sum_i += ( f_rows_p[r][4*j]   + f_rows_p[r][4*j+1] + 
+                       f_rows_p[r][4*j+2] + f_rows_p[r][4*j+3] );
+
+        fr_dst_p[j] = (uint8_t) ( ( sum_i + 7 + ( ( sum_i >> 4 ) & 1 ) ) >> 4 );
+    }
+}
+
 /// Resize.
 void
 CImageScalerOp::resize()
 {
-    m_scaledImgs_v.resize(m_img_v.size());
-        
-    for ( unsigned int i = 0; i < m_img_v.size(); ++i )
+    const int numImgs_i = m_img_v.size();
+
+    m_scaledImgs_v.resize ( numImgs_i );
+    m_buffers_v.resize    ( numImgs_i );
+    m_grayImgs_v.resize   ( numImgs_i );
+
+    m_tasks_v.clear();
+
+    size_t maxGrayRow_ui = 0;
+
+    /// Generic tasks first, as they take longer.
+    for (int pass_i = 0; pass_i < 2; ++pass_i)
     {
-        if ( m_img_v[i].size().width  > 0 && 
-             m_img_v[i].size().height > 0 )
+        for ( int i = 0; i < numImgs_i; ++i )
         {
-            cv::Size size;
-                 
-            if ( m_scaleMode_e == SM_FACTOR )
+            const cv::Mat & img = m_img_v[i];
+
+            if ( img.size().width  <= 0 ||
+                 img.size().height <= 0 )
             {
-                size = m_img_v[i].size();
-                size.width  *= m_scaleFactor.x;
-                size.height *= m_scaleFactor.y;
+                if ( pass_i == 0 )
+                    m_scaledImgs_v[i] = cv::Mat(0, 0, CV_8UC1);
+                continue;
             }
-            else
+
+            const cv::Size size = getOutputSize ( img.size() );
+
+            const bool gray_b   = m_toGray_b && ( img.channels() == 3 || img.channels() == 4 );
+            const int  factor_i = getFastFactor ( img, size );
+
+            if ( pass_i == 0 && factor_i == 0 )
             {
-                size = m_scaleSize;
+                if ( size == img.size() && !gray_b )
+                    m_scaledImgs_v[i] = img;
+                else
+                {
+                    SScaleTask task = { i, 0, 0, size.height };
+                    m_tasks_v.push_back ( task );
+                }
             }
-                
-            if (size == m_img_v[i].size())
-                m_scaledImgs_v[i] = m_img_v[i];
-            else
+            else if ( pass_i == 1 && factor_i > 0 )
             {
-                cv::resize(m_img_v[i], m_scaledImgs_v[i], size, 0, 0, m_interpolMode_i);
+                /// Allocate now, so that the tasks only write.
+                m_buffers_v[i].create ( size, CV_8UC1 );
+                m_scaledImgs_v[i] = m_buffers_v[i];
+
+                if ( gray_b )
+                    maxGrayRow_ui = std::max ( maxGrayRow_ui, (size_t) factor_i * img.cols );
+
+                for (int r = 0; r < size.height; r += ISO_ROWS_PER_TASK)
+                {
+                    SScaleTask task = { i, factor_i, r, std::min ( r + ISO_ROWS_PER_TASK, size.height ) };
+                    m_tasks_v.push_back ( task );
+                }
             }
         }
+    }
+
+#if defined ( _OPENMP )
+    const unsigned int numThreads_ui = omp_get_max_threads();
+#else
+    const unsigned int numThreads_ui = 1;
+#endif
+
+    m_grayRows_v.resize ( numThreads_ui );
+    for (unsigned int t = 0; t < numThreads_ui; ++t)
+        m_grayRows_v[t].resize ( maxGrayRow_ui );
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_ui) schedule(dynamic)
+#endif
+    for (int k = 0; k < (int) m_tasks_v.size(); ++k)
+    {
+#if defined ( _OPENMP )
+        const unsigned int threadNum_ui = omp_get_thread_num();
+#else
+        const unsigned int threadNum_ui = 0;
+#endif
+        const SScaleTask & task = m_tasks_v[k];
+
+        if ( task.factor_i == 0 )
+            scaleImage ( task.image_i );
         else
-            m_scaledImgs_v[i] = cv::Mat(0, 0, CV_8UC1);
+            downsampleRows ( task.image_i, task.factor_i, 
+                             task.firstRow_i, task.lastRow_i,
+                             m_grayRows_v[threadNum_ui].empty() ? NULL : &m_grayRows_v[threadNum_ui][0] );
     }
     
     registerOutput<CMatVector> ( m_outputId_str, &m_scaledImgs_v );
 }
 
+int
+CImageScalerOp::getFastFactor ( const cv::Mat &  f_img,
+                                const cv::Size & f_size ) const
+{
+    if ( f_img.depth() != CV_8U ||
+         ( f_img.channels() != 1 && 
+           !( m_toGray_b && ( f_img.channels() == 3 || f_img.channels() == 4 ) ) ) )
+        return 0;
+
+    if ( f_img.cols == 2 * f_size.width && f_img.rows == 2 * f_size.height &&
+         ( m_interpolMode_i == cv::INTER_AREA || m_interpolMode_i == cv::INTER_LINEAR ) )
+        return 2;
+
+    if ( f_img.cols == 4 * f_size.width && f_img.rows == 4 * f_size.height &&
+         m_interpolMode_i == cv::INTER_AREA )
+        return 4;
+
+    return 0;
+}
+
+void
+CImageScalerOp::scaleImage ( int f_img_i )
+{
+    cv::Mat src = m_img_v[f_img_i];
+
+    /// Only BGR and BGRA images are converted. Others are scaled as they are.
+    if ( m_toGray_b && ( src.channels() == 3 || src.channels() == 4 ) )
+    {
+        cv::cvtColor ( src, m_grayImgs_v[f_img_i], 
+                       src.channels() == 4 ? CV_BGRA2GRAY : CV_BGR2GRAY );
+        src = m_grayImgs_v[f_img_i];
+    }
+
+    const cv::Size size = getOutputSize ( m_img_v[f_img_i].size() );
+
+    if ( size == src.size() )
+        m_scaledImgs_v[f_img_i] = src;
+    else
+    {
+        cv::resize ( src, m_buffers_v[f_img_i], size, 0, 0, m_interpolMode_i );
+        m_scaledImgs_v[f_img_i] = m_buffers_v[f_img_i];
+    }
+}
+
+void
+CImageScalerOp::downsampleRows ( int             f_img_i, 
+                                 int             f_factor_i,
+                                 int             f_firstRow_i,
+                                 int             f_lastRow_i,
+                                 unsigned char * f_grayRows_p )
+{
+    const cv::Mat & src = m_img_v[f_img_i];
+    cv::Mat &       dst = m_buffers_v[f_img_i];
+
+    const int channels_i = src.channels();
+    const uint8_t * rows_p[4];
+
+    for (int i = f_firstRow_i; i < f_lastRow_i; ++i)
+    {
+        for (int r = 0; r < f_factor_i; ++r)
+        {
+            if ( channels_i == 1 )
+                rows_p[r] = src.ptr<uint8_t>(f_factor_i * i + r);
+            else
+            {
+                /// Convert the source rows in the same pass.
+                uint8_t * gray_p = f_grayRows_p + r * src.cols;
+                rowToGray ( src.ptr<uint8_t>(f_factor_i * i + r), channels_i, src.cols, gray_p );
+                rows_p[r] = gray_p;
+            }
+        }
+
+        if ( f_factor_i == 2 )
+            downsampleRow2 ( rows_p[0], rows_p[1], dst.cols, dst.ptr<uint8_t>(i) );
+        else
+            downsampleRow4 ( rows_p, dst.cols, dst.ptr<uint8_t>(i) );
+    }
+}
+
 /// Show event.
 bool
 CImageScalerOp::show()
@@ -348,5 +610,24 @@ CImageScalerOp::getScaleSize ( ) const
     return m_scaleSize;
 }
 
+cv::Size
+CImageScalerOp::getOutputSize ( const cv::Size & f_inputSize ) const
+{
+    cv::Size size;
+                 
+    if ( m_scaleMode_e == SM_FACTOR )
+    {
+        size = f_inputSize;
+        size.width  *= m_scaleFactor.x;
+        size.height *= m_scaleFactor.y;
+    }
+    else
+    {
+        size = cv::Size ( m_scaleSize.width, m_scaleSize.height );
+    }
+
+    return size;
+}
+
 
  
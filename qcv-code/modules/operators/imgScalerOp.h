@@ -71,6 +71,7 @@ namespace QCV
         ADD_PARAM_ACCESS (EScaleMode,  m_scaleMode_e,        ScaleMode );
 
         ADD_PARAM_ACCESS (int,         m_interpolMode_i,     InterpolationMode );
+        ADD_PARAM_ACCESS (bool,        m_toGray_b,           ToGray );
 
         bool              setScaleFactor ( S2D<float> f_factors );
         S2D<float>        getScaleFactor ( ) const;
@@ -78,6 +79,9 @@ namespace QCV
         bool              setScaleSize ( S2D<unsigned int> f_size );
         S2D<unsigned int> getScaleSize ( ) const;
 
+        /// Size of the scaled image for an input image size.
+        cv::Size          getOutputSize ( const cv::Size & f_inputSize ) const;
+
         /// Constructor, Desctructors
     public:    
         
@@ -122,6 +126,37 @@ namespace QCV
         
 	bool getInputs();
 
+        /// Downsampling factor (2 or 4) if the image can be scaled to
+        /// f_size with the area downsampling fast path, 0 otherwise.
+        int  getFastFactor ( const cv::Mat &  f_img,
+                             const cv::Size & f_size ) const;
+
+        /// Scale image f_img_i with the generic path.
+        void scaleImage ( int f_img_i );
+
+        /// Downsample the output rows [f_firstRow_i, f_lastRow_i) of 
+        /// image f_img_i with the fast path.
+        void downsampleRows ( int             f_img_i, 
+                              int             f_factor_i,
+                              int             f_firstRow_i,
+                              int             f_lastRow_i,
+                              unsigned char * f_grayRows_p );
+
+    private:
+        struct SScaleTask
+        {
+            /// Image index.
+            int     image_i;
+
+            /// Downsampling factor of the fast path (0 for the generic
+            /// path).
+            int     factor_i;
+
+            /// Output rows [firstRow_i, lastRow_i) for the fast path.
+            int     firstRow_i;
+            int     lastRow_i;
+        };
+
     private:
 
         /// Input image id
@@ -150,6 +185,21 @@ namespace QCV
 
         /// Interpolation mode
         int                         m_interpolMode_i;
+
+        /// Convert color images to gray while scaling?
+        bool                        m_toGray_b;
+
+        /// Output buffers (persistent over frames).
+        CMatVector                  m_buffers_v;
+
+        /// Gray conversions of the color images for the generic path.
+        CMatVector                  m_grayImgs_v;
+
+        /// Scaling tasks of the current frame.
+        std::vector<SScaleTask>     m_tasks_v;
+
+        /// Per thread buffers for the rows converted to gray.
+        std::vector< std::vector<unsigned char> > m_grayRows_v;
     };
 }
 #endif // __IMGSCALEROP_H
@@ -32,6 +32,7 @@
 
 /* INCLUDES */
 #include <limits>
+#include <algorithm>
 
 #include "kltTrackerOp.h"
 #include "paramMacros.h"
@@ -40,10 +41,6 @@
 #include "stereoCamera.h"
 #include "rigidMotion.h"
 
-#ifdef USE_GPU
-#include "opencv2/gpu/gpu.hpp"
-#include "opencv2/nonfree/gpu.hpp"
-#endif
 using namespace QCV;
 
 /// Constructors.
@@ -52,7 +49,9 @@ CKltTrackerOp::CKltTrackerOp ( COperator * const f_parent_p,
     : COperator (             f_parent_p, f_name_str ),
       m_inpImageId_str (                   "Image 0" ),
       m_featPointVector_str (       "Feature Vector" ),
+      m_featPointArray_str (         "Feature Array" ),
       m_compute_b (                             true ),
+      m_pyrParams (                           -1, -1 ),
       m_respCE (   CColorEncoding::CET_BLUE2GREEN2RED,
                                S2D<float> ( 0, 200 ) ),
       m_preFilter_b (                          false ),
@@ -69,6 +68,9 @@ CKltTrackerOp::CKltTrackerOp ( COperator * const f_parent_p,
       m_pyrLKEpsilon_f (                          1. ),
       m_pyrLKMaxCount_i (                        100 ),
       m_usePrediction_b (                       true ),
+      m_nativeLK_b (                            true ),
+      m_fbCheck_b (                            false ),
+      m_maxFBError_f (                           1.f ),
 
       m_minEigenvalue_f (                     1e-05f ),
       m_useSubPix_b (                           true ),
@@ -129,6 +131,13 @@ CKltTrackerOp::registerParameters( )
                          FeaturePointVectorId, 
                          CKltTrackerOp );
 
+      ADD_STR_PARAMETER( "Output Feature Array Id", 
+                         "Id of the structure of arrays feature storage.",
+                         m_featPointArray_str,
+                         this,
+                         FeaturePointArrayId, 
+                         CKltTrackerOp );
+
       ADD_BOOL_PARAMETER( "Pre-Filter?", 
                           "Apply mask normalization to input image.",
                           m_preFilter_b,
@@ -217,6 +226,28 @@ CKltTrackerOp::registerParameters( )
                           UsePrediction,
                           CKltTrackerOp );
 
+      ADD_BOOL_PARAMETER( "Native LK",
+                          "Use the native LK implementation instead of OpenCV's.",
+                          m_nativeLK_b,
+                          this,
+                          NativeLK,
+                          CKltTrackerOp );
+
+      ADD_BOOL_PARAMETER( "Forward-Backward Check",
+                          "Track features back and reject them if they do not return to their "
+                          "original position (native LK only).",
+                          m_fbCheck_b,
+                          this,
+                          ForwardBackwardCheck,
+                          CKltTrackerOp );
+
+      ADD_FLOAT_PARAMETER( "Max Forward-Backward Error",
+                           "Max distance between the original and the back tracked position [px].",
+                           m_maxFBError_f,
+                           this,
+                           MaxForwardBackwardError,
+                           CKltTrackerOp );
+
     END_PARAMETER_GROUP;
     BEGIN_PARAMETER_GROUP("Detection", false, SRgb(220,0,0));
 
@@ -334,74 +365,35 @@ bool CKltTrackerOp::cycle()
       if (m_preFilter_b)
       {
          startClock ("Pre-filtering");            
-         int ddepth = CV_32F;
-         cv::Mat imgf,imgf2;
-         //cv::Sobel( img,  m_currImg,  ddepth, 1, 1, 5, 255.f/500.f, 127.5f, cv::BORDER_DEFAULT );
-
-         cv::boxFilter( img, imgf, ddepth, cv::Size(m_pFMaskSize_i,m_pFMaskSize_i), cv::Point(-1,-1), true, cv::BORDER_DEFAULT );
-         img.convertTo ( imgf2, CV_32F, 1., 0);
-         imgf -= imgf2;
-         imgf.convertTo ( m_currImg, CV_8U, m_pFClampScale_f, 127);
+         getDerivedImage ( CDerivedImageCache::SImageDesc ( m_inpImageId_str ).boxFilter ( m_pFMaskSize_i, m_pFClampScale_f ) ).copyTo ( m_currImg );
          stopClock ("Pre-filtering");
       }
       else
          img.copyTo(m_currImg);
 
+      startClock ("Pyramid Construction");
+      buildPyramids();
+      stopClock ("Pyramid Construction");
+
       startClock ("Copy Feature Vector");
 
-      m_prevFeatureVector = m_featureVector;
+      /// Disparities are computed by the consumers of the output vector.
+      m_featureArray.importDisparities ( m_featureVector );
 
       stopClock ("Copy Feature Vector");
 
-      int halfMaskSize_i = m_kernelSize_i / 2;
       /// Get input from parent.
 
       if ( m_prevImg.cols > 0  )
       {
          startClock ("Collision Detection");            
-           
-         for (int i = 0; i < m_numFeatures_i; ++i)
-         {
-            if ( m_featureVector[i].state == SFeature::FS_TRACKED || 
-                 m_featureVector[i].state == SFeature::FS_NEW )
-            {
-               if (m_checkCollisions_b)
-               {
-                  int j;
-                  for (j = i+1; j < m_numFeatures_i; ++j)
-                  {
-                     if ( m_featureVector[j].state == SFeature::FS_TRACKED || 
-                          m_featureVector[j].state == SFeature::FS_NEW )
-                     {
-                        float diffx_f = m_featureVector[i].u - m_featureVector[j].u;
-                        float diffy_f = m_featureVector[i].v - m_featureVector[j].v;
-                        float sqDiff_f = diffx_f * diffx_f + diffy_f * diffy_f;
-                        
-                        if ( sqDiff_f <= m_maxSqDist4Collision_f )
-                        {
-			  m_featureVector[i].clear();
-                          
-                          const bool removeByAge_b = true;
-                          
-                          if ( (removeByAge_b && m_featureVector[i].t < m_featureVector[j].t) ||
-                               (!removeByAge_b && m_featureVector[i].e < m_featureVector[j].e ) )
-                             m_featureVector[i].clear();
-                          else
-                             m_featureVector[j].clear();
-
-                          break;
-                       }
-                     }
-                  }
-               }
-            }
-         }
+
+         if (m_checkCollisions_b)
+            removeCollisions();
+
          stopClock ("Collision Detection");
 
          startClock ("Build tracking list");
-         std::vector<cv::Point2f> featprev_ocv;
-         std::vector<cv::Point2f> featcurr_ocv;
-         std::vector<size_t>      mapping_v;
 
          SRigidMotion *   motion_p     = getInput<SRigidMotion>  ( "Predicted Motion" );
          CStereoCamera *  stCamera_p   = getInput<CStereoCamera> ( "Rectified Camera" );
@@ -411,11 +403,10 @@ bool CKltTrackerOp::cycle()
             monoCamera_p = getInput<CCamera> ( "Rectified Camera" );
 
          bool predict_b = m_usePrediction_b && (stCamera_p || monoCamera_p) && motion_p;
-         
-         std::vector<cv::Point2f> featpred; // FOR PAPER
-         for (size_t i = 0; i < m_numFeatures_i; ++i)
+
+         CStereoCamera cam;
+         if (predict_b)
          {
-            CStereoCamera cam;
             if (monoCamera_p)
             {
                ((CCamera)cam) = *monoCamera_p;
@@ -423,145 +414,138 @@ bool CKltTrackerOp::cycle()
             }
             else
                cam = *stCamera_p;
-            
-            if ( m_featureVector[i].state == SFeature::FS_TRACKED || 
-                 m_featureVector[i].state == SFeature::FS_NEW )
+         }
+
+         /// The current positions of the last cycle become the previous
+         /// ones. The current positions are the initial estimates. They 
+         /// are equal to the previous ones unless a prediction is 
+         /// available.
+         const int numFeatures_i = (int) m_featureArray.size();
+         m_trackMask_v.resize ( numFeatures_i );
+
+         std::vector<cv::Point2f> & prevPts_v = m_prevPts_v;
+         std::vector<cv::Point2f> & currPts_v = m_featureArray.getPositions();
+
+         prevPts_v.resize ( numFeatures_i );
+         prevPts_v.swap ( currPts_v );
+
+         for (int i = 0; i < numFeatures_i; ++i)
+         {
+            currPts_v[i] = prevPts_v[i];
+
+            m_trackMask_v[i] = m_featureArray.isActive(i);
+
+            if ( m_trackMask_v[i] && m_featureArray.getDisparity(i) > 0 && predict_b )
             {
-               featprev_ocv.push_back ( cv::Point2f(m_featureVector[i].u, m_featureVector[i].v) );
-               cv::Point2f curr (m_featureVector[i].u, m_featureVector[i].v);
-               
-               if ( m_featureVector[i].d > 0 && predict_b )
+               cv::Point2f & curr = m_featureArray.getPosition(i);
+
+               C3DVector prediction ( curr.x,
+                                      curr.y,
+                                      m_featureArray.getDisparity(i) );
+
+               C3DVector p;
+               if ( cam.image2Local ( prediction,
+                                      p ) )
                {
-                  C3DVector prediction ( m_featureVector[i].u,
-                                         m_featureVector[i].v,
-                                         m_featureVector[i].d );
-
-                  C3DVector p;
-                  if ( cam.image2Local ( prediction,
-                                               p ) )
-                  {
-                     C3DVector p2 = motion_p->rotation * p + motion_p->translation;
-                     if ( cam.local2Image ( p2, p ) )
-                     {
-                        prediction = p;
-                        curr = cv::Point2f(p.x(), p.y());
-                     }
-                  }
+                  C3DVector p2 = motion_p->rotation * p + motion_p->translation;
+                  if ( cam.local2Image ( p2, p ) )
+                     curr = cv::Point2f(p.x(), p.y());
                }
-               featpred.push_back (curr); // FOR PAPER
-               featcurr_ocv.push_back ( curr );
-               mapping_v.push_back(i);
             }
          }
+
          stopClock ("Build tracking list");                
          
          // KLT tracker using OpenCV
          startClock ("OpenCV KLT");
 
-         // set window size and criteria
-         std::vector<uint8_t> status_ocv;
-         std::vector<float> error_ocv;
-
-#ifdef USE_GPU
-         cv::Mat tmpFeatPrev = cv::Mat(1, featprev_ocv.size(), CV_32FC2, &featprev_ocv[0]);
-         cv::Mat tmpFeatCurr = cv::Mat(1, featcurr_ocv.size(), CV_32FC2, &featcurr_ocv[0]);
-
-         cv::gpu::GpuMat gpuPrevImg(m_prevImg);
-         cv::gpu::GpuMat gpuCurrImg(m_currImg);
-         cv::gpu::GpuMat gpuFeatPrev(tmpFeatPrev);
-         cv::gpu::GpuMat gpuFeatCurr(tmpFeatCurr);
-         cv::gpu::GpuMat gpuStatus;
-         cv::gpu::GpuMat gpuErrors;
-
-
-         // sparse lk optical flow
-         cv::gpu::PyrLKOpticalFlow    gpuPyrLK;
-         
-         gpuPyrLK.winSize.width  = m_kernelSize_i;
-         gpuPyrLK.winSize.height = m_kernelSize_i;
-         gpuPyrLK.maxLevel       = m_pyrLevels_i;
-         gpuPyrLK.iters          = m_pyrLKMaxCount_i;
-         gpuPyrLK.derivLambda    = m_pyrLKEpsilon_f;
-         gpuPyrLK.useInitialFlow = m_usePrediction_b;
-         
-         cv::gpu::GpuMat d_nextPts;
-         cv::gpu::GpuMat d_status;
-         cv::gpu::GpuMat d_err;
-         
-         gpuPyrLK.sparse(gpuPrevImg, 
-                         gpuCurrImg, 
-                         gpuFeatPrev, 
-                         gpuFeatCurr, 
-                         gpuStatus, 
-                         &gpuErrors);
-         
-         tmpFeatPrev = cv::Mat(gpuFeatPrev);
-         tmpFeatCurr = cv::Mat(gpuFeatCurr);
-         
-         for (int i = 0 ; i < tmpFeatPrev.cols; ++i)
-         {
-             featprev_ocv[i] = tmpFeatPrev.at<cv::Point2f>(i);
-         }
-         
-         for (int i = 0 ; i < tmpFeatCurr.cols; ++i)
+#if CV_MAJOR_VERSION > 2 || ( CV_MAJOR_VERSION == 2 && CV_MINOR_VERSION >= 4 )
+         const bool nativeLK_b = m_nativeLK_b;
+#else
+         const bool nativeLK_b = false;
+#endif
+         if ( nativeLK_b )
          {
-             featcurr_ocv[i] = tmpFeatCurr.at<cv::Point2f>(i);
+            /// Track in place on the feature arrays.
+            m_lkTracker.setWindowSize              ( m_kernelSize_i );
+            m_lkTracker.setMaxLevel                ( m_pyrLevels_i );
+            m_lkTracker.setMaxIterations           ( m_pyrLKMaxCount_i );
+            m_lkTracker.setEpsilon                 ( m_pyrLKEpsilon_f );
+            m_lkTracker.setUseInitialFlow          ( m_usePrediction_b );
+            m_lkTracker.setForwardBackwardCheck    ( m_fbCheck_b );
+            m_lkTracker.setMaxForwardBackwardError ( m_maxFBError_f );
+
+            if ( !m_lkTracker.track ( m_prevPyr_v, m_currPyr_v,
+                                      prevPts_v, currPts_v,
+                                      m_trackStatus_v, m_trackError_v,
+                                      &m_trackMask_v ) )
+            {
+               m_trackStatus_v.assign ( numFeatures_i, 0 );
+               m_trackError_v.assign  ( numFeatures_i, 0.f );
+            }
          }
-         
-         cv::Mat tmpStatus ( gpuStatus );
-         status_ocv.resize(gpuStatus.cols);
-         for (int i = 0 ; i < tmpStatus.cols; ++i)
+         else
          {
-             status_ocv[i] = tmpStatus.at<uint8_t>(i);
-         }
+            /// OpenCV has no mask, so all features are passed and the
+            /// results of the features not to be tracked are discarded
+            /// below. The current positions are tracked in place through
+            /// the matrix view of the array.
+            cv::Mat currPts = m_featureArray.getPositionMat();
+
+            cv::TermCriteria criteria_ocv;
+            cv::Size winsize_ocv;
+            winsize_ocv.width     = m_kernelSize_i;
+            winsize_ocv.height    = m_kernelSize_i;
+            criteria_ocv.epsilon  = m_pyrLKEpsilon_f;
+            criteria_ocv.maxCount = m_pyrLKMaxCount_i; 
+            criteria_ocv.type = (CV_TERMCRIT_EPS | CV_TERMCRIT_ITER);
+
+            int flags = (m_usePrediction_b)?cv::OPTFLOW_USE_INITIAL_FLOW:0;
+#if CV_MAJOR_VERSION > 2 || ( CV_MAJOR_VERSION == 2 && CV_MINOR_VERSION >= 4 )
+            cv::calcOpticalFlowPyrLK(m_prevPyr_v, m_currPyr_v, 
+                                     prevPts_v, currPts,
+                                     m_trackStatus_v, m_trackError_v, 
+                                     winsize_ocv, m_pyrLevels_i,
+                                     criteria_ocv, flags);
+#else
+            cv::calcOpticalFlowPyrLK(m_prevImg, m_currImg, 
+                                     prevPts_v, currPts,
+                                     m_trackStatus_v, m_trackError_v, 
+                                     winsize_ocv, m_pyrLevels_i,
+                                     criteria_ocv, flags);
+#endif
 
-         cv::Mat tmpError ( gpuErrors );
-         error_ocv.resize(gpuErrors.cols);
-         for (int i = 0 ; i < tmpError.cols; ++i)
-         {
-             error_ocv[i] = tmpError.at<float>(i);
+            /// Features not to be tracked keep their previous position.
+            for (int i = 0; i < numFeatures_i; ++i)
+            {
+               if ( !m_trackMask_v[i] )
+               {
+                  currPts_v[i]       = prevPts_v[i];
+                  m_trackStatus_v[i] = 0;
+               }
+            }
          }
-#else
-         cv::TermCriteria criteria_ocv;
-         cv::Size winsize_ocv;
-         winsize_ocv.width     = m_kernelSize_i;
-         winsize_ocv.height    = m_kernelSize_i;
-         criteria_ocv.epsilon  = m_pyrLKEpsilon_f;
-         criteria_ocv.maxCount = m_pyrLKMaxCount_i; 
-         criteria_ocv.type = (CV_TERMCRIT_EPS | CV_TERMCRIT_ITER);
-
-         int flags = (m_usePrediction_b)?cv::OPTFLOW_USE_INITIAL_FLOW:0;
-         cv::calcOpticalFlowPyrLK(m_prevImg, m_currImg, 
-                                  featprev_ocv, featcurr_ocv,
-                                  status_ocv, error_ocv, 
-                                  winsize_ocv, m_pyrLevels_i,
-                                  criteria_ocv, flags);
-         
-#endif    
-         for (int i = 0; i < featprev_ocv.size(); ++i) 
+
+         std::vector<float> &         disp_v  = m_featureArray.getDisparities();
+         std::vector<unsigned char> & state_v = m_featureArray.getStates();
+         std::vector<int> &           age_v   = m_featureArray.getAges();
+         std::vector<float> &         error_v = m_featureArray.getErrors();
+
+         for (int i = 0; i < numFeatures_i; ++i) 
          {
-            int j = mapping_v[i];
-            if (status_ocv[i] )
+            if ( !m_trackMask_v[i] )
+               continue;
+
+            if ( m_trackStatus_v[i] )
             {
- // FOR PAPER
-               C3DVector d1(featcurr_ocv[i].x-featpred[i].x, 
-                            featcurr_ocv[i].y-featpred[i].y,0.);
-               C3DVector d2(featcurr_ocv[i].x-featprev_ocv[i].x, 
-                            featcurr_ocv[i].y-featprev_ocv[i].y,0.);
-               //if (predict_b)
-               //   printf("Measurement  for %i is %f %f preddist %f prevdist %f \n", i, featcurr_ocv[i].x, featcurr_ocv[i].y, d1.magnitude(), d2.magnitude() );
-
-               int j = mapping_v[i];
-               m_featureVector[j].u      = featcurr_ocv[i].x;
-               m_featureVector[j].v      = featcurr_ocv[i].y;
-               m_featureVector[j].d      = -1;
-               m_featureVector[j].f      = imgNr_u;
-               m_featureVector[j].e      = error_ocv[i];
-               m_featureVector[j].state  = SFeature::FS_TRACKED;
-               ++m_featureVector[j].t;
+               disp_v[i]  = -1;
+               error_v[i] = m_trackError_v[i];
+               state_v[i] = SFeature::FS_TRACKED;
+               m_featureArray.getFrame(i) = imgNr_u;
+               ++age_v[i];
             }
             else
-               m_featureVector[j].state  = SFeature::FS_LOST;               
+               state_v[i] = SFeature::FS_LOST;               
          }
       }
       stopClock ("OpenCV KLT");
@@ -569,15 +553,119 @@ bool CKltTrackerOp::cycle()
       startClock ("Select Good Features");
       selectGoodFeatures();
       stopClock ("Select Good Features");
+
+      startClock ("Export Feature Vector");
+      m_featureArray.exportVector ( m_featureVector );
+      stopClock ("Export Feature Vector");
       
       registerOutput<cv::Mat>("KltTrackerOp Previous Image", &m_prevImg );      
       registerOutput<cv::Mat>("KltTrackerOp Current Image",  &m_currImg );
+      registerOutput<CImagePyramid>("KltTrackerOp Current Pyramid", &m_pyramid );
       registerOutput<CFeatureVector>(m_featPointVector_str, &m_featureVector );      
+      registerOutput<CFeatureArray>(m_featPointArray_str, &m_featureArray );
    }
    
    return COperator::cycle();
 }
 
+/// Build the pyramid of the current image. The pyramid of the current 
+/// image of the last cycle becomes the one of the previous image, so
+/// that it is not built again by the optical flow computation.
+void
+CKltTrackerOp::buildPyramids()
+{
+#if CV_MAJOR_VERSION > 2 || ( CV_MAJOR_VERSION == 2 && CV_MINOR_VERSION >= 4 )
+   const cv::Size winSize ( m_kernelSize_i, m_kernelSize_i );
+   const S2D<int> params  ( m_kernelSize_i, m_pyrLevels_i );
+
+   m_prevPyr_v.swap ( m_currPyr_v );
+
+   /// Rebuild the previous pyramid if the parameters have changed.
+   if ( m_prevImg.cols > 0 &&
+        ( m_prevPyr_v.empty() || 
+          params.x != m_pyrParams.x || params.y != m_pyrParams.y ) )
+      cv::buildOpticalFlowPyramid ( m_prevImg, m_prevPyr_v, winSize, m_pyrLevels_i, true );
+
+   cv::buildOpticalFlowPyramid ( m_currImg, m_currPyr_v, winSize, m_pyrLevels_i, true );
+
+   m_pyrParams = params;
+
+   /// Image levels are stored at even positions, derivatives at odd ones.
+   std::vector<cv::Mat> levels_v;
+   for (size_t i = 0; i < m_currPyr_v.size(); i += 2)
+      levels_v.push_back ( m_currPyr_v[i] );
+
+   m_pyramid.setLevelImages ( levels_v );
+#else
+   m_pyramid.setLevels ( m_pyrLevels_i + 1 );
+   m_pyramid.compute ( m_currImg );
+#endif
+}
+
+/// Remove one of each pair of features closer than the collision distance.
+void
+CKltTrackerOp::removeCollisions()
+{
+   const int numFeatures_i = std::min ( m_numFeatures_i, (int) m_featureArray.size() );
+
+   /// Cells not smaller than the collision distance so that only the 
+   /// adjacent cells must be visited, and not much more cells than features.
+   double cellSize_d = std::max( sqrt( (double) std::max(m_maxSqDist4Collision_f, 0.f) ), 1. );
+   cellSize_d = std::max( cellSize_d, 
+                          sqrt( m_currImg.cols * (double) m_currImg.rows / std::max(numFeatures_i, 1) ) );
+
+   if ( !m_collisionGrid.initialize ( m_currImg.cols, m_currImg.rows, cellSize_d ) )
+   {
+      printf("%s:%i Could not initialize the collision grid. Collisions are not removed.\n",
+             __FILE__, __LINE__);
+      return;
+   }
+
+   for (int i = 0; i < numFeatures_i; ++i)
+   {
+      if ( m_featureArray.isActive(i) )
+         m_collisionGrid.insert ( i, 
+                                  m_featureArray.getPosition(i).x, 
+                                  m_featureArray.getPosition(i).y );
+   }
+   
+   const bool removeByAge_b = true;
+
+   for (int i = 0; i < numFeatures_i; ++i)
+   {
+      if ( !m_featureArray.isActive(i) )
+         continue;
+
+      m_collisionGrid.getNeighbors ( m_featureArray.getPosition(i).x, 
+                                     m_featureArray.getPosition(i).y, 
+                                     m_maxSqDist4Collision_f,
+                                     m_neighbors_v );
+      
+      /// Colliding feature with lowest index after i which is still alive.
+      int j = numFeatures_i;
+      for (size_t k = 0; k < m_neighbors_v.size(); ++k)
+      {
+         const int n_i = m_neighbors_v[k];
+         if ( n_i > i && n_i < j && m_featureArray.isActive(n_i) )
+            j = n_i;
+      }
+
+      if ( j < numFeatures_i )
+      {
+         /// Same policy as the pairwise search: i is always removed.
+         /// The age (error) of the cleared i is 0, so j is removed as
+         /// well if its age (error) is not larger than 0.
+         m_featureArray.clearFeature(i);
+
+         if ( (removeByAge_b && m_featureArray.getAge(i) < m_featureArray.getAge(j)) ||
+              (!removeByAge_b && m_featureArray.getError(i) < m_featureArray.getError(j) ) )
+            m_featureArray.clearFeature(i);
+         else
+            m_featureArray.clearFeature(j);
+      }
+   }
+}
+
 /// Select good features to track.
 void
 CKltTrackerOp::selectGoodFeatures()
@@ -587,16 +675,16 @@ CKltTrackerOp::selectGoodFeatures()
    /// First pass: update occupancy mask.
     m_featureMask = cv::Mat(m_currImg.rows/downScale_i, m_currImg.cols/downScale_i, CV_8U, cv::Scalar(0));
 
-   for (int i = 0; i < m_featureVector.size(); ++i)
+   for (int i = 0; i < (int) m_featureArray.size(); ++i)
    {
-      if ( m_featureVector[i].state == SFeature::FS_TRACKED || 
-           m_featureVector[i].state == SFeature::FS_NEW )
+      if ( m_featureArray.isActive(i) )
         {
+            const cv::Point2f & pos = m_featureArray.getPosition(i);
             int minDist_i;
             if  ( m_adaptiveDistance_b )
       {
-         C3DVector p (m_featureVector[i].u - m_currImg.cols/2.,
-                      m_featureVector[i].v - m_currImg.rows/2., 0.);
+         C3DVector p (pos.x - m_currImg.cols/2.,
+                      pos.y - m_currImg.rows/2., 0.);
 
             minDist_i = std::min(std::max(1, int(m_minDistance_i * p.magnitude()/(m_currImg.cols/2.))), m_minDistance_i);
             }
@@ -605,8 +693,8 @@ CKltTrackerOp::selectGoodFeatures()
          
             minDist_i /= downScale_i;
 
-            int fx = int(m_featureVector[i].u + .5)/downScale_i;
-            int fy = int(m_featureVector[i].v + .5)/downScale_i;
+            int fx = int(pos.x + .5)/downScale_i;
+            int fy = int(pos.y + .5)/downScale_i;
                 
          /// Mark region in mask image.
          int minK = std::max(fy - minDist_i, 0);
@@ -653,35 +741,27 @@ CKltTrackerOp::selectGoodFeatures()
       
    stopClock ("Select Good Features - Build corner reponse image");
 
-   startClock ("Select Good Features - Sort Eigenvalues");
-   /// Order eigenvalues now.
-   m_eigenvalueVector.clear();
+   startClock ("Select Good Features - Tile Candidates");
 
    float threshold_f = m_detectGFTT_b?m_minEigenvalue_f:m_minHarrisResponse_d;
 
-   for (int i = 2; i < (int)m_eigenImg.rows - 2; ++i)
+   /// Number of empty places in the feature vector.
+   int numNeeded_i = 0;
+   for (int i = 0; i < m_numFeatures_i; ++i)
    {
-      float * eigenvalue_p   = &m_eigenImg.at<float>(i,2);
-      unsigned char * mask_p = &m_featureMask.at<uint8_t>(i,2);
-           
-      for ( int j = 2; j < (int)m_eigenImg.cols - 2; ++j, ++eigenvalue_p, ++mask_p )
-      {
-         if ( *eigenvalue_p > threshold_f &&
-              ! (*mask_p) )
-         { 
-            m_eigenvalueVector.push_back ( SEigenvalue( j, i, *eigenvalue_p ) );                    
-         }
-      }            
+      if ( i >= (int) m_featureArray.size() ||
+           !m_featureArray.isActive(i) )
+         ++numNeeded_i;
    }
-        
-   sort (m_eigenvalueVector.begin(), m_eigenvalueVector.end());
 
-   stopClock ("Select Good Features - Sort Eigenvalues");
+   collectCandidates ( threshold_f, numNeeded_i );
+
+   stopClock ("Select Good Features - Tile Candidates");
 
    startClock ("Select Good Features - New Feature Selection");
 
-   if (m_featureVector.size() != m_numFeatures_i)
-      m_featureVector.resize(m_numFeatures_i);   
+   if (m_featureArray.size() != m_numFeatures_i)
+      m_featureArray.resize(m_numFeatures_i);   
 
    const size_t imgNr_u = getInput<int> ("Frame Number", 0 );     
 
@@ -692,8 +772,7 @@ CKltTrackerOp::selectGoodFeatures()
    int i;
    for (i = 0; i < m_numFeatures_i; ++i)
    {
-      if ( m_featureVector[i].state == SFeature::FS_LOST || 
-           m_featureVector[i].state == SFeature::FS_UNINITIALIZED )
+      if ( !m_featureArray.isActive(i) )
       {
          /// Check for min distance constraint.
          SEigenvalue eigenvalue;
@@ -702,11 +781,9 @@ CKltTrackerOp::selectGoodFeatures()
                 
          unsigned char mask_i = 255;
                 
-         while (m_eigenvalueVector.size() > 0)
+         while ( popCandidate ( eigenvalue ) )
          {
-            eigenvalue = m_eigenvalueVector.back();
             mask_i = m_featureMask.at<uint8_t>(eigenvalue.y,eigenvalue.x);
-            m_eigenvalueVector.pop_back();
                     
             if ( !mask_i )
                break;
@@ -739,14 +816,14 @@ CKltTrackerOp::selectGoodFeatures()
                }
             }
 
-                m_featureVector[i].u     = eigenvalue.x*downScale_i;
-                m_featureVector[i].v     = eigenvalue.y*downScale_i;
-            m_featureVector[i].d     = -1;
-            m_featureVector[i].f     = imgNr_u;
-            m_featureVector[i].t     = 0;
-            m_featureVector[i].state = SFeature::FS_NEW;
+            m_featureArray.getPosition(i)  = cv::Point2f ( eigenvalue.x*downScale_i,
+                                                           eigenvalue.y*downScale_i );
+            m_featureArray.getDisparity(i) = -1;
+            m_featureArray.getFrame(i)     = imgNr_u;
+            m_featureArray.getAge(i)       = 0;
+            m_featureArray.getState(i)     = SFeature::FS_NEW;
 
-                addedPts_v.push_back(cv::Point2f(m_featureVector[i].u, m_featureVector[i].v));
+            addedPts_v.push_back(m_featureArray.getPosition(i));
             addedIdx_v.push_back (i);
          }
          else
@@ -771,10 +848,7 @@ CKltTrackerOp::selectGoodFeatures()
                                            m_subPixEPS_f) );
       
       for(size_t i = 0; i < addedPts_v.size(); ++i) 
-      {
-         m_featureVector[addedIdx_v[i]].u = addedPts_v[i].x;
-         m_featureVector[addedIdx_v[i]].v = addedPts_v[i].y;
-      }
+         m_featureArray.getPosition(addedIdx_v[i]) = addedPts_v[i];
       stopClock ("Select Good Features - Sub-pixel");
    }
    
@@ -782,16 +856,155 @@ CKltTrackerOp::selectGoodFeatures()
    // with new features with uninitialized states.
    for (; i < m_numFeatures_i; ++i)
    {
-      if ( m_featureVector[i].state == SFeature::FS_LOST || 
-           m_featureVector[i].state == SFeature::FS_UNINITIALIZED )
-      {
-         m_featureVector[i].state = SFeature::FS_UNINITIALIZED;
-      }
+      if ( !m_featureArray.isActive(i) )
+         m_featureArray.getState(i) = SFeature::FS_UNINITIALIZED;
    }
    stopClock ("Select Good Features - New Feature Selection");
 }    
 
 
+bool
+CKltTrackerOp::betterCandidate ( const SEigenvalue & f_a, 
+                                 const SEigenvalue & f_b )
+{
+   if ( f_a.eigenvalue != f_b.eigenvalue )
+      return f_a.eigenvalue > f_b.eigenvalue;
+
+   return f_a.y < f_b.y || ( f_a.y == f_b.y && f_a.x < f_b.x );
+}
+
+bool
+CKltTrackerOp::worseTileCandidate ( const STileCandidate & f_a, 
+                                    const STileCandidate & f_b )
+{
+   return betterCandidate ( f_b.candidate, f_a.candidate );
+}
+
+/// Collect candidates per tile and keep the best ones of each tile sorted.
+/// Only the number of needed features is sorted initially; tiles are 
+/// sorted further on demand in popCandidate, so that the selection order
+/// is the same as sorting all candidates.
+void
+CKltTrackerOp::collectCandidates ( float f_threshold_f,
+                                   int   f_numNeeded_i )
+{
+   const int border_i   = 2;
+   const int tileSize_i = KLT_SELECTION_TILE_SIZE;
+   const int width_i    = m_eigenImg.cols - 2 * border_i;
+   const int height_i   = m_eigenImg.rows - 2 * border_i;
+
+   m_candidateHeap_v.clear();
+
+   if ( f_numNeeded_i <= 0 || width_i <= 0 || height_i <= 0 )
+      return;
+
+   const int tilesX_i   = ( width_i  + tileSize_i - 1 ) / tileSize_i;
+   const int tilesY_i   = ( height_i + tileSize_i - 1 ) / tileSize_i;
+   const int numTiles_i = tilesX_i * tilesY_i;
+   const int chunk_i    = std::max ( f_numNeeded_i, KLT_MIN_CANDIDATE_CHUNK );
+
+   if ( (int) m_tileCandidates_v.size() < numTiles_i )
+      m_tileCandidates_v.resize ( numTiles_i );
+
+   m_tileSorted_v.assign ( numTiles_i, 0 );
+   m_tileNext_v.assign   ( numTiles_i, 0 );
+
+#if defined ( _OPENMP )
+#pragma omp parallel for schedule(dynamic)
+#endif
+   for (int t = 0; t < numTiles_i; ++t)
+   {
+      std::vector<SEigenvalue> & cand_v = m_tileCandidates_v[t];
+      cand_v.clear();
+
+      const int x0_i = border_i + ( t % tilesX_i ) * tileSize_i;
+      const int y0_i = border_i + ( t / tilesX_i ) * tileSize_i;
+      const int x1_i = std::min ( x0_i + tileSize_i, border_i + width_i  );
+      const int y1_i = std::min ( y0_i + tileSize_i, border_i + height_i );
+
+      for (int i = y0_i; i < y1_i; ++i)
+      {
+         const float *         eigenvalue_p = &m_eigenImg.at<float>(i,x0_i);
+         const unsigned char * mask_p       = &m_featureMask.at<uint8_t>(i,x0_i);
+           
+         for ( int j = x0_i; j < x1_i; ++j, ++eigenvalue_p, ++mask_p )
+         {
+            if ( *eigenvalue_p > f_threshold_f &&
+                 ! (*mask_p) )
+            { 
+               cand_v.push_back ( SEigenvalue( j, i, *eigenvalue_p ) );
+            }
+         }            
+      }
+
+      sortTileCandidates ( t, chunk_i );
+   }
+
+   for (int t = 0; t < numTiles_i; ++t)
+   {
+      if ( m_tileSorted_v[t] > 0 )
+      {
+         STileCandidate head;
+         head.candidate = m_tileCandidates_v[t][0];
+         head.tile_i    = t;
+         m_candidateHeap_v.push_back ( head );
+      }
+   }
+
+   std::make_heap ( m_candidateHeap_v.begin(), m_candidateHeap_v.end(), worseTileCandidate );
+}
+
+void
+CKltTrackerOp::sortTileCandidates ( int f_tile_i,
+                                    int f_count_i )
+{
+   std::vector<SEigenvalue> & cand_v = m_tileCandidates_v[f_tile_i];
+
+   const int first_i = m_tileSorted_v[f_tile_i];
+   const int count_i = std::min ( f_count_i, (int) cand_v.size() - first_i );
+
+   if ( count_i <= 0 ) return;
+
+   std::vector<SEigenvalue>::iterator first = cand_v.begin() + first_i;
+   std::vector<SEigenvalue>::iterator last  = first + count_i;
+
+   if ( last != cand_v.end() )
+      std::nth_element ( first, last, cand_v.end(), betterCandidate );
+
+   std::sort ( first, last, betterCandidate );
+
+   m_tileSorted_v[f_tile_i] += count_i;
+}
+
+bool
+CKltTrackerOp::popCandidate ( SEigenvalue & fr_candidate )
+{
+   if ( m_candidateHeap_v.empty() )
+      return false;
+
+   std::pop_heap ( m_candidateHeap_v.begin(), m_candidateHeap_v.end(), worseTileCandidate );
+
+   const int t = m_candidateHeap_v.back().tile_i;
+   fr_candidate = m_candidateHeap_v.back().candidate;
+   m_candidateHeap_v.pop_back();
+
+   /// Sort twice as many candidates of the tile if its sorted ones 
+   /// are exhausted.
+   if ( ++m_tileNext_v[t] == m_tileSorted_v[t] )
+      sortTileCandidates ( t, m_tileSorted_v[t] );
+
+   if ( m_tileNext_v[t] < m_tileSorted_v[t] )
+   {
+      STileCandidate head;
+      head.candidate = m_tileCandidates_v[t][m_tileNext_v[t]];
+      head.tile_i    = t;
+      m_candidateHeap_v.push_back ( head );
+      std::push_heap ( m_candidateHeap_v.begin(), m_candidateHeap_v.end(), worseTileCandidate );
+   }
+
+   return true;
+}
+
 /// Show event.
 bool CKltTrackerOp::show()
 {
@@ -813,16 +1026,19 @@ bool CKltTrackerOp::show()
 
    if ( list_p -> isVisible())
    {
-      for(size_t i = 0; i < m_featureVector.size(); i++) 
+      for(size_t i = 0; i < m_featureArray.size(); i++) 
       {
          if ( m_selectedIdx_i == i && 
-              ( m_featureVector[i].state != SFeature::FS_TRACKED ) )
+              ( m_featureArray.getState(i) != SFeature::FS_TRACKED ) )
             m_selectedIdx_i = -1;
 
-         if (m_featureVector[i].state == SFeature::FS_TRACKED)
+         if (m_featureArray.getState(i) == SFeature::FS_TRACKED)
          {
-            double dx = m_featureVector[i].u - m_prevFeatureVector[i].u;
-            double dy = m_featureVector[i].v - m_prevFeatureVector[i].v;
+            const cv::Point2f & curr = m_featureArray.getPosition(i);
+            const cv::Point2f & prev = m_prevPts_v[i];
+
+            double dx = curr.x - prev.x;
+            double dy = curr.y - prev.y;
             
             double sqDist_d = dx*dx+dy*dy;
             
@@ -830,8 +1046,8 @@ bool CKltTrackerOp::show()
             {
                list_p -> setLineWidth (1);
                list_p -> setLineColor (SRgb(255,255,255));
-               list_p -> addCross ( m_featureVector[i].u, 
-                                    m_featureVector[i].v,
+               list_p -> addCross ( curr.x, 
+                                    curr.y,
                                     m_kernelSize_i/2. );
                list_p -> setLineWidth (5);
             }
@@ -848,27 +1064,27 @@ bool CKltTrackerOp::show()
             list_p -> setFillColor (SRgba(color,120));
          
          
-            list_p -> addSquare ( m_featureVector[i].u, 
-                                  m_featureVector[i].v,
+            list_p -> addSquare ( curr.x, 
+                                  curr.y,
                                   m_kernelSize_i/2. );
 
-            list_p -> addLine( m_featureVector[i].u, 
-                               m_featureVector[i].v,
-                               m_prevFeatureVector[i].u, 
-                               m_prevFeatureVector[i].v );
+            list_p -> addLine( curr.x, 
+                               curr.y,
+                               prev.x, 
+                               prev.y );
 
             if (list2_p->isVisible())
             {
                list2_p -> setLineColor (color);
                list2_p -> setFillColor (SRgba(color,120));
                list2_p -> setLineWidth (2);
-               list2_p -> addSquare ( m_prevFeatureVector[i].u, 
-                                      m_prevFeatureVector[i].v,
+               list2_p -> addSquare ( prev.x, 
+                                      prev.y,
                                       m_kernelSize_i/2. );
-               list2_p -> addLine( m_featureVector[i].u, 
-                                   m_featureVector[i].v,
-                                   m_prevFeatureVector[i].u, 
-                                   m_prevFeatureVector[i].v );
+               list2_p -> addLine( curr.x, 
+                                   curr.y,
+                                   prev.x, 
+                                   prev.y );
             }
             
          }
@@ -923,12 +1139,16 @@ bool CKltTrackerOp::initialize()
         setScreenSize ( img.size() );
     }
 
-    m_featureVector.clear();
-    m_featureVector.resize( m_numFeatures_i );
-    m_prevFeatureVector = m_featureVector;
+    m_featureArray.clear();
+    m_featureArray.resize( m_numFeatures_i );
+    m_prevPts_v = m_featureArray.getPositions();
+    m_featureArray.exportVector ( m_featureVector );
 
     m_currImg = cv::Mat();
     m_prevImg = cv::Mat();
+
+    m_currPyr_v.clear();
+    m_prevPyr_v.clear();
     
     return COperator::initialize();
 }
@@ -980,13 +1200,12 @@ CKltTrackerOp::mouseMoved ( CMouseEvent * f_event_p )
 
            m_selectedIdx_i = -1;
 
-           for(size_t i = 0; i < m_featureVector.size(); i++) 
+           for(size_t i = 0; i < m_featureArray.size(); i++) 
            {
-              if ( m_featureVector[i].state == SFeature::FS_TRACKED || 
-                   m_featureVector[i].state == SFeature::FS_NEW )
+              if ( m_featureArray.isActive(i) )
               {
-                 double dx = m_featureVector[i].u - imgPosU_d;
-                 double dy = m_featureVector[i].v - imgPosV_d;
+                 double dx = m_featureArray.getPosition(i).x - imgPosU_d;
+                 double dy = m_featureArray.getPosition(i).y - imgPosV_d;
 
                  double dist_d = sqrt(dx*dx+dy*dy);
                  
@@ -47,12 +47,18 @@
 
 #include "operator.h"
 #include "colorEncoding.h"
+#include "imagePyramid.h"
+#include "lucasKanadeTracker.h"
 
 #include "feature.h"
+#include "featureArray.h"
+#include "featureGrid.h"
 
 /* PROTOTYPES */
 
 /* CONSTANTS */
+#define KLT_SELECTION_TILE_SIZE    64
+#define KLT_MIN_CANDIDATE_CHUNK    32
 
 namespace QCV
 {
@@ -98,6 +104,7 @@ namespace QCV
 
         ADD_PARAM_ACCESS (std::string,  m_inpImageId_str,          InputImageIdStr );
         ADD_PARAM_ACCESS (std::string,  m_featPointVector_str,     FeaturePointVectorId );
+        ADD_PARAM_ACCESS (std::string,  m_featPointArray_str,      FeaturePointArrayId );
         ADD_PARAM_ACCESS (bool,         m_compute_b,               Compute );
         ADD_PARAM_ACCESS (int,          m_numFeatures_i,           NumFeatures );
 	ADD_PARAM_ACCESS (int,          m_subPixBlockSize_i,       SubPixBlockSize );
@@ -111,6 +118,9 @@ namespace QCV
         ADD_PARAM_ACCESS (float,        m_pyrLKEpsilon_f,          PyrLKEpsilon );      
         ADD_PARAM_ACCESS (int,          m_pyrLKMaxCount_i,         PyrLKMaxCount );
         ADD_PARAM_ACCESS (bool,         m_usePrediction_b,         UsePrediction );
+        ADD_PARAM_ACCESS (bool,         m_nativeLK_b,              NativeLK );
+        ADD_PARAM_ACCESS (bool,         m_fbCheck_b,               ForwardBackwardCheck );
+        ADD_PARAM_ACCESS (float,        m_maxFBError_f,            MaxForwardBackwardError );
         ADD_PARAM_ACCESS (float,        m_maxSqDist4Collision_f,   MaxSqDist4Collision );
         ADD_PARAM_ACCESS (bool,         m_preFilter_b,             PreFilter);
         ADD_PARAM_ACCESS (int,          m_pFMaskSize_i,            PreFilterMaskSize);
@@ -129,6 +139,11 @@ namespace QCV
            return &m_featureVector;
        }
 
+       CFeatureArray * getFeatureArray ()
+       {
+           return &m_featureArray;
+       }
+
        cv::Mat &getCurrentImage() 
        {
           return m_currImg;
@@ -138,6 +153,11 @@ namespace QCV
        {
           return m_prevImg;
        }
+
+       CImagePyramid &getCurrentPyramid() 
+       {
+          return m_pyramid;
+       }
        
     /// Help methods
     protected:
@@ -147,6 +167,17 @@ namespace QCV
         void registerParameters(  );
 
         void selectGoodFeatures();
+
+        void removeCollisions();
+
+        /// Build the optical flow pyramid of the current image reusing
+        /// the one of the previous image.
+        void buildPyramids();
+
+        /// Collect the candidates of each tile of the eigenvalue image and
+        /// sort the best ones.
+        void collectCandidates ( float f_threshold_f,
+                                 int   f_numNeeded_i );
        
     /// Protected data types
     protected:
@@ -187,6 +218,28 @@ namespace QCV
 
         };
 
+       /// Best not yet selected candidate of a tile.
+       struct STileCandidate
+       {
+          SEigenvalue candidate;
+          int         tile_i;
+       };
+
+    private:
+       /// Strict candidate order: decreasing eigenvalue, then raster order.
+       static bool betterCandidate ( const SEigenvalue & f_a, 
+                                     const SEigenvalue & f_b );
+
+       static bool worseTileCandidate ( const STileCandidate & f_a, 
+                                        const STileCandidate & f_b );
+
+       /// Sort the next f_count_i best candidates of a tile.
+       void sortTileCandidates ( int f_tile_i,
+                                 int f_count_i );
+
+       /// Next best candidate of all tiles.
+       bool popCandidate ( SEigenvalue & fr_candidate );
+
     private:
         
         /// Input image Id.
@@ -195,6 +248,9 @@ namespace QCV
         /// Feature Vector Input String
         std::string                         m_featPointVector_str;
 
+        /// Feature Array Output String
+        std::string                         m_featPointArray_str;
+
         /// Compute
         bool                                m_compute_b;                                            
 
@@ -204,6 +260,18 @@ namespace QCV
         /// Input previous image                     
         cv::Mat                             m_prevImg;
 
+        /// Optical flow pyramid (with derivatives) of the current image.
+        std::vector<cv::Mat>                m_currPyr_v;
+
+        /// Optical flow pyramid (with derivatives) of the previous image.
+        std::vector<cv::Mat>                m_prevPyr_v;
+
+        /// Kernel size and levels used for building the pyramids.
+        S2D<int>                            m_pyrParams;
+
+        /// Image levels of the current pyramid (output).
+        CImagePyramid                       m_pyramid;
+
         /// Eigenvalue image.
         cv::Mat                             m_eigenImg;
        
@@ -240,6 +308,12 @@ namespace QCV
         /// Max squared distance to check collisions
         float                               m_maxSqDist4Collision_f;
 
+        /// Grid of the alive features for collision detection
+        CFeatureGrid                        m_collisionGrid;
+
+        /// Colliding features of the current query
+        std::vector<int>                    m_neighbors_v;
+
         /// Kernel size for tracking
 	int                                 m_kernelSize_i;
         
@@ -252,6 +326,18 @@ namespace QCV
         /// Use prediction to track features
         bool                                m_usePrediction_b;
 
+        /// Use the native LK implementation instead of OpenCV's
+        bool                                m_nativeLK_b;
+
+        /// Reject features failing the forward-backward check (native LK)
+        bool                                m_fbCheck_b;
+
+        /// Max forward-backward error [px]
+        float                               m_maxFBError_f;
+
+        /// Native pyramidal LK tracker
+        CLucasKanadeTracker                 m_lkTracker;
+
        /// Min eigenvalue to consider for detection
         float                               m_minEigenvalue_f;
 
@@ -267,14 +353,35 @@ namespace QCV
         /// Epsilon for subpixel estimation
         float                               m_subPixEPS_f;       
 
-        /// Previous set of tracked features
-        CFeatureVector                      m_prevFeatureVector;
+        /// Positions of the features in the previous image.
+        std::vector<cv::Point2f>            m_prevPts_v;
 
         /// Current set of tracked features
+        CFeatureArray                       m_featureArray;
+
+        /// Current set of tracked features as array of structures (output)
         CFeatureVector                      m_featureVector;
 
-        /// Vector of selected eigenvalues.
-        std::vector< SEigenvalue >           m_eigenvalueVector;
+        /// Features to track in the current cycle.
+        std::vector<unsigned char>          m_trackMask_v;
+
+        /// Tracking status of each feature.
+        std::vector<unsigned char>          m_trackStatus_v;
+
+        /// Tracking error of each feature.
+        std::vector<float>                  m_trackError_v;
+
+        /// Candidates above threshold of each tile of the eigenvalue image.
+        std::vector< std::vector< SEigenvalue > > m_tileCandidates_v;
+
+        /// Number of sorted candidates at the front of each tile.
+        std::vector< int >                   m_tileSorted_v;
+
+        /// Next candidate to select of each tile.
+        std::vector< int >                   m_tileNext_v;
+
+        /// Heap with the next candidate of each tile.
+        std::vector< STileCandidate >        m_candidateHeap_v;
 
        /// Search good fatures to track (thresholding min eigenvalue) or harris detector
        bool                                  m_detectGFTT_b;
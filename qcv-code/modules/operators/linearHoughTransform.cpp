@@ -36,18 +36,182 @@
 /* INCLUDES */
 #include "parameterSet.h"
 #include "dbl2DParam.h"
+#include "boolParam.h"
+#include "enumParam.h"
 #include "paramBaseConnector.h"
 #include "linearHoughTransform.h"
  
 #include <math.h>
+#include <algorithm>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 #define NORMALIZE_ANGLE(d) (d)+((d)<0?(((int)(1-(d)/(M_PI)))*(M_PI)):(d)>M_PI?-(((int)((d)/(M_PI)))*(M_PI)):0)
 
+/// Fractional bits of the fixed point splatting.
+#define LHT_FIXED_POINT_BITS 8
+
+/// Fractional bits of the votes in a 16 bit accumulator.
+#define LHT_UINT16_FIXED_POINT_BITS 4
+
+/// Tile size for peak extraction.
+#define LHT_PEAK_TILE_SIZE 64
+
+/// Minimum number of points per thread for batch accumulation.
+#define LHT_MIN_POINTS_PER_THREAD 512
+
 using namespace QCV;
 
+/// Row coordinates in the accumulator of the sinusoid of point (x,y) for
+/// the theta columns [j0,j1].
+static inline void computeRows ( const float         f_x_f,
+                                 const float         f_y_f,
+                                 const float * const f_cos_p,
+                                 const float * const f_sin_p,
+                                 const float         f_offset_f,
+                                 const int           f_j0_i,
+                                 const int           f_j1_i,
+                                 float * const       fr_rows_p )
+{
+    int j = f_j0_i;
+
+#if defined ( __SSE2__ )
+    const __m128 x      = _mm_set1_ps ( f_x_f );
+    const __m128 y      = _mm_set1_ps ( f_y_f );
+    const __m128 offset = _mm_set1_ps ( f_offset_f );
+
+    for (; j + 3 <= f_j1_i; j += 4)
+    {
+        const __m128 r = _mm_add_ps ( _mm_add_ps ( _mm_mul_ps ( x, _mm_loadu_ps ( f_cos_p + j ) ),
+                                                   _mm_mul_ps ( y, _mm_loadu_ps ( f_sin_p + j ) ) ),
+                                      offset );
+        _mm_storeu_ps ( fr_rows_p + j, r );
+    }
+#endif
+
+    for (; j <= f_j1_i; ++j)
+        fr_rows_p[j] = f_x_f * f_cos_p[j] + f_y_f * f_sin_p[j] + f_offset_f;
+}
+
+/// Bilinear splatting of the segment from p1 to p2 (same sampling as 
+/// addPoint). Only the first sample updates its upper row.
+static inline void splatSegment ( float * const f_accum_p,
+                                  const int     f_step_i,
+                                  const int     f_width_i,
+                                  const int     f_height_i,
+                                  const float   f_p1x_f,
+                                  const float   f_p1y_f,
+                                  const float   f_p2x_f,
+                                  const float   f_p2y_f,
+                                  const float   f_value_f,
+                                  const int     /*f_bits_i*/ )
+{
+    const int   dist_i = (int)fabsf(f_p1y_f-f_p2y_f)+1;
+    const float dx_f   = (f_p2x_f-f_p1x_f)/dist_i;
+    const float dy_f   = (f_p2y_f-f_p1y_f)/dist_i;
+
+    for (int i = 0; i < dist_i; ++i)
+    {
+        const float px_f = f_p1x_f + i * dx_f;
+        const float py_f = f_p1y_f + i * dy_f;
+        const int   ix_i = (int)px_f;
+        const int   iy_i = (int)py_f;
+
+        if ( iy_i < f_height_i-1 && iy_i >= 0 && 
+             ix_i < f_width_i-1  && ix_i >= 0 )
+        {
+            const float f1_f  = px_f - ix_i;
+            const float f2_f  = py_f - iy_i;
+            const float top_f = (i == 0) ? f_value_f * (1.f-f2_f) : 0.f;
+            const float bot_f = f_value_f * f2_f;
+
+            float * const p_p = f_accum_p + iy_i * f_step_i + ix_i;
+
+            p_p[0]          += top_f * (1.f-f1_f);
+            p_p[1]          += top_f * f1_f;
+            p_p[f_step_i]   += bot_f * (1.f-f1_f);
+            p_p[f_step_i+1] += bot_f * f1_f;
+        }
+    }
+}
+
+/// Orders intervals by their lower limit.
+static inline bool lessIntervalMin ( const S2D<float> & f_a, const S2D<float> & f_b )
+{
+    return f_a.min < f_b.min;
+}
+
+/// Adds a fixed point vote to an accumulator cell.
+static inline void addVote ( int & fr_cell_i, const int f_vote_i )
+{
+    fr_cell_i += f_vote_i;
+}
+
+/// Adds a fixed point vote to a 16 bit cell, saturating the result.
+static inline void addVote ( unsigned short & fr_cell_i, const int f_vote_i )
+{
+    const int sum_i = fr_cell_i + f_vote_i;
+    fr_cell_i = sum_i > 65535 ? 65535 : sum_i;
+}
+
+/// Fixed point version of the splatting above. The value and the 
+/// bilinear weights have f_bits_i fractional bits.
+template <typename AccumType_>
+static inline void splatSegment ( AccumType_ * const f_accum_p,
+                                  const int          f_step_i,
+                                  const int          f_width_i,
+                                  const int          f_height_i,
+                                  const float        f_p1x_f,
+                                  const float        f_p1y_f,
+                                  const float        f_p2x_f,
+                                  const float        f_p2y_f,
+                                  const float        f_value_f,
+                                  const int          f_bits_i )
+{
+    const int   one_i   = 1 << f_bits_i;
+    const int   half_i  = one_i >> 1;
+    const int   value_i = (int)(f_value_f * one_i + .5f);
+    const int   dist_i  = (int)fabsf(f_p1y_f-f_p2y_f)+1;
+    const float dx_f    = (f_p2x_f-f_p1x_f)/dist_i;
+    const float dy_f    = (f_p2y_f-f_p1y_f)/dist_i;
+
+    for (int i = 0; i < dist_i; ++i)
+    {
+        const float px_f = f_p1x_f + i * dx_f;
+        const float py_f = f_p1y_f + i * dy_f;
+        const int   ix_i = (int)px_f;
+        const int   iy_i = (int)py_f;
+
+        if ( iy_i < f_height_i-1 && iy_i >= 0 && 
+             ix_i < f_width_i-1  && ix_i >= 0 )
+        {
+            const int f1_i  = (int)((px_f - ix_i) * one_i + .5f);
+            const int f2_i  = (int)((py_f - iy_i) * one_i + .5f);
+            const int top_i = (i == 0) ? (value_i * (one_i-f2_i) + half_i) >> f_bits_i : 0;
+            const int bot_i = (value_i * f2_i + half_i) >> f_bits_i;
+
+            AccumType_ * const p_p = f_accum_p + iy_i * f_step_i + ix_i;
+
+            addVote ( p_p[0],          (top_i * (one_i-f1_i) + half_i) >> f_bits_i );
+            addVote ( p_p[1],          (top_i * f1_i         + half_i) >> f_bits_i );
+            addVote ( p_p[f_step_i],   (bot_i * (one_i-f1_i) + half_i) >> f_bits_i );
+            addVote ( p_p[f_step_i+1], (bot_i * f1_i         + half_i) >> f_bits_i );
+        }
+    }
+}
+
 CLinearHoughTransform::CLinearHoughTransform() 
         : m_accumImg (                         ),
           m_auxImg (                           ),
+          m_fixedPointSplat_b (           false ),
+          m_accumType_e (            AT_FLOAT32 ),
+          m_useWindows_b (                false ),
           m_theta (                   0., M_PI ),
           m_range (                  -400, 400 ),
           m_scale (              M_PI/180., 1. ),
@@ -65,6 +229,9 @@ CLinearHoughTransform::CLinearHoughTransform( double f_minTheta_d,
                                               double f_rangeScale_d )
         : m_accumImg (                                    ),
           m_auxImg (                                      ),
+          m_fixedPointSplat_b (                      false ),
+          m_accumType_e (                       AT_FLOAT32 ),
+          m_useWindows_b (                           false ),
           m_theta (            f_minTheta_d, f_maxTheta_d ),
           m_range (            f_minRange_d, f_maxRange_d ),
           m_scale (        f_thetaScale_d, f_rangeScale_d ),
@@ -80,6 +247,9 @@ CLinearHoughTransform::CLinearHoughTransform( S2D<double> f_theta,
                                               S2D<double> f_scale )
         : m_accumImg (                         ),
           m_auxImg (                           ),
+          m_fixedPointSplat_b (           false ),
+          m_accumType_e (            AT_FLOAT32 ),
+          m_useWindows_b (                false ),
           m_theta (                    f_theta ),
           m_range (                    f_range ),
           m_scale (                    f_scale ),
@@ -295,58 +465,142 @@ CLinearHoughTransform::getRangeScale ( ) const
     return m_scale.y;
 }
 
+bool
+CLinearHoughTransform::setFixedPointSplat ( bool f_val_b )
+{
+    m_fixedPointSplat_b = f_val_b;
+    return true;
+}
+
+bool
+CLinearHoughTransform::getFixedPointSplat ( ) const
+{
+    return m_fixedPointSplat_b;
+}
+
+bool
+CLinearHoughTransform::setAccumulatorType ( EAccumulatorType f_type_e )
+{
+    if ( m_accumType_e != f_type_e )
+    {
+        freeAccumulator(); 
+        m_accumType_e = f_type_e;
+        allocateAccumulator();
+    }
+
+    return true;
+}
+
+CLinearHoughTransform::EAccumulatorType
+CLinearHoughTransform::getAccumulatorType ( ) const
+{
+    return m_accumType_e;
+}
+
+float
+CLinearHoughTransform::getAccumulatorScale ( ) const
+{
+    if ( m_accumType_e == AT_FLOAT32 )
+        return 1.f;
+
+    return 1 << getFixedPointBits();
+}
+
+int
+CLinearHoughTransform::getFixedPointBits ( ) const
+{
+    if ( m_accumType_e == AT_UINT16 )
+        return LHT_UINT16_FIXED_POINT_BITS;
+
+    return LHT_FIXED_POINT_BITS;
+}
+
 /// Free acumulator
 void
 CLinearHoughTransform::freeAccumulator()
 {
     m_cosLUV.resize(0);
     m_sinLUV.resize(0);
+    m_cosRowLUV.resize(0);
+    m_sinRowLUV.resize(0);
+
+    /// Windows refer to the old accumulator geometry.
+    clearVotingWindows();
 }
 
 /// Allocate acumulator
 void
 CLinearHoughTransform::allocateAccumulator()
 {
+    const int type_i = ( m_accumType_e == AT_UINT16 ? CV_16UC1 :
+                         m_accumType_e == AT_INT32  ? CV_32SC1 : CV_32FC1 );
+
     m_accumImg = cv::Mat( (m_range.max-m_range.min)/m_scale.y + .5,
                           (m_theta.max-m_theta.min)/m_scale.x + .5,
-                          CV_32FC1);                          
+                          type_i);                          
 
-    m_auxImg = cv::Mat::zeros( m_accumImg.size(),
-                               CV_32FC1);
+    /// The auxiliary image is allocated on demand.
+    m_auxImg = cv::Mat();
 
     m_cosLUV.resize(m_accumImg.size().width);
     m_sinLUV.resize(m_accumImg.size().width);
+    m_cosRowLUV.resize(m_accumImg.size().width);
+    m_sinRowLUV.resize(m_accumImg.size().width);
 
     for (int j = 0; j < m_accumImg.size().width; ++j)
     {
         double theta_d =  m_theta.min + j * m_scale.x;
         m_cosLUV[j] = cos( theta_d );
         m_sinLUV[j] = sin( theta_d );
+        m_cosRowLUV[j] = m_cosLUV[j] / m_scale.y;
+        m_sinRowLUV[j] = m_sinLUV[j] / m_scale.y;
     }
 }
 
 cv::Mat
 CLinearHoughTransform::getAccumulatorImage() const
 {
-    return m_accumImg;
+    if ( m_accumImg.type() == CV_32FC1 )
+        return m_accumImg;
+
+    cv::Mat img;
+    m_accumImg.convertTo ( img, CV_32FC1, 1./getAccumulatorScale() );
+    return img;
 }
 
 cv::Mat &
 CLinearHoughTransform::getAccumulatorImageReference() 
 {
-    return m_accumImg;
+    if ( m_accumImg.type() == CV_32FC1 )
+        return m_accumImg;
+
+    m_accumImg.convertTo ( m_auxImg, CV_32FC1, 1./getAccumulatorScale() );
+    return m_auxImg;
+}
+
+cv::Size
+CLinearHoughTransform::getAccumulatorSize() const
+{
+    return m_accumImg.size();
 }
 
 void
 CLinearHoughTransform::clear()
 {
-    m_auxImg   = cv::Mat::zeros(m_auxImg.size(),   CV_32FC1);
-    m_accumImg = cv::Mat::zeros(m_accumImg.size(), CV_32FC1);
+    m_accumImg = cv::Mat::zeros(m_accumImg.size(), m_accumImg.type());
 }
 
 bool
 CLinearHoughTransform::compute ( )
 {
+    if ( m_accumImg.type() != CV_32FC1 )
+    {
+        m_accumImg.convertTo ( m_auxImg, CV_32FC1 );
+        cv::GaussianBlur( m_auxImg, m_auxImg, cv::Size(3,3), 0, 0, cv::BORDER_DEFAULT );
+        m_auxImg.convertTo ( m_accumImg, m_accumImg.type() );
+        return true;
+    }
+
     cv::GaussianBlur( m_accumImg, m_auxImg, cv::Size(3,3), 0, 0, cv::BORDER_DEFAULT );
     
     bool onlyApplyGauss_b = true;
@@ -393,6 +647,13 @@ CLinearHoughTransform::addPoint ( double f_x_d,
                                   double f_y_d,
                                   double f_weight_d )
 {
+    /// Integer accumulators are voted in fixed point.
+    if ( m_accumImg.type() != CV_32FC1 )
+    {
+        const float x_f = f_x_d, y_f = f_y_d, w_f = f_weight_d;
+        return accumulatePoints ( &x_f, &y_f, &w_f, NULL, NULL, 0, 1, 0. );
+    }
+
     cv::Size size = m_accumImg.size();
 
     S2D<float> p1, p2;
@@ -456,77 +717,21 @@ CLinearHoughTransform::addPoint ( double f_x_d,
                                   double f_expTheta_d,
                                   double f_deltaTheta_d )
 {
+    /// Integer accumulators are voted in fixed point.
+    if ( m_accumImg.type() != CV_32FC1 )
+    {
+        const float x_f = f_x_d, y_f = f_y_d, w_f = f_weight_d, t_f = f_expTheta_d;
+        return accumulatePoints ( &x_f, &y_f, &w_f, &t_f, NULL, 0, 1, f_deltaTheta_d );
+    }
+
     cv::Size size = m_accumImg.size();
 
     S2D<float> p1, p2;
 
-    //f_expTheta_d = NORMALIZE_ANGLE( f_expTheta_d );
-
-    /// Determine the limits of the image to update. Determine also
-    /// if two cycles are required because of a the circular sense of the 
-    /// accumulator.
-    double t1_d = f_expTheta_d - f_deltaTheta_d;
-    double t2_d = f_expTheta_d + f_deltaTheta_d;
-
-    //printf("x: %f y: %f f_expTheta_d = %f t1_d = %f t2_d = %f (violation t1: %i t2: %i)\n",
-    //       f_x_d, f_y_d, f_expTheta_d, t1_d, t2_d, (int)(m_theta.min > t1_d), (int)(m_theta.max < t2_d) );    
-
     int minJ[2];
     int maxJ[2];
-    int cycles_i = 1;
-    
-    minJ[0] = (std::max(t1_d, m_theta.min) - m_theta.min) / m_scale.x;
-    maxJ[0] = (std::min(t2_d, m_theta.max) - m_theta.min) / m_scale.x + .5;
-    
-    //printf("\tminJ[0] = %i maxJ[0] = %i\n", minJ[0], maxJ[0] );    
+    int cycles_i = getThetaWindows ( f_expTheta_d, f_deltaTheta_d, minJ, maxJ );
 
-    if ( (m_theta.min > t1_d && m_theta.max >= t2_d) ||
-         (m_theta.min <= t1_d && m_theta.max < t2_d) )
-    {
-        double nt1_d = NORMALIZE_ANGLE(t1_d);
-        double nt2_d = NORMALIZE_ANGLE(t2_d);
-        
-        //printf("\tnt1_d = %f nt2_d = %f\n", nt1_d, nt2_d );
-        
-        if ( m_theta.min >  t1_d  &&
-             m_theta.max >= t2_d  &&
-             m_theta.max >= nt1_d &&
-             m_theta.min <= nt1_d )
-        {
-            cycles_i = 2;
-            minJ[1] = (nt1_d - m_theta.min) / m_scale.x;
-            if (minJ[1] < 0 )
-                minJ[1] = 0;
-            maxJ[1] = size.width-1;
-
-            //printf("\tcase 1 minJ[1] = %i maxJ[1] = %i\n", minJ[1], maxJ[1] );    
-        }
-        else if ( m_theta.min <= t1_d  &&
-                  m_theta.max <  t2_d  &&
-                  m_theta.max >= nt2_d &&
-                  m_theta.min <= nt2_d )
-        {
-            cycles_i = 2;
-            minJ[1] = 0;
-            maxJ[1] = (nt2_d - m_theta.min) / m_scale.x + .5;
-            
-            if (maxJ[1] >= (signed) size.width )
-                maxJ[1] = size.width-1;
-            //printf("\tcase 2 minJ[1] = %i maxJ[1] = %i\n", minJ[1], maxJ[1] );    
-        }
-    }
-    
-
-    if (minJ[0] < 0 )
-        minJ[0] = 0;
-
-    if (maxJ[0] >= (signed) size.width )
-        maxJ[0] = size.width-1;
-
-    //printf("\tminJ[0] %i maxJ[0] %i diff = %i\n", minJ[0], maxJ[0], maxJ[0]-minJ[0]  );
-
-    
-    
     for (int l = 0; l < cycles_i; ++l)
     {
         for (int j = minJ[l]; j <= maxJ[l]; ++j)
@@ -590,6 +795,670 @@ CLinearHoughTransform::addPoint ( double f_x_d,
     return true;
 }
 
+/// Theta columns to update for an expected theta. Returns the number 
+/// of column intervals (2 if the interval wraps around the theta range).
+int
+CLinearHoughTransform::getThetaWindows ( double f_expTheta_d, 
+                                         double f_deltaTheta_d,
+                                         int    fr_minJ_p[2],
+                                         int    fr_maxJ_p[2] ) const
+{
+    cv::Size size = m_accumImg.size();
+
+    /// Determine the limits of the image to update. Determine also
+    /// if two cycles are required because of a the circular sense of the 
+    /// accumulator.
+    double t1_d = f_expTheta_d - f_deltaTheta_d;
+    double t2_d = f_expTheta_d + f_deltaTheta_d;
+
+    //printf("x: %f y: %f f_expTheta_d = %f t1_d = %f t2_d = %f (violation t1: %i t2: %i)\n",
+    //       f_x_d, f_y_d, f_expTheta_d, t1_d, t2_d, (int)(m_theta.min > t1_d), (int)(m_theta.max < t2_d) );    
+
+    int cycles_i = 1;
+    
+    fr_minJ_p[0] = (std::max(t1_d, m_theta.min) - m_theta.min) / m_scale.x;
+    fr_maxJ_p[0] = (std::min(t2_d, m_theta.max) - m_theta.min) / m_scale.x + .5;
+    
+    //printf("\tfr_minJ_p[0] = %i fr_maxJ_p[0] = %i\n", fr_minJ_p[0], fr_maxJ_p[0] );    
+
+    if ( (m_theta.min > t1_d && m_theta.max >= t2_d) ||
+         (m_theta.min <= t1_d && m_theta.max < t2_d) )
+    {
+        double nt1_d = NORMALIZE_ANGLE(t1_d);
+        double nt2_d = NORMALIZE_ANGLE(t2_d);
+        
+        //printf("\tnt1_d = %f nt2_d = %f\n", nt1_d, nt2_d );
+        
+        if ( m_theta.min >  t1_d  &&
+             m_theta.max >= t2_d  &&
+             m_theta.max >= nt1_d &&
+             m_theta.min <= nt1_d )
+        {
+            cycles_i = 2;
+            fr_minJ_p[1] = (nt1_d - m_theta.min) / m_scale.x;
+            if (fr_minJ_p[1] < 0 )
+                fr_minJ_p[1] = 0;
+            fr_maxJ_p[1] = size.width-1;
+
+            //printf("\tcase 1 fr_minJ_p[1] = %i fr_maxJ_p[1] = %i\n", fr_minJ_p[1], fr_maxJ_p[1] );    
+        }
+        else if ( m_theta.min <= t1_d  &&
+                  m_theta.max <  t2_d  &&
+                  m_theta.max >= nt2_d &&
+                  m_theta.min <= nt2_d )
+        {
+            cycles_i = 2;
+            fr_minJ_p[1] = 0;
+            fr_maxJ_p[1] = (nt2_d - m_theta.min) / m_scale.x + .5;
+            
+            if (fr_maxJ_p[1] >= (signed) size.width )
+                fr_maxJ_p[1] = size.width-1;
+            //printf("\tcase 2 fr_minJ_p[1] = %i fr_maxJ_p[1] = %i\n", fr_minJ_p[1], fr_maxJ_p[1] );    
+        }
+    }
+    
+
+    if (fr_minJ_p[0] < 0 )
+        fr_minJ_p[0] = 0;
+
+    if (fr_maxJ_p[0] >= (signed) size.width )
+        fr_maxJ_p[0] = size.width-1;
+
+    //printf("\tfr_minJ_p[0] %i fr_maxJ_p[0] %i diff = %i\n", fr_minJ_p[0], fr_maxJ_p[0], fr_maxJ_p[0]-fr_minJ_p[0]  );
+
+    return cycles_i;
+}
+
+bool
+CLinearHoughTransform::addPoints ( const float * const f_x_p,
+                                   const float * const f_y_p,
+                                   const float * const f_weight_p,
+                                   const int           f_n_i )
+{
+    return accumulatePoints ( f_x_p, f_y_p, f_weight_p, NULL, NULL, 0, f_n_i, 0. );
+}
+
+bool
+CLinearHoughTransform::addPoints ( const float * const f_x_p,
+                                   const float * const f_y_p,
+                                   const float * const f_weight_p,
+                                   const float * const f_expTheta_p,
+                                   const int           f_n_i,
+                                   const double        f_deltaTheta_d )
+{
+    return accumulatePoints ( f_x_p, f_y_p, f_weight_p, f_expTheta_p, NULL, 0, f_n_i, f_deltaTheta_d );
+}
+
+bool
+CLinearHoughTransform::addPoints ( const float * const          f_x_p,
+                                   const float * const          f_y_p,
+                                   const float * const          f_weight_p,
+                                   const unsigned short * const f_thetaBin_p,
+                                   const int                    f_numBins_i,
+                                   const int                    f_n_i,
+                                   const double                 f_deltaTheta_d )
+{
+    if ( f_numBins_i <= 0 )
+    {
+        printf("%s:%i Invalid number of orientation bins.\n", __FILE__, __LINE__ );
+        return false;
+    }
+
+    return accumulatePoints ( f_x_p, f_y_p, f_weight_p, NULL, f_thetaBin_p, f_numBins_i, f_n_i, f_deltaTheta_d );
+}
+
+/// Accumulates a batch of points. The points are split in contiguous 
+/// chunks, one per thread. Each thread votes in its own accumulator and 
+/// the accumulators are added to the main one at the end.
+bool
+CLinearHoughTransform::accumulatePoints ( const float * const          f_x_p,
+                                          const float * const          f_y_p,
+                                          const float * const          f_weight_p,
+                                          const float * const          f_expTheta_p,
+                                          const unsigned short * const f_thetaBin_p,
+                                          const int                    f_numBins_i,
+                                          const int                    f_n_i,
+                                          const double                 f_deltaTheta_d )
+{
+    if ( f_n_i <= 0 )
+        return true;
+
+    /// Theta columns of the orientation bins, for the bin centers.
+    if ( f_thetaBin_p )
+    {
+        m_binWindows_v.resize ( f_numBins_i );
+
+        for (int b = 0; b < f_numBins_i; ++b)
+        {
+            SThetaWindows & win = m_binWindows_v[b];
+            win.minJ_p[1] = win.maxJ_p[1] = 0;
+            win.cycles_i  = getThetaWindows ( ( b + .5 ) * M_PI / f_numBins_i, f_deltaTheta_d, 
+                                              win.minJ_p, win.maxJ_p );
+        }
+    }
+
+    const cv::Size size = m_accumImg.size();
+    const bool     fixedPoint_b = m_fixedPointSplat_b || m_accumType_e != AT_FLOAT32;
+    const int      bufferType_i = fixedPoint_b?CV_32SC1:CV_32FC1;
+
+#if defined ( _OPENMP )
+    const int numThreads_i = std::max(1, std::min( std::min(omp_get_max_threads(), LHT_MAX_CORES),
+                                                   f_n_i / LHT_MIN_POINTS_PER_THREAD ) );
+#else
+    const int numThreads_i = 1;
+#endif
+
+    /// A single thread votes directly in the accumulator, except for 
+    /// fixed point splatting in a float accumulator.
+    const bool direct_b = ( numThreads_i == 1 && 
+                            ( m_accumType_e != AT_FLOAT32 || !m_fixedPointSplat_b ) );
+
+    const int  voteType_i = direct_b?m_accumImg.type():bufferType_i;
+    
+    for (int t = 0; t < numThreads_i; ++t)
+    {
+        m_threadRows_p[t].resize ( size.width );
+
+        if ( !direct_b )
+        {
+            if ( m_threadAccum_p[t].size() != size ||
+                 m_threadAccum_p[t].type() != bufferType_i )
+                m_threadAccum_p[t] = cv::Mat ( size, bufferType_i );
+
+            m_threadAccum_p[t] = cv::Scalar(0);
+        }
+    }
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_i) schedule(static)
+#endif
+    for (int t = 0; t < numThreads_i; ++t)
+    {
+        const int first_i = (int)(((long long) f_n_i *  t   ) / numThreads_i);
+        const int last_i  = (int)(((long long) f_n_i * (t+1)) / numThreads_i);
+
+        cv::Mat & accum  = direct_b?m_accumImg:m_threadAccum_p[t];
+        float *   rows_p = &m_threadRows_p[t][0];
+
+        int minJ_p[2] = { 0, 0 };
+        int maxJ_p[2] = { size.width-1, 0 };
+        int cycles_i  = 1;
+
+        for (int p = first_i; p < last_i; ++p)
+        {
+            if ( f_expTheta_p )
+                cycles_i = getThetaWindows ( f_expTheta_p[p], f_deltaTheta_d, minJ_p, maxJ_p );
+            else if ( f_thetaBin_p )
+            {
+                const SThetaWindows & win = m_binWindows_v[std::min((int)f_thetaBin_p[p], f_numBins_i-1)];
+                cycles_i  = win.cycles_i;
+                minJ_p[0] = win.minJ_p[0]; minJ_p[1] = win.minJ_p[1];
+                maxJ_p[0] = win.maxJ_p[0]; maxJ_p[1] = win.maxJ_p[1];
+            }
+
+            if ( voteType_i == CV_32SC1 )
+                accumulatePoint<int>            ( f_x_p[p], f_y_p[p], f_weight_p[p], 
+                                                  cycles_i, minJ_p, maxJ_p, rows_p, accum );
+            else if ( voteType_i == CV_16UC1 )
+                accumulatePoint<unsigned short> ( f_x_p[p], f_y_p[p], f_weight_p[p], 
+                                                  cycles_i, minJ_p, maxJ_p, rows_p, accum );
+            else
+                accumulatePoint<float>          ( f_x_p[p], f_y_p[p], f_weight_p[p], 
+                                                  cycles_i, minJ_p, maxJ_p, rows_p, accum );
+        }
+    }
+
+    if ( direct_b )
+        return true;
+
+    /// Merge the thread accumulators.
+    const float fixedScale_f = 1.f / (1 << getFixedPointBits());
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_i) schedule(static)
+#endif
+    for (int i = 0; i < size.height; ++i)
+    {
+        for (int t = 0; t < numThreads_i; ++t)
+        {
+            if ( bufferType_i == CV_32FC1 )
+            {
+                float * const       dst_p = m_accumImg.ptr<float>(i);
+                const float * const src_p = m_threadAccum_p[t].ptr<float>(i);
+                for (int j = 0; j < size.width; ++j)
+                    dst_p[j] += src_p[j];
+            }
+            else if ( m_accumImg.type() == CV_32FC1 )
+            {
+                float * const     dst_p = m_accumImg.ptr<float>(i);
+                const int * const src_p = m_threadAccum_p[t].ptr<int>(i);
+                for (int j = 0; j < size.width; ++j)
+                    dst_p[j] += src_p[j] * fixedScale_f;
+            }
+            else if ( m_accumImg.type() == CV_32SC1 )
+            {
+                int * const       dst_p = m_accumImg.ptr<int>(i);
+                const int * const src_p = m_threadAccum_p[t].ptr<int>(i);
+                for (int j = 0; j < size.width; ++j)
+                    dst_p[j] += src_p[j];
+            }
+            else
+            {
+                unsigned short * const dst_p = m_accumImg.ptr<unsigned short>(i);
+                const int * const      src_p = m_threadAccum_p[t].ptr<int>(i);
+                for (int j = 0; j < size.width; ++j)
+                    addVote ( dst_p[j], src_p[j] );
+            }
+        }
+    }
+
+    return true;
+}
+
+/// Votes of a single point for the given theta column intervals.
+template <typename AccumType_>
+void
+CLinearHoughTransform::accumulatePoint ( float         f_x_f,
+                                         float         f_y_f,
+                                         float         f_weight_f,
+                                         const int     f_cycles_i,
+                                         const int     f_minJ_p[2],
+                                         const int     f_maxJ_p[2],
+                                         float *       fr_rows_p,
+                                         cv::Mat &     fr_accum ) const
+{
+    const int    width_i  = fr_accum.cols;
+    const int    height_i = fr_accum.rows;
+    const int    step_i   = fr_accum.step / sizeof(AccumType_);
+    const float  offset_f = -m_range.min / m_scale.y;
+    const int    bits_i   = getFixedPointBits();
+
+    AccumType_ * const accum_p = fr_accum.ptr<AccumType_>(0);
+
+    if ( m_useWindows_b )
+    {
+        accumulatePointInWindows<AccumType_> ( f_x_f, f_y_f, f_weight_f, 
+                                               f_cycles_i, f_minJ_p, f_maxJ_p, 
+                                               fr_rows_p, fr_accum );
+        return;
+    }
+
+    for (int l = 0; l < f_cycles_i; ++l)
+    {
+        computeRows ( f_x_f, f_y_f, 
+                      &m_cosRowLUV[0], &m_sinRowLUV[0], 
+                      offset_f, 
+                      f_minJ_p[l], f_maxJ_p[l], 
+                      fr_rows_p );
+
+        for (int j = f_minJ_p[l] + 1; j <= f_maxJ_p[l]; ++j)
+        {
+            const float i_f = fr_rows_p[j];
+
+            if ( i_f >= 0 && i_f < height_i )
+                splatSegment ( accum_p, step_i, width_i, height_i, 
+                               j, i_f, j-1, fr_rows_p[j-1], 
+                               f_weight_f, bits_i );
+        }
+    }
+}
+
+/// Votes of a single point restricted to the voting windows. Only 
+/// the column runs of the windows are evaluated and a segment is 
+/// splatted only if its end point lies in a row interval of the column.
+template <typename AccumType_>
+void
+CLinearHoughTransform::accumulatePointInWindows ( float         f_x_f,
+                                                  float         f_y_f,
+                                                  float         f_weight_f,
+                                                  const int     f_cycles_i,
+                                                  const int     f_minJ_p[2],
+                                                  const int     f_maxJ_p[2],
+                                                  float *       fr_rows_p,
+                                                  cv::Mat &     fr_accum ) const
+{
+    const int    width_i  = fr_accum.cols;
+    const int    height_i = fr_accum.rows;
+    const int    step_i   = fr_accum.step / sizeof(AccumType_);
+    const float  offset_f = -m_range.min / m_scale.y;
+    const int    bits_i   = getFixedPointBits();
+
+    AccumType_ * const accum_p = fr_accum.ptr<AccumType_>(0);
+
+    for (int l = 0; l < f_cycles_i; ++l)
+    {
+        for (unsigned int r = 0; r + 1 < m_winRuns_v.size(); r += 2)
+        {
+            const int lo_i = std::max(m_winRuns_v[r],   f_minJ_p[l]);
+            const int hi_i = std::min(m_winRuns_v[r+1], f_maxJ_p[l]);
+
+            if ( lo_i >= hi_i )
+                continue;
+
+            computeRows ( f_x_f, f_y_f, 
+                          &m_cosRowLUV[0], &m_sinRowLUV[0], 
+                          offset_f, 
+                          lo_i, hi_i, 
+                          fr_rows_p );
+
+            for (int j = lo_i + 1; j <= hi_i; ++j)
+            {
+                const float i_f = fr_rows_p[j];
+
+                for (int k = m_winColStart_v[j]; k < m_winColStart_v[j+1]; ++k)
+                {
+                    if ( i_f >= m_winRows_v[k].min && i_f <= m_winRows_v[k].max )
+                    {
+                        splatSegment ( accum_p, step_i, width_i, height_i, 
+                                       j, i_f, j-1, fr_rows_p[j-1], 
+                                       f_weight_f, bits_i );
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool
+CLinearHoughTransform::setVotingWindows ( const THoughWindowVector & f_windows_v )
+{
+    const cv::Size size = m_accumImg.size();
+
+    std::vector< std::vector< S2D<float> > > colIntervals_v ( size.width );
+
+    for (unsigned int w = 0; w < f_windows_v.size(); ++w)
+    {
+        const SHoughWindow & win = f_windows_v[w];
+
+        if ( win.theta.min > win.theta.max || win.range.min > win.range.max )
+        {
+            printf("%s:%i Invalid voting window %i\n", __FILE__, __LINE__, w);
+            return false;
+        }
+
+        addWindowIntervals ( win.theta.min, win.theta.max, 
+                             win.range.min, win.range.max, 
+                             colIntervals_v );
+        
+        /// Line (theta, range) is equal to line (theta +/- pi, -range).
+        if ( win.theta.min < m_theta.min )
+            addWindowIntervals ( win.theta.min + M_PI, win.theta.max + M_PI, 
+                                 -win.range.max, -win.range.min, 
+                                 colIntervals_v );
+
+        if ( win.theta.max > m_theta.max )
+            addWindowIntervals ( win.theta.min - M_PI, win.theta.max - M_PI, 
+                                 -win.range.max, -win.range.min, 
+                                 colIntervals_v );
+    }
+
+    /// Merge the intervals of each column and build the column runs.
+    m_winRuns_v.clear();
+    m_winRows_v.clear();
+    m_winColStart_v.resize ( size.width + 1 );
+
+    for (int j = 0; j < size.width; ++j)
+    {
+        std::vector< S2D<float> > & intervals_v = colIntervals_v[j];
+
+        m_winColStart_v[j] = m_winRows_v.size();
+
+        if ( intervals_v.empty() )
+            continue;
+
+        std::sort ( intervals_v.begin(), intervals_v.end(), lessIntervalMin );
+
+        S2D<float> current = intervals_v[0];
+        
+        for (unsigned int k = 1; k < intervals_v.size(); ++k)
+        {
+            if ( intervals_v[k].min <= current.max )
+                current.max = std::max(current.max, intervals_v[k].max);
+            else
+            {
+                m_winRows_v.push_back ( current );
+                current = intervals_v[k];
+            }
+        }
+
+        m_winRows_v.push_back ( current );
+
+        if ( !m_winRuns_v.empty() && m_winRuns_v.back() == j - 1 )
+            m_winRuns_v.back() = j;
+        else
+        {
+            m_winRuns_v.push_back ( j );
+            m_winRuns_v.push_back ( j );
+        }
+    }
+
+    m_winColStart_v[size.width] = m_winRows_v.size();
+
+    m_useWindows_b = true;
+
+    return true;
+}
+
+void
+CLinearHoughTransform::addWindowIntervals ( double                                f_minTheta_d,
+                                            double                                f_maxTheta_d,
+                                            double                                f_minRange_d,
+                                            double                                f_maxRange_d,
+                                            std::vector< std::vector< S2D<float> > > & fr_colIntervals_v ) const
+{
+    const cv::Size size = m_accumImg.size();
+
+    const int j0_i = std::max( (int)floor ( theta2Column ( f_minTheta_d ) ), 0 );
+    const int j1_i = std::min( (int)ceil  ( theta2Column ( f_maxTheta_d ) ), size.width - 1 );
+
+    const S2D<float> rows ( std::max( range2Row ( f_minRange_d ), 0. ),
+                            std::min( range2Row ( f_maxRange_d ), size.height - 1. ) );
+
+    if ( rows.min > rows.max )
+        return;
+
+    for (int j = j0_i; j <= j1_i; ++j)
+        fr_colIntervals_v[j].push_back ( rows );
+}
+
+void
+CLinearHoughTransform::clearVotingWindows ( )
+{
+    m_useWindows_b = false;
+    m_winRuns_v.clear();
+    m_winColStart_v.clear();
+    m_winRows_v.clear();
+}
+
+bool
+CLinearHoughTransform::hasVotingWindows ( ) const
+{
+    return m_useWindows_b;
+}
+
+/// Peak extraction. The accumulator is split in tiles that are 
+/// processed in parallel. Each tile is filtered with the 3x3 gaussian 
+/// kernel into a small buffer, where the 3x3 local maxima are searched.
+/// The strongest peaks of each tile are kept in a bounded heap and the
+/// heaps are merged at the end.
+bool
+CLinearHoughTransform::extractPeaks ( float              f_minValue_f,
+                                      int                f_border_i,
+                                      unsigned int       f_maxPeaks_ui,
+                                      THoughLineVector & fr_peaks_v )
+{
+    fr_peaks_v.clear();
+
+    /// The filtered neighbors of a peak require two pixels of border.
+    const int      border_i = std::max(f_border_i, 2);
+    const cv::Size size     = m_accumImg.size();
+    const int      w_i      = size.width  - 2 * border_i;
+    const int      h_i      = size.height - 2 * border_i;
+
+    if ( w_i <= 0 || h_i <= 0 )
+        return true;
+
+    const int tilesX_i = (w_i + LHT_PEAK_TILE_SIZE - 1) / LHT_PEAK_TILE_SIZE;
+    const int tilesY_i = (h_i + LHT_PEAK_TILE_SIZE - 1) / LHT_PEAK_TILE_SIZE;
+    const int tiles_i  = tilesX_i * tilesY_i;
+
+    m_tilePeaks_v.resize ( tiles_i );
+
+#if defined ( _OPENMP )
+    const int numThreads_i = std::max(1, std::min( std::min(omp_get_max_threads(), LHT_MAX_CORES),
+                                                   tiles_i ) );
+#else
+    const int numThreads_i = 1;
+#endif
+
+    /// Horizontally filtered rows plus the filtered tile with a border 
+    /// of one pixel.
+    const int bufferSize_i = ( (LHT_PEAK_TILE_SIZE + 4) * (LHT_PEAK_TILE_SIZE + 2) + 
+                               (LHT_PEAK_TILE_SIZE + 2) * (LHT_PEAK_TILE_SIZE + 2) );
+
+    for (int t = 0; t < numThreads_i; ++t)
+        m_threadTile_p[t].resize ( bufferSize_i );
+
+    const float minValue_f = f_minValue_f * getAccumulatorScale();
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_i) schedule(dynamic)
+#endif
+    for (int t = 0; t < tiles_i; ++t)
+    {
+#if defined ( _OPENMP )
+        const int threadIdx_i = omp_get_thread_num();
+#else
+        const int threadIdx_i = 0;
+#endif
+        const int x0_i = border_i + (t % tilesX_i) * LHT_PEAK_TILE_SIZE;
+        const int y0_i = border_i + (t / tilesX_i) * LHT_PEAK_TILE_SIZE;
+        const int x1_i = std::min(x0_i + LHT_PEAK_TILE_SIZE, size.width  - border_i);
+        const int y1_i = std::min(y0_i + LHT_PEAK_TILE_SIZE, size.height - border_i);
+
+        float * const buffer_p = &m_threadTile_p[threadIdx_i][0];
+
+        m_tilePeaks_v[t].clear();
+
+        if ( m_accumImg.type() == CV_32SC1 )
+            extractTilePeaks<int>            ( x0_i, y0_i, x1_i, y1_i, minValue_f, f_maxPeaks_ui,
+                                               buffer_p, m_tilePeaks_v[t] );
+        else if ( m_accumImg.type() == CV_16UC1 )
+            extractTilePeaks<unsigned short> ( x0_i, y0_i, x1_i, y1_i, minValue_f, f_maxPeaks_ui,
+                                               buffer_p, m_tilePeaks_v[t] );
+        else
+            extractTilePeaks<float>          ( x0_i, y0_i, x1_i, y1_i, minValue_f, f_maxPeaks_ui,
+                                               buffer_p, m_tilePeaks_v[t] );
+    }
+
+    /// Merge the heaps.
+    unsigned int count_ui = 0;
+    for (int t = 0; t < tiles_i; ++t)
+        count_ui += m_tilePeaks_v[t].size();
+
+    fr_peaks_v.reserve ( count_ui );
+
+    for (int t = 0; t < tiles_i; ++t)
+        fr_peaks_v.insert ( fr_peaks_v.end(), m_tilePeaks_v[t].begin(), m_tilePeaks_v[t].end() );
+
+    if ( f_maxPeaks_ui > 0 && fr_peaks_v.size() > f_maxPeaks_ui )
+    {
+        std::partial_sort ( fr_peaks_v.begin(), fr_peaks_v.begin() + f_maxPeaks_ui, fr_peaks_v.end() );
+        fr_peaks_v.resize ( f_maxPeaks_ui );
+    }
+    else
+        std::sort ( fr_peaks_v.begin(), fr_peaks_v.end() );
+
+    /// Values of the peaks in votes.
+    const float scale_f = 1.f / getAccumulatorScale();
+
+    if ( scale_f != 1.f )
+    {
+        for (unsigned int i = 0; i < fr_peaks_v.size(); ++i)
+            fr_peaks_v[i].val_f *= scale_f;
+    }
+
+    return true;
+}
+
+template <typename AccumType_>
+void
+CLinearHoughTransform::extractTilePeaks ( int                f_x0_i,
+                                          int                f_y0_i,
+                                          int                f_x1_i,
+                                          int                f_y1_i,
+                                          float              f_minValue_f,
+                                          unsigned int       f_maxPeaks_ui,
+                                          float *            fr_buffer_p,
+                                          THoughLineVector & fr_peaks_v ) const
+{
+    /// Filtered tile covers [x0-1,x1]x[y0-1,y1].
+    const int fw_i = f_x1_i - f_x0_i + 2;
+    const int fh_i = f_y1_i - f_y0_i + 2;
+
+    float * const hor_p = fr_buffer_p;
+    float * const flt_p = fr_buffer_p + fw_i * (fh_i + 2);
+
+    /// Horizontal [1 2 1] pass over the rows [y0-2,y1+1].
+    for (int i = 0; i < fh_i + 2; ++i)
+    {
+        const AccumType_ * const src_p = m_accumImg.ptr<AccumType_>(f_y0_i - 2 + i) + f_x0_i - 1;
+        float * const            dst_p = hor_p + i * fw_i;
+
+        for (int j = 0; j < fw_i; ++j)
+            dst_p[j] = (float)src_p[j-1] + 2.f * (float)src_p[j] + (float)src_p[j+1];
+    }
+
+    /// Vertical [1 2 1] pass.
+    for (int i = 0; i < fh_i; ++i)
+    {
+        const float * const s0_p = hor_p + i * fw_i;
+        const float * const s1_p = s0_p + fw_i;
+        const float * const s2_p = s1_p + fw_i;
+        float * const       dst_p = flt_p + i * fw_i;
+
+        for (int j = 0; j < fw_i; ++j)
+            dst_p[j] = (s0_p[j] + 2.f * s1_p[j] + s2_p[j]) * (1.f/16.f);
+    }
+
+    /// 3x3 non-maxima suppression.
+    for (int i = 1; i < fh_i - 1; ++i)
+    {
+        const float * sl0_p = flt_p + (i-1) * fw_i + 1;
+        const float * sl1_p = sl0_p + fw_i;
+        const float * sl2_p = sl1_p + fw_i;
+
+        for (int j = 1; j < fw_i - 1; ++j, ++sl0_p, ++sl1_p, ++sl2_p)
+        {
+            const float v_f = *sl1_p;
+
+            if ( v_f >= f_minValue_f && 
+                 v_f > sl0_p[-1] && v_f > sl0_p[0] && v_f > sl0_p[+1] &&
+                 v_f > sl1_p[-1] &&                   v_f > sl1_p[+1] &&
+                 v_f > sl2_p[-1] && v_f > sl2_p[0] && v_f > sl2_p[+1] )
+            {
+                const SHoughLine peak ( f_x0_i + j - 1, f_y0_i + i - 1, v_f );
+
+                /// Bounded heap with the weakest peak on top.
+                if ( !f_maxPeaks_ui )
+                    fr_peaks_v.push_back ( peak );
+                else if ( fr_peaks_v.size() < f_maxPeaks_ui )
+                {
+                    fr_peaks_v.push_back ( peak );
+                    std::push_heap ( fr_peaks_v.begin(), fr_peaks_v.end() );
+                }
+                else if ( v_f > fr_peaks_v.front().val_f )
+                {
+                    std::pop_heap ( fr_peaks_v.begin(), fr_peaks_v.end() );
+                    fr_peaks_v.back() = peak;
+                    std::push_heap ( fr_peaks_v.begin(), fr_peaks_v.end() );
+                }
+            }
+        }
+    }
+}
+
 CParameterSet *   
 CLinearHoughTransform::getParameterSet ( std::string f_name_str )
 {
@@ -629,6 +1498,32 @@ CLinearHoughTransform::getParameterSet ( std::string f_name_str )
                                       ( this,
                                         &CLinearHoughTransform::getScale,
                                         &CLinearHoughTransform::setScale ) ) );
+
+        m_paramSet_p -> addParameter (
+                new CBoolParameter ( "Fixed Point Splat",
+                                     "Use fixed point arithmetic for voting batches of points.",
+                                     getFixedPointSplat(),
+                                     new CParameterConnector< CLinearHoughTransform, bool, CBoolParameter>
+                                     ( this,
+                                       &CLinearHoughTransform::getFixedPointSplat,
+                                       &CLinearHoughTransform::setFixedPointSplat ) ) );
+
+        CEnumParameter<EAccumulatorType> * typeParam_p = 
+            new CEnumParameter<EAccumulatorType> ( "Accumulator Type",
+                                                   "Data type of the accumulator. Integer "
+                                                   "accumulators store fixed point votes.",
+                                                   getAccumulatorType(),
+                                                   "None",
+                                                   new CParameterConnector< CLinearHoughTransform, EAccumulatorType, CEnumParameter<EAccumulatorType> >
+                                                   ( this,
+                                                     &CLinearHoughTransform::getAccumulatorType,
+                                                     &CLinearHoughTransform::setAccumulatorType ) );
+        
+        typeParam_p -> addDescription ( AT_FLOAT32, "Float 32 bits" );
+        typeParam_p -> addDescription ( AT_UINT16,  "Unsigned int 16 bits" );
+        typeParam_p -> addDescription ( AT_INT32,   "Int 32 bits" );
+
+        m_paramSet_p -> addParameter ( typeParam_p );
     }
 
     return m_paramSet_p;
@@ -702,11 +1597,19 @@ CLinearHoughTransform::copyFrom ( const CLinearHoughTransform & other )
     m_theta = other.m_theta;
     m_range = other.m_range;
     m_scale = other.m_scale;    
+    m_fixedPointSplat_b = other.m_fixedPointSplat_b;
+    m_accumType_e = other.m_accumType_e;
     allocateAccumulator();
 
     other.m_accumImg.copyTo(m_accumImg);
     other.m_auxImg.copyTo(m_auxImg);
 
+    /// Same geometry, so the voting windows of the other object apply.
+    m_useWindows_b  = other.m_useWindows_b;
+    m_winRuns_v     = other.m_winRuns_v;
+    m_winColStart_v = other.m_winColStart_v;
+    m_winRows_v     = other.m_winRows_v;
+
     return true;
 }
 
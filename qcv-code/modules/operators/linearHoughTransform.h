@@ -37,18 +37,67 @@
  *******************************************************************************/
 
 /* INCLUDES */
+#include <vector>
 #include <opencv/highgui.h>
 #include "standardTypes.h"
 #include "parameterSet.h"
 
 /* CONSTANTS */
+#define LHT_MAX_CORES 8
 
 namespace QCV
 {
     class CParameterSet;
     
+    struct SHoughLine
+    {
+        float x_f;
+        float y_f;
+        float val_f;
+
+        SHoughLine () { x_f = y_f = val_f = 0.f; }
+            
+        SHoughLine (float f_x_f, float f_y_f, float f_val_f )
+            : x_f (     f_x_f ),
+              y_f (     f_y_f ),
+              val_f ( f_val_f ) {}
+
+        bool operator < ( const SHoughLine & f_other ) const
+        {
+            return val_f > f_other.val_f;
+        }
+    };
+
+    typedef std::vector<SHoughLine> THoughLineVector;
+
+    /// Theta x range window of the Hough space.
+    struct SHoughWindow
+    {
+        /// Min and max theta [rad].
+        S2D<double> theta;
+
+        /// Min and max range [px].
+        S2D<double> range;
+
+        SHoughWindow () {}
+            
+        SHoughWindow ( S2D<double> f_theta, S2D<double> f_range )
+            : theta ( f_theta ),
+              range ( f_range ) {}
+    };
+
+    typedef std::vector<SHoughWindow> THoughWindowVector;
+
     class CLinearHoughTransform
     {
+    public:
+        /// Data type of the accumulator.
+        typedef enum {
+            AT_FLOAT32,
+            AT_UINT16,
+            AT_INT32
+        } EAccumulatorType;
+
     /// Constructors/Destructor
     public:
         CLinearHoughTransform();
@@ -85,8 +134,53 @@ namespace QCV
                            double f_expTheta_d,
                            double f_deltaTheta_d );
 
+        /// Add a batch of points voting in the whole theta range.
+        bool    addPoints ( const float * const f_x_p,
+                            const float * const f_y_p,
+                            const float * const f_weight_p,
+                            const int           f_n_i );
+
+        /// Add a batch of points voting around the expected theta of 
+        /// each point.
+        bool    addPoints ( const float * const f_x_p,
+                            const float * const f_y_p,
+                            const float * const f_weight_p,
+                            const float * const f_expTheta_p,
+                            const int           f_n_i,
+                            const double        f_deltaTheta_d );
+
+        /// Add a batch of points voting around the expected theta of 
+        /// each point, quantized to one of f_numBins_i bins over [0,pi).
+        /// The theta columns to update are computed once per bin.
+        bool    addPoints ( const float * const          f_x_p,
+                            const float * const          f_y_p,
+                            const float * const          f_weight_p,
+                            const unsigned short * const f_thetaBin_p,
+                            const int                    f_numBins_i,
+                            const int                    f_n_i,
+                            const double                 f_deltaTheta_d );
+
         bool    compute ( );
 
+        /// Restrict the voting of batches of points (addPoints) to the 
+        /// given theta x range windows. Windows exceeding the theta range
+        /// are wrapped around with the range negated.
+        bool    setVotingWindows ( const THoughWindowVector & f_windows_v );
+
+        /// Vote again in the whole Hough space.
+        void    clearVotingWindows ( );
+
+        bool    hasVotingWindows ( ) const;
+
+        /// Extract local maxima of the 3x3 gaussian filtered accumulator 
+        /// with value larger or equal than the given one. Peaks are sorted 
+        /// by decreasing value. If f_maxPeaks_ui is not 0, only the 
+        /// strongest f_maxPeaks_ui peaks are returned.
+        bool    extractPeaks ( float              f_minValue_f,
+                               int                f_border_i,
+                               unsigned int       f_maxPeaks_ui,
+                               THoughLineVector & fr_peaks_v );
+
     /// Coordinate transformations.
     public:
         /// Hough to Image space
@@ -150,10 +244,25 @@ namespace QCV
         bool        setRangeScale ( double f_rangeScale );
         double      getRangeScale ( ) const;
 
+        /// Fixed point splatting for batches of points.
+        bool        setFixedPointSplat ( bool f_val_b );
+        bool        getFixedPointSplat ( ) const;
+
+        /// Accumulator data type.
+        bool             setAccumulatorType ( EAccumulatorType f_type_e );
+        EAccumulatorType getAccumulatorType ( ) const;
 
+        /// Factor between the values stored in the accumulator and the
+        /// votes.
+        float       getAccumulatorScale ( ) const;
+
+        /// Accumulator image as float (converted if the accumulator is 
+        /// of integer type).
         cv::Mat     getAccumulatorImage ( ) const;
         cv::Mat &   getAccumulatorImageReference ( );
 
+        cv::Size    getAccumulatorSize ( ) const;
+
         CParameterSet *   getParameterSet ( std::string f_name_str );
 
     /// Help functions
@@ -163,6 +272,67 @@ namespace QCV
 
         /// Allocate acumulator
         void    allocateAccumulator();
+
+        /// Theta columns to update for an expected theta.
+        int     getThetaWindows ( double f_expTheta_d, 
+                                  double f_deltaTheta_d,
+                                  int    fr_minJ_p[2],
+                                  int    fr_maxJ_p[2] ) const;
+
+        /// Batch accumulation (f_expTheta_p and f_thetaBin_p can be 
+        /// NULL).
+        bool    accumulatePoints ( const float * const          f_x_p,
+                                   const float * const          f_y_p,
+                                   const float * const          f_weight_p,
+                                   const float * const          f_expTheta_p,
+                                   const unsigned short * const f_thetaBin_p,
+                                   const int                    f_numBins_i,
+                                   const int                    f_n_i,
+                                   const double                 f_deltaTheta_d );
+
+        /// Accumulate a single point in the given accumulator.
+        template <typename AccumType_>
+        void    accumulatePoint ( float         f_x_f,
+                                  float         f_y_f,
+                                  float         f_weight_f,
+                                  const int     f_cycles_i,
+                                  const int     f_minJ_p[2],
+                                  const int     f_maxJ_p[2],
+                                  float *       fr_rows_p,
+                                  cv::Mat &     fr_accum ) const;
+
+        /// Accumulate a single point in the columns and rows of the 
+        /// voting windows.
+        template <typename AccumType_>
+        void    accumulatePointInWindows ( float         f_x_f,
+                                           float         f_y_f,
+                                           float         f_weight_f,
+                                           const int     f_cycles_i,
+                                           const int     f_minJ_p[2],
+                                           const int     f_maxJ_p[2],
+                                           float *       fr_rows_p,
+                                           cv::Mat &     fr_accum ) const;
+
+        /// Adds a window to the per column row intervals.
+        void    addWindowIntervals ( double                                f_minTheta_d,
+                                     double                                f_maxTheta_d,
+                                     double                                f_minRange_d,
+                                     double                                f_maxRange_d,
+                                     std::vector< std::vector< S2D<float> > > & fr_colIntervals_v ) const;
+
+        /// Peaks of the accumulator tile [x0,x1)x[y0,y1).
+        template <typename AccumType_>
+        void    extractTilePeaks ( int                f_x0_i,
+                                   int                f_y0_i,
+                                   int                f_x1_i,
+                                   int                f_y1_i,
+                                   float              f_minValue_f,
+                                   unsigned int       f_maxPeaks_ui,
+                                   float *            fr_buffer_p,
+                                   THoughLineVector & fr_peaks_v ) const;
+
+        /// Number of fractional bits of the fixed point votes.
+        int     getFixedPointBits ( ) const;
         
     private:
         /// Accumulator image.
@@ -176,6 +346,54 @@ namespace QCV
 
         /// Look up vector for sinus.
         std::vector<double>  m_sinLUV;
+
+        /// Look up vector for cosinus divided by the range scale.
+        std::vector<float>   m_cosRowLUV;
+
+        /// Look up vector for sinus divided by the range scale.
+        std::vector<float>   m_sinRowLUV;
+
+        /// Fixed point splatting for batches of points.
+        bool                 m_fixedPointSplat_b;
+
+        /// Accumulator data type.
+        EAccumulatorType     m_accumType_e;
+
+        /// Per thread accumulators for batches of points.
+        cv::Mat              m_threadAccum_p[LHT_MAX_CORES];
+
+        /// Per thread row coordinates of the current point.
+        std::vector<float>   m_threadRows_p[LHT_MAX_CORES];
+
+        /// Per thread filtered tiles for peak extraction.
+        std::vector<float>   m_threadTile_p[LHT_MAX_CORES];
+
+        /// Theta columns to update for an orientation bin.
+        struct SThetaWindows
+        {
+            int cycles_i;
+            int minJ_p[2];
+            int maxJ_p[2];
+        };
+
+        /// Theta columns of each orientation bin of the current batch.
+        std::vector<SThetaWindows> m_binWindows_v;
+
+        /// Peaks of each tile.
+        std::vector<THoughLineVector> m_tilePeaks_v;
+
+        /// Voting windows active?
+        bool                 m_useWindows_b;
+
+        /// Contiguous runs of columns (first, last) covered by the 
+        /// voting windows.
+        std::vector<int>     m_winRuns_v;
+
+        /// Offsets of the row intervals of each column.
+        std::vector<int>     m_winColStart_v;
+
+        /// Merged row intervals (min, max) of the voting windows.
+        std::vector< S2D<float> > m_winRows_v;
  
         /// Theta range
         S2D<double>          m_theta;
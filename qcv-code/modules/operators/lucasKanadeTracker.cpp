@@ -0,0 +1,773 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+/**
+ *******************************************************************************
+ *
+ * @file lucasKanadeTracker.cpp
+ *
+ * \class CLucasKanadeTracker
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Pyramidal Lucas-Kanade feature tracker.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include "lucasKanadeTracker.h"
+
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#if defined ( _OPENMP )
+#include <omp.h>
+#endif
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/// Fractional bits of the bilinear weights.
+#define LKT_W_BITS 14
+
+/// Fractional bits of the interpolated image values.
+#define LKT_I_BITS 5
+
+/// Scale of the gradient sums.
+#define LKT_FLT_SCALE (1.f/(1 << 20))
+
+/// Features per chunk for the dynamic thread scheduling.
+#define LKT_FEATURES_PER_CHUNK 16
+
+using namespace QCV;
+
+/// Fixed point bilinear weights for the fractional position (a,b).
+static inline void bilinearWeights ( float f_a_f,
+                                     float f_b_f,
+                                     int   fr_w_p[4] )
+{
+    fr_w_p[0] = cvRound((1.f - f_a_f)*(1.f - f_b_f)*(1 << LKT_W_BITS));
+    fr_w_p[1] = cvRound(f_a_f*(1.f - f_b_f)*(1 << LKT_W_BITS));
+    fr_w_p[2] = cvRound((1.f - f_a_f)*f_b_f*(1 << LKT_W_BITS));
+    fr_w_p[3] = (1 << LKT_W_BITS) - fr_w_p[0] - fr_w_p[1] - fr_w_p[2];
+}
+
+static inline int descale ( int f_val_i, int f_bits_i )
+{
+    return ( f_val_i + (1 << (f_bits_i-1)) ) >> f_bits_i;
+}
+
+#if defined ( __SSE2__ )
+/// Load 4 consecutive bytes as 16 bit values.
+static inline __m128i load4u8 ( const unsigned char * f_src_p )
+{
+    int val_i;
+    memcpy ( &val_i, f_src_p, sizeof(int) );
+    return _mm_unpacklo_epi8 ( _mm_cvtsi32_si128 ( val_i ), _mm_setzero_si128() );
+}
+
+/// Bilinear interpolation of 4 pixels of an 8 bit image with LKT_I_BITS
+/// fractional bits.
+static inline __m128i interpolate4u8 ( const unsigned char * f_row0_p,
+                                       const unsigned char * f_row1_p,
+                                       const __m128i         f_w01,
+                                       const __m128i         f_w23 )
+{
+    const __m128i delta = _mm_set1_epi32 ( 1 << (LKT_W_BITS-LKT_I_BITS-1) );
+
+    __m128i r0 = _mm_unpacklo_epi16 ( load4u8 ( f_row0_p ), load4u8 ( f_row0_p + 1 ) );
+    __m128i r1 = _mm_unpacklo_epi16 ( load4u8 ( f_row1_p ), load4u8 ( f_row1_p + 1 ) );
+
+    __m128i sum = _mm_add_epi32 ( _mm_madd_epi16 ( r0, f_w01 ),
+                                  _mm_madd_epi16 ( r1, f_w23 ) );
+
+    return _mm_srai_epi32 ( _mm_add_epi32 ( sum, delta ), LKT_W_BITS-LKT_I_BITS );
+}
+#endif
+
+/// Sample the image and derivative patch of the window at (x,y) and
+/// compute the spatial gradient matrix.
+static void samplePatch ( const cv::Mat & f_img,
+                          const cv::Mat & f_deriv,
+                          int             f_x_i,
+                          int             f_y_i,
+                          const int       f_w_p[4],
+                          int             f_winSize_i,
+                          short *         fr_patch_p,
+                          short *         fr_dPatch_p,
+                          float &         fr_a11_f,
+                          float &         fr_a12_f,
+                          float &         fr_a22_f )
+{
+    const int stepI_i = (int) f_img.step1();
+    const int stepD_i = (int) f_deriv.step1();
+
+    float a11_f = 0, a12_f = 0, a22_f = 0;
+
+#if defined ( __SSE2__ )
+    const __m128i w01   = _mm_set1_epi32 ( (f_w_p[1] << 16) | (f_w_p[0] & 0xffff) );
+    const __m128i w23   = _mm_set1_epi32 ( (f_w_p[3] << 16) | (f_w_p[2] & 0xffff) );
+    const __m128i delta = _mm_set1_epi32 ( 1 << (LKT_W_BITS-1) );
+    __m128 qSq  = _mm_setzero_ps();
+    __m128 qA12 = _mm_setzero_ps();
+#endif
+
+    for (int y = 0; y < f_winSize_i; ++y)
+    {
+        const unsigned char * src_p  = f_img.ptr<unsigned char>(f_y_i + y) + f_x_i;
+        const short *         dsrc_p = f_deriv.ptr<short>(f_y_i + y) + f_x_i * 2;
+        short *               patch_p  = fr_patch_p  + y * f_winSize_i;
+        short *               dPatch_p = fr_dPatch_p + y * f_winSize_i * 2;
+
+        int x = 0;
+
+#if defined ( __SSE2__ )
+        for (; x <= f_winSize_i - 4; x += 4)
+        {
+            __m128i ival = interpolate4u8 ( src_p + x, src_p + x + stepI_i, w01, w23 );
+            _mm_storel_epi64 ( (__m128i *) (patch_p + x), _mm_packs_epi32 ( ival, ival ) );
+
+            /// Derivatives are interleaved (dx,dy).
+            const short * d0_p = dsrc_p + x * 2;
+            const short * d1_p = d0_p + stepD_i;
+            __m128i t0 = _mm_loadu_si128 ( (const __m128i *) d0_p );
+            __m128i t1 = _mm_loadu_si128 ( (const __m128i *) (d0_p + 2) );
+            __m128i t2 = _mm_loadu_si128 ( (const __m128i *) d1_p );
+            __m128i t3 = _mm_loadu_si128 ( (const __m128i *) (d1_p + 2) );
+
+            __m128i lo = _mm_add_epi32 ( _mm_madd_epi16 ( _mm_unpacklo_epi16 ( t0, t1 ), w01 ),
+                                         _mm_madd_epi16 ( _mm_unpacklo_epi16 ( t2, t3 ), w23 ) );
+            __m128i hi = _mm_add_epi32 ( _mm_madd_epi16 ( _mm_unpackhi_epi16 ( t0, t1 ), w01 ),
+                                         _mm_madd_epi16 ( _mm_unpackhi_epi16 ( t2, t3 ), w23 ) );
+
+            lo = _mm_srai_epi32 ( _mm_add_epi32 ( lo, delta ), LKT_W_BITS );
+            hi = _mm_srai_epi32 ( _mm_add_epi32 ( hi, delta ), LKT_W_BITS );
+
+            /// (Ix0,Iy0,Ix1,Iy1,Ix2,Iy2,Ix3,Iy3)
+            __m128i d = _mm_packs_epi32 ( lo, hi );
+            _mm_storeu_si128 ( (__m128i *) (dPatch_p + x * 2), d );
+
+            /// Squares: even lanes Ix^2, odd lanes Iy^2.
+            __m128i pl = _mm_mullo_epi16 ( d, d );
+            __m128i ph = _mm_mulhi_epi16 ( d, d );
+            __m128i sq = _mm_add_epi32 ( _mm_unpacklo_epi16 ( pl, ph ),
+                                         _mm_unpackhi_epi16 ( pl, ph ) );
+
+            /// Cross products: each lane 2*Ix*Iy.
+            __m128i ds = _mm_shufflehi_epi16 ( _mm_shufflelo_epi16 ( d, _MM_SHUFFLE(2,3,0,1) ),
+                                               _MM_SHUFFLE(2,3,0,1) );
+            __m128i cr = _mm_madd_epi16 ( d, ds );
+
+            qSq  = _mm_add_ps ( qSq,  _mm_cvtepi32_ps ( sq ) );
+            qA12 = _mm_add_ps ( qA12, _mm_cvtepi32_ps ( cr ) );
+        }
+#endif
+
+        for (; x < f_winSize_i; ++x)
+        {
+            const int ival_i = descale ( src_p[x]         * f_w_p[0] + src_p[x+1]         * f_w_p[1] +
+                                         src_p[x+stepI_i] * f_w_p[2] + src_p[x+stepI_i+1] * f_w_p[3],
+                                         LKT_W_BITS-LKT_I_BITS );
+
+            const short * d_p = dsrc_p + x * 2;
+            const int ixval_i = descale ( d_p[0]       * f_w_p[0] + d_p[2]         * f_w_p[1] +
+                                          d_p[stepD_i] * f_w_p[2] + d_p[stepD_i+2] * f_w_p[3],
+                                          LKT_W_BITS );
+            const int iyval_i = descale ( d_p[1]         * f_w_p[0] + d_p[3]         * f_w_p[1] +
+                                          d_p[stepD_i+1] * f_w_p[2] + d_p[stepD_i+3] * f_w_p[3],
+                                          LKT_W_BITS );
+
+            patch_p[x]        = (short) ival_i;
+            dPatch_p[x*2]     = (short) ixval_i;
+            dPatch_p[x*2+1]   = (short) iyval_i;
+
+            a11_f += (float) (ixval_i * ixval_i);
+            a12_f += (float) (ixval_i * iyval_i);
+            a22_f += (float) (iyval_i * iyval_i);
+        }
+    }
+
+#if defined ( __SSE2__ )
+    float buf_p[4];
+    _mm_storeu_ps ( buf_p, qSq );
+    a11_f += buf_p[0] + buf_p[2];
+    a22_f += buf_p[1] + buf_p[3];
+    _mm_storeu_ps ( buf_p, qA12 );
+    a12_f += ( buf_p[0] + buf_p[1] + buf_p[2] + buf_p[3] ) * 0.5f;
+#endif
+
+    fr_a11_f = a11_f * LKT_FLT_SCALE;
+    fr_a12_f = a12_f * LKT_FLT_SCALE;
+    fr_a22_f = a22_f * LKT_FLT_SCALE;
+}
+
+/// Image mismatch vector between the window of J at (x,y) and the patch.
+static void computeMismatch ( const cv::Mat & f_img,
+                              int             f_x_i,
+                              int             f_y_i,
+                              const int       f_w_p[4],
+                              int             f_winSize_i,
+                              const short *   f_patch_p,
+                              const short *   f_dPatch_p,
+                              float &         fr_b1_f,
+                              float &         fr_b2_f )
+{
+    const int stepJ_i = (int) f_img.step1();
+
+    float b1_f = 0, b2_f = 0;
+
+#if defined ( __SSE2__ )
+    const __m128i w01 = _mm_set1_epi32 ( (f_w_p[1] << 16) | (f_w_p[0] & 0xffff) );
+    const __m128i w23 = _mm_set1_epi32 ( (f_w_p[3] << 16) | (f_w_p[2] & 0xffff) );
+    __m128 qb = _mm_setzero_ps();
+#endif
+
+    for (int y = 0; y < f_winSize_i; ++y)
+    {
+        const unsigned char * src_p    = f_img.ptr<unsigned char>(f_y_i + y) + f_x_i;
+        const short *         patch_p  = f_patch_p  + y * f_winSize_i;
+        const short *         dPatch_p = f_dPatch_p + y * f_winSize_i * 2;
+
+        int x = 0;
+
+#if defined ( __SSE2__ )
+        for (; x <= f_winSize_i - 4; x += 4)
+        {
+            __m128i jval = interpolate4u8 ( src_p + x, src_p + x + stepJ_i, w01, w23 );
+            __m128i diff = _mm_sub_epi16 ( _mm_packs_epi32 ( jval, jval ),
+                                           _mm_loadl_epi64 ( (const __m128i *) (patch_p + x) ) );
+
+            /// (d0,d0,d1,d1,d2,d2,d3,d3) x (Ix0,Iy0,...,Ix3,Iy3)
+            __m128i dd = _mm_unpacklo_epi16 ( diff, diff );
+            __m128i d  = _mm_loadu_si128 ( (const __m128i *) (dPatch_p + x * 2) );
+            __m128i pl = _mm_mullo_epi16 ( dd, d );
+            __m128i ph = _mm_mulhi_epi16 ( dd, d );
+
+            /// Even lanes diff*Ix, odd lanes diff*Iy.
+            __m128i p  = _mm_add_epi32 ( _mm_unpacklo_epi16 ( pl, ph ),
+                                         _mm_unpackhi_epi16 ( pl, ph ) );
+            qb = _mm_add_ps ( qb, _mm_cvtepi32_ps ( p ) );
+        }
+#endif
+
+        for (; x < f_winSize_i; ++x)
+        {
+            const int diff_i = descale ( src_p[x]         * f_w_p[0] + src_p[x+1]         * f_w_p[1] +
+                                         src_p[x+stepJ_i] * f_w_p[2] + src_p[x+stepJ_i+1] * f_w_p[3],
+                                         LKT_W_BITS-LKT_I_BITS ) - patch_p[x];
+
+            b1_f += (float) (diff_i * dPatch_p[x*2]);
+            b2_f += (float) (diff_i * dPatch_p[x*2+1]);
+        }
+    }
+
+#if defined ( __SSE2__ )
+    float buf_p[4];
+    _mm_storeu_ps ( buf_p, qb );
+    b1_f += buf_p[0] + buf_p[2];
+    b2_f += buf_p[1] + buf_p[3];
+#endif
+
+    fr_b1_f = b1_f * LKT_FLT_SCALE;
+    fr_b2_f = b2_f * LKT_FLT_SCALE;
+}
+
+/// Mean absolute difference between the window of J at (x,y) and the
+/// patch.
+static float computeError ( const cv::Mat & f_img,
+                            int             f_x_i,
+                            int             f_y_i,
+                            const int       f_w_p[4],
+                            int             f_winSize_i,
+                            const short *   f_patch_p )
+{
+    const int stepJ_i = (int) f_img.step1();
+
+    int sum_i = 0;
+
+#if defined ( __SSE2__ )
+    const __m128i w01 = _mm_set1_epi32 ( (f_w_p[1] << 16) | (f_w_p[0] & 0xffff) );
+    const __m128i w23 = _mm_set1_epi32 ( (f_w_p[3] << 16) | (f_w_p[2] & 0xffff) );
+    __m128i qsum = _mm_setzero_si128();
+#endif
+
+    for (int y = 0; y < f_winSize_i; ++y)
+    {
+        const unsigned char * src_p   = f_img.ptr<unsigned char>(f_y_i + y) + f_x_i;
+        const short *         patch_p = f_patch_p + y * f_winSize_i;
+
+        int x = 0;
+
+#if defined ( __SSE2__ )
+        for (; x <= f_winSize_i - 4; x += 4)
+        {
+            __m128i jval = interpolate4u8 ( src_p + x, src_p + x + stepJ_i, w01, w23 );
+            __m128i diff = _mm_sub_epi32 ( jval,
+                                           _mm_srai_epi32 ( _mm_unpacklo_epi16 ( _mm_setzero_si128(),
+                                                                                 _mm_loadl_epi64 ( (const __m128i *) (patch_p + x) ) ), 16 ) );
+            __m128i sign = _mm_srai_epi32 ( diff, 31 );
+            qsum = _mm_add_epi32 ( qsum, _mm_sub_epi32 ( _mm_xor_si128 ( diff, sign ), sign ) );
+        }
+#endif
+
+        for (; x < f_winSize_i; ++x)
+        {
+            const int diff_i = descale ( src_p[x]         * f_w_p[0] + src_p[x+1]         * f_w_p[1] +
+                                         src_p[x+stepJ_i] * f_w_p[2] + src_p[x+stepJ_i+1] * f_w_p[3],
+                                         LKT_W_BITS-LKT_I_BITS ) - patch_p[x];
+            sum_i += abs ( diff_i );
+        }
+    }
+
+#if defined ( __SSE2__ )
+    int buf_p[4];
+    _mm_storeu_si128 ( (__m128i *) buf_p, qsum );
+    sum_i += buf_p[0] + buf_p[1] + buf_p[2] + buf_p[3];
+#endif
+
+    return sum_i / (float) ( (1 << LKT_I_BITS) * f_winSize_i * f_winSize_i );
+}
+
+CLucasKanadeTracker::CLucasKanadeTracker()
+        : m_winSize_i (                     21 ),
+          m_maxLevel_i (                     3 ),
+          m_maxIter_i (                     30 ),
+          m_epsilon_f (                  0.01f ),
+          m_useInitialFlow_b (           false ),
+          m_minEigenvalue_f (            1e-4f ),
+          m_fbCheck_b (                  false ),
+          m_maxFBError_f (                 1.f )
+{
+}
+
+CLucasKanadeTracker::~CLucasKanadeTracker()
+{
+}
+
+int
+CLucasKanadeTracker::getUsableLevels ( const std::vector<cv::Mat> & f_pyr_v ) const
+{
+    const int levels_i = (int) f_pyr_v.size() / 2;
+
+    for (int l = 0; l < levels_i; ++l)
+    {
+        const cv::Mat & img   = f_pyr_v[2*l];
+        const cv::Mat & deriv = f_pyr_v[2*l+1];
+
+        if ( img.type() != CV_8UC1 || deriv.type() != CV_16SC2 ||
+             img.size() != deriv.size() )
+        {
+            if ( l == 0 )
+                printf("%s:%i Pyramid must contain 8 bit images and 16 bit derivatives.\n",
+                       __FILE__, __LINE__ );
+            return l;
+        }
+
+        /// Both must have a border of at least the window size.
+        for (int k = 0; k < 2; ++k)
+        {
+            const cv::Mat & m = k?deriv:img;
+            cv::Size  wholeSize;
+            cv::Point ofs;
+            m.locateROI ( wholeSize, ofs );
+
+            if ( ofs.x < m_winSize_i || ofs.y < m_winSize_i ||
+                 wholeSize.width  - ofs.x - m.cols < m_winSize_i ||
+                 wholeSize.height - ofs.y - m.rows < m_winSize_i )
+            {
+                if ( l == 0 )
+                    printf("%s:%i Pyramid border must be at least the window size (%i).\n",
+                           __FILE__, __LINE__, m_winSize_i );
+                return l;
+            }
+        }
+    }
+
+    return levels_i;
+}
+
+bool
+CLucasKanadeTracker::track ( const std::vector<cv::Mat> &       f_prevPyr_v,
+                             const std::vector<cv::Mat> &       f_currPyr_v,
+                             const std::vector<cv::Point2f> &   f_prevPts_v,
+                             std::vector<cv::Point2f> &         fr_currPts_v,
+                             std::vector<unsigned char> &       fr_status_v,
+                             std::vector<float> &               fr_error_v,
+                             const std::vector<unsigned char> * f_mask_p )
+{
+    const int numPoints_i = (int) f_prevPts_v.size();
+
+    const int levels_i = std::min ( getUsableLevels ( f_prevPyr_v ),
+                                    getUsableLevels ( f_currPyr_v ) );
+
+    if ( levels_i == 0 )
+        return false;
+
+    if ( m_useInitialFlow_b && (int) fr_currPts_v.size() != numPoints_i )
+    {
+        printf("%s:%i Initial flow requires as many current as previous points.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    if ( f_mask_p && (int) f_mask_p->size() != numPoints_i )
+    {
+        printf("%s:%i Mask size does not match the number of points.\n",
+               __FILE__, __LINE__ );
+        return false;
+    }
+
+    const int maxLevel_i = std::min ( m_maxLevel_i, levels_i - 1 );
+
+    if ( !m_useInitialFlow_b )
+        fr_currPts_v = f_prevPts_v;
+
+    fr_status_v.assign ( numPoints_i, 1 );
+    fr_error_v.assign  ( numPoints_i, 0.f );
+
+    if ( numPoints_i == 0 )
+        return true;
+
+    /// Image patch and interleaved derivative patch with some space for
+    /// the vector stores.
+    const size_t bufferSize_ui = m_winSize_i * m_winSize_i * 3 + 8;
+
+#if defined ( _OPENMP )
+    const int numThreads_i = std::max(1, std::min( std::min(omp_get_max_threads(), LKT_MAX_CORES),
+                                                   numPoints_i / LKT_FEATURES_PER_CHUNK ) );
+#else
+    const int numThreads_i = 1;
+#endif
+
+    for (int t = 0; t < numThreads_i; ++t)
+        if ( m_threadBuffer_p[t].size() < bufferSize_ui )
+            m_threadBuffer_p[t].resize ( bufferSize_ui );
+
+    const float maxSqFBError_f = m_maxFBError_f * m_maxFBError_f;
+
+#if defined ( _OPENMP )
+#pragma omp parallel for num_threads(numThreads_i) schedule(dynamic, LKT_FEATURES_PER_CHUNK)
+#endif
+    for (int i = 0; i < numPoints_i; ++i)
+    {
+        if ( f_mask_p && !(*f_mask_p)[i] )
+        {
+            fr_status_v[i] = 0;
+            continue;
+        }
+
+#if defined ( _OPENMP )
+        short * buffer_p = &m_threadBuffer_p[omp_get_thread_num()][0];
+#else
+        short * buffer_p = &m_threadBuffer_p[0][0];
+#endif
+        bool ok_b = trackPoint ( f_prevPyr_v,
+                                 f_currPyr_v,
+                                 maxLevel_i,
+                                 f_prevPts_v[i],
+                                 fr_currPts_v[i],
+                                 m_useInitialFlow_b,
+                                 &fr_error_v[i],
+                                 buffer_p );
+
+        if ( ok_b && m_fbCheck_b )
+        {
+            cv::Point2f back = fr_currPts_v[i];
+
+            ok_b = trackPoint ( f_currPyr_v,
+                                f_prevPyr_v,
+                                maxLevel_i,
+                                fr_currPts_v[i],
+                                back,
+                                false,
+                                NULL,
+                                buffer_p );
+
+            const float dx_f = back.x - f_prevPts_v[i].x;
+            const float dy_f = back.y - f_prevPts_v[i].y;
+
+            ok_b = ok_b && dx_f * dx_f + dy_f * dy_f <= maxSqFBError_f;
+        }
+
+        fr_status_v[i] = ok_b;
+    }
+
+    return true;
+}
+
+bool
+CLucasKanadeTracker::trackPoint ( const std::vector<cv::Mat> & f_pyrI_v,
+                                  const std::vector<cv::Mat> & f_pyrJ_v,
+                                  int                          f_maxLevel_i,
+                                  cv::Point2f                  f_prevPt,
+                                  cv::Point2f &                fr_nextPt,
+                                  bool                         f_useGuess_b,
+                                  float *                      fr_error_p,
+                                  short *                      fr_buffer_p ) const
+{
+    const int         winSize_i = m_winSize_i;
+    const cv::Point2f halfWin ( (winSize_i-1)*0.5f, (winSize_i-1)*0.5f );
+    const int         maxIter_i = std::min ( std::max ( m_maxIter_i, 0 ), 100 );
+    const float       eps_f     = std::min ( std::max ( m_epsilon_f, 0.f ), 10.f );
+    const float       sqEps_f   = eps_f * eps_f;
+
+    short * const patch_p  = fr_buffer_p;
+    short * const dPatch_p = fr_buffer_p + winSize_i * winSize_i + 4;
+
+    cv::Point2f pt = fr_nextPt;
+    bool ok_b = true;
+    int  w_p[4];
+
+    for (int level = f_maxLevel_i; level >= 0; --level)
+    {
+        const cv::Mat & imgI  = f_pyrI_v[2*level];
+        const cv::Mat & deriv = f_pyrI_v[2*level+1];
+        const cv::Mat & imgJ  = f_pyrJ_v[2*level];
+        const float     scale_f = 1.f / (1 << level);
+
+        if ( level == f_maxLevel_i )
+            pt = ( f_useGuess_b ? fr_nextPt : f_prevPt ) * scale_f;
+        else
+            pt = pt * 2.f;
+
+        cv::Point2f prevPt = f_prevPt * scale_f - halfWin;
+        const int   ix_i   = cvFloor ( prevPt.x );
+        const int   iy_i   = cvFloor ( prevPt.y );
+
+        if ( ix_i < -winSize_i || ix_i >= imgI.cols ||
+             iy_i < -winSize_i || iy_i >= imgI.rows )
+        {
+            if ( level == 0 )
+            {
+                ok_b = false;
+                if ( fr_error_p ) *fr_error_p = 0;
+            }
+            continue;
+        }
+
+        bilinearWeights ( prevPt.x - ix_i, prevPt.y - iy_i, w_p );
+
+        float a11_f, a12_f, a22_f;
+        samplePatch ( imgI, deriv, ix_i, iy_i, w_p, winSize_i,
+                      patch_p, dPatch_p, a11_f, a12_f, a22_f );
+
+        const float det_f    = a11_f * a22_f - a12_f * a12_f;
+        const float minEig_f = ( a22_f + a11_f - sqrtf( (a11_f-a22_f)*(a11_f-a22_f) + 4.f*a12_f*a12_f ) ) /
+                               ( 2 * winSize_i * winSize_i );
+
+        if ( minEig_f < m_minEigenvalue_f || det_f < FLT_EPSILON )
+        {
+            if ( level == 0 )
+                ok_b = false;
+            continue;
+        }
+
+        const float invDet_f = 1.f / det_f;
+
+        cv::Point2f nextPt = pt - halfWin;
+        cv::Point2f prevDelta;
+
+        /// Iterate until convergence or oscillation.
+        for (int j = 0; j < maxIter_i; ++j)
+        {
+            const int jx_i = cvFloor ( nextPt.x );
+            const int jy_i = cvFloor ( nextPt.y );
+
+            if ( jx_i < -winSize_i || jx_i >= imgJ.cols ||
+                 jy_i < -winSize_i || jy_i >= imgJ.rows )
+            {
+                if ( level == 0 )
+                    ok_b = false;
+                break;
+            }
+
+            bilinearWeights ( nextPt.x - jx_i, nextPt.y - jy_i, w_p );
+
+            float b1_f, b2_f;
+            computeMismatch ( imgJ, jx_i, jy_i, w_p, winSize_i,
+                              patch_p, dPatch_p, b1_f, b2_f );
+
+            const cv::Point2f delta ( (a12_f * b2_f - a22_f * b1_f) * invDet_f,
+                                      (a12_f * b1_f - a11_f * b2_f) * invDet_f );
+
+            nextPt += delta;
+            pt = nextPt + halfWin;
+
+            if ( delta.x * delta.x + delta.y * delta.y <= sqEps_f )
+                break;
+
+            if ( j > 0 &&
+                 fabs ( delta.x + prevDelta.x ) < 0.01f &&
+                 fabs ( delta.y + prevDelta.y ) < 0.01f )
+            {
+                pt -= delta * 0.5f;
+                break;
+            }
+
+            prevDelta = delta;
+        }
+
+        if ( ok_b && level == 0 && fr_error_p )
+        {
+            const cv::Point2f nextPoint = pt - halfWin;
+            const int jx_i = cvFloor ( nextPoint.x );
+            const int jy_i = cvFloor ( nextPoint.y );
+
+            if ( jx_i < -winSize_i || jx_i >= imgJ.cols ||
+                 jy_i < -winSize_i || jy_i >= imgJ.rows )
+            {
+                ok_b = false;
+            }
+            else
+            {
+                bilinearWeights ( nextPoint.x - jx_i, nextPoint.y - jy_i, w_p );
+                *fr_error_p = computeError ( imgJ, jx_i, jy_i, w_p, winSize_i, patch_p );
+            }
+        }
+    }
+
+    fr_nextPt = pt;
+
+    return ok_b;
+}
+
+bool
+CLucasKanadeTracker::setWindowSize ( int f_size_i )
+{
+    if ( f_size_i < 3 )
+        return false;
+
+    m_winSize_i = f_size_i;
+    return true;
+}
+
+int
+CLucasKanadeTracker::getWindowSize ( ) const
+{
+    return m_winSize_i;
+}
+
+bool
+CLucasKanadeTracker::setMaxLevel ( int f_level_i )
+{
+    if ( f_level_i < 0 )
+        return false;
+
+    m_maxLevel_i = f_level_i;
+    return true;
+}
+
+int
+CLucasKanadeTracker::getMaxLevel ( ) const
+{
+    return m_maxLevel_i;
+}
+
+bool
+CLucasKanadeTracker::setMaxIterations ( int f_count_i )
+{
+    if ( f_count_i < 0 )
+        return false;
+
+    m_maxIter_i = f_count_i;
+    return true;
+}
+
+int
+CLucasKanadeTracker::getMaxIterations ( ) const
+{
+    return m_maxIter_i;
+}
+
+bool
+CLucasKanadeTracker::setEpsilon ( float f_epsilon_f )
+{
+    if ( f_epsilon_f < 0 )
+        return false;
+
+    m_epsilon_f = f_epsilon_f;
+    return true;
+}
+
+float
+CLucasKanadeTracker::getEpsilon ( ) const
+{
+    return m_epsilon_f;
+}
+
+bool
+CLucasKanadeTracker::setUseInitialFlow ( bool f_val_b )
+{
+    m_useInitialFlow_b = f_val_b;
+    return true;
+}
+
+bool
+CLucasKanadeTracker::getUseInitialFlow ( ) const
+{
+    return m_useInitialFlow_b;
+}
+
+bool
+CLucasKanadeTracker::setMinEigenvalue ( float f_val_f )
+{
+    m_minEigenvalue_f = f_val_f;
+    return true;
+}
+
+float
+CLucasKanadeTracker::getMinEigenvalue ( ) const
+{
+    return m_minEigenvalue_f;
+}
+
+bool
+CLucasKanadeTracker::setForwardBackwardCheck ( bool f_val_b )
+{
+    m_fbCheck_b = f_val_b;
+    return true;
+}
+
+bool
+CLucasKanadeTracker::getForwardBackwardCheck ( ) const
+{
+    return m_fbCheck_b;
+}
+
+bool
+CLucasKanadeTracker::setMaxForwardBackwardError ( float f_dist_f )
+{
+    if ( f_dist_f < 0 )
+        return false;
+
+    m_maxFBError_f = f_dist_f;
+    return true;
+}
+
+float
+CLucasKanadeTracker::getMaxForwardBackwardError ( ) const
+{
+    return m_maxFBError_f;
+}
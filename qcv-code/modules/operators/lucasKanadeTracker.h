@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2012 Hernan Badino <hernan.badino@gmail.com>
+ *
+ * This file is part of QCV
+ *
+ * QCV is under the terms of the GNU Lesser General Public License
+ * version 2.1. See the GNU LGPL version 2.1 for details.
+ * QCV is distributed "AS IS" without ANY WARRANTY, without even the
+ * implied warranty of merchantability or fitness for a particular
+ * purpose.
+ *
+ * In no event shall the authors or contributors be liable
+ * for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages arising in any way out of the use of this
+ * software.
+ *
+ * By downloading, copying, installing or using the software you agree
+ * to this license. Do not download, install, copy or use the
+ * software, if you do not agree to this license.
+ */
+
+#ifndef __LUCASKANADETRACKER_H
+#define __LUCASKANADETRACKER_H
+
+/**
+ *******************************************************************************
+ *
+ * @file lucasKanadeTracker.h
+ *
+ * \class CLucasKanadeTracker
+ * \author Hernan Badino (hernan.badino@gmail.com)
+ *
+ * \brief Pyramidal Lucas-Kanade feature tracker.
+ *
+ * Pyramidal Lucas-Kanade tracker working on pyramids built with
+ * cv::buildOpticalFlowPyramid with derivatives (image and Scharr
+ * derivatives for each level, with a border of at least the window
+ * size). Bilinear sampling is done in 14 bit fixed point as in the
+ * OpenCV implementation. Features are tracked in parallel and an optional
+ * forward-backward consistency check is performed for each feature
+ * right after tracking it.
+ *
+ *******************************************************************************/
+
+/* INCLUDES */
+#include <vector>
+#include <opencv/cv.h>
+
+/* CONSTANTS */
+#define LKT_MAX_CORES 8
+
+namespace QCV
+{
+    class CLucasKanadeTracker
+    {
+    /// Constructors/Destructor
+    public:
+        CLucasKanadeTracker();
+
+        virtual ~CLucasKanadeTracker();
+
+    /// Operations
+    public:
+        /// Track the points from the previous to the current pyramid. If
+        /// the initial flow is used, fr_currPts_v must contain the initial
+        /// estimates. Points with a zero entry in the optional mask are
+        /// not tracked and get a zero status.
+        bool    track ( const std::vector<cv::Mat> &           f_prevPyr_v,
+                        const std::vector<cv::Mat> &           f_currPyr_v,
+                        const std::vector<cv::Point2f> &       f_prevPts_v,
+                        std::vector<cv::Point2f> &             fr_currPts_v,
+                        std::vector<unsigned char> &           fr_status_v,
+                        std::vector<float> &                   fr_error_v,
+                        const std::vector<unsigned char> *     f_mask_p = NULL );
+
+    /// Sets and Gets
+    public:
+        bool        setWindowSize ( int f_size_i );
+        int         getWindowSize ( ) const;
+
+        bool        setMaxLevel ( int f_level_i );
+        int         getMaxLevel ( ) const;
+
+        bool        setMaxIterations ( int f_count_i );
+        int         getMaxIterations ( ) const;
+
+        bool        setEpsilon ( float f_epsilon_f );
+        float       getEpsilon ( ) const;
+
+        bool        setUseInitialFlow ( bool f_val_b );
+        bool        getUseInitialFlow ( ) const;
+
+        /// Min eigenvalue of the normalized spatial gradient matrix.
+        bool        setMinEigenvalue ( float f_val_f );
+        float       getMinEigenvalue ( ) const;
+
+        /// Track back each feature and reject it if it does not return
+        /// close to the starting position.
+        bool        setForwardBackwardCheck ( bool f_val_b );
+        bool        getForwardBackwardCheck ( ) const;
+
+        bool        setMaxForwardBackwardError ( float f_dist_f );
+        float       getMaxForwardBackwardError ( ) const;
+
+    /// Help functions
+    protected:
+        /// Track a single point from pyramid I to pyramid J. fr_nextPt
+        /// contains the initial estimate if f_useGuess_b is true. Returns
+        /// false if the point was lost.
+        bool    trackPoint ( const std::vector<cv::Mat> & f_pyrI_v,
+                             const std::vector<cv::Mat> & f_pyrJ_v,
+                             int                          f_maxLevel_i,
+                             cv::Point2f                  f_prevPt,
+                             cv::Point2f &                fr_nextPt,
+                             bool                         f_useGuess_b,
+                             float *                      fr_error_p,
+                             short *                      fr_buffer_p ) const;
+
+        /// Check format and border of the pyramids and return the number
+        /// of usable levels.
+        int     getUsableLevels ( const std::vector<cv::Mat> & f_pyr_v ) const;
+
+    private:
+        /// Window size.
+        int                  m_winSize_i;
+
+        /// Max pyramid level.
+        int                  m_maxLevel_i;
+
+        /// Max number of iterations per level.
+        int                  m_maxIter_i;
+
+        /// Min update to stop the iterations [px].
+        float                m_epsilon_f;
+
+        /// Use the input current points as initial estimates?
+        bool                 m_useInitialFlow_b;
+
+        /// Min eigenvalue.
+        float                m_minEigenvalue_f;
+
+        /// Forward-backward check?
+        bool                 m_fbCheck_b;
+
+        /// Max forward-backward distance [px].
+        float                m_maxFBError_f;
+
+        /// Per thread image and derivative patches.
+        std::vector<short>   m_threadBuffer_p[LKT_MAX_CORES];
+    };
+}
+
+
+#endif // __LUCASKANADETRACKER_H
@@ -180,14 +180,14 @@ CMonoTrackerOp::cycle()
        /// Convert to gray scale if in RGB format.
        if ( img0.type() == CV_8UC3 )
        {
-          cvtColor(img0, m_scaledImage0, CV_BGR2GRAY);
+          m_scaledImage0 = getDerivedImage ( CDerivedImageCache::SImageDesc ( "Image 0" ).gray() );
           registerOutput<cv::Mat>("Image 0", &m_scaledImage0);
        }
 
        /// Convert to gray scale if in RGB format.
        if ( img1.type() == CV_8UC3 )
        {
-          cvtColor(img1, m_scaledImage1, CV_BGR2GRAY);
+          m_scaledImage1 = getDerivedImage ( CDerivedImageCache::SImageDesc ( "Image 1" ).gray() );
           registerOutput<cv::Mat>("Image 1", &m_scaledImage1);
        }
 
@@ -206,6 +206,11 @@ CMonoTrackerOp::cycle()
              cv::Rect roi (img0.cols/2.f-newWidth_f/2.f, std::max(img0.rows/2.f-newHeight_f/2.f, 0.f), 
                            newWidth_f, newHeight_f );
              
+             /// The outputs might share data with img0 and img1 or with
+             /// the derived image cache. Write into new images.
+             m_scaledImage0.release();
+             m_scaledImage1.release();
+
              if (m_resizeToOrigSize_b && !m_scaleHorOnly_b)
              {
                 cv::resize(img0(roi), m_scaledImage0, img0.size());
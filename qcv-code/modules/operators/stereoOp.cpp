@@ -41,6 +41,7 @@
 #include "imgScalerOp.h"
 #include "matVector.h"
 #include "stereoCamera.h"
+#include "medianFilter.h"
 
 using namespace QCV;
 
@@ -64,6 +65,7 @@ CStereoOp::CStereoOp ( COperator * const f_parent_p,
                                S2D<float> ( 0, 400 ) ),
       m_scale_i (                                  2 ),
       m_convert2Float_b (                      false ),
+      m_medianFilterSize_i (                       1 ),
       m_3DPointImg (                                 ),
       m_show3D_b (                              true )
 {
@@ -135,6 +137,14 @@ CStereoOp::registerParameters()
                         Downscale,
                         CStereoOp );
 
+    ADD_INT_PARAMETER ( "Median Filter Size",
+                        "Kernel size of the median filter applied to the disparity "
+                        "image at the computed resolution (1: no filter).",
+                        m_medianFilterSize_i,
+                        this,
+                        MedianFilterSize,
+                        CStereoOp );
+
     BEGIN_PARAMETER_GROUP("SGBM", false, SRgb(220,0,0));
 
       ADD_INT_PARAMETER ( "Number Of Disparities SGBM",
@@ -319,7 +329,7 @@ CStereoOp::registerParameters()
 
         addDrawingListParameter ( "B/W Disparity Image", "Fast rendering of disparity image" );
 
-        addDrawingListParameter ( "Colored Disparity Image", "Colorfull but slow" );
+        addDrawingListParameter ( "Colored Disparity Image", "Color encoded disparity image" );
 
         m_dispCE.setColorEncodingType ( CColorEncoding::CET_GREEN2RED );
         addColorEncodingParameter (  m_dispCE,
@@ -479,6 +489,13 @@ CStereoOp::cycle()
                 }
             }
         
+            /// Filter at the computed resolution, before upscaling.
+            if ( m_medianFilterSize_i > 1 )
+            {
+                cv::Mat & computed = m_scale_i > 1 ? m_auxImg : m_dispImg;
+                CMedianFilter::filter2D ( computed, computed, m_medianFilterSize_i | 1 );
+            }
+
             if (m_scale_i != 1)
             {
                 registerOutput<cv::Mat> ( std::string("Downscaled " + m_dispImgId_str), 
@@ -490,7 +507,6 @@ CStereoOp::cycle()
             else // Set the original-sized image as output
                 registerOutput<cv::Mat> ( std::string("Downscaled " + m_dispImgId_str), 
                                           &m_dispImg );
-               
 
             if ( m_convert2Float_b )
             {
@@ -538,7 +554,8 @@ bool CStereoOp::show()
 
     list_p = getDrawingList ( "Colored Disparity Image");
     list_p -> clear();    
-    list_p->addColorEncImage ( &m_dispImg, m_dispCE, 0, 0, getScreenSize().width, getScreenSize().height );
+    if (list_p -> isVisible() )
+        list_p->addColorEncImage ( &m_dispImg, m_dispCE, 0, 0, getScreenSize().width, getScreenSize().height );
 
     list_p = getDrawingList ( "B/W Disparity Image");
     list_p -> clear();    
@@ -153,6 +153,7 @@ namespace QCV
         ADD_PARAM_ACCESS         (EStereoAlgorithm,  m_alg_e,           StereoAlgorithm );
         ADD_PARAM_ACCESS_BOUNDED (int,               m_scale_i,         Downscale, 1, 6 );
         ADD_PARAM_ACCESS         (bool,              m_convert2Float_b, ConvertDispImg2Float );
+        ADD_PARAM_ACCESS_BOUNDED (int,               m_medianFilterSize_i, MedianFilterSize, 1, 11 );
         ADD_PARAM_ACCESS         (bool,              m_compute_b,       Compute );
 
         ADD_PARAM_ACCESS         (bool,              m_show3D_b,        Show3DMesh );
@@ -257,6 +258,9 @@ namespace QCV
         /// Convert disparity image to float?
         bool                        m_convert2Float_b;
 
+        /// Median filter kernel size for the disparity image.
+        int                         m_medianFilterSize_i;
+
         /// For 3D point mesh
         cv::Mat                     m_3DPointImg;
 
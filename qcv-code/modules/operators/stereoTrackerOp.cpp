@@ -67,6 +67,14 @@ CStereoTrackerOp::CStereoTrackerOp ( COperator * const f_parent_p,
       m_scaledImage1 (                               ),
       m_scaledImage2 (                               ),
       m_scaledImage3 (                               ),
+      m_rectLut0_p (                            NULL ),
+      m_rectLut1_p (                            NULL ),
+      m_rectOffset (                          0., 0. ),
+      m_rectScale (                           1., 1. ),
+      m_composedLut0 (                               ),
+      m_composedLut1 (                               ),
+      m_rectImage0 (                                 ),
+      m_rectImage1 (                                 ),
       m_unifiedFeatureVector (                       ),
       m_cropTopLeft (                         -1, -1 ),
       m_cropBottomRight (                     -1, -1 ),
@@ -172,6 +180,29 @@ CStereoTrackerOp::registerParameters(  )
     END_PARAMETER_GROUP;
 }
 
+/// Append a scale to the crop and scale transformation from the
+/// rectified images.
+static void scaleTransform ( const cv::Size & f_newSize,
+                             S2D<double> &    fr_scale,
+                             cv::Size &       fr_size )
+{
+    fr_scale.x *= f_newSize.width  / (double) fr_size.width;
+    fr_scale.y *= f_newSize.height / (double) fr_size.height;
+    fr_size     = f_newSize;
+}
+
+/// Append a crop to the crop and scale transformation from the
+/// rectified images.
+static void cropTransform ( const cv::Rect &    f_roi,
+                            S2D<double> &       fr_offset,
+                            const S2D<double> & f_scale,
+                            cv::Size &          fr_size )
+{
+    fr_offset.x += f_roi.x / f_scale.x;
+    fr_offset.y += f_roi.y / f_scale.y;
+    fr_size      = f_roi.size();
+}
+
 /// Virtual destructor.
 CStereoTrackerOp::~CStereoTrackerOp ()
 {
@@ -189,36 +220,65 @@ CStereoTrackerOp::cycle()
         cv::Mat imgRef =  getInput<cv::Mat>("Image 0", cv::Mat() );
         cv::Size refSize = imgRef.size();
 
+        /// If rectification LUTs are given, the input images are not
+        /// rectified. The scaling, fov and crop below are then only
+        /// accumulated and composed with the LUTs, so that a single
+        /// remap produces the output images.
+        CImgRemapper * lut0_p = getInput<CImgRemapper> ( "Image 0 Rectification LUT" );
+        CImgRemapper * lut1_p = getInput<CImgRemapper> ( "Image 1 Rectification LUT" );
+        const bool composed_b = lut0_p && lut1_p && refSize.width > 0;
+
+        /// Crop and scale from the rectified to the output images.
+        S2D<double> offset ( 0., 0. );
+        S2D<double> scale  ( 1., 1. );
+        cv::Size    size;
+
+        if ( composed_b )
+        {
+            refSize = lut0_p -> getOutputSize();
+            size    = refSize;
+        }
+
         registerOutput<CStereoCamera> ( "Rectified Camera", &m_camera );
 
         if (refSize.width > 0)
         {
-            // Scale images if required.
-            COperator::cycle(m_scaler_p);
-       
-            CMatVector * matVector_p = getInput<CMatVector>("Scaled Images");
-
-            if ( !matVector_p )
+            if ( composed_b )
             {
-                m_scaledImage2 =  getInput<cv::Mat>("Image 0", cv::Mat() );
-                m_scaledImage3 =  getInput<cv::Mat>("Image 1", cv::Mat() );
+                if ( m_scaler_p -> getCompute() )
+                    scaleTransform ( m_scaler_p -> getOutputSize ( size ), scale, size );
             }
             else
             {
-                if (matVector_p->size() >= 2)
+                // Scale images if required.
+                COperator::cycle(m_scaler_p);
+       
+                CMatVector * matVector_p = getInput<CMatVector>("Scaled Images");
+
+                if ( !matVector_p )
                 {
-                    m_scaledImage2 =  (*matVector_p)[0];
-                    m_scaledImage3 =  (*matVector_p)[1];
+                    m_scaledImage2 =  getInput<cv::Mat>("Image 0", cv::Mat() );
+                    m_scaledImage3 =  getInput<cv::Mat>("Image 1", cv::Mat() );
+                }
+                else
+                {
+                    if (matVector_p->size() >= 2)
+                    {
+                        m_scaledImage2 =  (*matVector_p)[0];
+                        m_scaledImage3 =  (*matVector_p)[1];
+                    }
                 }
-            }
        
-            registerOutput<cv::Mat>("Image 0", &m_scaledImage2);
-            registerOutput<cv::Mat>("Image 1", &m_scaledImage3);
+                registerOutput<cv::Mat>("Image 0", &m_scaledImage2);
+                registerOutput<cv::Mat>("Image 1", &m_scaledImage3);
 
-            if (m_scaledImage2.cols > 0)
+                size = m_scaledImage2.size();
+            }
+
+            if (size.width > 0)
             {
-                const float aspX_f = m_scaledImage2.cols / (float) refSize.width;
-                const float aspY_f = m_scaledImage2.rows / (float) refSize.height;
+                const float aspX_f = size.width  / (float) refSize.width;
+                const float aspY_f = size.height / (float) refSize.height;
 
                 if (aspX_f != 1)
                     m_camera.scale(aspX_f);
@@ -236,51 +296,74 @@ CStereoTrackerOp::cycle()
        /// Convert to gray scale if in RGB format.
        if ( img0.type() != CV_8UC1 )
        {
-          cvtColor(img0, m_scaledImage0, CV_BGR2GRAY);
+          m_scaledImage0 = getDerivedImage ( CDerivedImageCache::SImageDesc ( "Image 0" ).gray() );
           registerOutput<cv::Mat>("Image 0", &m_scaledImage0);
        }
 
        /// Convert to gray scale if in RGB format.
        if ( img1.type() != CV_8UC1 )
        {
-          cvtColor(img1, m_scaledImage1, CV_BGR2GRAY);
+          m_scaledImage1 = getDerivedImage ( CDerivedImageCache::SImageDesc ( "Image 1" ).gray() );
           registerOutput<cv::Mat>("Image 1", &m_scaledImage1);
        }
 
        img0 =  getInput<cv::Mat>("Image 0", cv::Mat() );
        img1 =  getInput<cv::Mat>("Image 1", cv::Mat() );
-       if (img0.cols > 0 && img1.cols > 0 && m_fovScale_f < 1.f)
+
+       if ( !composed_b )
+          size = img0.size();
+       
+       if (size.width > 0 && img1.cols > 0 && m_fovScale_f < 1.f)
        {
-          float fov_f       = atan(img0.cols/(2*m_origCamera.getFocalLength()));
+          float fov_f       = atan(size.width/(2*m_origCamera.getFocalLength()));
           fov_f            *= m_fovScale_f;
           float newWidth_f  = 2 * m_origCamera.getFocalLength() * tan(fov_f);
 
-          if (fabsf(newWidth_f - img0.cols) > 1.f )
+          if (fabsf(newWidth_f - size.width) > 1.f )
           {
-             float newHeight_f = m_scaleHorOnly_b?img0.rows:img0.rows * newWidth_f/img0.cols;
+             float newHeight_f = m_scaleHorOnly_b?size.height:size.height * newWidth_f/size.width;
              
-             cv::Rect roi (img0.cols/2.f-newWidth_f/2.f, std::max(img0.rows/2.f-newHeight_f/2.f, 0.f), 
+             cv::Rect roi (size.width/2.f-newWidth_f/2.f, std::max(size.height/2.f-newHeight_f/2.f, 0.f), 
                            newWidth_f, newHeight_f );
              
-             if (m_resizeToOrigSize_b && !m_scaleHorOnly_b)
+             if ( composed_b )
              {
-                cv::resize(img0(roi), m_scaledImage0, img0.size());
-                cv::resize(img1(roi), m_scaledImage1, img1.size());
+                const cv::Size origSize = size;
                 
-                m_camera.setFocalLength( img0.cols / (tan(fov_f)*2.f) );
+                cropTransform ( roi, offset, scale, size );
+                
+                if (m_resizeToOrigSize_b && !m_scaleHorOnly_b)
+                   scaleTransform ( origSize, scale, size );
+             }
+             else
+             {
+                /// The outputs might share data with img0 and img1 or with
+                /// the derived image cache. Write into new images.
+                m_scaledImage0.release();
+                m_scaledImage1.release();
+
+                if (m_resizeToOrigSize_b && !m_scaleHorOnly_b)
+                {
+                   cv::resize(img0(roi), m_scaledImage0, img0.size());
+                   cv::resize(img1(roi), m_scaledImage1, img1.size());
+                }
+                else
+                {
+                   img0(roi).copyTo(m_scaledImage0);
+                   img1(roi).copyTo(m_scaledImage1);
+                }
+             
+                registerOutput<cv::Mat>("Image 0", &m_scaledImage0);
+                registerOutput<cv::Mat>("Image 1", &m_scaledImage1);
              }
+
+             if (m_resizeToOrigSize_b && !m_scaleHorOnly_b)
+                m_camera.setFocalLength( size.width / (tan(fov_f)*2.f) );
              else
              {
-                float scale_f = newWidth_f/img0.cols;
-                img0(roi).copyTo(m_scaledImage0);
-                img1(roi).copyTo(m_scaledImage1);
                 m_camera.setU0( m_camera.getU0() - roi.x );
                 m_camera.setV0( m_camera.getV0() - roi.y );
              }
-             
-             registerOutput<cv::Mat>("Image 0", &m_scaledImage0);
-             registerOutput<cv::Mat>("Image 1", &m_scaledImage1);
-
           }
        }
  
@@ -292,27 +375,74 @@ CStereoTrackerOp::cycle()
           cv::Mat img0 =  getInput<cv::Mat>("Image 0", cv::Mat() );
           cv::Mat img1 =  getInput<cv::Mat>("Image 1", cv::Mat() );
 
-            if (img0.cols > 0 && img1.cols > 0)
+          if ( !composed_b )
+             size = img0.size();
+
+            if (size.width > 0 && img1.cols > 0)
             {
-          cv::Point2i topleft  ( m_cropTopLeft.x<0?0:std::min( std::max(m_cropTopLeft.x, 0), img0.cols-1),
-                                 m_cropTopLeft.y<0?0:std::min( std::max(m_cropTopLeft.y, 0), img0.rows-1) );
-          cv::Point2i botright ( m_cropBottomRight.x<0?img0.cols:std::min( std::max(m_cropBottomRight.x, 0), img0.cols),
-                                 m_cropBottomRight.y<0?img0.rows:std::min( std::max(m_cropBottomRight.y, 0), img0.rows) );
+          cv::Point2i topleft  ( m_cropTopLeft.x<0?0:std::min( std::max(m_cropTopLeft.x, 0), size.width-1),
+                                 m_cropTopLeft.y<0?0:std::min( std::max(m_cropTopLeft.y, 0), size.height-1) );
+          cv::Point2i botright ( m_cropBottomRight.x<0?size.width:std::min( std::max(m_cropBottomRight.x, 0), size.width),
+                                 m_cropBottomRight.y<0?size.height:std::min( std::max(m_cropBottomRight.y, 0), size.height) );
           
           if (topleft.x < botright.x && topleft.y < botright.y )
           {
-             m_scaledImage2 = img0(cv::Rect(topleft, botright));
-             m_scaledImage3 = img1(cv::Rect(topleft, botright));
+             if ( composed_b )
+                cropTransform ( cv::Rect(topleft, botright), offset, scale, size );
+             else
+             {
+                m_scaledImage2 = img0(cv::Rect(topleft, botright));
+                m_scaledImage3 = img1(cv::Rect(topleft, botright));
              
+                registerOutput<cv::Mat>("Image 0", &m_scaledImage2);
+                registerOutput<cv::Mat>("Image 1", &m_scaledImage3);
+             }
+
              m_camera.setU0( m_camera.getU0() - topleft.x );
              m_camera.setV0( m_camera.getV0() - topleft.y );
-
-             registerOutput<cv::Mat>("Image 0", &m_scaledImage2);
-             registerOutput<cv::Mat>("Image 1", &m_scaledImage3);
                 }
           }
        }
 
+       if ( composed_b && size.width > 0 && size.height > 0 )
+       {
+          /// Compose the LUTs only if the LUTs or the transformation
+          /// changed.
+          if ( lut0_p != m_rectLut0_p || lut1_p != m_rectLut1_p ||
+               offset.x != m_rectOffset.x || offset.y != m_rectOffset.y ||
+               scale.x  != m_rectScale.x  || scale.y  != m_rectScale.y  ||
+               size != m_rectImage0.size() || img0.type() != m_rectImage0.type() )
+          {
+             const S2D<unsigned int> outSize ( size.width, size.height );
+             
+             m_rectLut0_p = NULL;
+             m_rectLut1_p = NULL;
+
+             if ( m_composedLut0.compose ( *lut0_p, offset, scale, outSize ) &&
+                  m_composedLut1.compose ( *lut1_p, offset, scale, outSize ) )
+             {
+                m_rectLut0_p = lut0_p;
+                m_rectLut1_p = lut1_p;
+                m_rectOffset = offset;
+                m_rectScale  = scale;
+             }
+
+             /// Pixels without source keep this value.
+             m_rectImage0.create ( size, img0.type() );
+             m_rectImage1.create ( size, img1.type() );
+             m_rectImage0.setTo ( cv::Scalar::all(0) );
+             m_rectImage1.setTo ( cv::Scalar::all(0) );
+          }
+
+          if ( m_rectLut0_p && 
+               CImgRemapper::remapPair ( m_composedLut0, img0, m_rectImage0,
+                                         m_composedLut1, img1, m_rectImage1 ) )
+          {
+             registerOutput<cv::Mat>("Image 0", &m_rectImage0);
+             registerOutput<cv::Mat>("Image 1", &m_rectImage1);
+          }
+       }
+
        m_camera.setU0( m_camera.getU0() + m_centralPointOffset.x );
        m_camera.setV0( m_camera.getV0() + m_centralPointOffset.y );
        registerOutput<CStereoCamera> ( "Rectified Camera", &m_camera );
@@ -46,6 +46,7 @@
 #include "matVector.h"
 #include "stereoCamera.h"
 #include "imgScalerOp.h"
+#include "imgRemapper.h"
 
 #include "feature.h"
 /* PROTOTYPES */
@@ -159,6 +160,30 @@ namespace QCV
         /// Scaled images
         cv::Mat                     m_scaledImage3;         
 
+        /// Rectification LUTs of the composed LUTs.
+        const CImgRemapper *        m_rectLut0_p;
+
+        /// Rectification LUTs of the composed LUTs.
+        const CImgRemapper *        m_rectLut1_p;
+
+        /// Crop offset of the composed LUTs.
+        S2D<double>                 m_rectOffset;
+
+        /// Scale of the composed LUTs.
+        S2D<double>                 m_rectScale;
+
+        /// Rectification LUTs composed with the scaling and cropping.
+        CImgRemapper                m_composedLut0;
+
+        /// Rectification LUTs composed with the scaling and cropping.
+        CImgRemapper                m_composedLut1;
+
+        /// Rectified, scaled and cropped images.
+        cv::Mat                     m_rectImage0;
+
+        /// Rectified, scaled and cropped images.
+        cv::Mat                     m_rectImage1;
+
         /// Unified feature vector
         CFeatureVector              m_unifiedFeatureVector;
  
@@ -32,11 +32,13 @@
 #include "drawingList.h"
 #include "clock.h"
 #include "displayStateParam.h"
+#include "glTexturePool.h"
 
 using namespace QCV;
 
 CDrawingListHandler    COperator::m_drawingListHandler;
 CClockHandler          COperator::m_clockHandler;
+CDerivedImageCache     COperator::m_derivedImageCache;
 CGLViewer *            COperator::m_3dViewer_p = NULL;
 
 COperator::COperator (  COperator * const f_parent_p /* = NULL */, 
@@ -414,6 +416,22 @@ COperator::clearIOMap ( )
     }
 
     m_ios.erase( m_ios.begin(), m_ios.end() );
+
+    /// The inputs of the frame are released, and so are the images 
+    /// derived from them. Images displayed from now on are new.
+    if ( m_parent_p == NULL )
+    {
+        m_derivedImageCache.clear();
+        CGLTexturePool::newGeneration();
+    }
+}
+
+/// Get an image derived from an input image.
+cv::Mat
+COperator::getDerivedImage ( const CDerivedImageCache::SImageDesc & f_desc ) const
+{
+    return m_derivedImageCache.get ( f_desc, 
+                                     getInput<cv::Mat> ( f_desc.imageId_str, cv::Mat() ) );
 }
 
 
@@ -66,6 +66,7 @@
 
 #include "drawingListHandler.h"
 #include "clockHandler.h"
+#include "derivedImageCache.h"
 
 #if defined HAVE_QGLVIEWER
 #include "glViewer.h"
@@ -245,6 +246,12 @@ namespace QCV
         const _T &        getInput ( const std::string &f_id_str,
                                      const _T          &f_default ) const;
 
+        /// Get an image derived from an input image (gray scale, 
+        /// pyramid level, pre-filtered). Derived images are computed once
+        /// per frame on the first request and shared by all operators. The
+        /// returned image must not be modified.
+        cv::Mat           getDerivedImage ( const CDerivedImageCache::SImageDesc & f_desc ) const;
+
 
     /// Parameter handling.
     public:
@@ -309,6 +316,9 @@ namespace QCV
         /// Drawing handler
         static CClockHandler              m_clockHandler;
 
+        /// Images derived from the inputs of the current frame.
+        static CDerivedImageCache         m_derivedImageCache;
+
         /// Plots handling.
         /// to be implemented.
 
@@ -51,6 +51,9 @@ CPolygonList::add ( const CPolygonList &f_otherList )
     m_polygon_v.insert( m_polygon_v.begin(), 
                         f_otherList.m_polygon_v.begin(),
                         f_otherList.m_polygon_v.end() );
+
+    m_batch.addFront ( f_otherList.m_batch );
+
     return true;
 }
 
@@ -73,6 +76,9 @@ CPolygonList::add ( const std::vector< S2D<float> > & f_vector,
                                 f_vector.begin(), 
                                 f_vector.end());
 
+    if ( !f_vector.empty() )
+        m_batch.addLineLoop ( &f_vector[0], f_vector.size(), f_color, f_lineWidth_f );
+
     return true;
 }
 
@@ -94,7 +100,16 @@ CPolygonList::add (  const std::vector< S2D<float> > & f_vector,
     newPolygon.vertex_v.insert( newPolygon.vertex_v.end(), 
                                 f_vector.begin(), 
                                 f_vector.end());
-    
+
+    if ( !f_vector.empty() )
+    {
+        /// If not complete transparent.
+        if ( f_fillColor.a != 0 )
+            m_batch.addFill ( &f_vector[0], f_vector.size(), f_fillColor );
+
+        m_batch.addLineLoop ( &f_vector[0], f_vector.size(), f_outLineColor, f_lineWidth_f );
+    }
+
     return true;
 }
 
@@ -103,6 +118,7 @@ bool
 CPolygonList::clear ()
 {
     m_polygon_v.clear();
+    m_batch.clear();
     return m_polygon_v.size();
 }
 
@@ -110,45 +126,7 @@ CPolygonList::clear ()
 bool
 CPolygonList::show () const
 {
-    std::vector< SPolygon >::const_iterator last = m_polygon_v.end();
-
-    for (std::vector< SPolygon >::const_iterator i = m_polygon_v.begin(); 
-         i != last; ++i )
-    {
-        glLineWidth( i->lineWidth_f );
-        
-        /// If not complete transparent.
-        if ( i->fillColor.a != 0 )
-        {
-            glColor4ub( i->fillColor.r, 
-                        i->fillColor.g, 
-                        i->fillColor.b, 
-                        i->fillColor.a );
-            
-            glBegin(GL_POLYGON);
-
-            for (unsigned int v = 0; v < i->vertex_v.size(); ++v )
-                glVertex2f ( i->vertex_v[v].x, 
-                             i->vertex_v[v].y );
-            glEnd();
-        }       
-
-        glColor4ub( i->outlineColor.r, 
-                    i->outlineColor.g, 
-                    i->outlineColor.b, 
-                    i->outlineColor.a );
-        
-        glBegin ( GL_LINE_LOOP ) ;
-
-        for (unsigned int v = 0; v < i->vertex_v.size(); ++v )
-            glVertex2f ( i->vertex_v[v].x, 
-                         i->vertex_v[v].y );
-        glEnd();
-
-    }
-
-    /// Todo: Check GL status and return value.
-    return true;
+    return m_batch.show();
 }
 
 bool
@@ -44,6 +44,7 @@
 /* INCLUDES */
 #include "drawingElementList.h"
 #include "colors.h"
+#include "glVertexBatch.h"
 #include "standardTypes.h"
 
 #include <vector>
@@ -120,6 +121,9 @@ namespace QCV
         /// Private Members
     private:
         std::vector<SPolygon>    m_polygon_v;
+
+        /// Vertices of the polygons for drawing.
+        CGLVertexBatch           m_batch;
     };
 } // Namespace QCV
 
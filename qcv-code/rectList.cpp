@@ -51,6 +51,9 @@ CRectangleList::add ( const CRectangleList &f_otherList )
     m_rect_v.insert( m_rect_v.begin(), 
                      f_otherList.m_rect_v.begin(),
                      f_otherList.m_rect_v.end() );
+
+    m_batch.addFront ( f_otherList.m_batch );
+
     return true;
 }
 
@@ -78,6 +81,13 @@ CRectangleList::add ( float   f_u1_f,
 
     m_rect_v.push_back(newRect);
 
+    const S2D<float> corners_p[4] = { S2D<float> ( f_u1_f, f_v1_f ),
+                                      S2D<float> ( f_u2_f, f_v1_f ),
+                                      S2D<float> ( f_u2_f, f_v2_f ),
+                                      S2D<float> ( f_u1_f, f_v2_f ) };
+
+    m_batch.addLineLoop ( corners_p, 4, f_color, f_lineWidth_i );
+
     return true;
 }
 
@@ -103,6 +113,17 @@ CRectangleList::add (  float   f_u1_f,
 
     m_rect_v.push_back(newRect);
 
+    const S2D<float> corners_p[4] = { S2D<float> ( f_u1_f, f_v1_f ),
+                                      S2D<float> ( f_u2_f, f_v1_f ),
+                                      S2D<float> ( f_u2_f, f_v2_f ),
+                                      S2D<float> ( f_u1_f, f_v2_f ) };
+
+    /// If not complete transparent.
+    if ( f_fillColor.a != 0 )
+        m_batch.addFill ( corners_p, 4, f_fillColor );
+
+    m_batch.addLineLoop ( corners_p, 4, f_outLineColor, f_lineWidth_i );
+
     return true;
 }
 
@@ -111,6 +132,7 @@ bool
 CRectangleList::clear ()
 {
     m_rect_v.clear();
+    m_batch.clear();
     return m_rect_v.size();
 }
 
@@ -118,45 +140,7 @@ CRectangleList::clear ()
 bool
 CRectangleList::show () const
 {
-    std::vector< SRectangle >::const_iterator last = m_rect_v.end();
-
-    for (std::vector< SRectangle >::const_iterator i = m_rect_v.begin(); 
-         i != last; ++i )
-    {
-        glLineWidth( i->lineWidth_f );
-        
-        /// If not complete transparent.
-        if ( i->fillColor.a != 0 )
-        {
-            glColor4ub( i->fillColor.r, 
-                        i->fillColor.g, 
-                        i->fillColor.b, 
-                        i->fillColor.a );
-            
-            glBegin(GL_POLYGON);
-            glVertex2f ( i->u1_f, i->v1_f );
-            glVertex2f ( i->u2_f, i->v1_f );
-            glVertex2f ( i->u2_f, i->v2_f );
-            glVertex2f ( i->u1_f, i->v2_f );
-            glEnd();
-        }       
-
-        glColor4ub( i->outlineColor.r, 
-                    i->outlineColor.g, 
-                    i->outlineColor.b, 
-                    i->outlineColor.a );
-        
-        glBegin ( GL_LINE_LOOP ) ;
-        glVertex2f ( i->u1_f, i->v1_f );
-        glVertex2f ( i->u2_f, i->v1_f );
-        glVertex2f ( i->u2_f, i->v2_f );
-        glVertex2f ( i->u1_f, i->v2_f );
-        glEnd();
-
-    }
-
-    /// Todo: Check GL status and return value.
-    return true;
+    return m_batch.show();
 }
 
 bool
@@ -44,6 +44,7 @@
 /* INCLUDES */
 #include "drawingElementList.h"
 #include "colors.h"
+#include "glVertexBatch.h"
 
 #include <vector>
 
@@ -128,6 +129,9 @@ namespace QCV
         /// Private Members
     private:
         std::vector<SRectangle>    m_rect_v;
+
+        /// Vertices of the rectangles for drawing.
+        CGLVertexBatch             m_batch;
     };
 } // Namespace QCV
 
@@ -51,6 +51,8 @@ CTriangleList::add ( const CTriangleList &f_otherList )
                          f_otherList.m_triangle_v.begin(),
                          f_otherList.m_triangle_v.end() );
 
+    m_batch.addFront ( f_otherList.m_batch );
+
     return true;
 }
 
@@ -103,6 +105,12 @@ CTriangleList::add ( float          f_u1_f,
     newTriangle.lineWidth_f  = f_lineWidth_i;
 
     m_triangle_v.push_back(newTriangle);
+
+    /// If not complete transparent.
+    if ( newTriangle.fillColor.a != 0 )
+        m_batch.addFill ( newTriangle.vertices, 3, newTriangle.fillColor );
+
+    m_batch.addLineLoop ( newTriangle.vertices, 3, newTriangle.outlineColor, f_lineWidth_i );
     
     return true;
 }
@@ -157,6 +165,12 @@ CTriangleList::add (  float          f_u1_f,
 
     m_triangle_v.push_back(newTriangle);
 
+    /// If not complete transparent.
+    if ( newTriangle.fillColor.a != 0 )
+        m_batch.addFill ( newTriangle.vertices, 3, newTriangle.fillColor );
+
+    m_batch.addLineLoop ( newTriangle.vertices, 3, newTriangle.outlineColor, f_lineWidth_i );
+
     return true;
 }
 
@@ -165,6 +179,7 @@ bool
 CTriangleList::clear ()
 {
     m_triangle_v.clear();
+    m_batch.clear();
     return m_triangle_v.size();
 }
 
@@ -172,43 +187,7 @@ CTriangleList::clear ()
 bool 
 CTriangleList::show () const
 {
-    std::vector< STriangle >::const_iterator last = m_triangle_v.end();
-
-    for (std::vector< STriangle >::const_iterator i = m_triangle_v.begin(); 
-         i != last; ++i )
-    {
-        glLineWidth( i->lineWidth_f );
-        
-        /// If not complete transparent.
-        if ( i->fillColor.a != 0 )
-        {
-            glColor4ub( i->fillColor.r, 
-                        i->fillColor.g, 
-                        i->fillColor.b, 
-                        i->fillColor.a );
-            
-            glBegin(GL_POLYGON);
-            for (int v = 0; v < 3; ++v)
-                glVertex2f ( i->vertices[v].x, 
-                             i->vertices[v].y );
-            glEnd();
-        }       
-
-        glColor4ub( i->outlineColor.r, 
-                    i->outlineColor.g, 
-                    i->outlineColor.b, 
-                    i->outlineColor.a );
-        
-        glBegin ( GL_LINE_LOOP ) ;
-        for (int v = 0; v < 3; ++v)
-            glVertex2f ( i->vertices[v].x, 
-                         i->vertices[v].y );
-        glEnd();
-
-    }
-
-    /// Todo: Check GL status and return value.
-    return true;
+    return m_batch.show();
 }
 
 bool 
@@ -45,6 +45,7 @@
 #include "drawingElementList.h"
 #include "standardTypes.h"
 #include "colors.h"
+#include "glVertexBatch.h"
 
 #include <vector>
 
@@ -144,6 +145,9 @@ namespace QCV
         /// Private Members
     private:
         std::vector<STriangle>    m_triangle_v;
+
+        /// Vertices of the triangles for drawing.
+        CGLVertexBatch            m_batch;
     };
 } // Namespace QCV
 